@@ -7,14 +7,22 @@
 
 #include "app_event.h"
 #include "config.h"
+#include "core/async_io.h"
 #include "core/debug.h"
 #include "core/deferred_job.h"
+#include "core/rt_check.h"
+#include "core/rt_log.h"
+#include "dsp/dsp_ops.h"
 #include "engine/audio_io.h"
+#include "engine/autosave.h"
+#include "engine/clip_render.h"
 #include "engine/engine.h"
+#include "engine/file_index.h"
 #include "engine/project.h"
 #include "gfx/renderer.h"
 #include "path_def.h"
 #include "plughost/plugin_manager.h"
+#include "ui/browser.h"
 #include "ui/command_manager.h"
 #include "ui/control_bar.h"
 #include "ui/controls.h"
@@ -46,8 +54,12 @@ void app_init() {
     std::abort();
   }
 
+  rt_check_init(RtCheckMode::Record);
+  init_rt_log();
   init_app_event();
   init_deferred_job();
+  init_async_io();
+  dsp::init_dsp_ops();
   init_window_manager();
 
   // Initialize imgui
@@ -71,7 +83,26 @@ void app_init() {
   init_windows();
   start_audio_engine();
 
-  g_cmd_manager.init(10);
+  g_cmd_manager.init({
+    .memory_budget = (size_t)g_history_memory_budget_mb << 20,
+    .spill_budget = (size_t)g_history_spill_budget_mb << 20,
+    .spill_path = path_def::history_spill_path,
+  });
+  g_sample_table.compress_samples = g_compress_samples;
+  g_clip_renderer.init((size_t)g_clip_render_budget_mb << 20);
+  g_autosave.init({
+    .directory = path_def::autosave_path,
+    .interval_sec = g_autosave_interval_sec,
+    .num_backups = g_autosave_num_backups,
+  });
+
+  // Library roots are indexed in the background so missing samples can be relocated without scanning
+  if (g_file_index.open(path_def::file_index_path)) {
+    Vector<std::filesystem::path> library_roots;
+    for (const auto& dir : g_browser.directories)
+      library_roots.push_back(*dir.first);
+    g_file_index.refresh_async(library_roots);
+  }
   g_engine.set_bpm(150.0f);
 }
 
@@ -111,6 +142,9 @@ void app_render() {
   }
 
   g_engine.update_audio_visualization(GImGui->IO.Framerate);
+  rt_check_flush();
+  g_autosave.update(g_cmd_manager.num_changes);
+  g_clip_renderer.update(g_engine);
   render_control_bar();
   render_windows();
 
@@ -208,8 +242,12 @@ void app_run_loop() {
 void app_shutdown() {
   wm_close_all_plugin_window();
   save_settings_data();
+  g_autosave.shutdown();
+  g_file_index.close();
   shutdown_windows();
   shutdown_audio_io();
+  g_engine.sample_preview.shutdown();
+  g_clip_renderer.shutdown();
   g_engine.clear_all();
   g_cmd_manager.reset();
   g_sample_table.shutdown();
@@ -218,7 +256,9 @@ void app_shutdown() {
   ImGui_ImplSDL3_Shutdown();
   ImGui::DestroyContext();
   shutdown_window_manager();
+  shutdown_async_io();
   shutdown_deferred_job();
+  shutdown_rt_log();
   SDL_Quit();
 }
 
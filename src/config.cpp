@@ -6,6 +6,7 @@
 
 #include "app_event.h"
 #include "core/debug.h"
+#include "core/deferred_job.h"
 #include "engine/audio_io.h"
 #include "engine/engine.h"
 #include "extern/json.hpp"
@@ -24,6 +25,14 @@ AudioFormat g_audio_output_format{};
 AudioFormat g_audio_input_format{};
 uint32_t g_audio_buffer_size = 128;
 bool g_audio_exclusive_mode = false;
+uint64_t g_audio_thread_cpu_mask = 0;
+uint64_t g_worker_thread_cpu_mask = 0;
+uint32_t g_history_memory_budget_mb = 16;
+uint32_t g_history_spill_budget_mb = 256;
+uint32_t g_autosave_interval_sec = 120;
+uint32_t g_autosave_num_backups = 3;
+bool g_compress_samples = false;
+uint32_t g_clip_render_budget_mb = 1024;
 
 void load_settings_data() {
   Log::info("Loading user settings...");
@@ -87,6 +96,12 @@ void load_settings_data() {
     if (audio.contains("buffer_size")) {
       g_audio_buffer_size = audio["buffer_size"].get<uint32_t>();
     }
+    if (audio.contains("audio_thread_affinity")) {
+      g_audio_thread_cpu_mask = audio["audio_thread_affinity"].get<uint64_t>();
+    }
+    if (audio.contains("worker_thread_affinity")) {
+      g_worker_thread_cpu_mask = audio["worker_thread_affinity"].get<uint64_t>();
+    }
     if (audio.contains("sample_rate")) {
       sample_rate_value = audio["sample_rate"].get<uint32_t>();
       switch (sample_rate_value) {
@@ -101,6 +116,36 @@ void load_settings_data() {
     }
   }
 
+  if (settings.contains("history")) {
+    nlohmann::ordered_json& history = settings["history"];
+    if (history.contains("memory_budget_mb")) {
+      g_history_memory_budget_mb = history["memory_budget_mb"].get<uint32_t>();
+    }
+    if (history.contains("spill_budget_mb")) {
+      g_history_spill_budget_mb = history["spill_budget_mb"].get<uint32_t>();
+    }
+  }
+
+  if (settings.contains("autosave")) {
+    nlohmann::ordered_json& autosave = settings["autosave"];
+    if (autosave.contains("interval_sec")) {
+      g_autosave_interval_sec = autosave["interval_sec"].get<uint32_t>();
+    }
+    if (autosave.contains("num_backups")) {
+      g_autosave_num_backups = autosave["num_backups"].get<uint32_t>();
+    }
+  }
+
+  if (settings.contains("samples")) {
+    nlohmann::ordered_json& samples = settings["samples"];
+    if (samples.contains("compress_in_memory")) {
+      g_compress_samples = samples["compress_in_memory"].get<bool>();
+    }
+    if (samples.contains("render_budget_mb")) {
+      g_clip_render_budget_mb = samples["render_budget_mb"].get<uint32_t>();
+    }
+  }
+
   if (settings.contains("user_dirs")) {
     nlohmann::ordered_json& user_dirs = settings["user_dirs"];
     if (user_dirs.is_array()) {
@@ -179,6 +224,14 @@ void save_settings_data() {
   settings["audio"]["input_device_id"] = g_output_device_properties.id;
   settings["audio"]["buffer_size"] = g_audio_buffer_size;
   settings["audio"]["sample_rate"] = sample_rate_value;
+  settings["audio"]["audio_thread_affinity"] = g_audio_thread_cpu_mask;
+  settings["audio"]["worker_thread_affinity"] = g_worker_thread_cpu_mask;
+  settings["history"]["memory_budget_mb"] = g_history_memory_budget_mb;
+  settings["history"]["spill_budget_mb"] = g_history_spill_budget_mb;
+  settings["autosave"]["interval_sec"] = g_autosave_interval_sec;
+  settings["autosave"]["num_backups"] = g_autosave_num_backups;
+  settings["samples"]["compress_in_memory"] = g_compress_samples;
+  settings["samples"]["render_budget_mb"] = g_clip_render_budget_mb;
 
   std::vector<std::string> user_dirs;
   user_dirs.reserve(g_browser.directories.size());
@@ -222,6 +275,9 @@ void start_audio_engine() {
   g_audio_buffer_size -= g_audio_buffer_size % g_audio_io->buffer_alignment;
 
   g_engine.set_audio_channel_config(2, 2, g_audio_buffer_size, sample_rate_value);
+  g_audio_io->audio_thread_cpu_mask = g_audio_thread_cpu_mask;
+  g_engine.worker_thread_cpu_mask = g_worker_thread_cpu_mask;
+  set_deferred_job_affinity(g_worker_thread_cpu_mask);
   g_audio_io->start(
       &g_engine,
       g_audio_exclusive_mode,
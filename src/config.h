@@ -13,6 +13,14 @@ extern AudioFormat g_audio_output_format;
 extern AudioFormat g_audio_input_format;
 extern uint32_t g_audio_buffer_size;
 extern bool g_audio_exclusive_mode;
+extern uint64_t g_audio_thread_cpu_mask;
+extern uint64_t g_worker_thread_cpu_mask;
+extern uint32_t g_history_memory_budget_mb;
+extern uint32_t g_history_spill_budget_mb;
+extern uint32_t g_autosave_interval_sec;
+extern uint32_t g_autosave_num_backups;
+extern bool g_compress_samples;
+extern uint32_t g_clip_render_budget_mb;  // 0 disables pre-rendering of resampled clips
 
 void load_settings_data();
 void load_default_settings();
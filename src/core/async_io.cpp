@@ -0,0 +1,288 @@
+#include "async_io.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "bit_manipulation.h"
+#include "debug.h"
+#include "deferred_job.h"
+#include "memory.h"
+#include "vector.h"
+
+#ifdef WB_PLATFORM_WINDOWS
+#include <Windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace wb {
+
+AsyncIO* g_async_io;
+
+AsyncFile::~AsyncFile() {
+  close();
+}
+
+#ifdef WB_PLATFORM_WINDOWS
+
+bool AsyncFile::open(const std::filesystem::path& path, uint32_t flags, bool direct) {
+  close();
+  DWORD desired_access = 0;
+  DWORD creation_disposition = OPEN_EXISTING;
+  if (has_bit(flags, IOOpenMode::Read))
+    desired_access |= GENERIC_READ;
+  if (has_bit(flags, IOOpenMode::Write)) {
+    desired_access |= GENERIC_WRITE;
+    creation_disposition = OPEN_ALWAYS;
+  }
+  if (has_bit(flags, IOOpenMode::Truncate))
+    creation_disposition = CREATE_ALWAYS;
+
+  DWORD attributes = FILE_ATTRIBUTE_NORMAL | (direct ? FILE_FLAG_NO_BUFFERING : FILE_FLAG_SEQUENTIAL_SCAN);
+  HANDLE file =
+      CreateFile(path.c_str(), desired_access, FILE_SHARE_READ, nullptr, creation_disposition, attributes, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER file_size{};
+  GetFileSizeEx(file, &file_size);
+  handle_ = (intptr_t)file;
+  size_ = (uint64_t)file_size.QuadPart;
+  direct_ = direct;
+  return true;
+}
+
+void AsyncFile::close() {
+  if (handle_ != -1) {
+    CloseHandle((HANDLE)handle_);
+    handle_ = -1;
+  }
+  size_ = 0;
+  direct_ = false;
+}
+
+static int64_t transfer_sync(const AsyncIORequest* request) {
+  OVERLAPPED overlapped{};
+  overlapped.Offset = (DWORD)request->offset;
+  overlapped.OffsetHigh = (DWORD)(request->offset >> 32);
+  DWORD num_transferred = 0;
+  BOOL ok = request->op == AsyncIOOp::Read
+                ? ReadFile((HANDLE)request->file->handle_, request->buffer, request->size, &num_transferred, &overlapped)
+                : WriteFile((HANDLE)request->file->handle_, request->buffer, request->size, &num_transferred, &overlapped);
+  if (!ok) {
+    DWORD error = GetLastError();
+    return error == ERROR_HANDLE_EOF ? 0 : -(int64_t)error;
+  }
+  return num_transferred;
+}
+
+#else
+
+bool AsyncFile::open(const std::filesystem::path& path, uint32_t flags, bool direct) {
+  close();
+  int open_flags = O_CLOEXEC;
+  if (has_bit(flags, IOOpenMode::Read) && has_bit(flags, IOOpenMode::Write))
+    open_flags |= O_RDWR | O_CREAT;
+  else if (has_bit(flags, IOOpenMode::Write))
+    open_flags |= O_WRONLY | O_CREAT;
+  else
+    open_flags |= O_RDONLY;
+  if (has_bit(flags, IOOpenMode::Truncate))
+    open_flags |= O_TRUNC;
+
+  int fd = -1;
+#ifdef O_DIRECT
+  // tmpfs and some network file systems refuse O_DIRECT
+  if (direct) {
+    fd = ::open(path.c_str(), open_flags | O_DIRECT, 0644);
+    if (fd < 0 && errno != EINVAL)
+      return false;
+  }
+#endif
+  direct_ = fd >= 0;
+  if (fd < 0)
+    fd = ::open(path.c_str(), open_flags, 0644);
+  if (fd < 0)
+    return false;
+#if defined(WB_PLATFORM_MACOS)
+  if (direct)
+    ::fcntl(fd, F_NOCACHE, 1);
+#endif
+
+  struct stat st;
+  size_ = ::fstat(fd, &st) == 0 ? (uint64_t)st.st_size : 0;
+  handle_ = fd;
+  return true;
+}
+
+void AsyncFile::close() {
+  if (handle_ != -1) {
+    ::close((int)handle_);
+    handle_ = -1;
+  }
+  size_ = 0;
+  direct_ = false;
+}
+
+static int64_t transfer_sync(const AsyncIORequest* request) {
+  int fd = (int)request->file->handle_;
+  std::byte* buffer = (std::byte*)request->buffer;
+  uint64_t offset = request->offset;
+  uint32_t remaining = request->size;
+  // Short transfers are continued, only end of file stops a read early
+  while (remaining > 0) {
+    ssize_t ret = request->op == AsyncIOOp::Read ? ::pread(fd, buffer, remaining, (off_t)offset)
+                                                 : ::pwrite(fd, buffer, remaining, (off_t)offset);
+    if (ret < 0) {
+      if (errno == EINTR)
+        continue;
+      return -(int64_t)errno;
+    }
+    if (ret == 0)
+      break;
+    buffer += ret;
+    offset += (uint64_t)ret;
+    remaining -= (uint32_t)ret;
+  }
+  return request->size - remaining;
+}
+
+#endif
+
+// Fallback for systems without io_uring. Every thread runs one blocking transfer at a time.
+struct AsyncIOThreadPool : public AsyncIO {
+  Vector<std::thread> threads;
+  std::deque<AsyncIORequest*> queue;
+  std::mutex mutex;
+  std::condition_variable queue_cv;
+  std::condition_variable slot_cv;
+  std::condition_variable idle_cv;
+  uint32_t max_in_flight = 0;
+  uint32_t in_flight = 0;  // Queued and running requests
+  bool running = false;
+
+  AsyncIOThreadPool(uint32_t queue_depth, uint32_t num_threads) : max_in_flight(queue_depth) {
+    running = true;
+    for (uint32_t i = 0; i < num_threads; i++)
+      threads.push_back(std::thread(&AsyncIOThreadPool::worker_thread_, this));
+  }
+
+  ~AsyncIOThreadPool() {
+    shutdown();
+  }
+
+  const char* get_name() const override {
+    return "Thread pool";
+  }
+
+  void submit(AsyncIORequest* const* requests, uint32_t count) override {
+    std::unique_lock lock(mutex);
+    for (uint32_t i = 0; i < count; i++) {
+      slot_cv.wait(lock, [this] { return in_flight < max_in_flight; });
+      requests[i]->done.store(false, std::memory_order_relaxed);
+      queue.push_back(requests[i]);
+      in_flight++;
+      // Wake a worker right away, batches larger than the queue depth wait for a free slot
+      queue_cv.notify_one();
+    }
+  }
+
+  void wait_idle() override {
+    std::unique_lock lock(mutex);
+    idle_cv.wait(lock, [this] { return in_flight == 0; });
+  }
+
+  void shutdown() override {
+    if (!running)
+      return;
+    wait_idle();
+    {
+      std::lock_guard lock(mutex);
+      running = false;
+    }
+    queue_cv.notify_all();
+    for (auto& thread : threads)
+      thread.join();
+    threads.resize(0);
+  }
+
+  void worker_thread_() {
+    std::unique_lock lock(mutex);
+    while (true) {
+      queue_cv.wait(lock, [this] { return !running || !queue.empty(); });
+      if (!running)
+        break;
+
+      AsyncIORequest* request = queue.front();
+      queue.pop_front();
+      lock.unlock();
+      complete_async_io_request(request, transfer_sync(request));
+      lock.lock();
+      if (--in_flight == 0)
+        idle_cv.notify_all();
+      slot_cv.notify_one();
+    }
+  }
+};
+
+AsyncIO* create_async_io(uint32_t queue_depth, bool allow_io_uring) {
+  if (allow_io_uring) {
+    if (AsyncIO* io = create_async_io_uring(queue_depth))
+      return io;
+  }
+  uint32_t num_threads = math::clamp(std::thread::hardware_concurrency() / 2u, 2u, 8u);
+  return create_async_io_thread_pool(queue_depth, num_threads);
+}
+
+AsyncIO* create_async_io_thread_pool(uint32_t queue_depth, uint32_t num_threads) {
+  return new AsyncIOThreadPool(queue_depth, num_threads);
+}
+
+void* allocate_io_buffer(size_t size) {
+  size_t aligned_size = (size + AsyncIO::direct_alignment - 1) & ~(size_t)(AsyncIO::direct_alignment - 1);
+  return allocate_aligned(aligned_size, AsyncIO::direct_alignment);
+}
+
+void free_io_buffer(void* buffer) {
+  free_aligned(buffer);
+}
+
+static void run_async_io_callback(DeferredJobContext* ctx) {
+  AsyncIORequest* request = (AsyncIORequest*)ctx->userdata0;
+  request->callback(request);
+  request->done.store(true, std::memory_order_release);
+  request->done.notify_all();
+}
+
+void complete_async_io_request(AsyncIORequest* request, int64_t result) {
+  request->result = result;
+  if (request->callback) {
+    if (request->completion == AsyncIOCompletion::DeferredJob) {
+      enqueue_deferred_job(run_async_io_callback, request);
+      return;
+    }
+    request->callback(request);
+  }
+  request->done.store(true, std::memory_order_release);
+  request->done.notify_all();
+}
+
+void init_async_io() {
+  g_async_io = create_async_io(64);
+  Log::info("Async I/O backend: {}", g_async_io->get_name());
+}
+
+void shutdown_async_io() {
+  if (g_async_io == nullptr)
+    return;
+  g_async_io->shutdown();
+  delete g_async_io;
+  g_async_io = nullptr;
+}
+
+}  // namespace wb
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+
+#include "common.h"
+#include "io_types.h"
+
+namespace wb {
+
+enum class AsyncIOOp : uint8_t {
+  Read,
+  Write,
+};
+
+// Where the completion callback of a request runs
+enum class AsyncIOCompletion : uint8_t {
+  Inline,       // On the I/O completion thread, the callback must be short
+  DeferredJob,  // Enqueued on the deferred job thread
+};
+
+struct AsyncIORequest;
+using AsyncIOCallbackFn = void (*)(AsyncIORequest* request);
+
+// File opened for asynchronous I/O. Requests address the file with absolute offsets, there is no file position.
+struct AsyncFile {
+  intptr_t handle_ = -1;
+  uint64_t size_ = 0;
+  bool direct_ = false;
+
+  AsyncFile() = default;
+  AsyncFile(const AsyncFile&) = delete;
+  ~AsyncFile();
+
+  /**
+   * @brief Open a file.
+   *
+   * @param path File path.
+   * @param flags IOOpenMode flags.
+   * @param direct Bypass the page cache for large streaming transfers. Falls back to cached I/O if the file system does
+   * not support it, check is_direct() afterwards.
+   * @return True on success.
+   */
+  bool open(const std::filesystem::path& path, uint32_t flags, bool direct = false);
+  void close();
+
+  inline bool is_open() const {
+    return handle_ != -1;
+  }
+
+  // Offsets, sizes and buffer addresses must be multiples of AsyncIO::direct_alignment
+  inline bool is_direct() const {
+    return direct_;
+  }
+
+  inline uint64_t size() const {
+    return size_;
+  }
+};
+
+struct AsyncIORequest {
+  AsyncIOOp op{};
+  AsyncIOCompletion completion = AsyncIOCompletion::Inline;
+  int32_t buffer_index = -1;  // Registered buffer containing buffer, -1 if the buffer is not registered
+  AsyncFile* file{};
+  uint64_t offset{};
+  void* buffer{};
+  uint32_t size{};
+  AsyncIOCallbackFn callback{};
+  void* userdata{};
+  int64_t result{};     // Number of bytes transferred, or a negative error code
+  std::atomic_bool done;  // Set once the callback has returned, so the callback must not free the request
+
+  // Block until the request has completed
+  inline void wait() const {
+    done.wait(false, std::memory_order_acquire);
+  }
+};
+
+// Asynchronous file I/O service. Requests are submitted in batches and complete in any order, the request must stay
+// alive until it is done. Linux uses io_uring, other systems and kernels without io_uring use a pool of threads
+// running blocking reads and writes.
+struct AsyncIO {
+  static constexpr uint32_t direct_alignment = 4096;
+
+  virtual ~AsyncIO() {
+  }
+
+  virtual const char* get_name() const = 0;
+
+  /**
+   * @brief Register buffers with the kernel so they do not have to be mapped for every request. Requests reading
+   * into a registered buffer set AsyncIORequest::buffer_index. Replaces previously registered buffers.
+   *
+   * @param buffers Buffer addresses.
+   * @param sizes Buffer sizes.
+   * @param count Number of buffers.
+   * @return True if the buffers have been registered.
+   */
+  virtual bool register_buffers(void* const* buffers, const size_t* sizes, uint32_t count) {
+    return true;
+  }
+
+  virtual void unregister_buffers() {
+  }
+
+  /**
+   * @brief Submit a batch of requests. Blocks while the queue is full.
+   *
+   * @param requests Requests to submit.
+   * @param count Number of requests.
+   */
+  virtual void submit(AsyncIORequest* const* requests, uint32_t count) = 0;
+
+  // Wait until every submitted transfer has finished. Callbacks on the deferred job thread may still be pending.
+  virtual void wait_idle() = 0;
+
+  virtual void shutdown() = 0;
+
+  inline void submit(AsyncIORequest* request) {
+    submit(&request, 1);
+  }
+};
+
+/**
+ * @brief Create an I/O service.
+ *
+ * @param queue_depth Maximum number of requests in flight.
+ * @param allow_io_uring Use io_uring if the kernel supports it, otherwise always use the thread pool.
+ * @return The service, never nullptr.
+ */
+AsyncIO* create_async_io(uint32_t queue_depth, bool allow_io_uring = true);
+AsyncIO* create_async_io_uring(uint32_t queue_depth);
+AsyncIO* create_async_io_thread_pool(uint32_t queue_depth, uint32_t num_threads);
+
+void* allocate_io_buffer(size_t size);
+void free_io_buffer(void* buffer);
+
+// Finish a request: store the result, then run the callback or hand it to the deferred job thread.
+void complete_async_io_request(AsyncIORequest* request, int64_t result);
+
+void init_async_io();
+void shutdown_async_io();
+
+extern AsyncIO* g_async_io;
+
+}  // namespace wb
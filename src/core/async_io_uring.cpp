@@ -0,0 +1,351 @@
+#include "async_io.h"
+
+#ifdef WB_PLATFORM_LINUX
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include "debug.h"
+#include "vector.h"
+#endif
+
+namespace wb {
+
+#ifdef WB_PLATFORM_LINUX
+
+// liburing is not required, the rings are set up with the raw system calls
+static int io_uring_setup(uint32_t entries, io_uring_params* params) {
+  return (int)::syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete, uint32_t flags) {
+  return (int)::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static int io_uring_register(int fd, uint32_t opcode, const void* arg, uint32_t nr_args) {
+  return (int)::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+// Submissions are serialized by a mutex, a dedicated thread reaps completions and runs the callbacks.
+struct AsyncIOUring : public AsyncIO {
+  int ring_fd = -1;
+  void* ring_ptr = nullptr;
+  size_t ring_size = 0;
+  io_uring_sqe* sqes = nullptr;
+  size_t sqes_size = 0;
+
+  std::atomic_uint32_t* sq_tail{};
+  uint32_t* sq_array{};
+  uint32_t sq_mask = 0;
+  std::atomic_uint32_t* cq_head{};
+  std::atomic_uint32_t* cq_tail{};
+  io_uring_cqe* cqes{};
+  uint32_t cq_mask = 0;
+
+  std::thread completion_thread;
+  std::mutex mutex;
+  std::condition_variable slot_cv;
+  std::condition_variable idle_cv;
+  Vector<AsyncIORequest*> resubmit_list;  // Completion thread only
+  uint32_t max_in_flight = 0;
+  uint32_t in_flight = 0;
+  bool has_buffers = false;
+  bool running = false;
+
+  ~AsyncIOUring() {
+    shutdown();
+  }
+
+  const char* get_name() const override {
+    return "io_uring";
+  }
+
+  bool init(uint32_t queue_depth) {
+    io_uring_params params{};
+    // Leave room in the completion queue for the shutdown request
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = queue_depth * 2;
+    ring_fd = io_uring_setup(queue_depth, &params);
+    if (ring_fd < 0)
+      return false;
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !probe_ops_()) {
+      ::close(ring_fd);
+      ring_fd = -1;
+      errno = EOPNOTSUPP;
+      return false;
+    }
+
+    ring_size = math::max(
+        params.sq_off.array + params.sq_entries * sizeof(uint32_t),
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    ring_ptr = ::mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (ring_ptr == MAP_FAILED) {
+      ring_ptr = nullptr;
+      destroy_ring_();
+      return false;
+    }
+
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = (io_uring_sqe*)::mmap(
+        nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+      sqes = nullptr;
+      destroy_ring_();
+      return false;
+    }
+
+    std::byte* ring = (std::byte*)ring_ptr;
+    sq_tail = (std::atomic_uint32_t*)(ring + params.sq_off.tail);
+    sq_mask = *(uint32_t*)(ring + params.sq_off.ring_mask);
+    sq_array = (uint32_t*)(ring + params.sq_off.array);
+    cq_head = (std::atomic_uint32_t*)(ring + params.cq_off.head);
+    cq_tail = (std::atomic_uint32_t*)(ring + params.cq_off.tail);
+    cq_mask = *(uint32_t*)(ring + params.cq_off.ring_mask);
+    cqes = (io_uring_cqe*)(ring + params.cq_off.cqes);
+
+    // Every submission queue slot maps to the entry with the same index
+    for (uint32_t i = 0; i < params.sq_entries; i++)
+      sq_array[i] = i;
+
+    max_in_flight = params.sq_entries;
+    running = true;
+    completion_thread = std::thread(&AsyncIOUring::completion_thread_, this);
+    return true;
+  }
+
+  bool register_buffers(void* const* buffers, const size_t* sizes, uint32_t count) override {
+    unregister_buffers();
+    Vector<iovec> iovecs;
+    iovecs.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+      iovecs[i] = { .iov_base = buffers[i], .iov_len = sizes[i] };
+    if (io_uring_register(ring_fd, IORING_REGISTER_BUFFERS, iovecs.data(), count) < 0) {
+      Log::warn("Cannot register I/O buffers ({})", errno);
+      return false;
+    }
+    has_buffers = true;
+    return true;
+  }
+
+  void unregister_buffers() override {
+    if (!has_buffers)
+      return;
+    // The kernel holds on to the pages while requests using them are in flight
+    wait_idle();
+    io_uring_register(ring_fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+    has_buffers = false;
+  }
+
+  void submit(AsyncIORequest* const* requests, uint32_t count) override {
+    std::unique_lock lock(mutex);
+    uint32_t i = 0;
+    while (i < count) {
+      slot_cv.wait(lock, [this] { return in_flight < max_in_flight; });
+      AsyncIORequest* const* batch = requests + i;
+      uint32_t batch_size = math::min(count - i, max_in_flight - in_flight);
+      for (uint32_t j = 0; j < batch_size; j++) {
+        batch[j]->done.store(false, std::memory_order_relaxed);
+        batch[j]->result = 0;
+      }
+      in_flight += batch_size;
+      i += batch_size;
+      queue_requests_(lock, batch, batch_size);
+    }
+  }
+
+  void wait_idle() override {
+    std::unique_lock lock(mutex);
+    idle_cv.wait(lock, [this] { return in_flight == 0; });
+  }
+
+  void shutdown() override {
+    if (!running)
+      return;
+    wait_idle();
+    {
+      // A no-op request without user data stops the completion thread
+      std::lock_guard lock(mutex);
+      uint32_t tail = sq_tail->load(std::memory_order_relaxed);
+      io_uring_sqe* sqe = &sqes[tail & sq_mask];
+      *sqe = {};
+      sqe->opcode = IORING_OP_NOP;
+      sq_tail->store(tail + 1, std::memory_order_release);
+      int error;
+      submit_queued_(1, error);
+    }
+    completion_thread.join();
+    running = false;
+    unregister_buffers();
+    destroy_ring_();
+  }
+
+  // IORING_OP_READ and IORING_OP_WRITE need Linux 5.6, older kernels only have the vectored operations
+  bool probe_ops_() {
+    static constexpr uint32_t max_ops = 256;
+    alignas(io_uring_probe) std::byte buffer[sizeof(io_uring_probe) + max_ops * sizeof(io_uring_probe_op)]{};
+    io_uring_probe* probe = (io_uring_probe*)buffer;
+    if (io_uring_register(ring_fd, IORING_REGISTER_PROBE, probe, max_ops) < 0)
+      return false;
+    for (uint32_t op : { IORING_OP_READ, IORING_OP_WRITE, IORING_OP_READ_FIXED, IORING_OP_WRITE_FIXED }) {
+      if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+        return false;
+    }
+    return true;
+  }
+
+  // The part of the request that has not been transferred yet. request->result holds the bytes transferred by
+  // earlier parts of a short transfer.
+  void prepare_sqe_(io_uring_sqe* sqe, AsyncIORequest* request) {
+    bool fixed = request->buffer_index >= 0;
+    uint32_t transferred = (uint32_t)request->result;
+    *sqe = {};
+    if (request->op == AsyncIOOp::Read)
+      sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    else
+      sqe->opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = (int)request->file->handle_;
+    sqe->off = request->offset + transferred;
+    sqe->addr = (uint64_t)(uintptr_t)((std::byte*)request->buffer + transferred);
+    sqe->len = request->size - transferred;
+    if (fixed)
+      sqe->buf_index = (uint16_t)request->buffer_index;
+    sqe->user_data = (uint64_t)(uintptr_t)request;
+  }
+
+  /**
+   * @brief Queue and submit requests that are already counted in in_flight. Called with the mutex held.
+   *
+   * Requests the kernel does not take complete with the error, so they do not stay in flight and block wait_idle().
+   * The mutex is released while their callbacks run.
+   */
+  void queue_requests_(std::unique_lock<std::mutex>& lock, AsyncIORequest* const* requests, uint32_t count) {
+    uint32_t tail = sq_tail->load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; i++)
+      prepare_sqe_(&sqes[(tail + i) & sq_mask], requests[i]);
+    sq_tail->store(tail + count, std::memory_order_release);
+
+    int error = 0;
+    uint32_t num_failed = submit_queued_(count, error);
+    if (num_failed == 0)
+      return;
+    // Take back the entries the kernel has not read, the next submission would pick them up otherwise
+    sq_tail->store(tail + count - num_failed, std::memory_order_release);
+    lock.unlock();
+    for (uint32_t i = count - num_failed; i < count; i++)
+      complete_async_io_request(requests[i], -(int64_t)error);
+    lock.lock();
+    in_flight -= num_failed;
+    if (in_flight == 0)
+      idle_cv.notify_all();
+    slot_cv.notify_all();
+  }
+
+  // Returns the number of queued entries the kernel has not taken because io_uring_enter failed
+  uint32_t submit_queued_(uint32_t count, int& error) {
+    while (count > 0) {
+      int ret = io_uring_enter(ring_fd, count, 0, 0);
+      if (ret < 0) {
+        if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+          continue;
+        error = errno;
+        Log::error("io_uring_enter failed ({})", error);
+        return count;
+      }
+      count -= (uint32_t)ret;
+    }
+    return 0;
+  }
+
+  void completion_thread_() {
+    while (true) {
+      uint32_t head = cq_head->load(std::memory_order_relaxed);
+      uint32_t tail = cq_tail->load(std::memory_order_acquire);
+      if (head == tail) {
+        int ret = io_uring_enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+        if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+          Log::error("io_uring_enter failed ({})", errno);
+          return;
+        }
+        continue;
+      }
+
+      uint32_t num_completed = 0;
+      bool stop = false;
+      for (; head != tail; head++) {
+        const io_uring_cqe& cqe = cqes[head & cq_mask];
+        AsyncIORequest* request = (AsyncIORequest*)(uintptr_t)cqe.user_data;
+        if (request == nullptr) {
+          stop = true;
+          continue;
+        }
+        // Continue short transfers like the thread pool does, only end of file stops a read early
+        int64_t result = cqe.res;
+        if (result == -EINTR || (result > 0 && request->result + result < request->size)) {
+          request->result += math::max(result, (int64_t)0);
+          resubmit_list.push_back(request);
+          continue;
+        }
+        complete_async_io_request(request, result < 0 ? result : request->result + result);
+        num_completed++;
+      }
+      cq_head->store(head, std::memory_order_release);
+
+      if (resubmit_list.size() > 0) {
+        std::unique_lock lock(mutex);
+        queue_requests_(lock, resubmit_list.data(), resubmit_list.size());
+        resubmit_list.resize(0);
+      }
+
+      if (num_completed > 0) {
+        std::lock_guard lock(mutex);
+        in_flight -= num_completed;
+        if (in_flight == 0)
+          idle_cv.notify_all();
+        slot_cv.notify_all();
+      }
+      if (stop)
+        return;
+    }
+  }
+
+  void destroy_ring_() {
+    if (sqes)
+      ::munmap(sqes, sqes_size);
+    if (ring_ptr)
+      ::munmap(ring_ptr, ring_size);
+    if (ring_fd >= 0)
+      ::close(ring_fd);
+    sqes = nullptr;
+    ring_ptr = nullptr;
+    ring_fd = -1;
+  }
+};
+
+AsyncIO* create_async_io_uring(uint32_t queue_depth) {
+  AsyncIOUring* io = new AsyncIOUring();
+  if (!io->init(queue_depth)) {
+    int error = errno;
+    delete io;
+    Log::info("io_uring is not available ({}), using the thread pool for async I/O", error);
+    return nullptr;
+  }
+  return io;
+}
+
+#else
+
+AsyncIO* create_async_io_uring(uint32_t queue_depth) {
+  return nullptr;
+}
+
+#endif
+
+}  // namespace wb
@@ -21,6 +21,7 @@ struct AudioBuffer {
   uint32_t channel_capacity = internal_buffer_capacity;
   T* internal_channel_buffers[internal_buffer_capacity]{};
   T** channel_buffers{};
+  bool memory_locked = false;
 
   inline AudioBuffer() : channel_buffers(internal_channel_buffers) {
   }
@@ -38,6 +39,7 @@ struct AudioBuffer {
   }
 
   inline ~AudioBuffer() {
+    unlock_memory();
     for (uint32_t i = 0; i < n_channels; i++) {
       free_aligned(channel_buffers[i]);
       channel_buffers[i] = nullptr;
@@ -70,6 +72,25 @@ struct AudioBuffer {
     }
   }
 
+  // Locked buffers stay locked across resize() and resize_channel() and are unlocked before being freed
+  inline bool lock_memory() {
+    bool locked = true;
+    for (uint32_t i = 0; i < n_channels; i++) {
+      locked &= wb::lock_memory(channel_buffers[i], n_samples * sizeof(T));
+    }
+    memory_locked = true;
+    return locked;
+  }
+
+  inline void unlock_memory() {
+    if (!memory_locked)
+      return;
+    for (uint32_t i = 0; i < n_channels; i++) {
+      wb::unlock_memory(channel_buffers[i], n_samples * sizeof(T));
+    }
+    memory_locked = false;
+  }
+
   inline void mix(const AudioBuffer<T>& other) {
     assert(n_samples == other.n_samples);
     for (uint32_t i = 0; i < n_channels; i++) {
@@ -85,6 +106,8 @@ struct AudioBuffer {
     if (samples == n_samples)
       return;
 
+    bool relock = memory_locked;
+    unlock_memory();
     size_t new_size = samples * sizeof(T);
     if (clear) {
       for (uint32_t i = 0; i < n_channels; i++) {
@@ -107,12 +130,16 @@ struct AudioBuffer {
     }
 
     n_samples = samples;
+    if (relock)
+      lock_memory();
   }
 
   inline void resize_channel(uint32_t channel_count) {
     assert(n_samples != 0);
     if (channel_count == n_channels)
       return;
+    bool relock = memory_locked;
+    unlock_memory();
     uint32_t old_channel_count = n_channels;
     resize_channel_array_(channel_count);
     if (channel_count > old_channel_count) {
@@ -129,6 +156,8 @@ struct AudioBuffer {
         channel_buffers[i] = nullptr;
       }
     }
+    if (relock)
+      lock_memory();
   }
 
   inline void deinterleave_samples_from(const void* src, uint32_t dst_offset, uint32_t count, AudioFormat format) {
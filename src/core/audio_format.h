@@ -57,6 +57,19 @@ inline static constexpr bool is_floating_point_format(AudioFormat format) {
   return false;
 }
 
+// Read a packed little-endian 24-bit sample
+inline static int32_t read_packed_i24(const std::byte* src) {
+  uint32_t value = (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16);
+  return (int32_t)(value << 8) >> 8;
+}
+
+// Write a packed little-endian 24-bit sample
+inline static void write_packed_i24(std::byte* dst, int32_t value) {
+  dst[0] = std::byte(value);
+  dst[1] = std::byte(value >> 8);
+  dst[2] = std::byte(value >> 16);
+}
+
 inline static const char* get_audio_format_string(AudioFormat format) {
   switch (format) {
     case AudioFormat::I8: return "8-bit int";
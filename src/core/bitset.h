@@ -2,6 +2,7 @@
 
 #include <cstring>
 
+#include "core/bit_manipulation.h"
 #include "core/common.h"
 
 namespace wb {
@@ -86,5 +87,32 @@ struct BitSet {
     if (cap_ != 0)
       std::memset(data_, 0, cap_ * sizeof(uint32_t));
   }
+
+  /**
+   * @brief Call fn with the index of every set bit, in ascending order.
+   */
+  template<typename Fn>
+  void for_each_set(Fn&& fn) const {
+    for (uint32_t i = 0; i < cap_; i++) {
+      uint32_t bits = data_[i];
+      while (bits != 0)
+        fn((i << shift_amount) + next_set_bits(bits));
+    }
+  }
+
+  /**
+   * @brief Call fn with the index of every set bit, in descending order.
+   */
+  template<typename Fn>
+  void for_each_set_reverse(Fn&& fn) const {
+    for (uint32_t i = cap_; i-- > 0;) {
+      uint32_t bits = data_[i];
+      while (bits != 0) {
+        uint32_t bit = 31 - std::countl_zero(bits);
+        bits &= ~(1u << bit);
+        fn((i << shift_amount) + bit);
+      }
+    }
+  }
 };
 }  // namespace wb
\ No newline at end of file
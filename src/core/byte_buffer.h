@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstring>
 
 #include "common.h"
 #include "io_types.h"
@@ -40,6 +41,21 @@ struct ByteBuffer {
     size_ = 0;
   }
 
+  // Use external memory as the buffer storage, the memory is not owned by the buffer.
+  inline void wrap(std::byte* bytes, size_t size) {
+    if (buffer && managed_)
+      std::free(buffer);
+    buffer = bytes;
+    capacity_ = size;
+    position_ = 0;
+    size_ = size;
+    managed_ = false;
+  }
+
+  inline size_t size() const {
+    return size_;
+  }
+
   inline bool seek(int64_t offset, IOSeekMode mode) {
     switch (mode) {
       case IOSeekMode::Begin: position_ = offset; break;
@@ -0,0 +1,154 @@
+#include "chunk_file.h"
+
+#include <bit>
+#include <fstream>
+
+#include "bit_manipulation.h"
+#include "debug.h"
+#include "extern/xxhash.h"
+
+namespace wb {
+
+static_assert(std::endian::native == std::endian::little, "Chunk files are stored in little-endian");
+
+static constexpr uint64_t chunk_file_alignment = 8;
+
+static uint64_t align_offset(uint64_t offset) {
+  return (offset + chunk_file_alignment - 1) & ~(chunk_file_alignment - 1);
+}
+
+ByteBuffer& ChunkFileWriter::begin_section(uint32_t id, uint32_t flags) {
+  assert(current_section == (uint32_t)-1 && "end_section() must be called first");
+  static constexpr std::byte padding[chunk_file_alignment]{};
+  uint64_t offset = align_offset(body.position());
+  if (offset > body.position())
+    body.write(padding, offset - body.position());
+  current_section = sections.size();
+  sections.push_back({
+    .id = id,
+    .flags = flags,
+    .offset = offset,
+  });
+  return body;
+}
+
+void ChunkFileWriter::end_section() {
+  assert(current_section != (uint32_t)-1 && "begin_section() must be called first");
+  ChunkFileSection& section = sections[current_section];
+  section.size = body.position() - section.offset;
+  section.raw_size = section.size;
+  if (has_bit(section.flags, ChunkFileFlags::Checksum))
+    section.checksum = XXH64(body.data() + section.offset, section.size, 0);
+  current_section = (uint32_t)-1;
+}
+
+void ChunkFileWriter::finalize(uint32_t magic, uint32_t version, ByteBuffer& dst) const {
+  assert(current_section == (uint32_t)-1 && "end_section() must be called first");
+  uint64_t data_offset = align_offset(sizeof(ChunkFileHeader) + sections.size() * sizeof(ChunkFileSection));
+  ChunkFileHeader header{
+    .magic = magic,
+    .version = version,
+    .num_sections = sections.size(),
+  };
+
+  dst.reset();
+  dst.reserve(data_offset + body.position());
+  dst.write(&header, sizeof(ChunkFileHeader));
+  for (ChunkFileSection section : sections) {
+    section.offset += data_offset;
+    dst.write(&section, sizeof(ChunkFileSection));
+  }
+
+  static constexpr std::byte padding[chunk_file_alignment]{};
+  if (data_offset > dst.position())
+    dst.write(padding, data_offset - dst.position());
+  if (body.position() > 0)
+    dst.write(body.data(), body.position());
+}
+
+ChunkFileResult ChunkFileWriter::write_to_file(const std::filesystem::path& path, uint32_t magic, uint32_t version)
+    const {
+  ByteBuffer buffer;
+  finalize(magic, version, buffer);
+  if (!write_file_atomic(path, buffer.data(), buffer.position()))
+    return ChunkFileResult::ErrCannotAccessFile;
+  return ChunkFileResult::Ok;
+}
+
+ChunkFileResult ChunkFileReader::open(const std::filesystem::path& path, uint32_t magic) {
+  if (!file.open(path))
+    return ChunkFileResult::ErrCannotAccessFile;
+  return open_memory(file.data(), file.size(), magic);
+}
+
+ChunkFileResult ChunkFileReader::open_memory(const std::byte* data, size_t size, uint32_t magic) {
+  data_ = data;
+  size_ = size;
+  sections.clear();
+  verified.clear();
+
+  if (size < sizeof(ChunkFileHeader))
+    return ChunkFileResult::ErrInvalidFormat;
+  std::memcpy(&header, data, sizeof(ChunkFileHeader));
+  if (header.magic != magic)
+    return ChunkFileResult::ErrInvalidFormat;
+
+  uint64_t toc_size = (uint64_t)header.num_sections * sizeof(ChunkFileSection);
+  if (toc_size > size - sizeof(ChunkFileHeader))
+    return ChunkFileResult::ErrCorruptedFile;
+
+  sections.resize(header.num_sections);
+  std::memcpy(sections.data(), data + sizeof(ChunkFileHeader), toc_size);
+  for (const ChunkFileSection& section : sections) {
+    if (section.offset > size || section.size > size - section.offset) {
+      Log::error("Section {:x} is out of bounds", section.id);
+      return ChunkFileResult::ErrCorruptedFile;
+    }
+  }
+  verified.resize(header.num_sections, 0);
+
+  return ChunkFileResult::Ok;
+}
+
+ChunkFileResult ChunkFileReader::get_section(uint32_t id, ByteBuffer& section_data) {
+  int32_t index = find_section_(id);
+  if (index < 0)
+    return ChunkFileResult::ErrSectionNotFound;
+
+  const ChunkFileSection& section = sections[index];
+  if (has_bit(section.flags, ChunkFileFlags::Compressed))
+    return ChunkFileResult::ErrUnsupportedSection;
+
+  const std::byte* ptr = data_ + section.offset;
+  if (!verified[index]) {
+    if (has_bit(section.flags, ChunkFileFlags::Checksum) && XXH64(ptr, section.size, 0) != section.checksum) {
+      Log::error("Section {:x} checksum mismatch", section.id);
+      return ChunkFileResult::ErrCorruptedFile;
+    }
+    verified[index] = 1;
+  }
+
+  section_data.wrap(const_cast<std::byte*>(ptr), section.size);
+  return ChunkFileResult::Ok;
+}
+
+bool ChunkFileReader::has_section(uint32_t id) const {
+  return find_section_(id) >= 0;
+}
+
+int32_t ChunkFileReader::find_section_(uint32_t id) const {
+  for (uint32_t i = 0; i < sections.size(); i++)
+    if (sections[i].id == id)
+      return (int32_t)i;
+  return -1;
+}
+
+bool chunk_file_has_magic(const std::filesystem::path& path, uint32_t magic) {
+  std::ifstream file(path, std::ios::binary);
+  uint32_t file_magic = 0;
+  if (!file.read((char*)&file_magic, sizeof(uint32_t)))
+    return false;
+  return file_magic == magic;
+}
+
+}  // namespace wb
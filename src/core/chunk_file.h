@@ -0,0 +1,118 @@
+#pragma once
+
+#include <filesystem>
+
+#include "byte_buffer.h"
+#include "common.h"
+#include "fs.h"
+#include "vector.h"
+
+namespace wb {
+
+struct ChunkFileFlags {
+  enum : uint32_t {
+    Checksum = 1 << 0,    // The section has an XXH64 checksum
+    Compressed = 1 << 1,  // Reserved, the section data is compressed and raw_size holds the decompressed size
+  };
+};
+
+enum class ChunkFileResult {
+  Ok,
+  ErrCannotAccessFile,
+  ErrInvalidFormat,
+  ErrIncompatibleVersion,
+  ErrCorruptedFile,
+  ErrSectionNotFound,
+  ErrUnsupportedSection,
+};
+
+struct ChunkFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t num_sections;
+  uint32_t reserved;
+};
+
+struct ChunkFileSection {
+  uint32_t id;
+  uint32_t flags;
+  uint64_t offset;  // Absolute file offset, always 8-byte aligned
+  uint64_t size;
+  uint64_t raw_size;
+  uint64_t checksum;
+};
+
+// Chunked file container. The file starts with a header and a table of contents, followed by the section data. All
+// values are stored in little-endian. Sections are 8-byte aligned, so arrays of trivial types can be copied straight
+// out of the mapped file.
+struct ChunkFileWriter {
+  ByteBuffer body;
+  Vector<ChunkFileSection> sections;
+  uint32_t current_section = (uint32_t)-1;
+
+  /**
+   * @brief Start a new section. The section data is written into the returned buffer until end_section() is called.
+   *
+   * @param id Section id, usually a fourcc.
+   * @param flags Section flags, see ChunkFileFlags.
+   * @return Buffer to write the section data into.
+   */
+  ByteBuffer& begin_section(uint32_t id, uint32_t flags = ChunkFileFlags::Checksum);
+  void end_section();
+
+  /**
+   * @brief Write the container into the destination buffer.
+   *
+   * @param magic File magic number.
+   * @param version File version.
+   * @param dst Destination buffer.
+   */
+  void finalize(uint32_t magic, uint32_t version, ByteBuffer& dst) const;
+
+  // Writes the container through write_file_atomic().
+  ChunkFileResult write_to_file(const std::filesystem::path& path, uint32_t magic, uint32_t version) const;
+};
+
+// Reads a chunked file through a read-only file mapping. The table of contents is parsed when the file is opened,
+// section data is only touched (and its checksum verified) once the section is requested.
+struct ChunkFileReader {
+  MappedFile file;
+  const std::byte* data_ = nullptr;
+  size_t size_ = 0;
+  ChunkFileHeader header{};
+  Vector<ChunkFileSection> sections;
+  Vector<uint8_t> verified;
+
+  ChunkFileResult open(const std::filesystem::path& path, uint32_t magic);
+
+  /**
+   * @brief Read the container from memory. The memory must outlive the reader.
+   *
+   * @param data Container data.
+   * @param size Container size.
+   * @param magic Expected file magic number.
+   */
+  ChunkFileResult open_memory(const std::byte* data, size_t size, uint32_t magic);
+
+  /**
+   * @brief Get section data.
+   *
+   * @param id Section id.
+   * @param section_data Receives the section data. The buffer does not own the memory.
+   * @return ChunkFileResult::Ok if the section exists and its checksum matches.
+   */
+  ChunkFileResult get_section(uint32_t id, ByteBuffer& section_data);
+
+  bool has_section(uint32_t id) const;
+
+  inline uint32_t version() const {
+    return header.version;
+  }
+
+  int32_t find_section_(uint32_t id) const;
+};
+
+// Returns true if the file starts with the given magic number.
+bool chunk_file_has_magic(const std::filesystem::path& path, uint32_t magic);
+
+}  // namespace wb
@@ -21,6 +21,11 @@ class Log {
   ~Log() {
   }
 
+  template<typename... Args>
+  static void log(spdlog::level::level_enum level, spdlog::format_string_t<Args...> str, Args&&... args) {
+    g_main_logger.logger->log(level, str, std::forward<Args>(args)...);
+  }
+
   template<typename... Args>
   static void trace(spdlog::format_string_t<Args...> str, Args&&... args) {
     g_main_logger.logger->trace(str, std::forward<Args>(args)...);
@@ -3,7 +3,9 @@
 #include <condition_variable>
 #include <mutex>
 
+#include "debug.h"
 #include "queue.h"
+#include "thread.h"
 
 #define WB_MAX_DEFERRED_JOB 256
 
@@ -76,6 +78,11 @@ void shutdown_deferred_job() {
   delete[] job_items;
 }
 
+void set_deferred_job_affinity(uint64_t cpu_mask) {
+  if (cpu_mask != 0 && !set_thread_affinity(deferred_job_thread, cpu_mask))
+    Log::warn("Cannot set deferred job thread affinity");
+}
+
 DeferredJobHandle enqueue_deferred_job(DeferredJobFn fn, void* userdata0, void* userdata1) {
   for (;;) {
     uint32_t wpos = writer_data.pos.load(std::memory_order_relaxed);
@@ -15,6 +15,7 @@ using DeferredJobHandle = uint32_t;
 
 void init_deferred_job();
 void shutdown_deferred_job();
+void set_deferred_job_affinity(uint64_t cpu_mask);
 DeferredJobHandle enqueue_deferred_job(DeferredJobFn fn, void* userdata0 = nullptr, void* userdata1 = nullptr);
 void stop_deferred_job(DeferredJobHandle job_id);
 bool wait_for_deferred_job(DeferredJobHandle job_id, uint64_t timeout = UINT64_MAX);
@@ -107,6 +107,33 @@ struct File {
   }
 };
 
+// Read-only memory mapped file
+struct MappedFile {
+  void* handle_ = nullptr;
+  void* mapping_ = nullptr;
+  const std::byte* data_ = nullptr;
+  size_t size_ = 0;
+
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  ~MappedFile();
+
+  bool open(const std::filesystem::path& path);
+  void close();
+
+  inline const std::byte* data() const {
+    return data_;
+  }
+
+  inline size_t size() const {
+    return size_;
+  }
+
+  inline bool is_open() const {
+    return data_ != nullptr;
+  }
+};
+
 consteval uint32_t fourcc(const char ch[5]) {
   if constexpr (std::endian::native == std::endian::little)
     return ch[0] | (ch[1] << 8) | (ch[2] << 16) | (ch[3] << 24);
@@ -115,6 +142,11 @@ consteval uint32_t fourcc(const char ch[5]) {
 
 Vector<std::byte> read_file_content(File& file);
 Vector<std::byte> read_file_content(const std::filesystem::path& path);
+
+// Writes the content into a temporary file, flushes it to disk and renames it over path. The file at path always holds
+// either the old or the new content, even if the application crashes in the middle of the write.
+bool write_file_atomic(const std::filesystem::path& path, const void* data, size_t size);
+
 std::filesystem::path to_system_preferred_path(const std::filesystem::path& path);
 std::filesystem::path remove_filename_from_path(const std::filesystem::path& path);
 void explore_folder(const std::filesystem::path& path);
@@ -1,38 +1,157 @@
 #include "fs.h"
 
 #ifndef WB_PLATFORM_WINDOWS
+#include <cstdio>
+
+#include "bit_manipulation.h"
+
+#if defined(WB_PLATFORM_LINUX) || defined(WB_PLATFORM_MACOS)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace wb {
 File::File() : handle_(nullptr) {
 }
 
 File::~File() {
-  if (handle_ == nullptr) {
-    close();
-  }
+  close();
 }
 
 bool File::open(const std::filesystem::path& path, uint32_t flags) {
-  return false;
+  close();
+  const char* mode = "rb";
+  if (has_bit(flags, IOOpenMode::Truncate))
+    mode = has_bit(flags, IOOpenMode::Read) ? "w+b" : "wb";
+  else if (has_bit(flags, IOOpenMode::Write))
+    mode = "r+b";
+
+  FILE* file = std::fopen(path.c_str(), mode);
+  // Write without truncation creates the file if it does not exist yet, like OPEN_ALWAYS on Windows
+  if (file == nullptr && !has_bit(flags, IOOpenMode::Truncate) && has_bit(flags, IOOpenMode::Write))
+    file = std::fopen(path.c_str(), "w+b");
+  if (file == nullptr)
+    return false;
+
+  handle_ = (void*)file;
+  open_ = true;
+  return true;
 }
 
 bool File::seek(int64_t offset, IOSeekMode mode) {
-  return false;
+  int origin = mode == IOSeekMode::Begin ? SEEK_SET : (mode == IOSeekMode::Relative ? SEEK_CUR : SEEK_END);
+  return ::fseeko((FILE*)handle_, (off_t)offset, origin) == 0;
 }
 
 uint64_t File::position() const {
-  return 0;
+  off_t pos = ::ftello((FILE*)handle_);
+  return pos < 0 ? 0 : (uint64_t)pos;
 }
 
 uint32_t File::read(void* dest, size_t size) {
-  return 0;
+  return (uint32_t)std::fread(dest, 1, size, (FILE*)handle_);
 }
 
 uint32_t File::write(const void* src, size_t size) {
-  return 0;
+  return (uint32_t)std::fwrite(src, 1, size, (FILE*)handle_);
 }
 
 void File::close() {
-  handle_ = nullptr;
+  if (handle_ != nullptr) {
+    std::fclose((FILE*)handle_);
+    handle_ = nullptr;
+  }
+  open_ = false;
+}
+
+MappedFile::~MappedFile() {
+  close();
+}
+
+bool MappedFile::open(const std::filesystem::path& path) {
+  close();
+#if defined(WB_PLATFORM_LINUX) || defined(WB_PLATFORM_MACOS)
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+  void* ptr = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (ptr == MAP_FAILED)
+    return false;
+  mapping_ = ptr;
+  data_ = (const std::byte*)ptr;
+  size_ = (size_t)st.st_size;
+  return true;
+#else
+  return false;
+#endif
 }
+
+void MappedFile::close() {
+#if defined(WB_PLATFORM_LINUX) || defined(WB_PLATFORM_MACOS)
+  if (mapping_)
+    ::munmap(mapping_, size_);
+#endif
+  mapping_ = nullptr;
+  data_ = nullptr;
+  size_ = 0;
+}
+
+bool write_file_atomic(const std::filesystem::path& path, const void* data, size_t size) {
+#if defined(WB_PLATFORM_LINUX) || defined(WB_PLATFORM_MACOS)
+  std::filesystem::path tmp_path = path;
+  tmp_path += ".tmp";
+  int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return false;
+
+  const std::byte* ptr = (const std::byte*)data;
+  size_t remaining = size;
+  while (remaining > 0) {
+    ssize_t num_written = ::write(fd, ptr, remaining);
+    if (num_written < 0) {
+      if (errno == EINTR)
+        continue;
+      ::close(fd);
+      ::unlink(tmp_path.c_str());
+      return false;
+    }
+    ptr += num_written;
+    remaining -= (size_t)num_written;
+  }
+
+  if (::fsync(fd) != 0) {
+    ::close(fd);
+    ::unlink(tmp_path.c_str());
+    return false;
+  }
+  ::close(fd);
+
+  if (::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    ::unlink(tmp_path.c_str());
+    return false;
+  }
+
+  // Make the rename itself durable
+  std::filesystem::path dir = path.parent_path();
+  int dir_fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+  if (dir_fd >= 0) {
+    ::fsync(dir_fd);
+    ::close(dir_fd);
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
 }  // namespace wb
 #endif
\ No newline at end of file
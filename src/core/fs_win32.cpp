@@ -78,5 +78,92 @@ void File::close() {
   }
 }
 
+MappedFile::~MappedFile() {
+  close();
+}
+
+bool MappedFile::open(const std::filesystem::path& path) {
+  close();
+  HANDLE file = CreateFile(
+      path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    CloseHandle(file);
+    return false;
+  }
+
+  void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (view == nullptr) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  handle_ = (void*)file;
+  mapping_ = (void*)mapping;
+  data_ = (const std::byte*)view;
+  size_ = (size_t)file_size.QuadPart;
+  return true;
+}
+
+void MappedFile::close() {
+  if (data_)
+    UnmapViewOfFile(data_);
+  if (mapping_)
+    CloseHandle((HANDLE)mapping_);
+  if (handle_)
+    CloseHandle((HANDLE)handle_);
+  handle_ = nullptr;
+  mapping_ = nullptr;
+  data_ = nullptr;
+  size_ = 0;
+}
+
+
+bool write_file_atomic(const std::filesystem::path& path, const void* data, size_t size) {
+  std::filesystem::path tmp_path = path;
+  tmp_path += ".tmp";
+  HANDLE file =
+      CreateFile(tmp_path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  const std::byte* ptr = (const std::byte*)data;
+  size_t remaining = size;
+  while (remaining > 0) {
+    DWORD num_written;
+    DWORD chunk_size = (DWORD)std::min(remaining, (size_t)0x40000000);
+    if (!WriteFile(file, ptr, chunk_size, &num_written, nullptr)) {
+      CloseHandle(file);
+      DeleteFile(tmp_path.c_str());
+      return false;
+    }
+    ptr += num_written;
+    remaining -= num_written;
+  }
+
+  if (!FlushFileBuffers(file)) {
+    CloseHandle(file);
+    DeleteFile(tmp_path.c_str());
+    return false;
+  }
+  CloseHandle(file);
+
+  if (!MoveFileEx(tmp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+    DeleteFile(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
 }  // namespace wb
 #endif
\ No newline at end of file
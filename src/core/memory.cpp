@@ -41,4 +41,26 @@ uint32_t get_virtual_page_size() noexcept {
 #endif
 }
 
+bool lock_memory(const void* ptr, size_t size) noexcept {
+  if (ptr == nullptr || size == 0)
+    return false;
+#if defined(WB_PLATFORM_WINDOWS)
+  return ::VirtualLock((LPVOID)ptr, size) != 0;
+#elif defined(WB_PLATFORM_LINUX)
+  return ::mlock(ptr, size) == 0;
+#else
+  return false;
+#endif
+}
+
+void unlock_memory(const void* ptr, size_t size) noexcept {
+  if (ptr == nullptr || size == 0)
+    return;
+#if defined(WB_PLATFORM_WINDOWS)
+  ::VirtualUnlock((LPVOID)ptr, size);
+#elif defined(WB_PLATFORM_LINUX)
+  ::munlock(ptr, size);
+#endif
+}
+
 }  // namespace wb
\ No newline at end of file
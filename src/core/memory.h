@@ -12,6 +12,10 @@ void* allocate_virtual(size_t size) noexcept;
 void free_virtual(void* ptr, size_t size) noexcept;
 uint32_t get_virtual_page_size() noexcept;
 
+// Lock memory range into physical memory, so that the real-time thread does not page fault when accessing it.
+bool lock_memory(const void* ptr, size_t size) noexcept;
+void unlock_memory(const void* ptr, size_t size) noexcept;
+
 inline void* allocate_aligned(size_t size, size_t alignment = 16) noexcept {
 #ifdef WB_PLATFORM_WINDOWS
   return _aligned_malloc(size, alignment);
@@ -126,4 +130,55 @@ struct Pool {
   }
 };
 
+// Fixed-size bump allocator for per-block (audio callback) scratch memory. The storage is preallocated and locked
+// outside of the audio thread, allocations never fall back to the system allocator.
+struct BlockArena {
+  std::byte* data = nullptr;
+  size_t capacity = 0;
+  size_t used = 0;
+  size_t high_water = 0;
+  uint32_t num_overflows = 0;
+
+  BlockArena() = default;
+  BlockArena(const BlockArena&) = delete;
+
+  ~BlockArena() {
+    if (data)
+      free_virtual(data, capacity);
+  }
+
+  inline bool init(size_t size) noexcept {
+    if (data)
+      free_virtual(data, capacity);
+    data = (std::byte*)allocate_virtual(size);
+    capacity = data ? size : 0;
+    used = 0;
+    high_water = 0;
+    if (data)
+      lock_memory(data, capacity);
+    return data != nullptr;
+  }
+
+  inline void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) noexcept {
+    size_t offset = (used + alignment - 1) & ~(alignment - 1);
+    if (offset + size > capacity) {
+      num_overflows++;
+      return nullptr;
+    }
+    used = offset + size;
+    return data + offset;
+  }
+
+  template<typename T>
+  inline T* allocate_array(size_t count) noexcept {
+    static_assert(std::is_trivially_destructible_v<T>, "Arena objects are never destroyed");
+    return (T*)allocate(count * sizeof(T), alignof(T));
+  }
+
+  inline void reset() noexcept {
+    high_water = std::max(high_water, used);
+    used = 0;
+  }
+};
+
 }  // namespace wb
\ No newline at end of file
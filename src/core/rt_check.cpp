@@ -0,0 +1,252 @@
+#include "rt_check.h"
+
+#if WB_RT_CHECK
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+
+#include "debug.h"
+
+#if defined(WB_PLATFORM_WINDOWS)
+#include <Windows.h>
+#include <crtdbg.h>
+#elif defined(WB_PLATFORM_LINUX)
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define WB_RT_CHECK_MAX_VIOLATIONS 128
+
+namespace wb {
+
+struct RtViolationSlot {
+  std::atomic_bool ready;
+  RtViolation violation;
+};
+
+static RtCheckMode check_mode = RtCheckMode::Record;
+static RtViolationSlot violation_slots[WB_RT_CHECK_MAX_VIOLATIONS];
+static std::atomic_uint32_t violation_write_pos;
+static std::atomic_uint32_t num_dropped_violations;
+static uint32_t violation_read_pos;
+static thread_local uint32_t rt_depth;
+static thread_local bool rt_suspended;  // Prevents recursion while the violation is being reported
+
+static uint32_t capture_stack_trace(void** frames, uint32_t max_frames) {
+#if defined(WB_PLATFORM_WINDOWS)
+  return (uint32_t)CaptureStackBackTrace(2, max_frames, frames, nullptr);
+#elif defined(WB_PLATFORM_LINUX)
+  return (uint32_t)backtrace(frames, (int)max_frames);
+#else
+  return 0;
+#endif
+}
+
+static const char* get_violation_type_string(RtViolationType type) {
+  switch (type) {
+    case RtViolationType::Malloc: return "malloc";
+    case RtViolationType::Free: return "free";
+    case RtViolationType::MutexWait: return "mutex wait";
+    case RtViolationType::Syscall: return "syscall";
+  }
+  return "unknown";
+}
+
+static void print_violation(const RtViolation& violation) {
+  std::fprintf(
+      stderr,
+      "Real-time violation: %s (%s)\n",
+      get_violation_type_string(violation.type),
+      violation.what ? violation.what : "");
+#if defined(WB_PLATFORM_LINUX)
+  backtrace_symbols_fd(violation.frames, (int)violation.num_frames, STDERR_FILENO);
+#endif
+}
+
+#if defined(WB_PLATFORM_WINDOWS) && defined(_DEBUG)
+static int crt_alloc_hook(int type, void*, size_t, int, long, const unsigned char*, int) {
+  switch (type) {
+    case _HOOK_ALLOC: rt_check_report(RtViolationType::Malloc, "malloc"); break;
+    case _HOOK_REALLOC: rt_check_report(RtViolationType::Malloc, "realloc"); break;
+    case _HOOK_FREE: rt_check_report(RtViolationType::Free, "free"); break;
+    default: break;
+  }
+  return TRUE;
+}
+#endif
+
+void rt_check_init(RtCheckMode mode) {
+  check_mode = mode;
+  if (const char* env = std::getenv("WB_RT_CHECK_TRAP"); env != nullptr && env[0] == '1')
+    check_mode = RtCheckMode::Trap;
+
+  // The first stack trace capture may load the unwinder, do it here instead of on the audio thread.
+  void* frames[4];
+  capture_stack_trace(frames, 4);
+
+#if defined(WB_PLATFORM_WINDOWS) && defined(_DEBUG)
+  _CrtSetAllocHook(crt_alloc_hook);
+#endif
+
+  Log::info("Real-time safety checker enabled ({})", check_mode == RtCheckMode::Trap ? "trap" : "record");
+}
+
+void rt_check_enter() noexcept {
+  rt_depth++;
+}
+
+void rt_check_leave() noexcept {
+  rt_depth--;
+}
+
+bool rt_check_is_active() noexcept {
+  return rt_depth != 0 && !rt_suspended;
+}
+
+void rt_check_report(RtViolationType type, const char* what) noexcept {
+  if (!rt_check_is_active())
+    return;
+
+  rt_suspended = true;
+
+  if (check_mode == RtCheckMode::Trap) {
+    RtViolation violation{ .type = type, .what = what };
+    violation.num_frames = capture_stack_trace(violation.frames, RtViolation::max_frames);
+    print_violation(violation);
+    std::abort();
+  }
+
+  uint32_t pos = violation_write_pos.load(std::memory_order_relaxed);
+  RtViolationSlot& slot = violation_slots[pos % WB_RT_CHECK_MAX_VIOLATIONS];
+  if (pos - violation_read_pos >= WB_RT_CHECK_MAX_VIOLATIONS || slot.ready.load(std::memory_order_acquire)) {
+    num_dropped_violations.fetch_add(1, std::memory_order_relaxed);
+    rt_suspended = false;
+    return;
+  }
+
+  if (violation_write_pos.compare_exchange_strong(pos, pos + 1, std::memory_order_relaxed)) {
+    slot.violation.type = type;
+    slot.violation.what = what;
+    slot.violation.num_frames = capture_stack_trace(slot.violation.frames, RtViolation::max_frames);
+    slot.ready.store(true, std::memory_order_release);
+  } else {
+    num_dropped_violations.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  rt_suspended = false;
+}
+
+uint32_t rt_check_flush() {
+  uint32_t num_flushed = 0;
+  uint32_t write_pos = violation_write_pos.load(std::memory_order_relaxed);
+
+  while (violation_read_pos != write_pos) {
+    RtViolationSlot& slot = violation_slots[violation_read_pos % WB_RT_CHECK_MAX_VIOLATIONS];
+    if (!slot.ready.load(std::memory_order_acquire))
+      break;
+
+    const RtViolation& violation = slot.violation;
+    Log::warn("Real-time violation: {} ({})", get_violation_type_string(violation.type), violation.what);
+#if defined(WB_PLATFORM_LINUX)
+    char** symbols = backtrace_symbols(violation.frames, (int)violation.num_frames);
+    if (symbols) {
+      for (uint32_t i = 0; i < violation.num_frames; i++)
+        Log::warn("  #{} {}", i, symbols[i]);
+      std::free(symbols);
+    }
+#else
+    for (uint32_t i = 0; i < violation.num_frames; i++)
+      Log::warn("  #{} {}", i, violation.frames[i]);
+#endif
+
+    slot.ready.store(false, std::memory_order_release);
+    violation_read_pos++;
+    num_flushed++;
+  }
+
+  if (uint32_t num_dropped = num_dropped_violations.exchange(0, std::memory_order_relaxed))
+    Log::warn("{} real-time violations were dropped", num_dropped);
+
+  return num_flushed;
+}
+
+}  // namespace wb
+
+#if defined(WB_PLATFORM_LINUX)
+// Interpose allocation, locking and blocking syscalls. The real functions are resolved from the next object in the
+// lookup order (libc), glibc also exports __libc_* for the allocator so we can avoid dlsym() in the allocator path.
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(size_t size) {
+  wb::rt_check_report(wb::RtViolationType::Malloc, "malloc");
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+  wb::rt_check_report(wb::RtViolationType::Malloc, "calloc");
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  wb::rt_check_report(wb::RtViolationType::Malloc, "realloc");
+  return __libc_realloc(ptr, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  wb::rt_check_report(wb::RtViolationType::Malloc, "aligned_alloc");
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+  wb::rt_check_report(wb::RtViolationType::Malloc, "posix_memalign");
+  *ptr = __libc_memalign(alignment, size);
+  return *ptr ? 0 : ENOMEM;
+}
+
+void free(void* ptr) {
+  if (ptr)
+    wb::rt_check_report(wb::RtViolationType::Free, "free");
+  __libc_free(ptr);
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex) {
+  using Fn = int (*)(pthread_mutex_t*);
+  static Fn real_fn = (Fn)dlsym(RTLD_NEXT, "pthread_mutex_lock");
+  if (wb::rt_check_is_active()) {
+    if (pthread_mutex_trylock(mutex) == 0)
+      return 0;
+    wb::rt_check_report(wb::RtViolationType::MutexWait, "pthread_mutex_lock");
+  }
+  return real_fn(mutex);
+}
+
+#define WB_RT_CHECK_WRAP_SYSCALL(ret, name, params, args)       \
+  ret name params {                                             \
+    using Fn = ret(*) params;                                   \
+    static Fn real_fn = (Fn)dlsym(RTLD_NEXT, #name);            \
+    wb::rt_check_report(wb::RtViolationType::Syscall, #name); \
+    return real_fn args;                                        \
+  }
+
+WB_RT_CHECK_WRAP_SYSCALL(ssize_t, read, (int fd, void* buf, size_t count), (fd, buf, count))
+WB_RT_CHECK_WRAP_SYSCALL(ssize_t, write, (int fd, const void* buf, size_t count), (fd, buf, count))
+WB_RT_CHECK_WRAP_SYSCALL(int, close, (int fd), (fd))
+WB_RT_CHECK_WRAP_SYSCALL(int, fsync, (int fd), (fd))
+WB_RT_CHECK_WRAP_SYSCALL(int, poll, (struct pollfd * fds, nfds_t nfds, int timeout), (fds, nfds, timeout))
+WB_RT_CHECK_WRAP_SYSCALL(int, usleep, (useconds_t usec), (usec))
+WB_RT_CHECK_WRAP_SYSCALL(int, nanosleep, (const struct timespec* req, struct timespec* rem), (req, rem))
+}
+#endif
+
+#endif
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "common.h"
+
+#ifndef WB_RT_CHECK
+#define WB_RT_CHECK 0
+#endif
+
+namespace wb {
+
+enum class RtViolationType : uint8_t {
+  Malloc,
+  Free,
+  MutexWait,
+  Syscall,
+};
+
+enum class RtCheckMode {
+  Record,  // Store violations and report them later through rt_check_flush()
+  Trap,    // Print the stack trace and abort immediately
+};
+
+struct RtViolation {
+  static constexpr uint32_t max_frames = 32;
+  RtViolationType type;
+  const char* what;
+  uint32_t num_frames;
+  void* frames[max_frames];
+};
+
+#if WB_RT_CHECK
+void rt_check_init(RtCheckMode mode);
+void rt_check_enter() noexcept;
+void rt_check_leave() noexcept;
+bool rt_check_is_active() noexcept;
+void rt_check_report(RtViolationType type, const char* what) noexcept;
+
+// Log recorded violations with their stack traces. Returns the number of violations that have been flushed.
+uint32_t rt_check_flush();
+
+// Marks the real-time critical section of the audio thread.
+struct RtCheckScope {
+  inline RtCheckScope() noexcept {
+    rt_check_enter();
+  }
+  inline ~RtCheckScope() noexcept {
+    rt_check_leave();
+  }
+};
+
+#define WB_RT_CHECK_SCOPE()            ::wb::RtCheckScope rt_check_scope_
+#define WB_RT_CHECK_REPORT(type, what) ::wb::rt_check_report(type, what)
+#else
+inline void rt_check_init(RtCheckMode mode) {
+}
+inline bool rt_check_is_active() noexcept {
+  return false;
+}
+inline uint32_t rt_check_flush() {
+  return 0;
+}
+
+#define WB_RT_CHECK_SCOPE()
+#define WB_RT_CHECK_REPORT(type, what)
+#endif
+
+}  // namespace wb
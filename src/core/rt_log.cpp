@@ -0,0 +1,148 @@
+#include "rt_log.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "thread.h"
+#include "vector.h"
+
+#define WB_RT_LOG_RING_CAPACITY 1024
+
+namespace wb {
+
+// Single-producer single-consumer message ring. The producer is the owning thread, the consumer is the logger thread.
+struct RtLogRing {
+  alignas(64) std::atomic_uint32_t write_pos;
+  alignas(64) std::atomic_uint32_t read_pos;
+  alignas(64) std::atomic_uint32_t num_dropped;
+  std::atomic_bool retired;
+  std::string thread_name;
+  RtLogRecord records[WB_RT_LOG_RING_CAPACITY];
+};
+
+// Marks the ring as retired when the owning thread exits, the logger thread drains and frees it afterwards.
+struct RtLogThreadRing {
+  RtLogRing* ring = nullptr;
+  ~RtLogThreadRing() {
+    if (ring)
+      ring->retired.store(true, std::memory_order_release);
+  }
+};
+
+static std::atomic_bool running;
+static std::mutex ring_mtx;
+static std::condition_variable logger_cv;
+static Vector<RtLogRing*> rings;
+static std::thread logger_thread;
+static thread_local RtLogThreadRing current_ring;
+
+static uint32_t drain_ring(RtLogRing* ring, fmt::memory_buffer& buffer) {
+  uint32_t read_pos = ring->read_pos.load(std::memory_order_relaxed);
+  uint32_t write_pos = ring->write_pos.load(std::memory_order_acquire);
+  uint32_t num_messages = write_pos - read_pos;
+
+  while (read_pos != write_pos) {
+    const RtLogRecord& record = ring->records[read_pos % WB_RT_LOG_RING_CAPACITY];
+    buffer.clear();
+    record.format_fn(record, buffer);
+    Log::log(record.level, "{}", std::string_view(buffer.data(), buffer.size()));
+    read_pos++;
+  }
+
+  ring->read_pos.store(read_pos, std::memory_order_release);
+
+  if (uint32_t num_dropped = ring->num_dropped.exchange(0, std::memory_order_relaxed))
+    Log::warn("{}: {} real-time log messages were dropped", ring->thread_name, num_dropped);
+
+  return num_messages;
+}
+
+static void drain_all_rings(fmt::memory_buffer& buffer) {
+  std::scoped_lock lock(ring_mtx);
+  for (uint32_t i = 0; i < rings.size();) {
+    RtLogRing* ring = rings[i];
+    bool retired = ring->retired.load(std::memory_order_acquire);
+    drain_ring(ring, buffer);
+    if (retired) {
+      delete ring;
+      rings[i] = rings.back();
+      rings.pop_back();
+      continue;
+    }
+    i++;
+  }
+}
+
+static void logger_thread_runner() {
+#ifndef NDEBUG
+  set_current_thread_name("Whitebox Logger");
+#endif
+  fmt::memory_buffer buffer;
+
+  // Producers never signal the logger thread (that would be a syscall on the real-time thread), poll instead.
+  while (running.load(std::memory_order_relaxed)) {
+    drain_all_rings(buffer);
+    std::unique_lock lock(ring_mtx);
+    logger_cv.wait_for(lock, std::chrono::milliseconds(10), [] { return !running.load(std::memory_order_relaxed); });
+  }
+
+  drain_all_rings(buffer);
+}
+
+void init_rt_log() {
+  running = true;
+  logger_thread = std::thread(logger_thread_runner);
+}
+
+void shutdown_rt_log() {
+  {
+    std::scoped_lock lock(ring_mtx);
+    running = false;
+  }
+  logger_cv.notify_one();
+  logger_thread.join();
+
+  // Rings of threads that are still alive are not freed, their thread_local pointer would dangle
+  std::scoped_lock lock(ring_mtx);
+  for (uint32_t i = 0; i < rings.size();) {
+    if (rings[i]->retired.load(std::memory_order_acquire)) {
+      delete rings[i];
+      rings[i] = rings.back();
+      rings.pop_back();
+      continue;
+    }
+    i++;
+  }
+}
+
+void rt_log_register_thread(const char* name) {
+  if (current_ring.ring)
+    return;
+  RtLogRing* ring = new RtLogRing();
+  ring->thread_name = name;
+  std::scoped_lock lock(ring_mtx);
+  rings.push_back(ring);
+  current_ring.ring = ring;
+}
+
+bool rt_log_push(const RtLogRecord& record) noexcept {
+  if (current_ring.ring == nullptr) [[unlikely]]
+    rt_log_register_thread("Unnamed thread");
+
+  RtLogRing* ring = current_ring.ring;
+  uint32_t write_pos = ring->write_pos.load(std::memory_order_relaxed);
+  uint32_t read_pos = ring->read_pos.load(std::memory_order_acquire);
+
+  if (write_pos - read_pos >= WB_RT_LOG_RING_CAPACITY) {
+    ring->num_dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  ring->records[write_pos % WB_RT_LOG_RING_CAPACITY] = record;
+  ring->write_pos.store(write_pos + 1, std::memory_order_release);
+  return true;
+}
+
+}  // namespace wb
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "common.h"
+#include "debug.h"
+
+namespace wb {
+
+// Inline copy of a string for real-time logging. Use this for strings that may change or die before the logger thread
+// formats the message (track names, etc.). Longer strings are truncated.
+struct RtLogString {
+  static constexpr uint32_t max_length = 23;
+  char str[max_length + 1];
+
+  inline RtLogString(std::string_view view) noexcept {
+    size_t length = std::min(view.size(), (size_t)max_length);
+    std::memcpy(str, view.data(), length);
+    str[length] = 0;
+  }
+};
+
+struct RtLogRecord;
+using RtLogFormatFn = void (*)(const RtLogRecord& record, fmt::memory_buffer& buffer);
+
+// A single log message. The format string is used as the message id: it must be a string literal since the message
+// is formatted later on the logger thread. Arguments are stored as raw bytes and decoded by the format function.
+struct alignas(64) RtLogRecord {
+  static constexpr uint32_t max_args_size = 40;
+  const char* format;
+  RtLogFormatFn format_fn;
+  spdlog::level::level_enum level;
+  alignas(8) std::byte args[max_args_size];
+};
+
+void init_rt_log();
+void shutdown_rt_log();
+
+// Allocates the message ring for the current thread. Real-time threads should call this before entering the
+// real-time section, otherwise the ring is allocated on the first message.
+void rt_log_register_thread(const char* name);
+
+// Wait-free, never blocks nor allocates (once the thread is registered). Returns false if the message is dropped.
+bool rt_log_push(const RtLogRecord& record) noexcept;
+
+// Logs from the real-time thread. Arguments must be trivially copyable: numbers, enums, pointers to static strings
+// (string literals, name tables) or RtLogString. Formatting and I/O happen on the logger thread.
+struct RtLog {
+  template<typename... Args>
+  static constexpr size_t get_args_size() {
+    size_t offset = 0;
+    ((offset = ((offset + alignof(Args) - 1) & ~(alignof(Args) - 1)) + sizeof(Args)), ...);
+    return offset;
+  }
+
+  template<typename... Args>
+  static constexpr auto get_args_offsets() {
+    std::array<size_t, sizeof...(Args) + 1> offsets{};
+    size_t offset = 0;
+    size_t i = 0;
+    ((offset = (offset + alignof(Args) - 1) & ~(alignof(Args) - 1), offsets[i++] = offset, offset += sizeof(Args)), ...);
+    return offsets;
+  }
+
+  template<typename T>
+  static T load_arg(const std::byte* src) {
+    alignas(T) std::byte tmp[sizeof(T)];
+    std::memcpy(tmp, src, sizeof(T));
+    return *std::launder(reinterpret_cast<T*>(tmp));
+  }
+
+  template<typename... Args, size_t... I>
+  static void format_args(const RtLogRecord& record, fmt::memory_buffer& buffer, std::index_sequence<I...>) {
+    [[maybe_unused]] static constexpr auto offsets = get_args_offsets<Args...>();
+    fmt::format_to(std::back_inserter(buffer), fmt::runtime(record.format), load_arg<Args>(record.args + offsets[I])...);
+  }
+
+  template<typename... Args>
+  static void format_record(const RtLogRecord& record, fmt::memory_buffer& buffer) {
+    format_args<Args...>(record, buffer, std::index_sequence_for<Args...>{});
+  }
+
+  template<typename... Args>
+  static bool log(spdlog::level::level_enum level, const char* format, Args... args) noexcept {
+    static_assert((std::is_trivially_copyable_v<Args> && ...), "Real-time log arguments must be trivially copyable");
+    static_assert(get_args_size<Args...>() <= RtLogRecord::max_args_size, "Too many real-time log arguments");
+    static constexpr auto offsets = get_args_offsets<Args...>();
+    RtLogRecord record;
+    record.format = format;
+    record.format_fn = &format_record<Args...>;
+    record.level = level;
+    size_t i = 0;
+    ((std::memcpy(record.args + offsets[i++], &args, sizeof(Args))), ...);
+    return rt_log_push(record);
+  }
+
+  template<typename... Args>
+  static bool trace(fmt::format_string<Args...> str, Args... args) noexcept {
+    return log(spdlog::level::trace, fmt::string_view(str).data(), args...);
+  }
+
+  template<typename... Args>
+  static bool debug(fmt::format_string<Args...> str, Args... args) noexcept {
+    return log(spdlog::level::debug, fmt::string_view(str).data(), args...);
+  }
+
+  template<typename... Args>
+  static bool info(fmt::format_string<Args...> str, Args... args) noexcept {
+    return log(spdlog::level::info, fmt::string_view(str).data(), args...);
+  }
+
+  template<typename... Args>
+  static bool warn(fmt::format_string<Args...> str, Args... args) noexcept {
+    return log(spdlog::level::warn, fmt::string_view(str).data(), args...);
+  }
+
+  template<typename... Args>
+  static bool error(fmt::format_string<Args...> str, Args... args) noexcept {
+    return log(spdlog::level::err, fmt::string_view(str).data(), args...);
+  }
+};
+
+}  // namespace wb
+
+template<>
+struct fmt::formatter<wb::RtLogString> : fmt::formatter<const char*> {
+  auto format(const wb::RtLogString& value, format_context& ctx) const {
+    return fmt::formatter<const char*>::format(value.str, ctx);
+  }
+};
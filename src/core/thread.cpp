@@ -1,11 +1,26 @@
 #include "thread.h"
 
+#include <algorithm>
+#include <cstring>
 #include <thread>
 
 #include "debug.h"
+#include "rt_log.h"
 
 #ifdef WB_PLATFORM_WINDOWS
 #include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifdef WB_PLATFORM_LINUX
+#include <SDL3/SDL_hints.h>
+#include <SDL3/SDL_thread.h>
+#endif
+
+#if defined(__SSE__) || defined(_M_AMD64) || defined(_M_X64)
+#include <xmmintrin.h>
 #endif
 
 namespace wb {
@@ -49,7 +64,110 @@ void set_current_thread_name(const char* name) {
     RaiseException(MS_VC_EXCEPTION, 0, sizeof(info) / sizeof(ULONG_PTR), (ULONG_PTR*)&info);
   } __except (GetExceptionCode() == MS_VC_EXCEPTION ? EXCEPTION_CONTINUE_EXECUTION : EXCEPTION_EXECUTE_HANDLER) {
   }
+#elif defined(WB_PLATFORM_LINUX)
+  char truncated_name[16]{};  // Linux limits thread name to 15 characters
+  std::strncpy(truncated_name, name, sizeof(truncated_name) - 1);
+  pthread_setname_np(pthread_self(), truncated_name);
+#endif
+}
+
+bool set_current_thread_realtime(int32_t priority, bool* used_rtkit) {
+  if (used_rtkit)
+    *used_rtkit = false;
+#ifdef WB_PLATFORM_WINDOWS
+  return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+#else
+  sched_param param{};
+  param.sched_priority = std::clamp(priority, sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+  int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  if (ret == 0)
+    return true;
+#ifdef WB_PLATFORM_LINUX
+  // We are not allowed to use real-time scheduling directly (no CAP_SYS_NICE or RLIMIT_RTPRIO). SDL asks rtkit over
+  // D-Bus when setting time critical priority fails.
+  SDL_SetHint(SDL_HINT_THREAD_PRIORITY_POLICY, "fifo");
+  SDL_SetHint(SDL_HINT_THREAD_FORCE_REALTIME_TIME_CRITICAL, "1");
+  if (SDL_SetCurrentThreadPriority(SDL_THREAD_PRIORITY_TIME_CRITICAL)) {
+    if (used_rtkit)
+      *used_rtkit = true;
+    return true;
+  }
+#endif
+  Log::warn("Cannot set real-time priority: {}", std::strerror(ret));
+  return false;
 #endif
 }
 
+#ifdef WB_PLATFORM_LINUX
+static bool set_thread_affinity_impl(pthread_t thread, uint64_t cpu_mask) {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (uint32_t i = 0; i < 64; i++) {
+    if (cpu_mask & (1ull << i))
+      CPU_SET(i, &cpu_set);
+  }
+  int ret = pthread_setaffinity_np(thread, sizeof(cpu_set), &cpu_set);
+  if (ret != 0) {
+    Log::warn("Cannot set thread affinity: {}", std::strerror(ret));
+    return false;
+  }
+  return true;
+}
+#endif
+
+bool set_current_thread_affinity(uint64_t cpu_mask) {
+  if (cpu_mask == 0)
+    return false;
+#if defined(WB_PLATFORM_WINDOWS)
+  return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)cpu_mask) != 0;
+#elif defined(WB_PLATFORM_LINUX)
+  return set_thread_affinity_impl(pthread_self(), cpu_mask);
+#else
+  return false;  // macOS does not support explicit thread affinity
+#endif
+}
+
+bool set_thread_affinity(std::thread& thread, uint64_t cpu_mask) {
+  if (cpu_mask == 0 || !thread.joinable())
+    return false;
+#if defined(WB_PLATFORM_WINDOWS)
+  return SetThreadAffinityMask((HANDLE)thread.native_handle(), (DWORD_PTR)cpu_mask) != 0;
+#elif defined(WB_PLATFORM_LINUX)
+  return set_thread_affinity_impl(thread.native_handle(), cpu_mask);
+#else
+  return false;
+#endif
+}
+
+bool disable_denormals() {
+#if defined(__SSE__) || defined(_M_AMD64) || defined(_M_X64)
+  _mm_setcsr(_mm_getcsr() | 0x8040);  // FTZ (bit 15) | DAZ (bit 6)
+  return true;
+#elif defined(__aarch64__)
+  uint64_t fpcr;
+  __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+  __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr | (1ull << 24)));  // FZ
+  return true;
+#else
+  return false;
+#endif
+}
+
+RealtimeThreadStatus setup_realtime_thread(const char* name, int32_t priority, uint64_t cpu_mask) {
+  RealtimeThreadStatus status{};
+  set_current_thread_name(name);
+  status.priority = set_current_thread_realtime(priority, &status.rtkit);
+  status.affinity = set_current_thread_affinity(cpu_mask);
+  status.denormals = disable_denormals();
+  rt_log_register_thread(name);
+  Log::info(
+      "{}: real-time priority: {}{}, affinity: {}, FTZ/DAZ: {}",
+      name,
+      status.priority ? "yes" : "no",
+      status.rtkit ? " (rtkit)" : "",
+      cpu_mask == 0 ? "default" : (status.affinity ? "yes" : "no"),
+      status.denormals ? "yes" : "no");
+  return status;
+}
+
 }  // namespace wb
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <thread>
 
 #include "common.h"
+#include "rt_check.h"
 
 namespace wb {
 
@@ -19,6 +20,7 @@ struct Spinlock {
     for (;;) {
       if (!lock_.exchange(true, std::memory_order_acquire))
         return;
+      WB_RT_CHECK_REPORT(RtViolationType::MutexWait, "Spinlock::lock");
       while (lock_.load(std::memory_order_relaxed))
         std::this_thread::yield();
     }
@@ -28,6 +30,10 @@ struct Spinlock {
     lock_.store(false, std::memory_order_release);
   }
 
+  inline bool is_locked() const noexcept {
+    return lock_.load(std::memory_order_relaxed);
+  }
+
   inline void wait() noexcept {
     while (lock_.load(std::memory_order_relaxed))
       std::this_thread::yield();
@@ -48,4 +54,24 @@ inline void accurate_sleep(const std::chrono::duration<T, Period>& duration) {
 
 void set_current_thread_name(const char* name);
 
+struct RealtimeThreadStatus {
+  bool priority;   // Real-time scheduling has been applied
+  bool rtkit;      // Real-time scheduling was granted by rtkit instead of applied directly
+  bool affinity;   // Thread has been pinned to the requested cores
+  bool denormals;  // Denormals are flushed to zero (FTZ/DAZ)
+};
+
+// Request real-time scheduling (SCHED_FIFO) for the current thread. On Linux, this falls back to rtkit if the process
+// is not allowed to change its scheduling policy directly.
+bool set_current_thread_realtime(int32_t priority, bool* used_rtkit = nullptr);
+
+// Pin the current thread to the cores specified in cpu_mask (bit N = core N). Zero mask leaves the affinity unchanged.
+bool set_current_thread_affinity(uint64_t cpu_mask);
+bool set_thread_affinity(std::thread& thread, uint64_t cpu_mask);
+
+// Enable flush-to-zero and denormals-are-zero for the current thread.
+bool disable_denormals();
+
+RealtimeThreadStatus setup_realtime_thread(const char* name, int32_t priority, uint64_t cpu_mask);
+
 }  // namespace wb
@@ -0,0 +1,161 @@
+#include "undo_journal.h"
+
+#include "debug.h"
+
+namespace wb {
+
+UndoJournal::~UndoJournal() {
+  if (spill_file.is_open()) {
+    spill_file.close();
+    std::error_code ec;
+    std::filesystem::remove(spill_path, ec);
+  }
+}
+
+void UndoJournal::init(const UndoJournalConfig& config) {
+  arena.resize_fast((uint32_t)config.memory_budget);
+  spill_capacity = config.spill_budget;
+  spill_path = config.spill_path;
+  clear();
+}
+
+void UndoJournal::clear() {
+  base_id += entries.size();
+  entries.clear();
+  num_spilled = 0;
+  spill_begin = 0;
+  memory_begin = 0;
+  end = 0;
+}
+
+uint64_t UndoJournal::push(const void* data, uint32_t size) {
+  if (arena.empty() || size > arena.size())
+    return WB_INVALID_JOURNAL_ENTRY;
+  while (end + size - memory_begin > arena.size())
+    evict_oldest_();
+  write_arena_(end, data, size);
+  entries.push_back({ .offset = end, .size = size });
+  end += size;
+  return next_id() - 1;
+}
+
+bool UndoJournal::pop(uint64_t id, Vector<std::byte>& data) {
+  if (entries.empty() || id != next_id() - 1)
+    return false;
+
+  Entry entry = entries.back();
+  bool success = true;
+  data.resize(entry.size);
+
+  if (entries.size() <= num_spilled) {
+    // The memory arena is empty, the record comes from the spill file
+    success = read_spill_(entry.offset, data.data(), entry.size);
+    memory_begin = entry.offset;
+    num_spilled--;
+  } else {
+    read_arena_(entry.offset, data.data(), entry.size);
+  }
+
+  entries.pop_back();
+  end = entry.offset;
+  if (num_spilled == 0)
+    spill_begin = memory_begin;
+
+  return success;
+}
+
+void UndoJournal::evict_oldest_() {
+  assert(num_spilled < entries.size());
+  Entry entry = entries[num_spilled];
+
+  if (entry.size <= spill_capacity && open_spill_file_()) {
+    while (entry.offset + entry.size - spill_begin > spill_capacity)
+      drop_spilled_();
+    spill_buffer.resize_fast(entry.size);
+    read_arena_(entry.offset, spill_buffer.data(), entry.size);
+    if (write_spill_(entry.offset, spill_buffer.data(), entry.size)) {
+      num_spilled++;
+      memory_begin = entry.offset + entry.size;
+      return;
+    }
+  }
+
+  // The record cannot be spilled, drop it along with every older record
+  entries.erase_at(0, num_spilled + 1);
+  base_id += num_spilled + 1;
+  num_spilled = 0;
+  memory_begin = entry.offset + entry.size;
+  spill_begin = memory_begin;
+}
+
+void UndoJournal::drop_spilled_() {
+  assert(num_spilled > 0);
+  entries.erase_at(0);
+  base_id++;
+  num_spilled--;
+  spill_begin = num_spilled > 0 ? entries[0].offset : memory_begin;
+}
+
+void UndoJournal::write_arena_(uint64_t offset, const void* data, uint32_t size) {
+  uint32_t capacity = arena.size();
+  uint32_t pos = (uint32_t)(offset % capacity);
+  uint32_t first_part = std::min(size, capacity - pos);
+  std::memcpy(arena.data() + pos, data, first_part);
+  std::memcpy(arena.data(), (const std::byte*)data + first_part, size - first_part);
+}
+
+void UndoJournal::read_arena_(uint64_t offset, void* data, uint32_t size) const {
+  uint32_t capacity = arena.size();
+  uint32_t pos = (uint32_t)(offset % capacity);
+  uint32_t first_part = std::min(size, capacity - pos);
+  std::memcpy(data, arena.data() + pos, first_part);
+  std::memcpy((std::byte*)data + first_part, arena.data(), size - first_part);
+}
+
+bool UndoJournal::write_spill_(uint64_t offset, const void* data, uint32_t size) {
+  uint64_t pos = offset % spill_capacity;
+  uint32_t first_part = (uint32_t)std::min((uint64_t)size, spill_capacity - pos);
+  spill_file.seekp((std::streamoff)pos);
+  spill_file.write((const char*)data, first_part);
+  if (first_part < size) {
+    spill_file.seekp(0);
+    spill_file.write((const char*)data + first_part, size - first_part);
+  }
+  if (!spill_file.good()) {
+    spill_file.clear();
+    return false;
+  }
+  return true;
+}
+
+bool UndoJournal::read_spill_(uint64_t offset, void* data, uint32_t size) {
+  uint64_t pos = offset % spill_capacity;
+  uint32_t first_part = (uint32_t)std::min((uint64_t)size, spill_capacity - pos);
+  spill_file.seekg((std::streamoff)pos);
+  spill_file.read((char*)data, first_part);
+  if (first_part < size) {
+    spill_file.seekg(0);
+    spill_file.read((char*)data + first_part, size - first_part);
+  }
+  if (!spill_file.good()) {
+    spill_file.clear();
+    return false;
+  }
+  return true;
+}
+
+bool UndoJournal::open_spill_file_() {
+  if (spill_file.is_open())
+    return true;
+  if (spill_path.empty())
+    return false;
+  spill_file.open(spill_path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!spill_file.is_open()) {
+    Log::warn("Cannot open undo history spill file {}", spill_path.string());
+    spill_capacity = 0;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace wb
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+
+#include "common.h"
+#include "vector.h"
+
+#define WB_INVALID_JOURNAL_ENTRY (~0ULL)
+
+namespace wb {
+
+struct UndoJournalConfig {
+  size_t memory_budget = 8 * 1024 * 1024;  // Bytes kept in memory
+  size_t spill_budget = 0;                 // Bytes kept in the spill file, 0 disables spilling
+  std::filesystem::path spill_path;
+};
+
+// Stack of variable-sized undo records. Records are stored in a fixed-size ring arena, the oldest records are moved
+// into the spill file once the arena is full, and dropped once the spill budget is exceeded. The spill file is also
+// used as a ring, so both memory and disk usage stay within their budget.
+//
+// Records are addressed by a monotonic id. Only the newest record can be popped, records older than first_id() are
+// gone and cannot be restored anymore.
+struct UndoJournal {
+  struct Entry {
+    uint64_t offset;  // Logical byte offset, the physical offset is offset % capacity
+    uint32_t size;
+  };
+
+  Vector<std::byte> arena;
+  Vector<Entry> entries;
+  Vector<std::byte> spill_buffer;
+  uint64_t base_id = 0;      // Id of entries[0]
+  uint32_t num_spilled = 0;  // entries[0..num_spilled) are stored in the spill file
+  uint64_t spill_begin = 0;  // Logical offset of the oldest spilled byte
+  uint64_t memory_begin = 0;
+  uint64_t end = 0;
+  size_t spill_capacity = 0;
+  std::filesystem::path spill_path;
+  std::fstream spill_file;
+
+  UndoJournal() = default;
+  ~UndoJournal();
+
+  void init(const UndoJournalConfig& config);
+  void clear();
+
+  /**
+   * @brief Push a new record.
+   *
+   * @param data Record data.
+   * @param size Record size in bytes.
+   * @return Record id, or WB_INVALID_JOURNAL_ENTRY if the record does not fit in the memory budget.
+   */
+  uint64_t push(const void* data, uint32_t size);
+
+  /**
+   * @brief Read and remove the newest record.
+   *
+   * @param id Record id, must be the newest record.
+   * @param data Output buffer.
+   * @return false if the record does not exist anymore.
+   */
+  bool pop(uint64_t id, Vector<std::byte>& data);
+
+  inline uint64_t first_id() const {
+    return base_id;
+  }
+
+  inline uint64_t next_id() const {
+    return base_id + entries.size();
+  }
+
+  inline uint32_t num_entries() const {
+    return entries.size();
+  }
+
+  inline size_t memory_used() const {
+    return end - memory_begin;
+  }
+
+  inline size_t spill_used() const {
+    return memory_begin - spill_begin;
+  }
+
+  void evict_oldest_();
+  void drop_spilled_();
+  void write_arena_(uint64_t offset, const void* data, uint32_t size);
+  void read_arena_(uint64_t offset, void* data, uint32_t size) const;
+  bool write_spill_(uint64_t offset, const void* data, uint32_t size);
+  bool read_spill_(uint64_t offset, void* data, uint32_t size);
+  bool open_spill_file_();
+};
+
+}  // namespace wb
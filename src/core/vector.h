@@ -12,6 +12,8 @@ namespace wb {
 
 template<typename T>
 struct Vector {
+  using value_type = T;
+
   T* data_{};
   uint32_t size_{};
   uint32_t capacity_{};
@@ -340,7 +342,6 @@ struct Vector {
     if (size > size_) {
       reserve(size);
       fill_n(data_ + size_, default_value, size - size_);
-      return;
     }
     if constexpr (!std::is_trivially_destructible_v<T>) {
       if (size < size_) {
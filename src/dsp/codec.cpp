@@ -1,7 +1,33 @@
 #include "codec.h"
 
+#include <vorbis/vorbisfile.h>
+
+#include "core/core_math.h"
+#include "extern/dr_mp3.h"
+
 namespace wb::dsp {
 
+// Read float frames and convert them to integer PCM. Used by decoders that only produce float samples.
+template<typename T, typename ReadFn>
+static size_t read_converted(T* data, uint32_t n_channels, uint32_t num_frames, ReadFn&& read_f32) {
+  static constexpr uint32_t chunk_frames = 256;
+  static constexpr float scale = (float)std::numeric_limits<T>::max();
+  float buffer[chunk_frames * 8];
+  uint32_t max_chunk_frames = sizeof(buffer) / sizeof(float) / math::max(n_channels, 1u);
+  size_t total_read = 0;
+  while (total_read < num_frames) {
+    uint32_t frames_to_read = math::min(num_frames - (uint32_t)total_read, max_chunk_frames);
+    size_t num_read = read_f32(buffer, frames_to_read);
+    if (num_read == 0)
+      break;
+    T* dst = data + total_read * n_channels;
+    for (size_t i = 0; i < num_read * n_channels; i++)
+      dst[i] = (T)((double)math::clamp(buffer[i], -1.0f, 1.0f) * scale);
+    total_read += num_read;
+  }
+  return total_read;
+}
+
 AudioSFEncoder::AudioSFEncoder(uint32_t file_format, AudioFormat sample_format)
     : file_format_(file_format),
       sample_format_(sample_format) {
@@ -69,6 +95,8 @@ bool AudioSFDecoder::open(const char* file) {
   }
 
   channels = info.channels;
+  sample_rate = info.samplerate;
+  num_frames = info.frames;
 
   return true;
 }
@@ -80,6 +108,10 @@ void AudioSFDecoder::close() {
   }
 }
 
+bool AudioSFDecoder::seek(uint64_t frame) {
+  return sf_seek(snd_file, (sf_count_t)frame, SEEK_SET) >= 0;
+}
+
 size_t AudioSFDecoder::read_i16(int16_t* data, uint32_t n_channels, uint32_t num_frames) {
   return sf_readf_short(snd_file, data, num_frames);
 }
@@ -92,4 +124,261 @@ size_t AudioSFDecoder::read_f32(float* data, uint32_t n_channels, uint32_t num_f
   return sf_readf_float(snd_file, data, num_frames);
 }
 
+// --------------------------------------------------------------------------------------------------
+
+AudioMP3Decoder::~AudioMP3Decoder() {
+  close();
+}
+
+bool AudioMP3Decoder::open(const char* file) {
+  if (mp3_)
+    return false;
+
+  drmp3* mp3 = new drmp3();
+  if (!drmp3_init_file(mp3, file, nullptr)) {
+    delete mp3;
+    return false;
+  }
+
+  // Counting MP3 frames requires decoding the whole file, the length is left unknown
+  mp3_ = mp3;
+  format = AudioFormat::F32;
+  channels = mp3->channels;
+  sample_rate = mp3->sampleRate;
+  num_frames = 0;
+  return true;
+}
+
+void AudioMP3Decoder::close() {
+  if (mp3_) {
+    drmp3_uninit((drmp3*)mp3_);
+    delete (drmp3*)mp3_;
+    mp3_ = nullptr;
+  }
+}
+
+bool AudioMP3Decoder::seek(uint64_t frame) {
+  return drmp3_seek_to_pcm_frame((drmp3*)mp3_, frame);
+}
+
+size_t AudioMP3Decoder::read_i16(int16_t* data, uint32_t n_channels, uint32_t num_frames) {
+  return drmp3_read_pcm_frames_s16((drmp3*)mp3_, num_frames, data);
+}
+
+size_t AudioMP3Decoder::read_i32(int32_t* data, uint32_t n_channels, uint32_t num_frames) {
+  return read_converted(data, n_channels, num_frames, [this, n_channels](float* buffer, uint32_t frames) {
+    return read_f32(buffer, n_channels, frames);
+  });
+}
+
+size_t AudioMP3Decoder::read_f32(float* data, uint32_t n_channels, uint32_t num_frames) {
+  return drmp3_read_pcm_frames_f32((drmp3*)mp3_, num_frames, data);
+}
+
+// --------------------------------------------------------------------------------------------------
+
+AudioVorbisDecoder::~AudioVorbisDecoder() {
+  close();
+}
+
+bool AudioVorbisDecoder::open(const char* file) {
+  if (vf_)
+    return false;
+
+  OggVorbis_File* vf = new OggVorbis_File();
+  if (ov_fopen(file, vf) != 0) {
+    delete vf;
+    return false;
+  }
+
+  vorbis_info* info = ov_info(vf, -1);
+  vf_ = vf;
+  format = AudioFormat::F32;
+  channels = info->channels;
+  sample_rate = (uint32_t)info->rate;
+  ogg_int64_t total = ov_pcm_total(vf, -1);
+  num_frames = total > 0 ? (uint64_t)total : 0;
+  return true;
+}
+
+void AudioVorbisDecoder::close() {
+  if (vf_) {
+    ov_clear((OggVorbis_File*)vf_);
+    delete (OggVorbis_File*)vf_;
+    vf_ = nullptr;
+  }
+}
+
+bool AudioVorbisDecoder::seek(uint64_t frame) {
+  return ov_pcm_seek((OggVorbis_File*)vf_, (ogg_int64_t)frame) == 0;
+}
+
+size_t AudioVorbisDecoder::read_i16(int16_t* data, uint32_t n_channels, uint32_t num_frames) {
+  return read_converted(data, n_channels, num_frames, [this, n_channels](float* buffer, uint32_t frames) {
+    return read_f32(buffer, n_channels, frames);
+  });
+}
+
+size_t AudioVorbisDecoder::read_i32(int32_t* data, uint32_t n_channels, uint32_t num_frames) {
+  return read_converted(data, n_channels, num_frames, [this, n_channels](float* buffer, uint32_t frames) {
+    return read_f32(buffer, n_channels, frames);
+  });
+}
+
+size_t AudioVorbisDecoder::read_f32(float* data, uint32_t n_channels, uint32_t num_frames) {
+  size_t total_read = 0;
+  int current_bitstream = 0;
+  while (total_read < num_frames) {
+    float** decode_channels = nullptr;
+    long ret = ov_read_float((OggVorbis_File*)vf_, &decode_channels, (int)(num_frames - total_read), &current_bitstream);
+    if (ret <= 0)
+      break;
+    float* dst = data + total_read * n_channels;
+    for (long i = 0; i < ret; i++)
+      for (uint32_t c = 0; c < n_channels; c++)
+        dst[i * n_channels + c] = decode_channels[c][i];
+    total_read += ret;
+  }
+  return total_read;
+}
+
+// --------------------------------------------------------------------------------------------------
+
+AudioFlacDecoder::~AudioFlacDecoder() {
+  close();
+}
+
+bool AudioFlacDecoder::open(const char* file) {
+  if (file_.is_open())
+    return false;
+  if (!file_.open(file))
+    return false;
+  if (!stream_.open(file_.data(), file_.size())) {
+    file_.close();
+    return false;
+  }
+
+  format = stream_.bits_per_sample <= 16 ? AudioFormat::I16 : AudioFormat::I32;
+  channels = stream_.channels;
+  sample_rate = stream_.sample_rate;
+  num_frames = stream_.num_frames;
+  block_.resize(stream_.max_block_size * stream_.channels);
+  next_offset_ = stream_.first_frame_offset;
+  block_position_ = 0;
+  block_frames_ = 0;
+  return true;
+}
+
+void AudioFlacDecoder::close() {
+  file_.close();
+  stream_ = {};
+  block_.resize(0);
+}
+
+bool AudioFlacDecoder::seek(uint64_t frame) {
+  if (!file_.is_open())
+    return false;
+
+  // Bisect on byte offsets to get close, then walk frame by frame
+  FlacFrameHeader header;
+  size_t low = stream_.first_frame_offset;
+  size_t high = stream_.size;
+  while (high - low > 64 * 1024) {
+    size_t mid = low + (high - low) / 2;
+    size_t offset = stream_.find_frame(mid, header);
+    if (offset < high && header.first_frame <= frame)
+      low = offset;
+    else
+      high = mid;
+  }
+
+  next_offset_ = low;
+  block_position_ = 0;
+  block_frames_ = 0;
+  while (decode_next_frame_(header)) {
+    if (frame < header.first_frame + header.block_size) {
+      block_position_ = (uint32_t)(frame - math::min(frame, header.first_frame));
+      return true;
+    }
+  }
+  return frame == num_frames;
+}
+
+size_t AudioFlacDecoder::read_i16(int16_t* data, uint32_t n_channels, uint32_t num_frames) {
+  return read_converted(data, n_channels, num_frames, [this, n_channels](float* buffer, uint32_t frames) {
+    return read_f32(buffer, n_channels, frames);
+  });
+}
+
+size_t AudioFlacDecoder::read_i32(int32_t* data, uint32_t n_channels, uint32_t num_frames) {
+  return read_converted(data, n_channels, num_frames, [this, n_channels](float* buffer, uint32_t frames) {
+    return read_f32(buffer, n_channels, frames);
+  });
+}
+
+size_t AudioFlacDecoder::read_f32(float* data, uint32_t n_channels, uint32_t num_frames) {
+  float scale = 1.0f / (float)(1u << (stream_.bits_per_sample - 1));
+  size_t total_read = 0;
+  while (total_read < num_frames) {
+    if (block_position_ >= block_frames_) {
+      FlacFrameHeader header;
+      block_position_ = 0;
+      if (!decode_next_frame_(header))
+        break;
+    }
+    uint32_t count = math::min(block_frames_ - block_position_, num_frames - (uint32_t)total_read);
+    float* dst = data + total_read * n_channels;
+    for (uint32_t c = 0; c < n_channels; c++) {
+      const int32_t* src = block_.data() + math::min(c, channels - 1) * stream_.max_block_size + block_position_;
+      for (uint32_t i = 0; i < count; i++)
+        dst[i * n_channels + c] = (float)src[i] * scale;
+    }
+    block_position_ += count;
+    total_read += count;
+  }
+  return total_read;
+}
+
+bool AudioFlacDecoder::decode_next_frame_(FlacFrameHeader& header) {
+  int32_t* block_channels[FlacStream::max_channels];
+  for (uint32_t i = 0; i < stream_.channels; i++)
+    block_channels[i] = block_.data() + i * stream_.max_block_size;
+
+  // Damaged frames are skipped
+  while (next_offset_ < stream_.size) {
+    size_t offset = next_offset_;
+    if (!stream_.read_frame_header(offset, header))
+      offset = stream_.find_frame(offset, header);
+    if (offset >= stream_.size)
+      break;
+    if (stream_.decode_frame(offset, header, block_channels, &next_offset_)) {
+      block_frames_ = header.block_size;
+      return true;
+    }
+    next_offset_ = offset + 1;
+  }
+  next_offset_ = stream_.size;
+  block_frames_ = 0;
+  return false;
+}
+
+// --------------------------------------------------------------------------------------------------
+
+std::unique_ptr<AudioDecoder> open_audio_decoder(const std::filesystem::path& path) {
+  std::string str_path = path.generic_string();
+  std::unique_ptr<AudioDecoder> decoder = std::make_unique<AudioSFDecoder>();
+  if (decoder->open(str_path.c_str()))
+    return decoder;
+  decoder = std::make_unique<AudioFlacDecoder>();
+  if (decoder->open(str_path.c_str()))
+    return decoder;
+  decoder = std::make_unique<AudioMP3Decoder>();
+  if (decoder->open(str_path.c_str()))
+    return decoder;
+  decoder = std::make_unique<AudioVorbisDecoder>();
+  if (decoder->open(str_path.c_str()))
+    return decoder;
+  return nullptr;
+}
+
 }  // namespace wb::dsp
\ No newline at end of file
@@ -2,9 +2,14 @@
 
 #include <sndfile.h>
 
+#include <filesystem>
+#include <memory>
 #include <string_view>
 
 #include "core/audio_format.h"
+#include "core/fs.h"
+#include "core/vector.h"
+#include "flac.h"
 
 namespace wb::dsp {
 
@@ -19,11 +24,14 @@ struct AudioEncoder {
 struct AudioDecoder {
   AudioFormat format{};
   uint32_t channels{};
+  uint32_t sample_rate{};
+  uint64_t num_frames{};  // 0 if the length is unknown without decoding the whole file
 
   virtual ~AudioDecoder() {
   }
   virtual bool open(const char* file) = 0;
   virtual void close() = 0;
+  virtual bool seek(uint64_t frame) = 0;
   virtual size_t read_i16(int16_t* data, uint32_t n_channels, uint32_t num_frames) = 0;
   virtual size_t read_i32(int32_t* data, uint32_t n_channels, uint32_t num_frames) = 0;
   virtual size_t read_f32(float* data, uint32_t n_channels, uint32_t num_frames) = 0;
@@ -53,9 +61,56 @@ struct AudioSFDecoder final : public AudioDecoder {
   ~AudioSFDecoder();
   bool open(const char* file) override;
   void close() override;
+  bool seek(uint64_t frame) override;
   size_t read_i16(int16_t* data, uint32_t n_channels, uint32_t num_frames) override;
   size_t read_i32(int32_t* data, uint32_t n_channels, uint32_t num_frames) override;
   size_t read_f32(float* data, uint32_t n_channels, uint32_t num_frames) override;
 };
 
+// Compressed formats decode to 32-bit float, integer reads are converted.
+struct AudioMP3Decoder final : public AudioDecoder {
+  void* mp3_{};  // drmp3
+
+  ~AudioMP3Decoder();
+  bool open(const char* file) override;
+  void close() override;
+  bool seek(uint64_t frame) override;
+  size_t read_i16(int16_t* data, uint32_t n_channels, uint32_t num_frames) override;
+  size_t read_i32(int32_t* data, uint32_t n_channels, uint32_t num_frames) override;
+  size_t read_f32(float* data, uint32_t n_channels, uint32_t num_frames) override;
+};
+
+struct AudioVorbisDecoder final : public AudioDecoder {
+  void* vf_{};  // OggVorbis_File
+
+  ~AudioVorbisDecoder();
+  bool open(const char* file) override;
+  void close() override;
+  bool seek(uint64_t frame) override;
+  size_t read_i16(int16_t* data, uint32_t n_channels, uint32_t num_frames) override;
+  size_t read_i32(int32_t* data, uint32_t n_channels, uint32_t num_frames) override;
+  size_t read_f32(float* data, uint32_t n_channels, uint32_t num_frames) override;
+};
+
+struct AudioFlacDecoder final : public AudioDecoder {
+  MappedFile file_;
+  FlacStream stream_;
+  Vector<int32_t> block_;  // Decoded samples of the current frame, one block per channel
+  size_t next_offset_ = 0;
+  uint32_t block_position_ = 0;
+  uint32_t block_frames_ = 0;
+
+  ~AudioFlacDecoder();
+  bool open(const char* file) override;
+  void close() override;
+  bool seek(uint64_t frame) override;
+  size_t read_i16(int16_t* data, uint32_t n_channels, uint32_t num_frames) override;
+  size_t read_i32(int32_t* data, uint32_t n_channels, uint32_t num_frames) override;
+  size_t read_f32(float* data, uint32_t n_channels, uint32_t num_frames) override;
+  bool decode_next_frame_(FlacFrameHeader& header);
+};
+
+// Open a streaming decoder for any supported audio file. Returns nullptr if the file cannot be decoded.
+std::unique_ptr<AudioDecoder> open_audio_decoder(const std::filesystem::path& path);
+
 }  // namespace wb::dsp
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "dsp_ops.h"
+
+#ifdef WB_DSP_OPS_X86
+#ifdef _MSC_VER
+#include <immintrin.h>
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#include "core/debug.h"
+
+namespace wb::dsp {
+
+static constexpr DSPOps scalar_ops{
+  .level = SIMDLevel::Scalar,
+  .find_abs_maximum = find_abs_maximum<float>,
+  .gain = gain<float>,
+  .apply_gain = apply_gain<float>,
+  .hard_clip = hard_clip<float>,
+  .mix = mix<float>,
+  .mix_gain = mix_gain<float>,
+  .mix_gain_ramp = mix_gain_ramp<float>,
+  .pan_accumulate = pan_accumulate<float>,
+  .hard_clip_peak = hard_clip_peak<float>,
+  .apply_gain_peak = apply_gain_peak<float>,
+};
+
+DSPOps g_dsp_ops = scalar_ops;
+
+#ifdef WB_DSP_OPS_X86
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) {
+#ifdef _MSC_VER
+  __cpuidex((int*)regs, (int)leaf, (int)subleaf);
+#else
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Register state the operating system saves on context switches
+static uint64_t get_xcr0() {
+#ifdef _MSC_VER
+  return _xgetbv(0);
+#else
+  uint32_t eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return ((uint64_t)edx << 32) | eax;
+#endif
+}
+#endif
+
+SIMDLevel get_supported_simd_level() {
+#ifdef WB_DSP_OPS_X86
+  uint32_t regs[4];
+  cpuid(0, 0, regs);
+  uint32_t max_leaf = regs[0];
+  cpuid(1, 0, regs);
+  if (!(regs[3] & (1u << 26)))
+    return SIMDLevel::Scalar;
+
+  bool has_fma = regs[2] & (1u << 12);
+  bool has_osxsave = regs[2] & (1u << 27);
+  bool has_avx = regs[2] & (1u << 28);
+  if (max_leaf < 7 || !has_osxsave || !has_avx || !has_fma)
+    return SIMDLevel::SSE2;
+
+  // XMM and YMM state
+  uint64_t xcr0 = get_xcr0();
+  if ((xcr0 & 0x6) != 0x6)
+    return SIMDLevel::SSE2;
+
+  cpuid(7, 0, regs);
+  if (!(regs[1] & (1u << 5)))
+    return SIMDLevel::SSE2;
+
+  // AVX-512F, plus opmask and ZMM state
+  if ((regs[1] & (1u << 16)) && (xcr0 & 0xE6) == 0xE6)
+    return SIMDLevel::AVX512;
+  return SIMDLevel::AVX2;
+#else
+  return SIMDLevel::Scalar;
+#endif
+}
+
+bool get_dsp_ops(SIMDLevel level, DSPOps& ops) {
+  if (level > get_supported_simd_level())
+    return false;
+  switch (level) {
+    case SIMDLevel::Scalar: ops = scalar_ops; return true;
+#ifdef WB_DSP_OPS_X86
+    case SIMDLevel::SSE2: get_dsp_ops_sse2(ops); return true;
+    case SIMDLevel::AVX2: get_dsp_ops_avx2(ops); return true;
+    case SIMDLevel::AVX512: get_dsp_ops_avx512(ops); return true;
+#endif
+    default: break;
+  }
+  return false;
+}
+
+void init_dsp_ops(SIMDLevel max_level) {
+  SIMDLevel level = math::min(get_supported_simd_level(), max_level);
+  while (!get_dsp_ops(level, g_dsp_ops))
+    level = (SIMDLevel)((int)level - 1);
+  Log::info("DSP kernels: {}", get_simd_level_name(level));
+}
+
+const char* get_simd_level_name(SIMDLevel level) {
+  switch (level) {
+    case SIMDLevel::Scalar: return "Scalar";
+    case SIMDLevel::SSE2: return "SSE2";
+    case SIMDLevel::AVX2: return "AVX2";
+    case SIMDLevel::AVX512: return "AVX-512";
+  }
+  return "Unknown";
+}
+
+}  // namespace wb::dsp
@@ -5,8 +5,15 @@
 #include "core/core_math.h"
 #include "core/types.h"
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_AMD64) || defined(_M_IX86)
+#define WB_DSP_OPS_X86 1
+#endif
+
 namespace wb::dsp {
 
+// Scalar implementations. The float overloads below dispatch to the SIMD kernels, the templates stay as the reference
+// and handle other sample types.
+
 template<std::floating_point T>
 static T find_abs_maximum(const T arr[], uint32_t count) {
   T abs_max = T(0);
@@ -37,4 +44,154 @@ static void hard_clip(const T input[], T output[], uint32_t count, const T thres
   }
 }
 
-}  // namespace wb::dsp
\ No newline at end of file
+template<std::floating_point T>
+static void mix(const T input[], T output[], uint32_t count) {
+  for (uint32_t i = 0; i < count; i++)
+    output[i] += input[i];
+}
+
+template<std::floating_point T>
+static void mix_gain(const T input[], T output[], uint32_t count, const T gain) {
+  for (uint32_t i = 0; i < count; i++)
+    output[i] += input[i] * gain;
+}
+
+// Gain moves linearly from start_gain towards end_gain, sample i gets start_gain + (end_gain - start_gain) * i / count
+template<std::floating_point T>
+static void mix_gain_ramp(const T input[], T output[], uint32_t count, const T start_gain, const T end_gain) {
+  T step = (end_gain - start_gain) / T(count);
+  for (uint32_t i = 0; i < count; i++)
+    output[i] += input[i] * (start_gain + step * T(i));
+}
+
+// Mix a mono signal into a stereo pair
+template<std::floating_point T>
+static void pan_accumulate(const T input[], T left[], T right[], uint32_t count, const T left_gain, const T right_gain) {
+  for (uint32_t i = 0; i < count; i++) {
+    left[i] += input[i] * left_gain;
+    right[i] += input[i] * right_gain;
+  }
+}
+
+// Clip the signal and return the peak of the input, so callers can tell whether it has been clipped
+template<std::floating_point T>
+static T hard_clip_peak(const T input[], T output[], uint32_t count, const T thresh = 1.0f) {
+  T abs_max = T(0);
+  for (uint32_t i = 0; i < count; i++) {
+    T v = input[i];
+    T abs_v = v < T(0) ? -v : v;
+    abs_max = abs_v < abs_max ? abs_max : abs_v;
+    output[i] = math::clamp(v, -thresh, thresh);
+  }
+  return abs_max;
+}
+
+// Apply gain and return the peak of the result, for feeding level meters
+template<std::floating_point T>
+static T apply_gain_peak(T inout[], uint32_t count, const T gain) {
+  T abs_max = T(0);
+  for (uint32_t i = 0; i < count; i++) {
+    T v = inout[i] * gain;
+    T abs_v = v < T(0) ? -v : v;
+    abs_max = abs_v < abs_max ? abs_max : abs_v;
+    inout[i] = v;
+  }
+  return abs_max;
+}
+
+enum class SIMDLevel {
+  Scalar,
+  SSE2,
+  AVX2,    // AVX2 + FMA
+  AVX512,  // AVX-512F
+};
+
+// Kernel table of one instruction set. Buffers need no particular alignment.
+struct DSPOps {
+  SIMDLevel level;
+  float (*find_abs_maximum)(const float arr[], uint32_t count);
+  void (*gain)(const float input[], float output[], uint32_t count, float gain);
+  void (*apply_gain)(float inout[], uint32_t count, float gain);
+  void (*hard_clip)(const float input[], float output[], uint32_t count, float thresh);
+  void (*mix)(const float input[], float output[], uint32_t count);
+  void (*mix_gain)(const float input[], float output[], uint32_t count, float gain);
+  void (*mix_gain_ramp)(const float input[], float output[], uint32_t count, float start_gain, float end_gain);
+  void (*pan_accumulate)(
+      const float input[], float left[], float right[], uint32_t count, float left_gain, float right_gain);
+  float (*hard_clip_peak)(const float input[], float output[], uint32_t count, float thresh);
+  float (*apply_gain_peak)(float inout[], uint32_t count, float gain);
+};
+
+// Kernels used by the float overloads. Holds the scalar kernels until init_dsp_ops() runs.
+extern DSPOps g_dsp_ops;
+
+/**
+ * @brief Select the kernels once at startup, before the audio thread starts.
+ *
+ * @param max_level Highest instruction set to use, lower than the CPU supports for testing.
+ */
+void init_dsp_ops(SIMDLevel max_level = SIMDLevel::AVX512);
+
+// Highest instruction set supported by both the CPU and the operating system
+SIMDLevel get_supported_simd_level();
+
+/**
+ * @brief Get the kernels of an instruction set.
+ *
+ * @param level Instruction set.
+ * @param ops Receives the kernels.
+ * @return False if the instruction set is not supported by this CPU or this build.
+ */
+bool get_dsp_ops(SIMDLevel level, DSPOps& ops);
+
+const char* get_simd_level_name(SIMDLevel level);
+
+#ifdef WB_DSP_OPS_X86
+// Defined in dsp_ops_<isa>.cpp, each compiled for its own instruction set
+void get_dsp_ops_sse2(DSPOps& ops);
+void get_dsp_ops_avx2(DSPOps& ops);
+void get_dsp_ops_avx512(DSPOps& ops);
+#endif
+
+inline float find_abs_maximum(const float arr[], uint32_t count) {
+  return g_dsp_ops.find_abs_maximum(arr, count);
+}
+
+inline void gain(const float input[], float output[], uint32_t count, float gain) {
+  g_dsp_ops.gain(input, output, count, gain);
+}
+
+inline void apply_gain(float inout[], uint32_t count, float gain) {
+  g_dsp_ops.apply_gain(inout, count, gain);
+}
+
+inline void hard_clip(const float input[], float output[], uint32_t count, float thresh = 1.0f) {
+  g_dsp_ops.hard_clip(input, output, count, thresh);
+}
+
+inline void mix(const float input[], float output[], uint32_t count) {
+  g_dsp_ops.mix(input, output, count);
+}
+
+inline void mix_gain(const float input[], float output[], uint32_t count, float gain) {
+  g_dsp_ops.mix_gain(input, output, count, gain);
+}
+
+inline void mix_gain_ramp(const float input[], float output[], uint32_t count, float start_gain, float end_gain) {
+  g_dsp_ops.mix_gain_ramp(input, output, count, start_gain, end_gain);
+}
+
+inline void pan_accumulate(
+    const float input[], float left[], float right[], uint32_t count, float left_gain, float right_gain) {
+  g_dsp_ops.pan_accumulate(input, left, right, count, left_gain, right_gain);
+}
+
+inline float hard_clip_peak(const float input[], float output[], uint32_t count, float thresh = 1.0f) {
+  return g_dsp_ops.hard_clip_peak(input, output, count, thresh);
+}
+
+inline float apply_gain_peak(float inout[], uint32_t count, float gain) {
+  return g_dsp_ops.apply_gain_peak(inout, count, gain);
+}
+
+}  // namespace wb::dsp
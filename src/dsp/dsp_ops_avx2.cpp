@@ -0,0 +1,61 @@
+#include "dsp_ops.h"
+
+#ifdef WB_DSP_OPS_X86
+#include <immintrin.h>
+
+#include "dsp_ops_simd.h"
+
+// Compiled with AVX2 and FMA enabled, only called after get_supported_simd_level() has checked the CPU
+namespace wb::dsp {
+namespace {
+
+struct VecAVX2 {
+  using type = __m256;
+  static constexpr uint32_t width = 8;
+
+  static inline __m256 load(const float* ptr) {
+    return _mm256_loadu_ps(ptr);
+  }
+  static inline void store(float* ptr, __m256 x) {
+    _mm256_storeu_ps(ptr, x);
+  }
+  static inline __m256 set1(float x) {
+    return _mm256_set1_ps(x);
+  }
+  static inline __m256 add(__m256 a, __m256 b) {
+    return _mm256_add_ps(a, b);
+  }
+  static inline __m256 mul(__m256 a, __m256 b) {
+    return _mm256_mul_ps(a, b);
+  }
+  static inline __m256 mul_add(__m256 a, __m256 b, __m256 c) {
+    return _mm256_fmadd_ps(a, b, c);
+  }
+  static inline __m256 min(__m256 a, __m256 b) {
+    return _mm256_min_ps(a, b);
+  }
+  static inline __m256 max(__m256 a, __m256 b) {
+    return _mm256_max_ps(a, b);
+  }
+  static inline __m256 abs(__m256 x) {
+    return _mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF)));
+  }
+  static inline float reduce_max(__m256 x) {
+    __m128 v = _mm_max_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(v);
+  }
+  static inline __m256 lane_index() {
+    return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+  }
+};
+
+}  // namespace
+
+void get_dsp_ops_avx2(DSPOps& ops) {
+  SIMDKernels<VecAVX2>::fill_ops(ops, SIMDLevel::AVX2);
+}
+
+}  // namespace wb::dsp
+#endif
@@ -0,0 +1,59 @@
+#include "dsp_ops.h"
+
+#ifdef WB_DSP_OPS_X86
+#include <immintrin.h>
+
+#include "dsp_ops_simd.h"
+
+// Compiled with AVX-512F enabled, only called after get_supported_simd_level() has checked the CPU
+namespace wb::dsp {
+namespace {
+
+struct VecAVX512 {
+  using type = __m512;
+  static constexpr uint32_t width = 16;
+
+  static inline __m512 load(const float* ptr) {
+    return _mm512_loadu_ps(ptr);
+  }
+  static inline void store(float* ptr, __m512 x) {
+    _mm512_storeu_ps(ptr, x);
+  }
+  static inline __m512 set1(float x) {
+    return _mm512_set1_ps(x);
+  }
+  static inline __m512 add(__m512 a, __m512 b) {
+    return _mm512_add_ps(a, b);
+  }
+  static inline __m512 mul(__m512 a, __m512 b) {
+    return _mm512_mul_ps(a, b);
+  }
+  static inline __m512 mul_add(__m512 a, __m512 b, __m512 c) {
+    return _mm512_fmadd_ps(a, b, c);
+  }
+  static inline __m512 min(__m512 a, __m512 b) {
+    return _mm512_min_ps(a, b);
+  }
+  static inline __m512 max(__m512 a, __m512 b) {
+    return _mm512_max_ps(a, b);
+  }
+  static inline __m512 abs(__m512 x) {
+    return _mm512_abs_ps(x);
+  }
+  static inline float reduce_max(__m512 x) {
+    return _mm512_reduce_max_ps(x);
+  }
+  static inline __m512 lane_index() {
+    return _mm512_setr_ps(
+        0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f);
+  }
+};
+
+}  // namespace
+
+void get_dsp_ops_avx512(DSPOps& ops) {
+  SIMDKernels<VecAVX512>::fill_ops(ops, SIMDLevel::AVX512);
+}
+
+}  // namespace wb::dsp
+#endif
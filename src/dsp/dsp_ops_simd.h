@@ -0,0 +1,170 @@
+#pragma once
+
+#include "dsp_ops.h"
+
+// Kernels written once against a vector type V, included by dsp_ops_<isa>.cpp. Those files are compiled with their
+// own instruction set flags, so everything here must stay internal to the including file: an inline function with
+// external linkage emitted there could be picked by the linker for callers running on older CPUs.
+//
+// V provides: type, width, load, store, set1, add, mul, mul_add (a * b + c), min, max, abs, reduce_max and lane_index
+// (0, 1, 2, ... as floats).
+
+namespace wb::dsp {
+namespace {
+
+// Tails use these instead of the math helpers, which are shared with code built for the baseline instruction set
+inline float abs_scalar(float x) {
+  return x < 0.0f ? -x : x;
+}
+
+inline float max_scalar(float a, float b) {
+  return a < b ? b : a;
+}
+
+inline float clamp_scalar(float x, float lo, float hi) {
+  float max_part = x < hi ? x : hi;
+  return max_part > lo ? max_part : lo;
+}
+
+template<typename V>
+struct SIMDKernels {
+  using vec = typename V::type;
+  static constexpr uint32_t width = V::width;
+
+  static float find_abs_maximum(const float arr[], uint32_t count) {
+    vec abs_max = V::set1(0.0f);
+    uint32_t i = 0;
+    for (; i + width <= count; i += width)
+      abs_max = V::max(abs_max, V::abs(V::load(arr + i)));
+    float result = V::reduce_max(abs_max);
+    for (; i < count; i++)
+      result = max_scalar(result, abs_scalar(arr[i]));
+    return result;
+  }
+
+  static void gain(const float input[], float output[], uint32_t count, float gain) {
+    vec g = V::set1(gain);
+    uint32_t i = 0;
+    for (; i + width <= count; i += width)
+      V::store(output + i, V::mul(V::load(input + i), g));
+    for (; i < count; i++)
+      output[i] = input[i] * gain;
+  }
+
+  static void apply_gain(float inout[], uint32_t count, float gain) {
+    SIMDKernels::gain(inout, inout, count, gain);
+  }
+
+  static void hard_clip(const float input[], float output[], uint32_t count, float thresh) {
+    vec hi = V::set1(thresh);
+    vec lo = V::set1(-thresh);
+    uint32_t i = 0;
+    for (; i + width <= count; i += width)
+      V::store(output + i, V::max(V::min(V::load(input + i), hi), lo));
+    for (; i < count; i++)
+      output[i] = clamp_scalar(input[i], -thresh, thresh);
+  }
+
+  static void mix(const float input[], float output[], uint32_t count) {
+    uint32_t i = 0;
+    for (; i + width <= count; i += width)
+      V::store(output + i, V::add(V::load(output + i), V::load(input + i)));
+    for (; i < count; i++)
+      output[i] += input[i];
+  }
+
+  static void mix_gain(const float input[], float output[], uint32_t count, float gain) {
+    vec g = V::set1(gain);
+    uint32_t i = 0;
+    for (; i + width <= count; i += width)
+      V::store(output + i, V::mul_add(V::load(input + i), g, V::load(output + i)));
+    for (; i < count; i++)
+      output[i] += input[i] * gain;
+  }
+
+  static void mix_gain_ramp(const float input[], float output[], uint32_t count, float start_gain, float end_gain) {
+    float step = (end_gain - start_gain) / (float)count;
+    // The gain is computed from the sample index instead of being accumulated, so it does not drift
+    vec start = V::set1(start_gain);
+    vec step_v = V::set1(step);
+    vec lane_index = V::lane_index();
+    uint32_t i = 0;
+    for (; i + width <= count; i += width) {
+      vec index = V::add(V::set1((float)i), lane_index);
+      vec g = V::add(start, V::mul(step_v, index));
+      V::store(output + i, V::mul_add(V::load(input + i), g, V::load(output + i)));
+    }
+    for (; i < count; i++)
+      output[i] += input[i] * (start_gain + step * (float)i);
+  }
+
+  static void pan_accumulate(
+      const float input[], float left[], float right[], uint32_t count, float left_gain, float right_gain) {
+    vec lg = V::set1(left_gain);
+    vec rg = V::set1(right_gain);
+    uint32_t i = 0;
+    for (; i + width <= count; i += width) {
+      vec x = V::load(input + i);
+      V::store(left + i, V::mul_add(x, lg, V::load(left + i)));
+      V::store(right + i, V::mul_add(x, rg, V::load(right + i)));
+    }
+    for (; i < count; i++) {
+      left[i] += input[i] * left_gain;
+      right[i] += input[i] * right_gain;
+    }
+  }
+
+  static float hard_clip_peak(const float input[], float output[], uint32_t count, float thresh) {
+    vec hi = V::set1(thresh);
+    vec lo = V::set1(-thresh);
+    vec abs_max = V::set1(0.0f);
+    uint32_t i = 0;
+    for (; i + width <= count; i += width) {
+      vec x = V::load(input + i);
+      abs_max = V::max(abs_max, V::abs(x));
+      V::store(output + i, V::max(V::min(x, hi), lo));
+    }
+    float result = V::reduce_max(abs_max);
+    for (; i < count; i++) {
+      result = max_scalar(result, abs_scalar(input[i]));
+      output[i] = clamp_scalar(input[i], -thresh, thresh);
+    }
+    return result;
+  }
+
+  static float apply_gain_peak(float inout[], uint32_t count, float gain) {
+    vec g = V::set1(gain);
+    vec abs_max = V::set1(0.0f);
+    uint32_t i = 0;
+    for (; i + width <= count; i += width) {
+      vec x = V::mul(V::load(inout + i), g);
+      abs_max = V::max(abs_max, V::abs(x));
+      V::store(inout + i, x);
+    }
+    float result = V::reduce_max(abs_max);
+    for (; i < count; i++) {
+      inout[i] *= gain;
+      result = max_scalar(result, abs_scalar(inout[i]));
+    }
+    return result;
+  }
+
+  static void fill_ops(DSPOps& ops, SIMDLevel level) {
+    ops = DSPOps{
+      .level = level,
+      .find_abs_maximum = find_abs_maximum,
+      .gain = gain,
+      .apply_gain = apply_gain,
+      .hard_clip = hard_clip,
+      .mix = mix,
+      .mix_gain = mix_gain,
+      .mix_gain_ramp = mix_gain_ramp,
+      .pan_accumulate = pan_accumulate,
+      .hard_clip_peak = hard_clip_peak,
+      .apply_gain_peak = apply_gain_peak,
+    };
+  }
+};
+
+}  // namespace
+}  // namespace wb::dsp
@@ -0,0 +1,59 @@
+#include "dsp_ops.h"
+
+#ifdef WB_DSP_OPS_X86
+#include <emmintrin.h>
+
+#include "dsp_ops_simd.h"
+
+namespace wb::dsp {
+namespace {
+
+struct VecSSE2 {
+  using type = __m128;
+  static constexpr uint32_t width = 4;
+
+  static inline __m128 load(const float* ptr) {
+    return _mm_loadu_ps(ptr);
+  }
+  static inline void store(float* ptr, __m128 x) {
+    _mm_storeu_ps(ptr, x);
+  }
+  static inline __m128 set1(float x) {
+    return _mm_set1_ps(x);
+  }
+  static inline __m128 add(__m128 a, __m128 b) {
+    return _mm_add_ps(a, b);
+  }
+  static inline __m128 mul(__m128 a, __m128 b) {
+    return _mm_mul_ps(a, b);
+  }
+  static inline __m128 mul_add(__m128 a, __m128 b, __m128 c) {
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+  }
+  static inline __m128 min(__m128 a, __m128 b) {
+    return _mm_min_ps(a, b);
+  }
+  static inline __m128 max(__m128 a, __m128 b) {
+    return _mm_max_ps(a, b);
+  }
+  static inline __m128 abs(__m128 x) {
+    return _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF)));
+  }
+  static inline float reduce_max(__m128 x) {
+    x = _mm_max_ps(x, _mm_shuffle_ps(x, x, _MM_SHUFFLE(1, 0, 3, 2)));
+    x = _mm_max_ps(x, _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(x);
+  }
+  static inline __m128 lane_index() {
+    return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+  }
+};
+
+}  // namespace
+
+void get_dsp_ops_sse2(DSPOps& ops) {
+  SIMDKernels<VecSSE2>::fill_ops(ops, SIMDLevel::SSE2);
+}
+
+}  // namespace wb::dsp
+#endif
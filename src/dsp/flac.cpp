@@ -0,0 +1,439 @@
+#include "flac.h"
+
+#include <array>
+#include <bit>
+#include <cstring>
+
+namespace wb::dsp {
+
+static constexpr uint8_t flac_stream_info_block = 0;
+
+static uint8_t flac_crc8(const uint8_t* data, size_t size) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < size; i++) {
+    crc ^= data[i];
+    for (uint32_t j = 0; j < 8; j++)
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+static uint16_t flac_crc16(const uint8_t* data, size_t size) {
+  static constexpr auto table = [] {
+    std::array<uint16_t, 256> table{};
+    for (uint32_t i = 0; i < 256; i++) {
+      uint16_t crc = (uint16_t)(i << 8);
+      for (uint32_t j = 0; j < 8; j++)
+        crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x8005) : (uint16_t)(crc << 1);
+      table[i] = crc;
+    }
+    return table;
+  }();
+  uint16_t crc = 0;
+  for (size_t i = 0; i < size; i++)
+    crc = (uint16_t)((crc << 8) ^ table[(crc >> 8) ^ data[i]]);
+  return crc;
+}
+
+// MSB-first bit reader. Running past the end of the data sets the error flag and yields zeros.
+struct FlacBitReader {
+  const uint8_t* pos;
+  const uint8_t* end;
+  uint64_t cache = 0;  // Left-aligned
+  uint32_t cache_bits = 0;
+  bool error = false;
+
+  FlacBitReader(const uint8_t* data, const uint8_t* data_end) : pos(data), end(data_end) {
+  }
+
+  inline void refill() {
+    while (cache_bits <= 56 && pos < end) {
+      cache |= (uint64_t)*pos++ << (56 - cache_bits);
+      cache_bits += 8;
+    }
+  }
+
+  inline uint32_t read(uint32_t num_bits) {
+    if (num_bits == 0)
+      return 0;
+    if (cache_bits < num_bits) {
+      refill();
+      if (cache_bits < num_bits) {
+        error = true;
+        return 0;
+      }
+    }
+    uint32_t value = (uint32_t)(cache >> (64 - num_bits));
+    cache <<= num_bits;
+    cache_bits -= num_bits;
+    return value;
+  }
+
+  inline int32_t read_signed(uint32_t num_bits) {
+    if (num_bits == 0)
+      return 0;
+    uint32_t value = read(num_bits);
+    uint32_t shift = 32 - num_bits;
+    return (int32_t)(value << shift) >> shift;
+  }
+
+  // Number of zero bits before the next one bit
+  inline uint32_t read_unary() {
+    uint32_t count = 0;
+    for (;;) {
+      if (cache_bits == 0) {
+        refill();
+        if (cache_bits == 0) {
+          error = true;
+          return 0;
+        }
+      }
+      if (cache != 0) {
+        uint32_t zeros = (uint32_t)std::countl_zero(cache);
+        // The stop bit can be the last bit of the cache, shifting by 64 at once is undefined
+        cache = (cache << zeros) << 1;
+        cache_bits -= zeros + 1;
+        return count + zeros;
+      }
+      count += cache_bits;
+      cache_bits = 0;
+    }
+  }
+
+  inline int32_t read_rice(uint32_t param) {
+    uint32_t msb = read_unary();
+    uint32_t value = (msb << param) | read(param);
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+  }
+
+  inline void align_to_byte() {
+    uint32_t skip = cache_bits % 8;
+    cache <<= skip;
+    cache_bits -= skip;
+  }
+
+  // Byte position of the reader, only valid when aligned
+  inline const uint8_t* byte_position() const {
+    return pos - cache_bits / 8;
+  }
+};
+
+static bool decode_residual(
+    FlacBitReader& reader,
+    uint32_t block_size,
+    uint32_t order,
+    int32_t* residual) {
+  uint32_t method = reader.read(2);
+  if (method > 1)
+    return false;
+  uint32_t param_bits = method == 0 ? 4 : 5;
+  uint32_t escape_param = method == 0 ? 15 : 31;
+  uint32_t partition_order = reader.read(4);
+  uint32_t num_partitions = 1u << partition_order;
+  uint32_t partition_size = block_size >> partition_order;
+  if ((partition_size << partition_order) != block_size || partition_size < order)
+    return false;
+
+  uint32_t sample = 0;
+  for (uint32_t partition = 0; partition < num_partitions; partition++) {
+    uint32_t num_samples = partition == 0 ? partition_size - order : partition_size;
+    uint32_t param = reader.read(param_bits);
+    if (param == escape_param) {
+      uint32_t num_bits = reader.read(5);
+      for (uint32_t i = 0; i < num_samples; i++)
+        residual[sample++] = reader.read_signed(num_bits);
+    } else {
+      for (uint32_t i = 0; i < num_samples; i++)
+        residual[sample++] = reader.read_rice(param);
+    }
+    if (reader.error)
+      return false;
+  }
+  return true;
+}
+
+static bool decode_subframe(FlacBitReader& reader, uint32_t block_size, uint32_t bits_per_sample, int32_t* output) {
+  if (reader.read(1) != 0)
+    return false;
+  uint32_t type = reader.read(6);
+  uint32_t wasted_bits = 0;
+  if (reader.read(1)) {
+    wasted_bits = reader.read_unary() + 1;
+    if (wasted_bits >= bits_per_sample)
+      return false;
+    bits_per_sample -= wasted_bits;
+  }
+
+  if (type == 0) {
+    int32_t value = reader.read_signed(bits_per_sample);
+    for (uint32_t i = 0; i < block_size; i++)
+      output[i] = value;
+  } else if (type == 1) {
+    for (uint32_t i = 0; i < block_size; i++)
+      output[i] = reader.read_signed(bits_per_sample);
+  } else if (type >= 8 && type <= 12) {
+    uint32_t order = type - 8;
+    if (order > block_size)
+      return false;
+    for (uint32_t i = 0; i < order; i++)
+      output[i] = reader.read_signed(bits_per_sample);
+    if (!decode_residual(reader, block_size, order, output + order))
+      return false;
+    // Fixed predictors, the residual is replaced by the prediction in place
+    switch (order) {
+      case 1:
+        for (uint32_t i = 1; i < block_size; i++)
+          output[i] += output[i - 1];
+        break;
+      case 2:
+        for (uint32_t i = 2; i < block_size; i++)
+          output[i] += 2 * output[i - 1] - output[i - 2];
+        break;
+      case 3:
+        for (uint32_t i = 3; i < block_size; i++)
+          output[i] += 3 * output[i - 1] - 3 * output[i - 2] + output[i - 3];
+        break;
+      case 4:
+        for (uint32_t i = 4; i < block_size; i++)
+          output[i] += 4 * output[i - 1] - 6 * output[i - 2] + 4 * output[i - 3] - output[i - 4];
+        break;
+      default: break;
+    }
+  } else if (type >= 32) {
+    uint32_t order = type - 31;
+    if (order > block_size)
+      return false;
+    for (uint32_t i = 0; i < order; i++)
+      output[i] = reader.read_signed(bits_per_sample);
+    uint32_t precision = reader.read(4) + 1;
+    if (precision == 16)
+      return false;
+    int32_t shift = reader.read_signed(5);
+    if (shift < 0)
+      return false;
+    int32_t coefs[32];
+    for (uint32_t i = 0; i < order; i++)
+      coefs[i] = reader.read_signed(precision);
+    if (!decode_residual(reader, block_size, order, output + order))
+      return false;
+    for (uint32_t i = order; i < block_size; i++) {
+      int64_t prediction = 0;
+      for (uint32_t j = 0; j < order; j++)
+        prediction += (int64_t)coefs[j] * output[i - 1 - j];
+      output[i] += (int32_t)(prediction >> shift);
+    }
+  } else {
+    return false;
+  }
+
+  if (wasted_bits != 0)
+    for (uint32_t i = 0; i < block_size; i++)
+      output[i] <<= wasted_bits;
+  return !reader.error;
+}
+
+bool FlacStream::open(const void* stream_data, size_t stream_size) {
+  data = (const uint8_t*)stream_data;
+  size = stream_size;
+
+  // Skip ID3v2 tag
+  size_t offset = 0;
+  if (size >= 10 && std::memcmp(data, "ID3", 3) == 0) {
+    uint32_t tag_size = ((data[6] & 0x7F) << 21) | ((data[7] & 0x7F) << 14) | ((data[8] & 0x7F) << 7) | (data[9] & 0x7F);
+    offset = 10 + tag_size + ((data[5] & 0x10) ? 10 : 0);
+  }
+  if (offset + 4 > size || std::memcmp(data + offset, "fLaC", 4) != 0)
+    return false;
+  offset += 4;
+
+  bool has_stream_info = false;
+  for (;;) {
+    if (offset + 4 > size)
+      return false;
+    bool last = (data[offset] & 0x80) != 0;
+    uint8_t type = data[offset] & 0x7F;
+    uint32_t length = (data[offset + 1] << 16) | (data[offset + 2] << 8) | data[offset + 3];
+    offset += 4;
+    if (offset + length > size)
+      return false;
+
+    if (type == flac_stream_info_block) {
+      if (length < 34)
+        return false;
+      FlacBitReader reader(data + offset, data + offset + length);
+      min_block_size = reader.read(16);
+      max_block_size = reader.read(16);
+      reader.read(24);  // Minimum frame size
+      reader.read(24);  // Maximum frame size
+      sample_rate = reader.read(20);
+      channels = reader.read(3) + 1;
+      bits_per_sample = reader.read(5) + 1;
+      num_frames = ((uint64_t)reader.read(4) << 32) | reader.read(32);
+      has_stream_info = true;
+    }
+
+    offset += length;
+    if (last)
+      break;
+  }
+
+  if (!has_stream_info || sample_rate == 0 || max_block_size < 16 || bits_per_sample < 4 ||
+      bits_per_sample > max_bits_per_sample)
+    return false;
+  first_frame_offset = offset;
+  return true;
+}
+
+size_t FlacStream::find_frame(size_t offset, FlacFrameHeader& header) const {
+  for (; offset + 1 < size; offset++) {
+    if (data[offset] != 0xFF || (data[offset + 1] & 0xFE) != 0xF8)
+      continue;
+    if (read_frame_header(offset, header))
+      return offset;
+  }
+  return size;
+}
+
+bool FlacStream::read_frame_header(size_t offset, FlacFrameHeader& header) const {
+  static constexpr uint32_t sample_sizes[8] = { 0, 8, 12, 0, 16, 20, 24, 0 };
+
+  // Longest possible header: sync, 2 bytes of codes, 7 bytes of coded number, 2 + 2 bytes of extras and the CRC
+  if (offset + 6 > size)
+    return false;
+  const uint8_t* bytes = data + offset;
+  if (bytes[0] != 0xFF || (bytes[1] & 0xFE) != 0xF8)
+    return false;
+  bool variable_block_size = (bytes[1] & 0x01) != 0;
+  uint32_t block_size_code = bytes[2] >> 4;
+  uint32_t sample_rate_code = bytes[2] & 0x0F;
+  uint32_t channel_assignment = bytes[3] >> 4;
+  uint32_t sample_size_code = (bytes[3] >> 1) & 0x07;
+  if (block_size_code == 0 || sample_rate_code == 15 || channel_assignment > 10 || (bytes[3] & 0x01) != 0 ||
+      sample_size_code == 3 || sample_size_code == 7)
+    return false;
+
+  // UTF-8 style coded frame or sample number
+  size_t pos = 4;
+  uint64_t number = bytes[pos++];
+  uint32_t num_continuation = 0;
+  if ((number & 0x80) != 0) {
+    if ((number & 0xE0) == 0xC0) {
+      number &= 0x1F;
+      num_continuation = 1;
+    } else if ((number & 0xF0) == 0xE0) {
+      number &= 0x0F;
+      num_continuation = 2;
+    } else if ((number & 0xF8) == 0xF0) {
+      number &= 0x07;
+      num_continuation = 3;
+    } else if ((number & 0xFC) == 0xF8) {
+      number &= 0x03;
+      num_continuation = 4;
+    } else if ((number & 0xFE) == 0xFC) {
+      number &= 0x01;
+      num_continuation = 5;
+    } else if (number == 0xFE) {
+      number = 0;
+      num_continuation = 6;
+    } else {
+      return false;
+    }
+  }
+  if (offset + pos + num_continuation + 5 > size)
+    return false;
+  for (uint32_t i = 0; i < num_continuation; i++) {
+    uint8_t byte = bytes[pos++];
+    if ((byte & 0xC0) != 0x80)
+      return false;
+    number = (number << 6) | (byte & 0x3F);
+  }
+
+  uint32_t block_size;
+  if (block_size_code == 1) {
+    block_size = 192;
+  } else if (block_size_code <= 5) {
+    block_size = 576u << (block_size_code - 2);
+  } else if (block_size_code == 6) {
+    block_size = bytes[pos++] + 1;
+  } else if (block_size_code == 7) {
+    block_size = ((bytes[pos] << 8) | bytes[pos + 1]) + 1;
+    pos += 2;
+  } else {
+    block_size = 256u << (block_size_code - 8);
+  }
+
+  if (sample_rate_code == 12)
+    pos += 1;
+  else if (sample_rate_code == 13 || sample_rate_code == 14)
+    pos += 2;
+
+  if (flac_crc8(bytes, pos) != bytes[pos])
+    return false;
+
+  uint32_t frame_channels = channel_assignment < 8 ? channel_assignment + 1 : 2;
+  uint32_t frame_bits_per_sample = sample_size_code == 0 ? bits_per_sample : sample_sizes[sample_size_code];
+  if (frame_channels != channels || frame_bits_per_sample != bits_per_sample || block_size > max_block_size)
+    return false;
+
+  header.first_frame = variable_block_size ? number : number * max_block_size;
+  header.block_size = block_size;
+  header.channels = frame_channels;
+  header.bits_per_sample = frame_bits_per_sample;
+  header.channel_assignment = channel_assignment;
+  header.header_size = (uint32_t)pos + 1;
+  return true;
+}
+
+bool FlacStream::decode_frame(
+    size_t offset,
+    const FlacFrameHeader& header,
+    int32_t* const* output,
+    size_t* next_offset) const {
+  const uint8_t* frame_start = data + offset;
+  FlacBitReader reader(frame_start + header.header_size, data + size);
+
+  for (uint32_t ch = 0; ch < header.channels; ch++) {
+    // The side channel has one extra bit
+    uint32_t subframe_bits = header.bits_per_sample;
+    if ((header.channel_assignment == 8 && ch == 1) || (header.channel_assignment == 9 && ch == 0) ||
+        (header.channel_assignment == 10 && ch == 1))
+      subframe_bits++;
+    if (!decode_subframe(reader, header.block_size, subframe_bits, output[ch]))
+      return false;
+  }
+
+  reader.align_to_byte();
+  const uint8_t* frame_end = reader.byte_position();
+  if (frame_end + 2 > data + size)
+    return false;
+  uint16_t crc = (uint16_t)((frame_end[0] << 8) | frame_end[1]);
+  if (flac_crc16(frame_start, frame_end - frame_start) != crc)
+    return false;
+
+  int32_t* left = output[0];
+  int32_t* right = header.channels > 1 ? output[1] : nullptr;
+  switch (header.channel_assignment) {
+    case 8:  // Left, side
+      for (uint32_t i = 0; i < header.block_size; i++)
+        right[i] = left[i] - right[i];
+      break;
+    case 9:  // Side, right
+      for (uint32_t i = 0; i < header.block_size; i++)
+        left[i] += right[i];
+      break;
+    case 10:  // Mid, side
+      for (uint32_t i = 0; i < header.block_size; i++) {
+        int32_t side = right[i];
+        int32_t mid = (int32_t)((uint32_t)left[i] << 1) | (side & 1);
+        left[i] = (mid + side) >> 1;
+        right[i] = (mid - side) >> 1;
+      }
+      break;
+    default: break;
+  }
+
+  *next_offset = (size_t)(frame_end + 2 - data);
+  return true;
+}
+
+}  // namespace wb::dsp
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "core/common.h"
+
+namespace wb::dsp {
+
+struct FlacFrameHeader {
+  uint64_t first_frame;  // Index of the first PCM frame in this FLAC frame
+  uint32_t block_size;
+  uint32_t channels;
+  uint32_t bits_per_sample;
+  uint32_t channel_assignment;
+  uint32_t header_size;
+};
+
+// Native FLAC decoder working on a file mapped into memory. FLAC frames can be decoded independently of each other,
+// each one starts with a sync code and carries its own position in the stream, so the stream can be split at any byte
+// offset: find_frame() locates the next frame and the frame header tells where its samples go.
+//
+// Supports 4 to 24 bits per sample and up to 8 channels. Samples are decoded to 32-bit integers at their native bit
+// depth.
+struct FlacStream {
+  static constexpr uint32_t max_channels = 8;
+  static constexpr uint32_t max_bits_per_sample = 24;
+
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+  size_t first_frame_offset = 0;
+  uint32_t sample_rate = 0;
+  uint32_t channels = 0;
+  uint32_t bits_per_sample = 0;
+  uint32_t min_block_size = 0;
+  uint32_t max_block_size = 0;
+  uint64_t num_frames = 0;  // Total number of PCM frames, 0 if unknown
+
+  /**
+   * @brief Parse the stream header.
+   *
+   * @param stream_data File contents, must stay valid while the stream is used.
+   * @param stream_size File size.
+   * @return True if this is a supported FLAC stream.
+   */
+  bool open(const void* stream_data, size_t stream_size);
+
+  /**
+   * @brief Find the next frame starting at or after the given byte offset.
+   *
+   * @param offset Byte offset to start searching from.
+   * @param header Receives the frame header.
+   * @return Offset of the frame, or `size` if there are no more frames.
+   */
+  size_t find_frame(size_t offset, FlacFrameHeader& header) const;
+
+  // Parse and validate the frame header at the given byte offset.
+  bool read_frame_header(size_t offset, FlacFrameHeader& header) const;
+
+  /**
+   * @brief Decode a frame. The frame checksum is verified.
+   *
+   * @param offset Byte offset of the frame.
+   * @param header Frame header returned by read_frame_header() or find_frame().
+   * @param output Per-channel output, each one must hold at least header.block_size samples.
+   * @param next_offset Receives the byte offset right after the frame.
+   * @return True on success.
+   */
+  bool decode_frame(size_t offset, const FlacFrameHeader& header, int32_t* const* output, size_t* next_offset) const;
+};
+
+}  // namespace wb::dsp
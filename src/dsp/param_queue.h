@@ -43,7 +43,7 @@ struct ParamQueue {
   }
 
   inline void push_back_value(uint32_t sample_offset, uint32_t id, double value) {
-    assert(values.size() == 0 || sample_offset <= values.back().sample_offset);
+    assert(values.size() == 0 || sample_offset >= values.back().sample_offset);
     values.emplace_back(sample_offset, id, value);
   }
 
@@ -0,0 +1,138 @@
+#include "resampler.h"
+
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <vector>
+
+#include "core/core_math.h"
+#include "sample_blocks.h"
+
+namespace wb::dsp {
+
+static constexpr uint32_t sinc_table_size = SincResampler::zero_crossings * SincResampler::table_resolution + 2;
+
+// Modified Bessel function of the first kind, order 0
+static double bessel_i0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  double half_x = x * 0.5;
+  for (uint32_t k = 1; k < 64; k++) {
+    double t = half_x / (double)k;
+    term *= t * t;
+    sum += term;
+    if (term < sum * 1e-15)
+      break;
+  }
+  return sum;
+}
+
+// One side of the windowed sinc kernel, indexed by distance in zero crossings times table_resolution
+static const float* get_sinc_table() {
+  static const std::vector<float> table = [] {
+    std::vector<float> kernel(sinc_table_size, 0.0f);
+    double window_norm = 1.0 / bessel_i0(SincResampler::kaiser_beta);
+    for (uint32_t i = 0; i < sinc_table_size - 1; i++) {
+      double x = (double)i / (double)SincResampler::table_resolution;
+      double w = x / (double)SincResampler::zero_crossings;
+      double window = w < 1.0 ? bessel_i0(SincResampler::kaiser_beta * std::sqrt(1.0 - w * w)) * window_norm : 0.0;
+      double sinc = i == 0 ? 1.0 : std::sin(std::numbers::pi * x) / (std::numbers::pi * x);
+      kernel[i] = (float)(sinc * window);
+    }
+    return kernel;
+  }();
+  return table.data();
+}
+
+void SincResampler::process(const float* input, size_t input_count, double ratio, float* output, size_t output_count) {
+  const float* table = get_sinc_table();
+  const double cutoff = math::min(1.0, 1.0 / ratio);
+  const double radius = (double)zero_crossings / cutoff;
+  const double table_step = cutoff * (double)table_resolution;
+  const int64_t last_input = (int64_t)input_count - 1;
+
+  for (size_t n = 0; n < output_count; n++) {
+    double position = (double)n * ratio;
+    int64_t first = math::max((int64_t)std::floor(position - radius) + 1, (int64_t)0);
+    int64_t last = math::min((int64_t)std::floor(position + radius), last_input);
+    double sum = 0.0;
+    for (int64_t k = first; k <= last; k++) {
+      double x = std::abs(position - (double)k) * table_step;
+      uint32_t index = (uint32_t)x;
+      float fx = (float)(x - (double)index);
+      float w = table[index] + fx * (table[index + 1] - table[index]);
+      sum += (double)(input[k] * w);
+    }
+    output[n] = (float)(sum * cutoff);
+  }
+}
+
+size_t SincResampler::get_output_count(size_t input_count, double ratio) {
+  return (size_t)std::ceil((double)input_count / ratio);
+}
+
+// Convert one channel of any supported format to normalized floats
+static void read_channel_f32(const Sample& sample, uint32_t channel, float* output) {
+  if (sample.is_compressed()) {
+    static constexpr uint32_t block_frames = SampleBlocks::block_frames;
+    const float normalizer = sample.format == AudioFormat::I16 ? 1.0f / (float)INT16_MAX : 1.0f / (float)((1 << 23) - 1);
+    std::vector<int32_t> block(block_frames);
+    for (uint64_t b = 0; b < sample.blocks->num_blocks; b++) {
+      sample.blocks->decode_block(channel, b, block.data());
+      size_t first_frame = b * block_frames;
+      uint32_t count = (uint32_t)math::min((size_t)block_frames, sample.count - first_frame);
+      for (uint32_t i = 0; i < count; i++)
+        output[first_frame + i] = (float)block[i] * normalizer;
+    }
+    return;
+  }
+
+  switch (sample.format) {
+    case AudioFormat::I16: {
+      const int16_t* src = sample.get_read_pointer<int16_t>(channel);
+      for (size_t i = 0; i < sample.count; i++)
+        output[i] = (float)src[i] * (1.0f / (float)INT16_MAX);
+      break;
+    }
+    case AudioFormat::I24: {
+      const std::byte* src = sample.get_read_pointer<std::byte>(channel);
+      for (size_t i = 0; i < sample.count; i++)
+        output[i] = (float)read_packed_i24(src + i * 3) * (1.0f / (float)((1 << 23) - 1));
+      break;
+    }
+    case AudioFormat::I32: {
+      const int32_t* src = sample.get_read_pointer<int32_t>(channel);
+      for (size_t i = 0; i < sample.count; i++)
+        output[i] = (float)((double)src[i] * (1.0 / (double)INT32_MAX));
+      break;
+    }
+    case AudioFormat::F32:
+      std::memcpy(output, sample.get_read_pointer<float>(channel), sample.count * sizeof(float));
+      break;
+    default:
+      std::memset(output, 0, sample.count * sizeof(float));
+      break;
+  }
+}
+
+Sample resample_sample(const Sample& source, double ratio, uint32_t target_rate) {
+  size_t output_count = SincResampler::get_output_count(source.count, ratio);
+  Sample rendered(AudioFormat::F32, target_rate);
+  rendered.name = source.name;
+  rendered.path = source.path;
+  if (output_count == 0 || source.channels == 0)
+    return rendered;
+
+  rendered.resize(output_count + Sample::sample_padding, source.channels);
+  rendered.count = output_count;
+  std::vector<float> input(source.count);
+  for (uint32_t c = 0; c < source.channels; c++) {
+    float* output = rendered.get_write_pointer<float>(c);
+    read_channel_f32(source, c, input.data());
+    SincResampler::process(input.data(), source.count, ratio, output, output_count);
+    std::memset(output + output_count, 0, Sample::sample_padding * sizeof(float));
+  }
+  return rendered;
+}
+
+}  // namespace wb::dsp
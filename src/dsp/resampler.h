@@ -0,0 +1,40 @@
+#pragma once
+
+#include "core/common.h"
+#include "sample.h"
+
+namespace wb::dsp {
+
+// Offline band-limited resampler. Each output sample is a Kaiser windowed sinc convolution over the input, the filter
+// is far too long to run on the audio thread, see ClipRenderer.
+struct SincResampler {
+  static constexpr uint32_t zero_crossings = 32;     // Filter half-width in zero crossings of the sinc
+  static constexpr uint32_t table_resolution = 256;  // Kernel points per zero crossing
+  static constexpr double kaiser_beta = 9.0;
+
+  /**
+   * @brief Resample a signal. The cutoff follows the lower of both rates, so downsampling does not alias.
+   *
+   * @param input Input signal. Samples outside of it are treated as silence.
+   * @param input_count Number of input samples.
+   * @param ratio Input samples per output sample.
+   * @param output Receives output_count samples.
+   * @param output_count Number of output samples to render, output sample n is taken at input position n * ratio.
+   */
+  static void process(const float* input, size_t input_count, double ratio, float* output, size_t output_count);
+
+  // Number of output samples covering input_count input samples
+  static size_t get_output_count(size_t input_count, double ratio);
+};
+
+/**
+ * @brief Render a resampled copy of a sample in 32-bit float.
+ *
+ * @param source Source sample, may be compressed.
+ * @param ratio Source samples per rendered sample.
+ * @param target_rate Sample rate of the rendered sample.
+ * @return Rendered sample with Sample::sample_padding silent frames after its end.
+ */
+Sample resample_sample(const Sample& source, double ratio, uint32_t target_rate);
+
+}  // namespace wb::dsp
@@ -3,13 +3,19 @@
 #include <sndfile.h>
 #include <vorbis/vorbisfile.h>
 
+#include <algorithm>
 #include <memory>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "core/core_math.h"
 #include "core/debug.h"
 #include "core/defer.h"
+#include "core/fs.h"
 #include "extern/dr_mp3.h"
+#include "flac.h"
+#include "sample_blocks.h"
 
 namespace wb {
 
@@ -17,7 +23,7 @@ static AudioFormat from_sf_format(int sf_format) {
   // Only supports uncompressed format
   switch (sf_format) {
     case SF_FORMAT_PCM_16: return AudioFormat::I16;
-    case SF_FORMAT_PCM_24: return AudioFormat::I32;  // Converted to 32-bit
+    case SF_FORMAT_PCM_24: return AudioFormat::I24;  // Packed into 3 bytes
     case SF_FORMAT_PCM_32: return AudioFormat::I32;
     case SF_FORMAT_FLOAT: return AudioFormat::F32;
     case SF_FORMAT_DOUBLE: return AudioFormat::F64;
@@ -42,6 +48,130 @@ static sf_count_t deinterleave_samples(
   return num_frames_written + num_read;
 }
 
+// Compressed files shorter than this are decoded on the calling thread
+static constexpr uint64_t min_decode_segment_frames = 1 << 17;
+static constexpr uint32_t decode_chunk_frames = 1024;
+
+// Layer III main data starts at most this far back in the bit reservoir
+static constexpr size_t mp3_max_reservoir_size = 511;
+// Header, CRC and side info
+static constexpr size_t mp3_max_frame_overhead = 4 + 2 + 32;
+static constexpr size_t mp3_max_read_size = INT32_MAX;
+
+struct MemoryReader {
+  const uint8_t* data;
+  size_t size;
+  size_t position = 0;
+};
+
+static size_t ogg_memory_read(void* ptr, size_t size, size_t nmemb, void* datasource) {
+  MemoryReader* reader = (MemoryReader*)datasource;
+  size_t num_bytes = math::min(size * nmemb, reader->size - reader->position);
+  std::memcpy(ptr, reader->data + reader->position, num_bytes);
+  reader->position += num_bytes;
+  return size != 0 ? num_bytes / size : 0;
+}
+
+static int ogg_memory_seek(void* datasource, ogg_int64_t offset, int whence) {
+  MemoryReader* reader = (MemoryReader*)datasource;
+  int64_t base = whence == SEEK_SET ? 0 : whence == SEEK_CUR ? (int64_t)reader->position : (int64_t)reader->size;
+  int64_t position = base + offset;
+  if (position < 0 || position > (int64_t)reader->size)
+    return -1;
+  reader->position = (size_t)position;
+  return 0;
+}
+
+static long ogg_memory_tell(void* datasource) {
+  return (long)((MemoryReader*)datasource)->position;
+}
+
+static const ov_callbacks ogg_memory_callbacks = {
+  .read_func = ogg_memory_read,
+  .seek_func = ogg_memory_seek,
+  .close_func = nullptr,
+  .tell_func = ogg_memory_tell,
+};
+
+static sf_count_t sf_memory_get_filelen(void* user_data) {
+  return (sf_count_t)((MemoryReader*)user_data)->size;
+}
+
+static sf_count_t sf_memory_seek(sf_count_t offset, int whence, void* user_data) {
+  MemoryReader* reader = (MemoryReader*)user_data;
+  if (ogg_memory_seek(user_data, offset, whence) != 0)
+    return -1;
+  return (sf_count_t)reader->position;
+}
+
+static sf_count_t sf_memory_read(void* ptr, sf_count_t count, void* user_data) {
+  return (sf_count_t)ogg_memory_read(ptr, 1, (size_t)count, user_data);
+}
+
+static sf_count_t sf_memory_tell(void* user_data) {
+  return (sf_count_t)((MemoryReader*)user_data)->position;
+}
+
+// Read-only, the write callback is never called
+static SF_VIRTUAL_IO sf_memory_io = {
+  .get_filelen = sf_memory_get_filelen,
+  .seek = sf_memory_seek,
+  .read = sf_memory_read,
+  .write = nullptr,
+  .tell = sf_memory_tell,
+};
+
+// Allocate the final channel buffers. Decoders write into them directly, only the padding is cleared here.
+static bool allocate_channel_samples(
+    Vector<std::byte*>& channel_samples,
+    uint32_t channels,
+    uint64_t num_frames,
+    uint32_t sample_size) {
+  channel_samples.reserve(channels);
+  for (uint32_t i = 0; i < channels; i++) {
+    std::byte* mem = (std::byte*)std::malloc((num_frames + Sample::sample_padding) * sample_size);
+    if (!mem) {
+      for (auto sample_data : channel_samples)
+        std::free(sample_data);
+      channel_samples.resize(0);
+      return false;
+    }
+    std::memset(mem + num_frames * sample_size, 0, Sample::sample_padding * sample_size);
+    channel_samples.push_back(mem);
+  }
+  return true;
+}
+
+// Silence frames that could not be decoded
+static void clear_channel_samples(
+    const Vector<std::byte*>& channel_samples,
+    uint32_t sample_size,
+    uint64_t start,
+    uint64_t end) {
+  if (start >= end)
+    return;
+  for (auto sample_data : channel_samples)
+    std::memset(sample_data + start * sample_size, 0, (end - start) * sample_size);
+}
+
+static uint32_t get_num_decode_segments(uint64_t num_frames, uint32_t num_threads) {
+  if (num_threads == 0)
+    num_threads = math::max(std::thread::hardware_concurrency(), 1u);
+  return (uint32_t)math::clamp(num_frames / min_decode_segment_frames, (uint64_t)1, (uint64_t)num_threads);
+}
+
+// Decode every segment on its own thread, the calling thread takes the first one.
+template<typename Fn>
+static void decode_segments(uint32_t num_segments, Fn&& decode_segment) {
+  std::vector<std::thread> workers;
+  workers.reserve(num_segments - 1);
+  for (uint32_t i = 1; i < num_segments; i++)
+    workers.emplace_back([&decode_segment, i] { decode_segment(i); });
+  decode_segment(0);
+  for (auto& worker : workers)
+    worker.join();
+}
+
 Sample::Sample(AudioFormat format, uint32_t sample_rate) : format(format), sample_rate(sample_rate) {
 }
 
@@ -52,7 +182,8 @@ Sample::Sample(Sample&& other) noexcept
       channels(std::exchange(other.channels, 0)),
       sample_rate(std::exchange(other.sample_rate, 0)),
       count(std::exchange(other.count, 0)),
-      sample_data(std::move(other.sample_data)) {
+      sample_data(std::move(other.sample_data)),
+      blocks(std::move(other.blocks)) {
 }
 
 Sample::~Sample() {
@@ -60,6 +191,28 @@ Sample::~Sample() {
     std::free(sample);
 }
 
+size_t Sample::get_memory_size() const {
+  if (blocks)
+    return blocks->memory_size();
+  return count * channels * get_audio_format_size(format);
+}
+
+size_t Sample::get_unpacked_memory_size() const {
+  uint32_t sample_size = format == AudioFormat::I24 ? 4 : get_audio_format_size(format);
+  return count * channels * sample_size;
+}
+
+bool Sample::compress() {
+  auto new_blocks = std::make_unique<SampleBlocks>();
+  if (!new_blocks->encode(*this) || new_blocks->memory_size() >= get_memory_size())
+    return false;
+  for (auto sample : sample_data)
+    std::free(sample);
+  sample_data.resize(0);
+  blocks = std::move(new_blocks);
+  return true;
+}
+
 void Sample::set_channel_count(uint32_t count) {
 }
 
@@ -67,6 +220,7 @@ void Sample::reserve(size_t new_sample_count) {
 }
 
 void Sample::resize(size_t new_sample_count, uint32_t new_channels, bool discard) {
+  assert(!is_compressed() && "Cannot resize compressed sample");
   assert(new_sample_count != 0);
   assert(new_channels != 0);
   if (new_sample_count != count) {
@@ -112,12 +266,19 @@ void Sample::resize(size_t new_sample_count, uint32_t new_channels, bool discard
 std::optional<Sample> Sample::load_file(const std::filesystem::path& path) noexcept {
   if (!std::filesystem::is_regular_file(path))
     return {};
+  MappedFile file;
+  if (!file.open(path))
+    return {};
+  return load_file(path, file.data(), file.size());
+}
 
+std::optional<Sample> Sample::load_file(const std::filesystem::path& path, const std::byte* data, size_t size) noexcept {
   // Try open with SF
-  SF_INFO info;
-  SNDFILE* file = sf_open(path.generic_string().c_str(), SFM_READ, &info);
+  SF_INFO info{};
+  MemoryReader reader{ (const uint8_t*)data, size };
+  SNDFILE* file = sf_open_virtual(&sf_memory_io, SFM_READ, &info, &reader);
   if (!file)
-    return load_compressed_file(path);
+    return load_compressed_file(path, data, size);
 
   AudioFormat format = from_sf_format(info.format & SF_FORMAT_SUBMASK);
   if (format == AudioFormat::Unknown)
@@ -125,26 +286,28 @@ std::optional<Sample> Sample::load_file(const std::filesystem::path& path) noexc
 
   uint32_t sample_size = get_audio_format_size(format);
   size_t data_size = (info.frames + sample_padding) * sample_size;
-  Vector<std::byte*> data;
-  data.reserve(info.channels);
+  Vector<std::byte*> channel_samples;
+  channel_samples.reserve(info.channels);
 
   for (int i = 0; i < info.channels; i++) {
     std::byte* channel_data = (std::byte*)std::malloc(data_size);
     if (!channel_data) {
       // Cleanup if failed
-      for (auto allocated_data : data)
+      for (auto allocated_data : channel_samples)
         std::free(allocated_data);
       sf_close(file);
       return {};
     }
     std::memset(channel_data, 0, data_size);
-    data.push_back(channel_data);
+    channel_samples.push_back(channel_data);
   }
 
+  // 24-bit samples are read as 32-bit and packed afterwards
   sf_count_t buffer_len_per_channel = 1024;
-  void* decode_buffer = std::malloc(buffer_len_per_channel * info.channels * sample_size);
+  uint32_t decode_sample_size = format == AudioFormat::I24 ? sizeof(int32_t) : sample_size;
+  void* decode_buffer = std::malloc(buffer_len_per_channel * info.channels * decode_sample_size);
   if (!decode_buffer) {
-    for (auto allocated_data : data)
+    for (auto allocated_data : channel_samples)
       std::free(allocated_data);
     sf_close(file);
     return {};
@@ -161,21 +324,33 @@ std::optional<Sample> Sample::load_file(const std::filesystem::path& path) noexc
       int16_t* buffer = (int16_t*)decode_buffer;
       while ((num_frames_read = sf_readf_short(file, buffer, buffer_len_per_channel)))
         num_frames_written =
-            deinterleave_samples(data, buffer, num_frames_read, info.frames, num_frames_written, info.channels);
+            deinterleave_samples(channel_samples, buffer, num_frames_read, info.frames, num_frames_written, info.channels);
+      break;
+    }
+    case AudioFormat::I24: {
+      int32_t* buffer = (int32_t*)decode_buffer;
+      while ((num_frames_read = sf_readf_int(file, buffer, buffer_len_per_channel))) {
+        for (int i = 0; i < info.channels; i++) {
+          std::byte* channel_data = channel_samples[i] + num_frames_written * 3;
+          for (sf_count_t j = 0; j < num_frames_read; j++)
+            write_packed_i24(channel_data + j * 3, buffer[info.channels * j + i] >> 8);
+        }
+        num_frames_written += num_frames_read;
+      }
       break;
     }
     case AudioFormat::I32: {
       int32_t* buffer = (int32_t*)decode_buffer;
       while ((num_frames_read = sf_readf_int(file, buffer, buffer_len_per_channel)))
         num_frames_written =
-            deinterleave_samples(data, buffer, num_frames_read, info.frames, num_frames_written, info.channels);
+            deinterleave_samples(channel_samples, buffer, num_frames_read, info.frames, num_frames_written, info.channels);
       break;
     }
     case AudioFormat::F32: {
       float* buffer = (float*)decode_buffer;
       while ((num_frames_read = sf_readf_float(file, buffer, buffer_len_per_channel)))
         num_frames_written =
-            deinterleave_samples(data, buffer, num_frames_read, info.frames, num_frames_written, info.channels);
+            deinterleave_samples(channel_samples, buffer, num_frames_read, info.frames, num_frames_written, info.channels);
       break;
     }
     case AudioFormat::F64: assert(false && "Not supported at the moment"); break;
@@ -191,125 +366,296 @@ std::optional<Sample> Sample::load_file(const std::filesystem::path& path) noexc
   ret->path = path;
   ret->channels = info.channels;
   ret->count = info.frames;
-  ret->sample_data = std::move(data);
+  ret->sample_data = std::move(channel_samples);
 
   return ret;
 }
 
-std::optional<Sample> Sample::load_compressed_file(const std::filesystem::path& path) noexcept {
-  if (auto mp3 = load_mp3_file(path))
+std::optional<Sample> Sample::load_compressed_file(
+    const std::filesystem::path& path,
+    const std::byte* data,
+    size_t size) noexcept {
+  if (auto flac = load_flac_file(path, data, size))
+    return flac;
+  if (auto mp3 = load_mp3_file(path, data, size))
     return mp3;
-  if (auto ogv = load_ogg_vorbis_file(path))
+  if (auto ogv = load_ogg_vorbis_file(path, data, size))
     return ogv;
   return {};
 }
 
-std::optional<Sample> Sample::load_mp3_file(const std::filesystem::path& path) noexcept {
-  if (!std::filesystem::is_regular_file(path))
+std::optional<Sample> Sample::load_mp3_file(
+    const std::filesystem::path& path,
+    const std::byte* data,
+    size_t size,
+    uint32_t num_threads) noexcept {
+  // Index the MP3 frames first. Decoding without output only parses the headers and tracks the bit reservoir. Like
+  // drmp3_read_pcm_frames_f32(), frames that fail to decode are skipped and produce no PCM frames.
+  struct Mp3Frame {
+    size_t offset;
+    uint64_t position;
+  };
+  const drmp3_uint8* mp3_data = (const drmp3_uint8*)data;
+  Vector<Mp3Frame> mp3_frames;
+  uint64_t total_frame_count = 0;
+  uint32_t channels = 0;
+  uint32_t sample_rate = 0;
+  drmp3dec index_decoder;
+  drmp3dec_init(&index_decoder);
+  for (size_t offset = 0; offset < size;) {
+    drmp3dec_frame_info info;
+    int num_frames = drmp3dec_decode_frame(
+        &index_decoder, mp3_data + offset, (int)math::min(size - offset, mp3_max_read_size), nullptr, &info);
+    if (info.frame_bytes == 0)
+      break;
+    if (num_frames > 0) {
+      if (channels == 0) {
+        channels = info.channels;
+        sample_rate = info.hz;
+      }
+      mp3_frames.push_back(Mp3Frame{ .offset = offset, .position = total_frame_count });
+      total_frame_count += num_frames;
+    }
+    offset += info.frame_bytes;
+  }
+  if (total_frame_count == 0)
     return {};
 
-  drmp3 mp3_file;
-  if (!drmp3_init_file(&mp3_file, path.generic_string().c_str(), nullptr)) {
+  Vector<std::byte*> channel_samples;
+  if (!allocate_channel_samples(channel_samples, channels, total_frame_count, sizeof(float)))
     return {};
-  }
 
-  uint64_t buffer_len_per_channel = 1024;
-  float* decode_buffer = (float*)std::malloc(buffer_len_per_channel * mp3_file.channels * sizeof(float));
-  if (!decode_buffer) {
-    drmp3_uninit(&mp3_file);
+  // Split at MP3 frame boundaries. Layer III frames can take their main data from the bit reservoir, up to 511 bytes
+  // before the frame. Each segment starts decoding early enough to refill it, plus one more frame that fills the
+  // overlap of the synthesis filters, and discards the output of those frames. The segments then join exactly.
+  auto find_mp3_frame = [&](uint64_t position) {
+    const Mp3Frame* frame = std::lower_bound(
+        mp3_frames.begin(), mp3_frames.end(), position, [](const Mp3Frame& frame, uint64_t position) {
+          return frame.position < position;
+        });
+    return (uint32_t)(frame - mp3_frames.begin());
+  };
+  uint32_t num_segments = get_num_decode_segments(total_frame_count, num_threads);
+  decode_segments(num_segments, [&](uint32_t segment) {
+    uint32_t first_mp3_frame = find_mp3_frame(total_frame_count * segment / num_segments);
+    uint32_t end_mp3_frame = find_mp3_frame(total_frame_count * (segment + 1) / num_segments);
+    if (first_mp3_frame == end_mp3_frame)
+      return;
+    uint64_t start = mp3_frames[first_mp3_frame].position;
+    uint64_t end = end_mp3_frame < mp3_frames.size() ? mp3_frames[end_mp3_frame].position : total_frame_count;
+
+    uint32_t warmup_mp3_frame = first_mp3_frame;
+    if (warmup_mp3_frame > 0) {
+      warmup_mp3_frame--;
+      size_t reservoir_size = 0;
+      while (warmup_mp3_frame > 0 && reservoir_size < mp3_max_reservoir_size) {
+        warmup_mp3_frame--;
+        size_t frame_size = mp3_frames[warmup_mp3_frame + 1].offset - mp3_frames[warmup_mp3_frame].offset;
+        reservoir_size += frame_size - math::min(frame_size, mp3_max_frame_overhead);
+      }
+    }
+
+    // dr_mp3 is built with 16-bit output, converted the same way as drmp3_read_pcm_frames_f32() does
+    drmp3dec decoder;
+    drmp3dec_init(&decoder);
+    drmp3_int16 buffer[DRMP3_MAX_SAMPLES_PER_FRAME];
+    size_t first_offset = mp3_frames[first_mp3_frame].offset;
+    size_t offset = mp3_frames[warmup_mp3_frame].offset;
+    uint64_t position = start;
+    while (position < end && offset < size) {
+      drmp3dec_frame_info info;
+      int num_frames = drmp3dec_decode_frame(
+          &decoder, mp3_data + offset, (int)math::min(size - offset, mp3_max_read_size), buffer, &info);
+      if (info.frame_bytes == 0)
+        break;
+      if (num_frames > 0 && offset >= first_offset) {
+        uint64_t num_frames_written = math::min((uint64_t)num_frames, end - position);
+        for (uint32_t c = 0; c < channels; c++) {
+          float* channel_data = (float*)channel_samples[c] + position;
+          uint32_t src_channel = math::min(c, (uint32_t)info.channels - 1);
+          for (uint64_t i = 0; i < num_frames_written; i++)
+            channel_data[i] = (float)buffer[i * info.channels + src_channel] * (1.0f / 32768.0f);
+        }
+        position += num_frames_written;
+      }
+      offset += info.frame_bytes;
+    }
+    clear_channel_samples(channel_samples, sizeof(float), position, end);
+  });
+
+  std::optional<Sample> ret;
+  ret.emplace(AudioFormat::F32, sample_rate);
+  ret->name = path.filename().string();
+  ret->path = path;
+  ret->channels = channels;
+  ret->count = total_frame_count;
+  ret->sample_data = std::move(channel_samples);
+
+  return ret;
+}
+
+std::optional<Sample> Sample::load_flac_file(
+    const std::filesystem::path& path,
+    const std::byte* data,
+    size_t size,
+    uint32_t num_threads) noexcept {
+  dsp::FlacStream stream;
+  if (!stream.open(data, size))
+    return {};
+  if (stream.num_frames == 0) {
+    Log::error("Cannot load FLAC file without a length: {}", path.string());
     return {};
   }
 
-  uint64_t total_frame_count = drmp3_get_pcm_frame_count(&mp3_file);
+  AudioFormat format = stream.bits_per_sample <= 16 ? AudioFormat::I16 : AudioFormat::I24;
+  uint32_t sample_size = get_audio_format_size(format);
+  uint64_t total_frame_count = stream.num_frames;
   Vector<std::byte*> channel_samples;
-  channel_samples.reserve(mp3_file.channels);
+  if (!allocate_channel_samples(channel_samples, stream.channels, total_frame_count, sample_size))
+    return {};
 
-  for (uint32_t i = 0; i < mp3_file.channels; i++) {
-    std::byte* mem = (std::byte*)std::malloc(total_frame_count * sizeof(float));
-    if (!mem) {
-      for (auto sample_data : channel_samples)
-        std::free(sample_data);
-      std::free(decode_buffer);
-      drmp3_uninit(&mp3_file);
-      return {};
-    }
-    channel_samples.push_back(mem);
-  }
+  // FLAC frames are self-contained. Each segment decodes the frames that start inside its byte range and writes them
+  // at the position stored in the frame header. Decoded ranges are recorded, so that gaps left by frames that fail
+  // to decode across segment boundaries can be cleared afterwards.
+  struct DecodedRange {
+    uint64_t first;
+    uint64_t end;
+  };
+  uint32_t num_segments = get_num_decode_segments(total_frame_count, num_threads);
+  size_t stream_size = stream.size - stream.first_frame_offset;
+  Vector<DecodedRange> decoded_ranges;
+  decoded_ranges.resize(num_segments);
+  decode_segments(num_segments, [&](uint32_t segment) {
+    size_t start = stream.first_frame_offset + stream_size * segment / num_segments;
+    size_t end = stream.first_frame_offset + stream_size * (segment + 1) / num_segments;
+    Vector<int32_t> block;
+    block.resize(stream.max_block_size * stream.channels);
+    int32_t* block_channels[dsp::FlacStream::max_channels];
+    for (uint32_t i = 0; i < stream.channels; i++)
+      block_channels[i] = block.data() + i * stream.max_block_size;
+
+    // Frames that fail to decode are left silent
+    uint64_t first_frame = UINT64_MAX;
+    uint64_t position = UINT64_MAX;
+    dsp::FlacFrameHeader header;
+    size_t offset = stream.find_frame(start, header);
+    while (offset < end) {
+      size_t next_offset;
+      if (!stream.decode_frame(offset, header, block_channels, &next_offset)) {
+        offset = stream.find_frame(offset + 1, header);
+        continue;
+      }
+      if (header.first_frame >= total_frame_count)
+        break;
+
+      uint64_t num_frames = math::min((uint64_t)header.block_size, total_frame_count - header.first_frame);
+      if (first_frame == UINT64_MAX)
+        first_frame = header.first_frame;
+      else if (position < header.first_frame)
+        clear_channel_samples(channel_samples, sample_size, position, header.first_frame);
+      if (format == AudioFormat::I16) {
+        uint32_t shift = 16 - stream.bits_per_sample;
+        for (uint32_t c = 0; c < stream.channels; c++) {
+          int16_t* dst = (int16_t*)channel_samples[c] + header.first_frame;
+          for (uint64_t i = 0; i < num_frames; i++)
+            dst[i] = (int16_t)(block_channels[c][i] << shift);
+        }
+      } else {
+        uint32_t shift = 24 - stream.bits_per_sample;
+        for (uint32_t c = 0; c < stream.channels; c++) {
+          std::byte* dst = channel_samples[c] + header.first_frame * 3;
+          for (uint64_t i = 0; i < num_frames; i++)
+            write_packed_i24(dst + i * 3, (int32_t)((uint32_t)block_channels[c][i] << shift));
+        }
+      }
+      position = header.first_frame + num_frames;
 
-  uint64_t num_frames_read = 0;
-  sf_count_t num_frames_written = 0;
-  while (true) {
-    num_frames_read = drmp3_read_pcm_frames_f32(&mp3_file, buffer_len_per_channel, decode_buffer);
-    if (num_frames_read == 0)
-      break;
-    num_frames_written = deinterleave_samples(
-        channel_samples, decode_buffer, num_frames_read, total_frame_count, num_frames_written, mp3_file.channels);
+      if (!stream.read_frame_header(next_offset, header))
+        next_offset = stream.find_frame(next_offset, header);
+      offset = next_offset;
+    }
+    decoded_ranges[segment] = { .first = first_frame, .end = first_frame == UINT64_MAX ? 0 : position };
+  });
+
+  uint64_t cleared_until = 0;
+  for (const auto& range : decoded_ranges) {
+    if (range.first == UINT64_MAX)
+      continue;
+    clear_channel_samples(channel_samples, sample_size, cleared_until, range.first);
+    cleared_until = math::max(cleared_until, range.end);
   }
-
-  drmp3_uninit(&mp3_file);
-  std::free(decode_buffer);
+  clear_channel_samples(channel_samples, sample_size, cleared_until, total_frame_count);
 
   std::optional<Sample> ret;
-  ret.emplace(AudioFormat::F32, (uint32_t)mp3_file.sampleRate);
+  ret.emplace(format, stream.sample_rate);
   ret->name = path.filename().string();
   ret->path = path;
-  ret->channels = mp3_file.channels;
+  ret->channels = stream.channels;
   ret->count = total_frame_count;
   ret->sample_data = std::move(channel_samples);
 
   return ret;
 }
 
-std::optional<Sample> Sample::load_flac_file(const std::filesystem::path& path) noexcept {
-  return std::optional<Sample>();
-}
-
-std::optional<Sample> Sample::load_ogg_vorbis_file(const std::filesystem::path& path) noexcept {
-  if (!std::filesystem::is_regular_file(path))
-    return {};
-
+std::optional<Sample> Sample::load_ogg_vorbis_file(
+    const std::filesystem::path& path,
+    const std::byte* data,
+    size_t size,
+    uint32_t num_threads) noexcept {
   OggVorbis_File vf;
-  if (ov_fopen(path.generic_string().c_str(), &vf) != 0)
+  MemoryReader reader{ (const uint8_t*)data, size };
+  if (ov_open_callbacks(&reader, &vf, nullptr, 0, ogg_memory_callbacks) != 0)
     return {};
   defer(ov_clear(&vf));
 
   vorbis_info* info = ov_info(&vf, -1);
-  int channels = math::min(info->channels, 32);  // Maximum number of channel is 32
-  uint64_t buffer_len_per_channel = 1024;
-  uint64_t total_frame_count = ov_pcm_total(&vf, -1);
-  Vector<std::byte*> channel_samples;
-  channel_samples.reserve(info->channels);
+  uint32_t channels = (uint32_t)math::min(info->channels, 32);  // Maximum number of channel is 32
+  uint32_t sample_rate = (uint32_t)info->rate;
+  ogg_int64_t pcm_total = ov_pcm_total(&vf, -1);
+  if (pcm_total <= 0)
+    return {};
+  uint64_t total_frame_count = (uint64_t)pcm_total;
 
-  for (uint32_t i = 0; i < info->channels; i++) {
-    std::byte* mem = (std::byte*)std::malloc(total_frame_count * sizeof(float));
-    if (!mem) {
-      for (auto sample_data : channel_samples)
-        std::free(sample_data);
-      return {};
-    }
-    channel_samples.push_back(mem);
-  }
+  Vector<std::byte*> channel_samples;
+  if (!allocate_channel_samples(channel_samples, channels, total_frame_count, sizeof(float)))
+    return {};
 
-  uint64_t num_frames_written = 0;
-  int current_bitstream = 0;
-  float** decode_channels = nullptr;
-  while (true) {
-    int ret = ov_read_float(&vf, &decode_channels, buffer_len_per_channel, &current_bitstream);
-    if (ret == 0) {
-      break;
-    } else if (ret < 0) {
-      Log::error("Failed to decode Ogg Vorbis file. ov_read_float() returned {}", ret);
-      break;
-    }
-    for (int c = 0; c < channels; c++) {
-      float* channel_data = (float*)channel_samples[c];
-      std::memcpy(channel_data + num_frames_written, decode_channels[c], ret * sizeof(float));
+  // Every segment opens its own decoder. ov_pcm_seek() is sample accurate, it decodes the pre-roll of the page it
+  // lands on, so the segments join exactly.
+  uint32_t num_segments = get_num_decode_segments(total_frame_count, num_threads);
+  decode_segments(num_segments, [&](uint32_t segment) {
+    uint64_t start = total_frame_count * segment / num_segments;
+    uint64_t end = total_frame_count * (segment + 1) / num_segments;
+    uint64_t position = start;
+
+    OggVorbis_File segment_vf;
+    MemoryReader segment_reader{ (const uint8_t*)data, size };
+    if (ov_open_callbacks(&segment_reader, &segment_vf, nullptr, 0, ogg_memory_callbacks) == 0) {
+      if (start == 0 || ov_pcm_seek(&segment_vf, (ogg_int64_t)start) == 0) {
+        int current_bitstream = 0;
+        float** decode_channels = nullptr;
+        while (position < end) {
+          int frames_to_read = (int)math::min(end - position, (uint64_t)decode_chunk_frames);
+          long ret = ov_read_float(&segment_vf, &decode_channels, frames_to_read, &current_bitstream);
+          if (ret == 0) {
+            break;
+          } else if (ret < 0) {
+            Log::error("Failed to decode Ogg Vorbis file. ov_read_float() returned {}", ret);
+            break;
+          }
+          // Copied straight out of the decoder's buffers
+          for (uint32_t c = 0; c < channels; c++)
+            std::memcpy((float*)channel_samples[c] + position, decode_channels[c], ret * sizeof(float));
+          position += ret;
+        }
+      }
+      ov_clear(&segment_vf);
     }
-    num_frames_written += ret;
-  }
+    clear_channel_samples(channel_samples, sizeof(float), position, end);
+  });
 
   std::optional<Sample> ret;
-  ret.emplace(AudioFormat::F32, info->rate);
+  ret.emplace(AudioFormat::F32, sample_rate);
   ret->name = path.filename().string();
   ret->path = path;
   ret->channels = channels;
@@ -329,6 +675,18 @@ std::optional<SampleInfo> Sample::get_file_info(const std::filesystem::path& pat
       .sample_count = (uint64_t)sf_info.frames,
       .channel_count = (uint32_t)sf_info.channels,
       .rate = (uint32_t)sf_info.samplerate,
+      .format = from_sf_format(sf_info.format & SF_FORMAT_SUBMASK),
+    };
+  }
+
+  MappedFile flac_file;
+  dsp::FlacStream flac;
+  if (flac_file.open(path) && flac.open(flac_file.data(), flac_file.size())) {
+    return SampleInfo{
+      .sample_count = flac.num_frames,
+      .channel_count = flac.channels,
+      .rate = flac.sample_rate,
+      .format = flac.bits_per_sample <= 16 ? AudioFormat::I16 : AudioFormat::I24,
     };
   }
 
@@ -339,6 +697,7 @@ std::optional<SampleInfo> Sample::get_file_info(const std::filesystem::path& pat
       .sample_count = drmp3_get_pcm_frame_count(&mp3),
       .channel_count = mp3.channels,
       .rate = mp3.sampleRate,
+      .format = AudioFormat::F32,
     };
   }
 
@@ -349,6 +708,7 @@ std::optional<SampleInfo> Sample::get_file_info(const std::filesystem::path& pat
       .sample_count = (uint64_t)ov_pcm_total(&vf, -1),
       .channel_count = (uint32_t)vf.vi->channels,
       .rate = (uint32_t)vf.vi->rate,
+      .format = AudioFormat::F32,
     };
   }
 
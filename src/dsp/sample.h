@@ -1,6 +1,7 @@
 #pragma once
 
 #include <filesystem>
+#include <memory>
 #include <optional>
 #include <string>
 
@@ -9,10 +10,17 @@
 
 namespace wb {
 
+struct SampleBlocks;
+
 struct SampleInfo {
   uint64_t sample_count;
   uint32_t channel_count;
   uint32_t rate;
+  AudioFormat format;  // Format of the decoded samples
+
+  inline double duration() const {
+    return rate != 0 ? (double)sample_count / (double)rate : 0.0;
+  }
 };
 
 struct Sample {
@@ -26,6 +34,7 @@ struct Sample {
   size_t count{};
   size_t capacity{};
   Vector<std::byte*> sample_data;
+  std::unique_ptr<SampleBlocks> blocks;  // Set if the sample is compressed, sample_data is empty then
 
   Sample(AudioFormat format, uint32_t sample_rate);
   Sample(Sample&& other) noexcept;
@@ -55,19 +64,64 @@ struct Sample {
     return (T* const*)sample_data.data();
   }
 
+  inline bool is_compressed() const noexcept {
+    return blocks != nullptr;
+  }
+
+  // Number of bytes used by the sample data
+  size_t get_memory_size() const;
+
+  // Number of bytes the sample data would use without packing and compression. 24-bit samples are counted in 4-byte
+  // containers.
+  size_t get_unpacked_memory_size() const;
+
+  /**
+   * @brief Replace the sample data with losslessly compressed blocks. The sample is streamed through a small decode
+   * cache afterwards, see SampleBlocks.
+   *
+   * @return True if the sample has been compressed. Fails for unsupported formats or if compression does not save
+   * memory.
+   */
+  bool compress();
+
   void set_channel_count(uint32_t count);
   void reserve(size_t count);
   void resize(size_t count, uint32_t channels, bool discard = false);
 
   static std::optional<Sample> load_file(const std::filesystem::path& path) noexcept;
 
-  static std::optional<Sample> load_compressed_file(const std::filesystem::path& path) noexcept;
-
-  static std::optional<Sample> load_mp3_file(const std::filesystem::path& path) noexcept;
-
-  static std::optional<Sample> load_flac_file(const std::filesystem::path& path) noexcept;
-
-  static std::optional<Sample> load_ogg_vorbis_file(const std::filesystem::path& path) noexcept;
+  /**
+   * @brief Decode a sample from a file that has already been read into memory.
+   *
+   * @param path Path of the file, only used to name the sample.
+   * @param data Contents of the file.
+   * @param size Size of the file in bytes.
+   */
+  static std::optional<Sample> load_file(const std::filesystem::path& path, const std::byte* data, size_t size) noexcept;
+
+  static std::optional<Sample> load_compressed_file(
+      const std::filesystem::path& path,
+      const std::byte* data,
+      size_t size) noexcept;
+
+  // Long compressed files are split into segments decoded in parallel, num_threads = 0 uses one thread per CPU core
+  static std::optional<Sample> load_mp3_file(
+      const std::filesystem::path& path,
+      const std::byte* data,
+      size_t size,
+      uint32_t num_threads = 0) noexcept;
+
+  static std::optional<Sample> load_flac_file(
+      const std::filesystem::path& path,
+      const std::byte* data,
+      size_t size,
+      uint32_t num_threads = 0) noexcept;
+
+  static std::optional<Sample> load_ogg_vorbis_file(
+      const std::filesystem::path& path,
+      const std::byte* data,
+      size_t size,
+      uint32_t num_threads = 0) noexcept;
 
   static std::optional<SampleInfo> get_file_info(const std::filesystem::path& path) noexcept;
 };
@@ -0,0 +1,191 @@
+#include "sample_blocks.h"
+
+#include <bit>
+#include <cstring>
+
+#include "core/core_math.h"
+#include "sample.h"
+
+namespace wb {
+
+// Residuals with a quotient this large are stored as raw folded values instead
+static constexpr uint32_t rice_escape_quotient = 16;
+static constexpr uint32_t rice_escape_bits = 28;
+static constexpr uint32_t max_rice_param = 26;
+static constexpr uint32_t max_predictor_order = 2;
+static constexpr uint32_t warmup_bits = 32;
+
+// MSB-first bit writer
+struct BlockBitWriter {
+  std::vector<uint8_t>& bytes;
+  uint64_t cache = 0;
+  uint32_t cache_bits = 0;
+
+  inline void write(uint32_t value, uint32_t num_bits) {
+    if (num_bits == 0)
+      return;
+    cache = (cache << num_bits) | (value & (uint32_t)((1ull << num_bits) - 1));
+    cache_bits += num_bits;
+    while (cache_bits >= 8) {
+      cache_bits -= 8;
+      bytes.push_back((uint8_t)(cache >> cache_bits));
+    }
+  }
+
+  inline void write_residual(int32_t value, uint32_t param) {
+    uint32_t folded = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    uint32_t quotient = folded >> param;
+    if (quotient < rice_escape_quotient) {
+      write(1, quotient + 1);
+      write(folded, param);
+    } else {
+      write(0, rice_escape_quotient);
+      write(folded, rice_escape_bits);
+    }
+  }
+
+  inline void flush() {
+    if (cache_bits != 0)
+      write(0, 8 - cache_bits);
+  }
+};
+
+// MSB-first bit reader. The encoded data is padded, so reads never check for the end.
+struct BlockBitReader {
+  const uint8_t* pos;
+  uint64_t cache = 0;  // Left-aligned
+  uint32_t cache_bits = 0;
+
+  inline void refill() {
+    while (cache_bits <= 56) {
+      cache |= (uint64_t)*pos++ << (56 - cache_bits);
+      cache_bits += 8;
+    }
+  }
+
+  inline uint32_t read(uint32_t num_bits) {
+    if (num_bits == 0)
+      return 0;
+    if (cache_bits < num_bits)
+      refill();
+    uint32_t value = (uint32_t)(cache >> (64 - num_bits));
+    cache <<= num_bits;
+    cache_bits -= num_bits;
+    return value;
+  }
+
+  inline int32_t read_residual(uint32_t param) {
+    if (cache_bits < rice_escape_quotient + 1 + max_rice_param + 4)
+      refill();
+    uint32_t quotient = math::min((uint32_t)std::countl_zero(cache), rice_escape_quotient);
+    uint32_t folded;
+    if (quotient < rice_escape_quotient) {
+      cache <<= quotient + 1;
+      cache_bits -= quotient + 1;
+      folded = (quotient << param) | read(param);
+    } else {
+      cache <<= rice_escape_quotient;
+      cache_bits -= rice_escape_quotient;
+      folded = read(rice_escape_bits);
+    }
+    return (int32_t)(folded >> 1) ^ -(int32_t)(folded & 1);
+  }
+};
+
+static inline int32_t predict(const int32_t* samples, uint32_t order) {
+  switch (order) {
+    case 1: return samples[-1];
+    case 2: return 2 * samples[-1] - samples[-2];
+    default: break;
+  }
+  return 0;
+}
+
+static void encode_block(BlockBitWriter& writer, const int32_t* samples, uint32_t count) {
+  // Pick the predictor order with the smallest residuals
+  uint32_t order = 0;
+  uint64_t best_sum = UINT64_MAX;
+  for (uint32_t o = 0; o <= math::min(max_predictor_order, count); o++) {
+    uint64_t sum = 0;
+    for (uint32_t i = o; i < count; i++) {
+      int32_t residual = samples[i] - predict(samples + i, o);
+      sum += ((uint32_t)residual << 1) ^ (uint32_t)(residual >> 31);
+    }
+    if (sum < best_sum) {
+      best_sum = sum;
+      order = o;
+    }
+  }
+
+  uint32_t param = 0;
+  if (count > order) {
+    uint64_t mean = best_sum / (count - order);
+    param = mean > 0 ? math::min((uint32_t)std::bit_width(mean) - 1, max_rice_param) : 0;
+  }
+
+  writer.write(order, 2);
+  writer.write(param, 5);
+  for (uint32_t i = 0; i < order; i++)
+    writer.write((uint32_t)samples[i], warmup_bits);
+  for (uint32_t i = order; i < count; i++)
+    writer.write_residual(samples[i] - predict(samples + i, order), param);
+  writer.flush();
+}
+
+bool SampleBlocks::encode(const Sample& sample) {
+  if (sample.format != AudioFormat::I16 && sample.format != AudioFormat::I24)
+    return false;
+  if (sample.channels == 0 || sample.channels > max_channels || sample.is_compressed())
+    return false;
+
+  channels = sample.channels;
+  num_frames = sample.count;
+  num_blocks = (sample.count + block_frames - 1) / block_frames;
+  block_offsets.resize(num_blocks * channels);
+  data.clear();
+
+  int32_t block_samples[block_frames];
+  BlockBitWriter writer{ data };
+  for (uint64_t block = 0; block < num_blocks; block++) {
+    uint64_t first_frame = block * block_frames;
+    uint32_t count = (uint32_t)math::min((uint64_t)block_frames, num_frames - first_frame);
+    for (uint32_t c = 0; c < channels; c++) {
+      if (sample.format == AudioFormat::I16) {
+        const int16_t* src = sample.get_read_pointer<int16_t>(c) + first_frame;
+        for (uint32_t i = 0; i < count; i++)
+          block_samples[i] = src[i];
+      } else {
+        const std::byte* src = sample.get_read_pointer<std::byte>(c) + first_frame * 3;
+        for (uint32_t i = 0; i < count; i++)
+          block_samples[i] = read_packed_i24(src + i * 3);
+      }
+      block_offsets[block * channels + c] = data.size();
+      encode_block(writer, block_samples, count);
+    }
+  }
+
+  // Padding for the bit reader
+  data.resize(data.size() + sizeof(uint64_t), 0);
+  data.shrink_to_fit();
+  return true;
+}
+
+void SampleBlocks::decode_block(uint32_t channel, uint64_t block, int32_t* output) const {
+  if (block >= num_blocks) {
+    std::memset(output, 0, block_frames * sizeof(int32_t));
+    return;
+  }
+
+  uint32_t count = (uint32_t)math::min((uint64_t)block_frames, num_frames - block * block_frames);
+  BlockBitReader reader{ data.data() + block_offsets[block * channels + channel] };
+  uint32_t order = reader.read(2);
+  uint32_t param = reader.read(5);
+  for (uint32_t i = 0; i < order; i++)
+    output[i] = (int32_t)reader.read(warmup_bits);
+  for (uint32_t i = order; i < count; i++)
+    output[i] = predict(output + i, order) + reader.read_residual(param);
+  if (count < block_frames)
+    std::memset(output + count, 0, (block_frames - count) * sizeof(int32_t));
+}
+
+}  // namespace wb
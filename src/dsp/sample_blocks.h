@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+#include "core/common.h"
+
+namespace wb {
+
+struct Sample;
+
+// Lossless in-memory compression of integer samples. Each channel is split into blocks of block_frames frames. A block
+// is coded with a fixed polynomial predictor and Rice coded residuals like a FLAC subframe, so any block can be decoded
+// on its own while streaming.
+struct SampleBlocks {
+  static constexpr uint32_t block_frames = 4096;
+  static constexpr uint32_t max_channels = 2;
+
+  uint32_t channels = 0;
+  uint64_t num_frames = 0;
+  uint64_t num_blocks = 0;
+  std::vector<uint64_t> block_offsets;  // Indexed by block * channels + channel
+  std::vector<uint8_t> data;
+
+  /**
+   * @brief Compress the samples. Only mono and stereo 16-bit and packed 24-bit samples are supported.
+   *
+   * @param sample Sample to compress.
+   * @return True on success.
+   */
+  bool encode(const Sample& sample);
+
+  /**
+   * @brief Decode one block of a channel.
+   *
+   * @param channel Channel index.
+   * @param block Block index.
+   * @param output Receives block_frames samples. Frames past the end of the sample are zero.
+   */
+  void decode_block(uint32_t channel, uint64_t block, int32_t* output) const;
+
+  inline size_t memory_size() const {
+    return data.size() + block_offsets.size() * sizeof(uint64_t);
+  }
+};
+
+}  // namespace wb
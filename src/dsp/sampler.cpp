@@ -1,9 +1,20 @@
 #include "sampler.h"
 
+#include <cstring>
+
 #include "core/core_math.h"
+#include "dsp_ops.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define WB_SAMPLER_SSE2 1
+#endif
 
 namespace wb::dsp {
 
+// Number of packed 24-bit samples converted at once before mixing
+static constexpr uint32_t unpack_chunk_size = 256;
+
 template<AudioFormat Fmt>
 inline static constexpr auto get_pcm_sample_normalizer() {
   if constexpr (Fmt == AudioFormat::I16) {
@@ -17,17 +28,57 @@ inline static constexpr auto get_pcm_sample_normalizer() {
   }
 }
 
-static void sample_nearest(
-    Sampler* sampler,
-    Sample* sample,
-    uint32_t channel,
+template<AudioFormat Fmt, typename T>
+inline static auto load_pcm_sample(const T* src, int64_t index) {
+  if constexpr (Fmt == AudioFormat::I24) {
+    return read_packed_i24((const std::byte*)src + index * 3);
+  } else {
+    return src[index];
+  }
+}
+
+// Convert packed 24-bit samples to normalized floats
+static void unpack_i24_to_f32(const std::byte* src, float* dst, uint32_t count) {
+  static constexpr float normalizer = get_pcm_sample_normalizer<AudioFormat::I24>();
+  uint32_t i = 0;
+#if defined(WB_SAMPLER_SSE2)
+  // Gather four samples from 12 bytes into the 32-bit lanes, then shift them up and back down to sign extend them.
+  // Each load reads 16 bytes, the last samples are left to the scalar loop so the load stays inside the buffer.
+  const __m128 scale = _mm_set1_ps(normalizer);
+  for (; i + 6 <= count; i += 4) {
+    __m128i x = _mm_loadu_si128((const __m128i*)(src + i * 3));
+    __m128i s01 = _mm_unpacklo_epi32(x, _mm_srli_si128(x, 3));
+    __m128i s23 = _mm_unpacklo_epi32(_mm_srli_si128(x, 6), _mm_srli_si128(x, 9));
+    __m128i v = _mm_unpacklo_epi64(s01, s23);
+    v = _mm_srai_epi32(_mm_slli_epi32(v, 8), 8);
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+  }
+#endif
+  for (; i < count; i++)
+    dst[i] = (float)read_packed_i24(src + i * 3) * normalizer;
+}
+
+// Rounds to the closest source frame, which reads at most one frame ahead like the linear interpolation
+template<typename T, AudioFormat Fmt>
+inline static void sample_nearest(
+    uint32_t num_channels,
     uint32_t num_samples,
-    size_t sample_offset,
-    float* output_buffer) {
-  switch (sample->format) {
-    case AudioFormat::I16: break;
-    case AudioFormat::I24: break;
-    default: break;
+    uint32_t buffer_offset,
+    float gain,
+    double playback_speed,
+    double sample_position,
+    const T* const* src_channels,
+    float** output_buffer) {
+  static constexpr auto pcm_normalizer = get_pcm_sample_normalizer<Fmt>();
+  using NormalizerT = decltype(pcm_normalizer);
+  for (uint32_t i = 0; i < num_channels; i++) {
+    const T* src_sample = src_channels[i];
+    float* dst_buffer = output_buffer[i] + buffer_offset;
+    for (uint32_t j = 0; j < num_samples; j++) {
+      const int64_t ix = (int64_t)(sample_position + ((double)j * playback_speed) + 0.5);
+      const float s = (float)(pcm_normalizer * (NormalizerT)load_pcm_sample<Fmt>(src_sample, ix));
+      dst_buffer[j] += s * gain;
+    }
   }
 }
 
@@ -50,14 +101,37 @@ inline static void sample_linear(
       const double x = sample_position + ((double)j * playback_speed);
       const int64_t ix = (int64_t)x;
       const float fx = (float)(x - (double)ix);
-      const float a = (float)(pcm_normalizer * (NormalizerT)src_sample[ix]);
-      const float b = (float)(pcm_normalizer * (NormalizerT)src_sample[ix + 1]);
+      const float a = (float)(pcm_normalizer * (NormalizerT)load_pcm_sample<Fmt>(src_sample, ix));
+      const float b = (float)(pcm_normalizer * (NormalizerT)load_pcm_sample<Fmt>(src_sample, ix + 1));
       const float s = a + fx * (b - a);
       dst_buffer[j] += s * gain;
     }
   }
 }
 
+template<typename T, AudioFormat Fmt>
+inline static void resample(
+    ResamplerType resampler_type,
+    uint32_t num_channels,
+    uint32_t num_samples,
+    uint32_t buffer_offset,
+    float gain,
+    double playback_speed,
+    double sample_position,
+    const T* const* src_channels,
+    float** output_buffer) {
+  switch (resampler_type) {
+    case ResamplerType::Nearest:
+      sample_nearest<T, Fmt>(
+          num_channels, num_samples, buffer_offset, gain, playback_speed, sample_position, src_channels, output_buffer);
+      break;
+    case ResamplerType::Linear:
+      sample_linear<T, Fmt>(
+          num_channels, num_samples, buffer_offset, gain, playback_speed, sample_position, src_channels, output_buffer);
+      break;
+  }
+}
+
 template<typename T, AudioFormat Fmt>
 inline static void sample_catmull_rom(
     uint32_t num_channels,
@@ -77,10 +151,10 @@ inline static void sample_catmull_rom(
       const double x = (sample_position + (double)j) * playback_speed;
       const int64_t ix = (int64_t)x;
       const float fx = (float)(x - (double)ix);
-      const float a = (float)(pcm_normalizer * (NormalizerT)src_sample[ix - 1]);
-      const float b = (float)(pcm_normalizer * (NormalizerT)src_sample[ix]);
-      const float c = (float)(pcm_normalizer * (NormalizerT)src_sample[ix + 1]);
-      const float d = (float)(pcm_normalizer * (NormalizerT)src_sample[ix + 2]);
+      const float a = (float)(pcm_normalizer * (NormalizerT)load_pcm_sample<Fmt>(src_sample, ix - 1));
+      const float b = (float)(pcm_normalizer * (NormalizerT)load_pcm_sample<Fmt>(src_sample, ix));
+      const float c = (float)(pcm_normalizer * (NormalizerT)load_pcm_sample<Fmt>(src_sample, ix + 1));
+      const float d = (float)(pcm_normalizer * (NormalizerT)load_pcm_sample<Fmt>(src_sample, ix + 2));
     }
   }
 }
@@ -93,12 +167,16 @@ void Sampler::stream(
     float gain,
     float** dst_out_buffer) {
   static constexpr float i16_pcm_normalizer = 1.0f / static_cast<float>(std::numeric_limits<int16_t>::max());
-  static constexpr double i24_pcm_normalizer = 1.0 / static_cast<double>((1 << 23) - 1);
   static constexpr double i32_pcm_normalizer = 1.0 / static_cast<double>(std::numeric_limits<int32_t>::max());
 
   if (sample_offset_ >= sample->count)
     return;  // has finished streaming
 
+  if (sample->is_compressed()) {
+    stream_compressed_(sample, num_channels, num_samples, buffer_offset, gain, dst_out_buffer);
+    return;
+  }
+
   double stream_max_length = ((double)sample->count - sample_offset_) / playback_speed_;
   double next_sample_offset = sample_offset_ + ((double)num_samples * playback_speed_);
   uint32_t num_actual_samples = std::min(num_samples, (uint32_t)std::ceil(stream_max_length));
@@ -119,13 +197,16 @@ void Sampler::stream(
         break;
       }
       case AudioFormat::I24: {
+        float unpacked[unpack_chunk_size];
         for (uint32_t i = 0; i < num_channels; i++) {
           int32_t c = i % sample->channels;
-          const int32_t* sample_data = sample->get_read_pointer<int32_t>(c);
+          const std::byte* sample_data = sample->get_read_pointer<std::byte>(c) + (size_t)sample_offset_u32 * 3;
           float* output_buffer = dst_out_buffer[i] + buffer_offset;
-          for (uint32_t j = 0; j < num_actual_samples; j++) {
-            double sample = (double)sample_data[sample_offset_u32 + j] * i24_pcm_normalizer;
-            output_buffer[j] += (float)math::clamp(sample, -1.0, 1.0) * gain;
+          for (uint32_t j = 0; j < num_actual_samples; j += unpack_chunk_size) {
+            uint32_t count = std::min(unpack_chunk_size, num_actual_samples - j);
+            unpack_i24_to_f32(sample_data + (size_t)j * 3, unpacked, count);
+            for (uint32_t k = 0; k < count; k++)
+              output_buffer[j + k] += math::clamp(unpacked[k], -1.0f, 1.0f) * gain;
           }
         }
         break;
@@ -146,11 +227,7 @@ void Sampler::stream(
         for (uint32_t i = 0; i < num_channels; i++) {
           int32_t c = i % sample->channels;
           const float* sample_data = sample->get_read_pointer<float>(c);
-          float* output_buffer = dst_out_buffer[i] + buffer_offset;
-          for (uint32_t j = 0; j < num_actual_samples; j++) {
-            float sample = sample_data[sample_offset_u32 + j];
-            output_buffer[j] += sample * gain;
-          }
+          mix_gain(sample_data + sample_offset_u32, dst_out_buffer[i] + buffer_offset, num_actual_samples, gain);
         }
         break;
       }
@@ -159,7 +236,8 @@ void Sampler::stream(
   } else {
     switch (sample->format) {
       case AudioFormat::I16:
-        sample_linear<int16_t, AudioFormat::I16>(
+        resample<int16_t, AudioFormat::I16>(
+            resampler_type_,
             num_channels,
             num_actual_samples,
             buffer_offset,
@@ -170,18 +248,20 @@ void Sampler::stream(
             dst_out_buffer);
         break;
       case AudioFormat::I24:
-        sample_linear<int32_t, AudioFormat::I24>(
+        resample<std::byte, AudioFormat::I24>(
+            resampler_type_,
             num_channels,
             num_actual_samples,
             buffer_offset,
             gain,
             playback_speed_,
             sample_offset_,
-            sample->get_sample_data<int32_t>(),
+            sample->get_sample_data<std::byte>(),
             dst_out_buffer);
         break;
       case AudioFormat::I32:
-        sample_linear<int32_t, AudioFormat::I32>(
+        resample<int32_t, AudioFormat::I32>(
+            resampler_type_,
             num_channels,
             num_actual_samples,
             buffer_offset,
@@ -192,7 +272,8 @@ void Sampler::stream(
             dst_out_buffer);
         break;
       case AudioFormat::F32:
-        sample_linear<float, AudioFormat::F32>(
+        resample<float, AudioFormat::F32>(
+            resampler_type_,
             num_channels,
             num_actual_samples,
             buffer_offset,
@@ -209,4 +290,83 @@ void Sampler::stream(
   sample_offset_ = next_sample_offset;
 }
 
+void Sampler::stream_compressed_(
+    Sample* sample,
+    uint32_t num_channels,
+    uint32_t num_samples,
+    uint32_t buffer_offset,
+    float gain,
+    float** dst_out_buffer) {
+  static constexpr uint32_t block_frames = SampleBlocks::block_frames;
+  // Allocating here would block the audio thread, the track allocates the cache when the sample is assigned
+  assert(block_cache_ != nullptr && "Block cache is not allocated");
+  if (block_cache_ == nullptr) [[unlikely]] {
+    sample_offset_ += (double)num_samples * playback_speed_;
+    return;
+  }
+  double stream_max_length = ((double)sample->count - sample_offset_) / playback_speed_;
+  uint32_t num_actual_samples = std::min(num_samples, (uint32_t)std::ceil(stream_max_length));
+
+  // Stream the cached blocks, then move the cache forward
+  uint32_t num_streamed = 0;
+  while (num_streamed < num_actual_samples) {
+    double position = sample_offset_ + (double)num_streamed * playback_speed_;
+    uint64_t first_block = (uint64_t)position / block_frames;
+    fill_block_cache_(sample, first_block);
+
+    // Interpolation reads one frame ahead, stop before it runs past the cache
+    double cache_position = position - (double)(first_block * block_frames);
+    double num_cached = std::floor(((double)(block_cache_frames - 2) - cache_position) / playback_speed_) + 1.0;
+    uint32_t count = (uint32_t)math::min((double)(num_actual_samples - num_streamed), num_cached);
+    for (uint32_t i = 0; i < num_channels; i++) {
+      const float* cache = block_cache_->frames[i % sample->channels];
+      if (playback_speed_ == 1.0) {
+        const float* src = cache + (uint32_t)cache_position;
+        mix_gain(src, dst_out_buffer[i] + buffer_offset + num_streamed, count, gain);
+      } else {
+        resample<float, AudioFormat::F32>(
+            resampler_type_,
+            1,
+            count,
+            buffer_offset + num_streamed,
+            gain,
+            playback_speed_,
+            cache_position,
+            &cache,
+            &dst_out_buffer[i]);
+      }
+    }
+    num_streamed += count;
+  }
+
+  sample_offset_ += (double)num_samples * playback_speed_;
+}
+
+void Sampler::fill_block_cache_(Sample* sample, uint64_t first_block) {
+  static constexpr uint32_t block_frames = SampleBlocks::block_frames;
+  if (cached_block_ == first_block)
+    return;
+  for (uint32_t c = 0; c < sample->channels; c++) {
+    float* cache = block_cache_->frames[c];
+    if (cached_block_ != invalid_block && cached_block_ + 1 == first_block) {
+      // Playback moved to the next block, which is already decoded
+      std::memcpy(cache, cache + block_frames, block_frames * sizeof(float));
+      decode_cache_block_(sample, c, first_block + 1, cache + block_frames);
+    } else {
+      decode_cache_block_(sample, c, first_block, cache);
+      decode_cache_block_(sample, c, first_block + 1, cache + block_frames);
+    }
+  }
+  cached_block_ = first_block;
+}
+
+void Sampler::decode_cache_block_(Sample* sample, uint32_t channel, uint64_t block, float* output) {
+  int32_t* decode_buffer = block_cache_->decode_buffer;
+  sample->blocks->decode_block(channel, block, decode_buffer);
+  float normalizer = sample->format == AudioFormat::I16 ? get_pcm_sample_normalizer<AudioFormat::I16>()
+                                                        : (float)get_pcm_sample_normalizer<AudioFormat::I24>();
+  for (uint32_t i = 0; i < SampleBlocks::block_frames; i++)
+    output[i] = math::clamp((float)decode_buffer[i] * normalizer, -1.0f, 1.0f);
+}
+
 }  // namespace wb::dsp
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <memory>
+
 #include "core/common.h"
 #include "sample.h"
+#include "sample_blocks.h"
 
 namespace wb::dsp {
 
@@ -11,9 +14,20 @@ enum class ResamplerType {
 };
 
 struct Sampler {
+  // Two consecutive blocks of a compressed sample are kept decoded, so interpolation can read across a block boundary
+  static constexpr uint32_t block_cache_frames = SampleBlocks::block_frames * 2;
+  static constexpr uint64_t invalid_block = UINT64_MAX;
+
+  struct BlockCache {
+    float frames[SampleBlocks::max_channels][block_cache_frames];
+    int32_t decode_buffer[SampleBlocks::block_frames];
+  };
+
   double playback_speed_;
   double sample_offset_;
   ResamplerType resampler_type_;
+  uint64_t cached_block_ = invalid_block;
+  std::unique_ptr<BlockCache> block_cache_;  // Allocated by allocate_block_cache(), never on the audio thread
 
   void reset_state(
       ResamplerType resampler_type,
@@ -24,6 +38,18 @@ struct Sampler {
     playback_speed_ = (src_sample_rate / dst_sample_rate) * speed;
     sample_offset_ = sample_offset;
     resampler_type_ = resampler_type;
+    cached_block_ = invalid_block;
+  }
+
+  // Prepare for streaming compressed samples. Most tracks never play one, so the cache is only allocated once a
+  // compressed sample is assigned to the track.
+  void allocate_block_cache() {
+    if (block_cache_ == nullptr)
+      block_cache_ = std::make_unique<BlockCache>();
+  }
+
+  inline bool has_block_cache() const {
+    return block_cache_ != nullptr;
   }
 
   void stream(
@@ -33,6 +59,16 @@ struct Sampler {
       uint32_t buffer_offset,
       float gain,
       float** dst_out_buffer);
+
+  void stream_compressed_(
+      Sample* sample,
+      uint32_t num_channels,
+      uint32_t num_samples,
+      uint32_t buffer_offset,
+      float gain,
+      float** dst_out_buffer);
+  void fill_block_cache_(Sample* sample, uint64_t first_block);
+  void decode_cache_block_(Sample* sample, uint32_t channel, uint64_t block, float* output);
 };
 
 }  // namespace wb::dsp
\ No newline at end of file
@@ -2,17 +2,98 @@
 
 #include "core/algorithm.h"
 #include "core/debug.h"
+#include "core/fs.h"
 #include "core/midi_file.h"
+#include "dsp/sample_blocks.h"
+#include "engine/clip_render.h"
+#include "engine/file_index.h"
 #include "extern/xxhash.h"
 
 namespace wb {
 
 static constexpr XXH64_hash_t sample_hash_seed = 69420;
 
-SampleAsset::~SampleAsset() {
+static uint64_t get_path_hash(const std::filesystem::path& path) {
+  std::u8string str_path = path.u8string();
+  return XXH64(str_path.data(), str_path.size(), sample_hash_seed);
+}
+
+// Bytes of sample heads currently locked into memory, shared by all sample contents
+static std::atomic<size_t> g_locked_head_total;
+static std::atomic_bool g_head_lock_disabled;
+
+static size_t get_locked_head_total_size(const Sample& sample, size_t locked_head_size) {
+  return sample.is_compressed() ? locked_head_size : locked_head_size * sample.channels;
+}
+
+static bool reserve_head_lock_budget(size_t size) {
+  size_t total = g_locked_head_total.load(std::memory_order_relaxed);
+  do {
+    if (total + size > SampleContent::head_lock_budget)
+      return false;
+  } while (!g_locked_head_total.compare_exchange_weak(total, total + size, std::memory_order_relaxed));
+  return true;
+}
+
+static void disable_head_lock() {
+  // Locking a valid range only fails when the memory lock limit is reached or not permitted (ENOMEM/EPERM), the
+  // following samples would fail as well
+  if (!g_head_lock_disabled.exchange(true, std::memory_order_relaxed))
+    Log::warn("Cannot lock sample heads into memory, memory lock limit reached");
+}
+
+SampleContent::~SampleContent() {
+  g_clip_renderer.release_renders(this);
+  if (locked_head_size != 0) {
+    if (sample_instance.is_compressed()) {
+      unlock_memory(sample_instance.blocks->data.data(), locked_head_size);
+    } else {
+      for (uint32_t i = 0; i < sample_instance.channels; i++)
+        unlock_memory(sample_instance.sample_data[i], locked_head_size);
+    }
+    g_locked_head_total.fetch_sub(get_locked_head_total_size(sample_instance, locked_head_size),
+                                  std::memory_order_relaxed);
+  }
   delete peaks;
 }
 
+bool SampleContent::lock_sample_head() {
+  if (g_head_lock_disabled.load(std::memory_order_relaxed))
+    return false;
+
+  if (sample_instance.is_compressed()) {
+    // Blocks of all channels are stored next to each other, lock the head of the compressed data as a whole
+    const std::vector<uint8_t>& data = sample_instance.blocks->data;
+    size_t lock_size = std::min(data.size(), head_lock_size * sample_instance.channels);
+    if (lock_size == 0 || !reserve_head_lock_budget(lock_size))
+      return false;
+    if (!lock_memory(data.data(), lock_size)) {
+      g_locked_head_total.fetch_sub(lock_size, std::memory_order_relaxed);
+      disable_head_lock();
+      return false;
+    }
+    locked_head_size = lock_size;
+    return true;
+  }
+
+  size_t sample_size = sample_instance.count * get_audio_format_size(sample_instance.format);
+  size_t lock_size = std::min(sample_size, head_lock_size);
+  size_t total_size = lock_size * sample_instance.channels;
+  if (total_size == 0 || !reserve_head_lock_budget(total_size))
+    return false;
+  for (uint32_t i = 0; i < sample_instance.channels; i++) {
+    if (!lock_memory(sample_instance.sample_data[i], lock_size)) {
+      for (uint32_t j = 0; j < i; j++)
+        unlock_memory(sample_instance.sample_data[j], lock_size);
+      g_locked_head_total.fetch_sub(total_size, std::memory_order_relaxed);
+      disable_head_lock();
+      return false;
+    }
+  }
+  locked_head_size = lock_size;
+  return true;
+}
+
 void SampleAsset::release() {
   if (ref_count == 0)
     return;
@@ -22,8 +103,7 @@ void SampleAsset::release() {
 }
 
 SampleAsset* SampleTable::create_from_existing_sample(Sample&& sample) {
-  std::u8string str_path = sample.path.u8string();
-  uint64_t hash = XXH64(str_path.data(), str_path.size(), sample_hash_seed);
+  uint64_t hash = get_path_hash(sample.path);
 
   auto item = samples.find(hash);
   if (item != samples.end()) {
@@ -35,13 +115,14 @@ SampleAsset* SampleTable::create_from_existing_sample(Sample&& sample) {
   if (sample_peaks == nullptr)
     return {};
 
-  auto asset = samples.try_emplace(hash, this, hash, 1u, std::move(sample), sample_peaks);
-  return &asset.first->second;
+  // Recorded samples are not backed by a file, never share them
+  std::filesystem::path path = sample.path;
+  SampleContent* content = create_content_(0, 0, 0, std::move(sample), sample_peaks);
+  return create_asset_(hash, path, content);
 }
 
 SampleAsset* SampleTable::load_from_file(const std::filesystem::path& path) {
-  std::u8string str_path = path.u8string();
-  uint64_t hash = XXH64(str_path.data(), str_path.size(), sample_hash_seed);
+  uint64_t hash = get_path_hash(path);
 
   auto item = samples.find(hash);
   if (item != samples.end()) {
@@ -49,7 +130,22 @@ SampleAsset* SampleTable::load_from_file(const std::filesystem::path& path) {
     return &item->second;
   }
 
-  auto new_sample{ Sample::load_file(path) };
+  // The file is read once. The full hash comes from the same bytes the decoder reads, it is stored with the content
+  // and projects use it to confirm relocated files.
+  MappedFile file;
+  if (!std::filesystem::is_regular_file(path) || !file.open(path))
+    return {};
+  uint64_t file_size = file.size();
+  uint64_t content_hash = g_file_index.get_content_hash(path);
+  uint64_t full_hash = compute_full_hash(file.data(), file.size());
+  if (content_hash != 0) {
+    if (SampleContent* content = find_content_(content_hash, full_hash)) {
+      Log::debug("Sharing sample data of {} with {}", path.string(), content->source_path.string());
+      return create_asset_(hash, path, content);
+    }
+  }
+
+  auto new_sample{ Sample::load_file(path, file.data(), file.size()) };
   if (!new_sample)
     return {};
 
@@ -57,15 +153,27 @@ SampleAsset* SampleTable::load_from_file(const std::filesystem::path& path) {
   if (sample_peaks == nullptr)
     return {};
 
-  auto asset = samples.try_emplace(hash, this, hash, 1u, std::move(*new_sample), sample_peaks);
-  return &asset.first->second;
+  // Peaks are generated from the plain samples, compress afterwards
+  if (compress_samples)
+    new_sample->compress();
+  size_t memory_size = new_sample->get_memory_size();
+  Log::info(
+      "Loaded sample {}: {} KiB in memory, {} KiB saved",
+      path.string(),
+      memory_size >> 10,
+      (new_sample->get_unpacked_memory_size() - memory_size) >> 10);
+
+  SampleContent* content = create_content_(content_hash, full_hash, file_size, std::move(*new_sample), sample_peaks);
+  return create_asset_(hash, path, content);
 }
 
 void SampleTable::destroy_sample(uint64_t hash) {
   auto item = samples.find(hash);
   if (item == samples.end())
     return;
+  SampleContent* content = item->second.content;
   samples.erase(item);
+  release_content_(content);
 }
 
 void SampleTable::destroy_unused() {
@@ -74,14 +182,58 @@ void SampleTable::destroy_unused() {
     if (sample.ref_count == 0)
       unused_samples.push_back(hash);
   for (auto hash : unused_samples)
-    samples.erase(hash);
+    destroy_sample(hash);
 }
 
 void SampleTable::shutdown() {
   // NOTE(native-m): Sample may leak if created with ref_count == 0
   for (auto& [hash, sample] : samples)
-    Log::debug("Sample asset leak: {}", sample.sample_instance.path.string(), sample.ref_count);
+    Log::debug("Sample asset leak: {}", sample.path.string(), sample.ref_count);
   samples.clear();
+  contents.clear();
+}
+
+SampleContent* SampleTable::find_content_(uint64_t content_hash, uint64_t full_hash) {
+  // The quick hash only covers the head and tail of the file, confirm the match with the whole file
+  auto [first, last] = contents.equal_range(content_hash);
+  for (auto it = first; it != last; ++it) {
+    SampleContent& content = it->second;
+    if (content.full_hash == full_hash)
+      return &content;
+  }
+  return nullptr;
+}
+
+SampleContent* SampleTable::create_content_(
+    uint64_t content_hash,
+    uint64_t full_hash,
+    uint64_t file_size,
+    Sample&& sample,
+    WaveformVisual* peaks) {
+  std::filesystem::path source_path = sample.path;
+  auto item = contents.emplace(std::piecewise_construct, std::forward_as_tuple(content_hash),
+                               std::forward_as_tuple(content_hash, full_hash, file_size, std::move(source_path), 0u,
+                                                     std::move(sample), peaks));
+  item->second.lock_sample_head();
+  return &item->second;
+}
+
+SampleAsset* SampleTable::create_asset_(uint64_t hash, const std::filesystem::path& path, SampleContent* content) {
+  content->num_assets++;
+  auto asset = samples.try_emplace(hash, this, hash, 1u, path, content);
+  return &asset.first->second;
+}
+
+void SampleTable::release_content_(SampleContent* content) {
+  if (--content->num_assets != 0)
+    return;
+  auto [first, last] = contents.equal_range(content->content_hash);
+  for (auto it = first; it != last; ++it) {
+    if (&it->second == content) {
+      contents.erase(it);
+      return;
+    }
+  }
 }
 
 //
@@ -97,16 +249,7 @@ void MidiAsset::release() {
 }
 
 uint32_t MidiAsset::find_first_note(double pos, uint32_t channel) {
-  const MidiNoteBuffer& buffer = data.note_sequence;
-  auto begin = buffer.begin();
-  auto end = buffer.end();
-  while (begin != end && pos >= begin->max_time) {
-    begin++;
-  }
-  if (begin == end) {
-    return (uint32_t)(-1);
-  }
-  return begin - buffer.begin();
+  return data.find_first_note(pos);
 }
 
 MidiAsset* MidiTable::load_from_file(const std::filesystem::path& path) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <filesystem>
 #include <optional>
 #include <unordered_map>
@@ -16,18 +17,40 @@
 namespace wb {
 
 using SampleHash = uint64_t;
+struct SampleRender;
 struct SampleTable;
 struct MidiTable;
 
+// Decoded audio and waveform of a sample file. Files with identical content share one SampleContent.
+struct SampleContent {
+  // Number of bytes per channel locked into memory at the start of each sample
+  static constexpr size_t head_lock_size = 256 * 1024;
+  // Total number of bytes of sample heads that may be locked into memory
+  static constexpr size_t head_lock_budget = 64 * 1024 * 1024;
+
+  uint64_t content_hash;  // Hash of the file head and tail, 0 if the sample is not backed by a file
+  uint64_t full_hash;     // Hash of the whole file, 0 if the sample is not backed by a file
+  uint64_t file_size;     // Size of the file when it was loaded
+  std::filesystem::path source_path;
+  uint32_t num_assets;
+  Sample sample_instance;
+  WaveformVisual* peaks{};
+  size_t locked_head_size = 0;  // Per channel, or in total for compressed samples
+  std::atomic<SampleRender*> renders{};  // Pre-rendered copies, see ClipRenderer
+
+  ~SampleContent();
+  bool lock_sample_head();
+};
+
+// A sample file referenced by clips. Each path has its own asset, paths with the same content share the content.
 struct SampleAsset {
   SampleTable* sample_table;
-  uint64_t hash;
+  uint64_t hash;  // Hash of the path
   uint32_t ref_count = 1u;
-  Sample sample_instance;
-  WaveformVisual* peaks{};
+  std::filesystem::path path;
+  SampleContent* content;
   bool keep_alive = false;
 
-  ~SampleAsset();
   inline void add_ref() noexcept {
     ++ref_count;
   }
@@ -49,12 +72,33 @@ struct MidiAsset : public InplaceList<MidiAsset> {
 };
 
 struct SampleTable {
-  std::unordered_map<uint64_t, SampleAsset> samples;
+  std::unordered_map<uint64_t, SampleAsset> samples;          // Keyed by path hash
+  std::unordered_multimap<uint64_t, SampleContent> contents;  // Keyed by content hash
+  bool compress_samples = false;  // Keep loaded samples losslessly compressed in memory
+
   SampleAsset* create_from_existing_sample(Sample&& sample);
+
+  /**
+   * @brief Load a sample file. If a file with the same content has already been loaded, its decoded samples and
+   * waveform are shared instead of decoding the file again.
+   *
+   * @param path Sample file path.
+   * @return Sample asset, or nullptr if the file cannot be loaded.
+   */
   SampleAsset* load_from_file(const std::filesystem::path& path);
   void destroy_sample(uint64_t hash);
   void destroy_unused();
   void shutdown();
+
+  SampleContent* find_content_(uint64_t content_hash, uint64_t full_hash);
+  SampleContent* create_content_(
+      uint64_t content_hash,
+      uint64_t full_hash,
+      uint64_t file_size,
+      Sample&& sample,
+      WaveformVisual* peaks);
+  SampleAsset* create_asset_(uint64_t hash, const std::filesystem::path& path, SampleContent* content);
+  void release_content_(SampleContent* content);
 };
 
 struct MidiTable {
@@ -83,6 +83,7 @@ struct AudioIO {
   AudioDevicePeriod min_period = 0;
   bool low_latency_shared_mode{};
   uint32_t buffer_alignment = 0;
+  uint64_t audio_thread_cpu_mask = 0;
   bool open = false;
 
   uint32_t get_input_device_count() const {
@@ -179,6 +180,18 @@ struct AudioIO {
       AudioThreadPriority priority) = 0;
 };
 
+// Map audio thread priority to SCHED_FIFO priority
+inline static int32_t get_audio_thread_realtime_priority(AudioThreadPriority priority) {
+  switch (priority) {
+    case AudioThreadPriority::Lowest: return 60;
+    case AudioThreadPriority::Low: return 65;
+    case AudioThreadPriority::Normal: return 70;
+    case AudioThreadPriority::High: return 75;
+    case AudioThreadPriority::Highest: return 80;
+  }
+  return 70;
+}
+
 inline static uint32_t period_to_buffer_size(AudioDevicePeriod period, uint32_t sample_rate) {
   constexpr double unit_100_ns = 10000000.0;
   return (uint32_t)math::round(sample_rate * period / unit_100_ns);
@@ -8,6 +8,7 @@
 #include "core/audio_format_conv.h"
 #include "core/debug.h"
 #include "core/defer.h"
+#include "core/thread.h"
 #include "core/vector.h"
 #include "engine.h"
 
@@ -466,6 +467,11 @@ struct AudioIOPulseAudio2 : public AudioIO {
   }
 
   static void audio_thread_runner(AudioIOPulseAudio2* instance, AudioThreadPriority thread_priority) {
+    // Stream callbacks are dispatched from the main loop, so the real-time setup applies to them
+    setup_realtime_thread(
+        "Whitebox Audio Thread",
+        get_audio_thread_realtime_priority(thread_priority),
+        instance->audio_thread_cpu_mask);
     pa_mainloop_run(instance->main_loop_, nullptr);
   }
 };
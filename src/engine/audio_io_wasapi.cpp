@@ -18,6 +18,8 @@
 #include "core/audio_format_conv.h"
 #include "core/core_math.h"
 #include "core/debug.h"
+#include "core/rt_log.h"
+#include "core/thread.h"
 #include "engine/engine.h"
 
 #ifndef __mmdeviceapi_h__
@@ -647,6 +649,13 @@ void AudioIOWASAPI::audio_thread_runner(AudioIOWASAPI* instance, AudioThreadPrio
     AvSetMmThreadPriority(task, avrt_priority);
   }
 
+  // MMCSS takes care of the thread priority
+  if (instance->audio_thread_cpu_mask != 0 && !set_current_thread_affinity(instance->audio_thread_cpu_mask))
+    Log::warn("Cannot set audio thread affinity");
+  if (!disable_denormals())
+    Log::warn("Cannot disable denormals on audio thread");
+  rt_log_register_thread("Whitebox Audio Thread");
+
   uint32_t buffer_size = instance->stream_buffer_size;
   uint32_t maximum_input_buffer_size = instance->maximum_input_buffer_size;
   uint32_t maximum_output_buffer_size = instance->maximum_output_buffer_size;
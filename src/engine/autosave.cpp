@@ -0,0 +1,103 @@
+#include "autosave.h"
+
+#include <fmt/format.h>
+
+#include "assets_table.h"
+#include "core/debug.h"
+#include "core/fs.h"
+#include "engine.h"
+#include "ui/timeline.h"
+
+namespace wb {
+
+Autosave g_autosave;
+
+void Autosave::init(const AutosaveConfig& autosave_config) {
+  config = autosave_config;
+  last_save_time = Clock::now();
+  if (config.interval_sec == 0)
+    return;
+
+  std::error_code ec;
+  std::filesystem::create_directories(config.directory, ec);
+  if (ec) {
+    Log::warn("Cannot create autosave directory {}", config.directory.string());
+    config.interval_sec = 0;
+    return;
+  }
+
+  std::filesystem::path latest = get_file_path(0);
+  if (std::filesystem::is_regular_file(latest))
+    Log::info("Previous autosave is available at {}", latest.string());
+}
+
+void Autosave::update(uint64_t num_changes) {
+  if (config.interval_sec == 0 || num_changes == saved_num_changes)
+    return;
+  if (Clock::now() - last_save_time < std::chrono::seconds(config.interval_sec))
+    return;
+  save(num_changes);
+}
+
+bool Autosave::save(uint64_t num_changes) {
+  if (config.interval_sec == 0 || busy.load(std::memory_order_acquire))
+    return false;
+
+  // Capturing the snapshot only copies the note sequences that have changed since the last autosave
+  g_engine.editor_lock.lock();
+  ProjectSnapshot new_snapshot;
+  capture_project_snapshot(new_snapshot, &snapshot, g_engine, g_sample_table, g_midi_table, g_timeline);
+  g_engine.editor_lock.unlock();
+
+  snapshot = std::move(new_snapshot);
+  saved_num_changes = num_changes;
+  last_save_time = Clock::now();
+  busy.store(true, std::memory_order_release);
+  enqueue_deferred_job(write_job_, this);
+  return true;
+}
+
+void Autosave::shutdown() {
+  busy.wait(true, std::memory_order_acquire);
+}
+
+std::filesystem::path Autosave::get_file_path(uint32_t backup_index) const {
+  if (backup_index == 0)
+    return config.directory / "autosave.wb";
+  return config.directory / fmt::format("autosave.{}.wb", backup_index);
+}
+
+void Autosave::rotate_backups_() const {
+  std::error_code ec;
+  for (uint32_t i = config.num_backups; i > 1; i--) {
+    std::filesystem::path src = get_file_path(i - 1);
+    if (std::filesystem::is_regular_file(src, ec))
+      std::filesystem::rename(src, get_file_path(i), ec);
+  }
+
+  // The latest autosave is copied rather than renamed, so it stays in place until the new one replaces it
+  std::filesystem::path latest = get_file_path(0);
+  if (std::filesystem::is_regular_file(latest, ec))
+    std::filesystem::copy_file(latest, get_file_path(1), std::filesystem::copy_options::overwrite_existing, ec);
+}
+
+void Autosave::write_job_(DeferredJobContext* ctx) {
+  Autosave* autosave = (Autosave*)ctx->userdata0;
+  ByteBuffer buffer;
+  encode_project_snapshot(autosave->snapshot, buffer);
+
+  // The latest autosave is copied to the first backup, then the new autosave replaces it atomically
+  if (autosave->config.num_backups > 0)
+    autosave->rotate_backups_();
+  ProjectFileResult result = ProjectFileResult::Ok;
+  if (!write_file_atomic(autosave->get_file_path(0), buffer.data(), buffer.position())) {
+    Log::error("Cannot write autosave {}", autosave->get_file_path(0).string());
+    result = ProjectFileResult::ErrCannotAccessFile;
+  }
+
+  autosave->last_result.store(result, std::memory_order_relaxed);
+  autosave->busy.store(false, std::memory_order_release);
+  autosave->busy.notify_all();
+}
+
+}  // namespace wb
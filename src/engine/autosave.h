@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+
+#include "core/common.h"
+#include "core/deferred_job.h"
+#include "project.h"
+
+namespace wb {
+
+struct AutosaveConfig {
+  std::filesystem::path directory;
+  uint32_t interval_sec = 120;  // 0 disables autosave
+  uint32_t num_backups = 3;     // Number of older autosaves kept next to the latest one
+};
+
+// Periodic project autosave. The project state is captured on the UI thread while holding the editor lock, encoding
+// and writing the file is done on the deferred job thread. Autosaves are written atomically and rotated, the latest
+// one is always "autosave.wb" and older ones are "autosave.1.wb", "autosave.2.wb", and so on.
+struct Autosave {
+  using Clock = std::chrono::steady_clock;
+
+  AutosaveConfig config;
+  ProjectSnapshot snapshot;  // Owned by the write job while busy is set
+  Clock::time_point last_save_time;
+  uint64_t saved_num_changes = 0;
+  std::atomic_bool busy;
+  std::atomic<ProjectFileResult> last_result{ ProjectFileResult::Ok };
+
+  void init(const AutosaveConfig& autosave_config);
+
+  /**
+   * @brief Start a new autosave once the interval has elapsed and the project has changed. Must be called from the UI
+   * thread.
+   *
+   * @param num_changes Project change counter, the project is only saved if it differs from the last autosave.
+   */
+  void update(uint64_t num_changes);
+
+  // Start a new autosave now, unless the previous one is still being written.
+  bool save(uint64_t num_changes);
+
+  // Wait until the pending autosave has been written.
+  void shutdown();
+
+  std::filesystem::path get_file_path(uint32_t backup_index) const;
+  void rotate_backups_() const;
+  static void write_job_(DeferredJobContext* ctx);
+};
+
+extern Autosave g_autosave;
+
+}  // namespace wb
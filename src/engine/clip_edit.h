@@ -4,6 +4,7 @@
 #include "core/common.h"
 #include "core/core_math.h"
 #include "etypes.h"
+#include "tempo_map.h"
 
 namespace wb {
 
@@ -15,13 +16,32 @@ static inline ClipMoveResult calc_move_clip(Clip* clip, double relative_pos, dou
   };
 }
 
+// Source frames an audio clip plays per second
+static inline double get_clip_frame_rate(const Clip* clip) {
+  return (double)clip->audio.asset->content->sample_instance.sample_rate * clip->audio.speed;
+}
+
+// Beat where the first frame of the clip content plays, before min_time when the clip starts inside its content
+static inline double get_clip_content_start(const Clip* clip, const TempoMap& tempo_map) {
+  if (clip->is_audio()) {
+    if (clip->audio.asset == nullptr)
+      return clip->min_time;
+    return tempo_map.time_to_beat(tempo_map.beat_to_time(clip->min_time) - clip->start_offset / get_clip_frame_rate(clip));
+  }
+  return clip->min_time - clip->start_offset;
+}
+
+/**
+ * @brief Resize or stretch a clip. Audio clip offsets follow the tempo map, like Track::process_event() converts them
+ * during playback.
+ */
 static inline ClipResizeResult calc_resize_clip(
     Clip* clip,
     double relative_pos,
     double resize_limit,
     double min_length,
     double min_resize_pos,
-    double beat_duration,
+    const TempoMap& tempo_map,
     bool is_min,
     bool shift = false,
     bool stretch = false,
@@ -37,31 +57,24 @@ static inline ClipResizeResult calc_resize_clip(
     double start_offset = clip->start_offset;
     double new_speed = 1.0;
 
+    // The content follows the right edge
     if (shift) {
-      SampleAsset* asset = nullptr;
-      double mult = 1.0;
       if (clip->is_audio()) {
-        asset = clip->audio.asset;
-        mult = clip->audio.speed;
-        start_offset = samples_to_beat(start_offset, (double)asset->sample_instance.sample_rate, beat_duration);
-      }
-      if (old_max < new_max)
-        start_offset -= (new_max - old_max) * mult;
-      else
-        start_offset += (old_max - new_max) * mult;
-      start_offset = math::max(start_offset, 0.0);
-      if (clip->is_audio() && asset) {
-        start_offset = math::min(start_offset, (double)asset->sample_instance.count);
-        start_offset = beat_to_samples(start_offset, (double)asset->sample_instance.sample_rate, beat_duration);
+        double shifted_time = tempo_map.beat_to_time(new_max) - tempo_map.beat_to_time(old_max);
+        start_offset -= shifted_time * get_clip_frame_rate(clip);
+        start_offset = math::clamp(start_offset, 0.0, (double)clip->audio.asset->content->sample_instance.count);
+      } else {
+        start_offset = math::max(start_offset - (new_max - old_max), 0.0);
       }
     }
 
     if (stretch && clip->is_audio()) {
       SampleAsset* asset = clip->audio.asset;
       if (asset) {
-        double sample_count = (double)asset->sample_instance.count;
+        double sample_count = (double)asset->content->sample_instance.count;
         double old_length = sample_count / clip->audio.speed;
-        double num_samples = beat_to_samples(relative_pos, clip->get_asset_sample_rate(), beat_duration);
+        double added_time = tempo_map.beat_to_time(old_max + relative_pos) - tempo_map.beat_to_time(old_max);
+        double num_samples = added_time * clip->get_asset_sample_rate();
         new_speed = sample_count / (old_length + num_samples);
       }
     }
@@ -87,32 +100,30 @@ static inline ClipResizeResult calc_resize_clip(
   double new_speed = 1.0;
 
   if (!shift) {
-    double old_start_offset = start_offset;
-    SampleAsset* asset = nullptr;
     if (clip->is_audio()) {
-      asset = clip->audio.asset;
-      start_offset = samples_to_beat(start_offset, (double)asset->sample_instance.sample_rate, beat_duration);
-    }
-
-    if (old_min < new_min)
-      start_offset -= old_min - new_min;
-    else
+      double frame_rate = get_clip_frame_rate(clip);
+      double old_min_time = tempo_map.beat_to_time(old_min);
+      start_offset += (tempo_map.beat_to_time(new_min) - old_min_time) * frame_rate;
+      // Stop at the first frame of the content
+      if (start_offset < 0.0) {
+        new_min = tempo_map.time_to_beat(old_min_time - clip->start_offset / frame_rate);
+        start_offset = 0.0;
+      }
+    } else {
       start_offset += new_min - old_min;
-
-    if (start_offset < 0.0)
-      new_min = new_min - start_offset;
-
-    start_offset = math::max(start_offset, 0.0);
-    if (clip->is_audio() && asset)
-      start_offset = beat_to_samples(start_offset, (double)asset->sample_instance.sample_rate, beat_duration);
+      if (start_offset < 0.0)
+        new_min = new_min - start_offset;
+      start_offset = math::max(start_offset, 0.0);
+    }
   }
 
   if (stretch && clip->is_audio()) {
     SampleAsset* asset = clip->audio.asset;
     if (asset) {
-      double sample_count = (double)asset->sample_instance.count;
+      double sample_count = (double)asset->content->sample_instance.count;
       double old_length = sample_count / clip->audio.speed;
-      double num_samples = beat_to_samples(old_min - new_min, clip->get_asset_sample_rate(), beat_duration);
+      double added_time = tempo_map.beat_to_time(old_min) - tempo_map.beat_to_time(new_min);
+      double num_samples = added_time * clip->get_asset_sample_rate();
       new_speed = sample_count / (old_length + num_samples);
     }
   }
@@ -125,28 +136,34 @@ static inline ClipResizeResult calc_resize_clip(
   };
 }
 
-static double
-calc_clip_shift(bool is_audio_clip, double start_offset, double relative_pos, double beat_duration, double sample_rate) {
+/**
+ * @brief Move the content of a clip starting at position by relative_pos beats.
+ *
+ * @param frame_rate Source frames an audio clip plays per second.
+ * @return The new start offset.
+ */
+static double calc_clip_shift(
+    bool is_audio_clip,
+    double start_offset,
+    double position,
+    double relative_pos,
+    const TempoMap& tempo_map,
+    double frame_rate) {
   if (is_audio_clip) {
-    const double offset_in_beat = samples_to_beat(start_offset, sample_rate, beat_duration);
-    return beat_to_samples(math::max(offset_in_beat - relative_pos, 0.0), sample_rate, beat_duration);
+    const double shifted_time = tempo_map.beat_to_time(position) - tempo_map.beat_to_time(position - relative_pos);
+    return math::max(start_offset - shifted_time * frame_rate, 0.0);
   }
 
   const double offset = start_offset;
   return math::max(offset - relative_pos, 0.0);
 }
 
-static double shift_clip_content(Clip* clip, double relative_pos, double beat_duration) {
+// The content starting at clip->min_time moves by relative_pos beats. Passing old_min - new_min keeps the content in
+// place while the clip start moves, clip->min_time must still hold the old position then.
+static double shift_clip_content(Clip* clip, double relative_pos, const TempoMap& tempo_map) {
   bool is_audio_clip = clip->is_audio();
-  double sample_rate = 0.0;
-
-  if (is_audio_clip) {
-    SampleAsset* asset = clip->audio.asset;
-    sample_rate = (double)asset->sample_instance.sample_rate;
-    relative_pos *= clip->audio.speed;
-  }
-
-  return calc_clip_shift(is_audio_clip, clip->start_offset, relative_pos, beat_duration, sample_rate);
+  double frame_rate = is_audio_clip ? get_clip_frame_rate(clip) : 0.0;
+  return calc_clip_shift(is_audio_clip, clip->start_offset, clip->min_time, relative_pos, tempo_map, frame_rate);
 }
 
 }  // namespace wb
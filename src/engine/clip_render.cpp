@@ -0,0 +1,211 @@
+#include "clip_render.h"
+
+#include "core/debug.h"
+#include "dsp/resampler.h"
+#include "engine.h"
+#include "track.h"
+
+namespace wb {
+
+ClipRenderer g_clip_renderer;
+
+static size_t get_render_size(const Sample& source, double ratio) {
+  return dsp::SincResampler::get_output_count(source.count, ratio) * source.channels * sizeof(float);
+}
+
+// Whether a track is still streaming the render, possibly for a clip that has been deleted meanwhile
+static bool is_render_playing(const Engine& engine, const SampleRender* render) {
+  if (!render->sample)
+    return false;
+  for (auto track : engine.tracks)
+    if (track->current_audio_event.type == EventType::PlaySample && track->current_audio_event.sample == &*render->sample)
+      return true;
+  return false;
+}
+
+void ClipRenderer::init(size_t render_memory_budget) {
+  memory_budget = render_memory_budget;
+  if (memory_budget == 0)
+    return;
+  running = true;
+  worker = std::thread(&ClipRenderer::worker_thread_, this);
+}
+
+void ClipRenderer::update(const Engine& engine) {
+  uint32_t target_rate = engine.audio_sample_rate;
+  if (!running || target_rate == 0 || engine.recording.load(std::memory_order_relaxed))
+    return;
+
+  scan_index++;
+  std::unique_lock lock(mutex);
+  bool has_new_jobs = false;
+  bool retry_failed = memory_freed;
+  memory_freed = false;
+  for (auto track : engine.tracks) {
+    for (auto clip : track->clips) {
+      if (!clip->is_audio() || clip->deleted)
+        continue;
+      SampleContent* content = clip->audio.asset->content;
+      double speed = clip->audio.speed;
+      if (speed == 1.0 && content->sample_instance.sample_rate == target_rate)
+        continue;
+
+      SampleRender* render = content->renders.load(std::memory_order_relaxed);
+      while (render && !(render->speed == speed && render->target_rate == target_rate))
+        render = render->next;
+      if (render == nullptr) {
+        if (content->renders.load(std::memory_order_relaxed) == nullptr)
+          render_contents.push_back(content);
+        render = new SampleRender{
+          .speed = speed,
+          .target_rate = target_rate,
+          .ratio = ((double)content->sample_instance.sample_rate / (double)target_rate) * speed,
+          .next = content->renders.load(std::memory_order_relaxed),
+        };
+        content->renders.store(render, std::memory_order_release);
+      }
+
+      render->last_scan = scan_index;
+      if (retry_failed && render->failed.load(std::memory_order_relaxed) &&
+          get_render_size(content->sample_instance, render->ratio) <=
+              memory_budget - memory_usage.load(std::memory_order_relaxed))
+        render->failed.store(false, std::memory_order_relaxed);
+      if (!render->queued && !render->ready.load(std::memory_order_relaxed) &&
+          !render->failed.load(std::memory_order_relaxed)) {
+        render->queued = true;
+        jobs.push_back({ content, render });
+        has_new_jobs = true;
+      }
+    }
+  }
+
+  // Renders of intermediate speeds while a clip is being stretched are dropped before they start
+  for (auto it = jobs.begin(); it != jobs.end();) {
+    if (it->render->last_scan != scan_index) {
+      it->render->queued = false;
+      it = jobs.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  evict_unused_renders_(engine);
+  lock.unlock();
+  if (has_new_jobs)
+    job_cv.notify_one();
+}
+
+void ClipRenderer::evict_unused_renders_(const Engine& engine) {
+  // Unlink under the editor lock, the audio thread only walks the render lists while holding it
+  SampleRender* evicted = nullptr;
+  engine.editor_lock.lock();
+  for (auto content : render_contents) {
+    if (content == busy_content)
+      continue;
+    SampleRender* prev = nullptr;
+    SampleRender* render = content->renders.load(std::memory_order_relaxed);
+    while (render) {
+      SampleRender* next = render->next;
+      if (render->last_scan != scan_index && !is_render_playing(engine, render)) {
+        if (prev)
+          prev->next = next;
+        else
+          content->renders.store(next, std::memory_order_release);
+        render->next = evicted;
+        evicted = render;
+      } else {
+        prev = render;
+      }
+      render = next;
+    }
+  }
+  engine.editor_lock.unlock();
+
+  std::erase_if(render_contents, [](const SampleContent* content) {
+    return content->renders.load(std::memory_order_relaxed) == nullptr;
+  });
+
+  while (evicted) {
+    SampleRender* next = evicted->next;
+    if (evicted->ready.load(std::memory_order_relaxed)) {
+      memory_usage.fetch_sub(evicted->sample->get_memory_size(), std::memory_order_relaxed);
+      memory_freed = true;
+    }
+    delete evicted;
+    evicted = next;
+  }
+}
+
+void ClipRenderer::release_renders(SampleContent* content) {
+  SampleRender* render = content->renders.exchange(nullptr, std::memory_order_acq_rel);
+  if (render == nullptr)
+    return;
+  std::erase(render_contents, content);
+
+  if (running) {
+    std::unique_lock lock(mutex);
+    std::erase_if(jobs, [content](const Job& job) { return job.content == content; });
+    done_cv.wait(lock, [this, content] { return busy_content != content; });
+  }
+
+  while (render) {
+    SampleRender* next = render->next;
+    if (render->ready.load(std::memory_order_relaxed)) {
+      memory_usage.fetch_sub(render->sample->get_memory_size(), std::memory_order_relaxed);
+      memory_freed = true;
+    }
+    delete render;
+    render = next;
+  }
+}
+
+void ClipRenderer::shutdown() {
+  if (!running)
+    return;
+  {
+    std::lock_guard lock(mutex);
+    running = false;
+    for (auto& job : jobs)
+      job.render->queued = false;
+    jobs.clear();
+  }
+  job_cv.notify_all();
+  worker.join();
+}
+
+void ClipRenderer::render_(const Job& job) {
+  const Sample& source = job.content->sample_instance;
+  SampleRender* render = job.render;
+  size_t size = get_render_size(source, render->ratio);
+  if (memory_usage.load(std::memory_order_relaxed) + size > memory_budget) {
+    // Retried by update() once renders that are no longer played have been freed
+    Log::warn("Clip render memory budget exceeded, {} keeps playing with live resampling", source.name);
+    render->failed.store(true, std::memory_order_relaxed);
+    return;
+  }
+
+  render->sample.emplace(dsp::resample_sample(source, render->ratio, render->target_rate));
+  memory_usage.fetch_add(render->sample->get_memory_size(), std::memory_order_relaxed);
+  render->ready.store(true, std::memory_order_release);
+  Log::debug("Rendered {} at {}x speed, {} Hz ({} KiB)", source.name, render->speed, render->target_rate, size / 1024);
+}
+
+void ClipRenderer::worker_thread_() {
+  std::unique_lock lock(mutex);
+  while (true) {
+    job_cv.wait(lock, [this] { return !running || !jobs.empty(); });
+    if (!running)
+      break;
+
+    Job job = jobs.front();
+    jobs.pop_front();
+    busy_content = job.content;
+    lock.unlock();
+    render_(job);
+    lock.lock();
+    busy_content = nullptr;
+    done_cv.notify_all();
+  }
+}
+
+}  // namespace wb
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "assets_table.h"
+#include "core/common.h"
+#include "dsp/sample.h"
+
+namespace wb {
+
+struct Engine;
+
+// Copy of a sample resampled at full quality for one clip speed and one device sample rate. Renders are linked into
+// SampleContent::renders and freed by ClipRenderer::update() once no clip plays them anymore.
+struct SampleRender {
+  double speed;
+  uint32_t target_rate;
+  double ratio;  // Source frames per rendered frame
+  std::atomic_bool ready;
+  std::atomic_bool failed;  // Did not fit into the memory budget, retried when memory is freed
+  bool queued = false;     // UI thread only
+  uint64_t last_scan = 0;  // UI thread only, last ClipRenderer::update() that found a clip playing this render
+  std::optional<Sample> sample;
+  SampleRender* next;
+};
+
+/**
+ * @brief Find a finished render of a clip's sample. Safe to call from the audio thread.
+ *
+ * @param content Sample content of the clip.
+ * @param speed Clip playback speed.
+ * @param target_rate Output sample rate.
+ * @return The render, or nullptr if the sample still has to be resampled live.
+ */
+inline SampleRender* find_sample_render(const SampleContent* content, double speed, uint32_t target_rate) {
+  for (SampleRender* render = content->renders.load(std::memory_order_acquire); render; render = render->next) {
+    if (render->speed == speed && render->target_rate == target_rate)
+      return render->ready.load(std::memory_order_acquire) ? render : nullptr;
+  }
+  return nullptr;
+}
+
+// Renders audio clips that need sample rate conversion or a speed change on a background thread. Until a render is
+// ready, the sampler keeps resampling the clip live with linear interpolation.
+struct ClipRenderer {
+  struct Job {
+    SampleContent* content;
+    SampleRender* render;
+  };
+
+  size_t memory_budget = 0;
+  std::atomic<size_t> memory_usage;
+  uint64_t scan_index = 0;
+  bool running = false;
+  std::thread worker;
+  std::mutex mutex;
+  std::condition_variable job_cv;
+  std::condition_variable done_cv;
+  std::deque<Job> jobs;
+  SampleContent* busy_content = nullptr;  // Content being rendered by the worker
+  std::vector<SampleContent*> render_contents;  // UI thread only, contents that have renders
+  bool memory_freed = false;                    // UI thread only, failed renders may fit now
+
+  void init(size_t render_memory_budget);
+
+  /**
+   * @brief Queue renders for the clips that need them, drop queued renders that are no longer used and free the
+   * renders no clip plays anymore. Must be called from the UI thread.
+   *
+   * @param engine Engine playing the clips.
+   */
+  void update(const Engine& engine);
+
+  // Cancel the pending renders of a sample content and free its renders. Called when the content is destroyed.
+  void release_renders(SampleContent* content);
+
+  void shutdown();
+
+  void evict_unused_renders_(const Engine& engine);
+  void render_(const Job& job);
+  void worker_thread_();
+};
+
+extern ClipRenderer g_clip_renderer;
+
+}  // namespace wb
@@ -8,6 +8,9 @@
 #include "clip_edit.h"
 #include "core/core_math.h"
 #include "core/debug.h"
+#include "core/rt_check.h"
+#include "dsp/dsp_ops.h"
+#include "gfx/waveform_visual.h"
 #include "track.h"
 
 using namespace std::chrono_literals;
@@ -22,11 +25,49 @@ Engine::~Engine() {
 }
 
 void Engine::set_bpm(double bpm) {
-  double new_beat_duration = 60.0 / bpm;
+  editor_lock.lock();
+  bool valid = tempo_map.set_initial_tempo(bpm);
+  double new_bpm = tempo_map.get_initial_bpm();  // Clamped
+  editor_lock.unlock();
+  if (!valid) {
+    Log::warn("Ignoring invalid tempo {}", bpm);
+    return;
+  }
+  double new_beat_duration = 60.0 / new_bpm;
   beat_duration.store(new_beat_duration, std::memory_order_release);
   for (auto& listener : on_bpm_change_listener) {
-    listener(new_beat_duration, bpm);
+    listener(new_beat_duration, new_bpm);
+  }
+}
+
+bool Engine::add_tempo_point(double beat, double bpm, bool ramp) {
+  editor_lock.lock();
+  bool valid = tempo_map.add_tempo_point(beat, bpm, ramp);
+  editor_lock.unlock();
+  if (!valid)
+    return false;
+  for (auto& listener : on_bpm_change_listener) {
+    listener(get_beat_duration(), get_bpm());
   }
+  return true;
+}
+
+void Engine::remove_tempo_point(uint32_t index) {
+  editor_lock.lock();
+  tempo_map.remove_tempo_point(index);
+  editor_lock.unlock();
+  for (auto& listener : on_bpm_change_listener) {
+    listener(get_beat_duration(), get_bpm());
+  }
+}
+
+bool Engine::add_time_signature(uint32_t bar, uint16_t numerator, uint16_t denominator) {
+  editor_lock.lock();
+  bool valid = tempo_map.add_time_signature(bar, numerator, denominator);
+  editor_lock.unlock();
+  if (!valid)
+    Log::warn("Ignoring invalid time signature {}/{}", numerator, denominator);
+  return valid;
 }
 
 void Engine::set_playhead_position(double beat_position) {
@@ -52,8 +93,15 @@ void Engine::set_audio_channel_config(
   audio_buffer_duration_ms = period_to_ms(buffer_size_to_period(buffer_size, sample_rate));
   mixing_buffer.resize(buffer_size);
   mixing_buffer.resize_channel(output_channels);
-  for (auto track : tracks)
+  bool buffers_locked = mixing_buffer.lock_memory();
+  for (auto track : tracks) {
     track->prepare_effect_buffer(num_output_channels, buffer_size);
+    buffers_locked &= track->effect_buffer.lock_memory();
+  }
+  if (block_arena.capacity == 0 && !block_arena.init(block_arena_size))
+    Log::error("Cannot allocate audio block arena");
+  if (!buffers_locked)
+    Log::warn("Cannot lock engine buffers into memory");
 }
 
 void Engine::clear_all() {
@@ -63,6 +111,7 @@ void Engine::clear_all() {
     delete track;
   }
   tracks.clear();
+  song_length = {};
 }
 
 void Engine::play() {
@@ -96,8 +145,16 @@ void Engine::record() {
   if (recording && playing)
     return;
   if (track_input_groups.size() != 0) {
+    // Create the live peaks before the recorder thread starts writing into them
+    for (auto& group : track_input_groups) {
+      TrackInput input = TrackInput::from_packed_u32(group.input);
+      uint32_t num_channels = input.type == TrackInputType::ExternalMono ? 1 : 2;
+      for (auto input_attr = group.input_attrs; input_attr != nullptr; input_attr = input_attr->next())
+        input_attr->track->recorded_peaks = new LiveWaveform(num_channels, (int32_t)audio_sample_rate);
+    }
     recorder_queue.start(AudioFormat::F32, audio_record_buffer_size / 4, track_input_groups);
     recorder_thread = std::thread(recorder_thread_runner_, this);
+    set_thread_affinity(recorder_thread, worker_thread_cpu_mask);
   }
   recording = true;
   play();
@@ -113,6 +170,10 @@ void Engine::stop_record() {
     recorder_thread.join();
   }
   for (auto track : tracks) {
+    if (track->recorded_peaks) {
+      delete track->recorded_peaks;
+      track->recorded_peaks = nullptr;
+    }
     if (track->input_attr.recording) {
       std::string name;
       auto current_datetime = std::chrono::system_clock::now();
@@ -128,7 +189,7 @@ void Engine::stop_record() {
       SampleAsset* asset = g_sample_table.create_from_existing_sample(std::move(*track->recorded_samples));
       add_audio_clip(
           track,
-          asset->sample_instance.name,
+          asset->content->sample_instance.name,
           track->record_min_time,
           track->record_max_time,
           0.0,
@@ -201,9 +262,14 @@ Track* Engine::add_track(const std::string& name) {
   Track* new_track = new Track();
   new_track->name = name;
   new_track->prepare_effect_buffer(num_output_channels, audio_buffer_size);
+  // Tracks added after the audio device has started need their buffer locked like the existing ones
+  if (mixing_buffer.memory_locked && !new_track->effect_buffer.lock_memory())
+    Log::warn("Cannot lock track buffer into memory");
   editor_lock.lock();
   tracks.push_back(new_track);
   editor_lock.unlock();
+  new_track->editor_lock = &editor_lock;
+  new_track->set_song_length(&song_length);
   return new_track;
 }
 
@@ -213,6 +279,7 @@ void Engine::delete_track(uint32_t slot) {
   if (track->input.type != TrackInputType::None)
     set_track_input(slot, TrackInputType::None, 0, false);
   tracks.erase(tracks.begin() + slot);
+  song_length.remove(track->content_end);
   delete track;
   editor_lock.unlock();
 }
@@ -262,11 +329,11 @@ void Engine::solo_track(uint32_t slot) {
 }
 
 void Engine::preview_sample(const std::filesystem::path& path) {
-  auto sample{ Sample::load_file(path) };
-  if (!sample) {
-    Log::error("Cannot open sample file {}", path.string());
-    return;
-  }
+  sample_preview.play(path);
+}
+
+void Engine::stop_preview() {
+  sample_preview.stop();
 }
 
 TrackEditResult Engine::add_clip_from_file(Track* track, const std::filesystem::path& path, double time_pos) {
@@ -274,8 +341,10 @@ TrackEditResult Engine::add_clip_from_file(Track* track, const std::filesystem::
   Clip* clip = nullptr;
 
   if (SampleAsset* sample_asset = g_sample_table.load_from_file(path)) {
-    double sample_rate = (double)sample_asset->sample_instance.sample_rate;
-    double clip_length = samples_to_beat(sample_asset->sample_instance.count, sample_rate, beat_duration);
+    // The clip covers the duration of the sample at the tempo where it is placed
+    const Sample& sample = sample_asset->content->sample_instance;
+    double duration = (double)sample.count / (double)sample.sample_rate;
+    double clip_length = tempo_map.time_to_beat(tempo_map.beat_to_time(time_pos) + duration) - time_pos;
     double max_time = time_pos + math::uround(clip_length * ppq) / ppq;
     return add_audio_clip(
         track, path.filename().string(), time_pos, max_time, 0.0, { .asset = sample_asset, .speed = 1.0, .gain = 1.0f });
@@ -375,7 +444,7 @@ TrackEditResult Engine::resize_clip(
     return {};
   std::unique_lock lock(editor_lock);
   auto [min_time, max_time, start_offset, speed] = calc_resize_clip(
-      clip, relative_pos, resize_limit, min_length, clip->min_time, beat_duration, left_side, shift, stretch);
+      clip, relative_pos, resize_limit, min_length, clip->min_time, tempo_map, left_side, shift, stretch);
   auto query_result = track->query_clip_by_range(min_time, max_time);
   TrackEditResult trim_result =
       query_result ? reserve_track_region(track, query_result->first, query_result->last, min_time, max_time, true, clip)
@@ -398,6 +467,7 @@ TrackEditResult Engine::resize_clip(
 }
 
 TrackEditResult Engine::delete_clip(Track* track, Clip* clip) {
+  std::unique_lock lock(editor_lock);
   TrackEditResult result;
   result.deleted_clips.push_back(*clip);
   track->mark_clip_deleted(clip);
@@ -411,8 +481,7 @@ TrackEditResult Engine::add_to_cliplist(Track* track, Clip* clip) {
   if (clips.size() == 0) {
     TrackEditResult trim_result;
     trim_result.added_clips.push_back(clip);
-    clip->id = 0;
-    clips.push_back(clip);
+    track->insert_clip(clip);
     track->reset_playback_state(playhead, true);
     return trim_result;
   }
@@ -421,8 +490,7 @@ TrackEditResult Engine::add_to_cliplist(Track* track, Clip* clip) {
   if (auto last_clip = clips.back(); last_clip->max_time < clip->min_time) {
     TrackEditResult trim_result;
     trim_result.added_clips.push_back(clip);
-    clip->id = last_clip->id + 1;
-    clips.push_back(clip);
+    track->insert_clip(clip);
     track->reset_playback_state(playhead, true);
     return trim_result;
   }
@@ -430,9 +498,7 @@ TrackEditResult Engine::add_to_cliplist(Track* track, Clip* clip) {
   if (auto first_clip = clips.front(); first_clip->min_time > clip->max_time) {
     TrackEditResult trim_result;
     trim_result.added_clips.push_back(clip);
-    clips.push_front(clip);
-    for (uint32_t i = 0; i < (uint32_t)clips.size(); i++)
-      clips[i]->id = i;
+    track->insert_clip(clip);
     track->reset_playback_state(playhead, true);
     return trim_result;
   }
@@ -443,8 +509,7 @@ TrackEditResult Engine::add_to_cliplist(Track* track, Clip* clip) {
   if (!result) {
     TrackEditResult trim_result;
     trim_result.added_clips.push_back(clip);
-    clips.push_back(clip);
-    track->update_clip_ordering();
+    track->insert_clip(clip);
     track->reset_playback_state(playhead, true);
     return trim_result;
   }
@@ -487,7 +552,6 @@ TrackEditResult Engine::reserve_track_region(
   if (clips.size() == 0)
     return {};
 
-  double current_beat_duration = beat_duration.load(std::memory_order_relaxed);
   Vector<Clip> deleted_clips;
   Vector<Clip*> added_clips;
   Vector<Clip*> modified_clips;
@@ -507,7 +571,7 @@ TrackEditResult Engine::reserve_track_region(
       }
       new (new_clip) Clip(*clip);
       new_clip->min_time = max;
-      new_clip->start_offset = shift_clip_content(new_clip, clip->min_time - max, current_beat_duration);
+      new_clip->start_offset = shift_clip_content(clip, clip->min_time - max, tempo_map);
       modified_clips.push_back(new_clip);
       clip->max_time = min;
       bool locked = editor_lock.try_lock();
@@ -518,7 +582,7 @@ TrackEditResult Engine::reserve_track_region(
     } else if (min > clip->min_time) {
       clip->max_time = min;
     } else if (max < clip->max_time) {
-      clip->start_offset = shift_clip_content(clip, clip->min_time - max, current_beat_duration);
+      clip->start_offset = shift_clip_content(clip, clip->min_time - max, tempo_map);
       clip->min_time = max;
     } else {
       track->mark_clip_deleted(clip);
@@ -547,7 +611,7 @@ TrackEditResult Engine::reserve_track_region(
   if (last != ignore_clip && max < last->max_time) {
     deleted_clips.push_back(*last);
     modified_clips.push_back(last);
-    last->start_offset = shift_clip_content(last, last->min_time - max, current_beat_duration);
+    last->start_offset = shift_clip_content(last, last->min_time - max, tempo_map);
     last->min_time = max;
     last_clip--;
   }
@@ -615,7 +679,6 @@ MultiEditResult Engine::move_or_duplicate_region(
   uint32_t src_track_end = src_track_idx + num_selected_regions;
   uint32_t dst_track_idx = math::clamp((int32_t)src_track_idx + dst_track_relative_idx, 0, dst_max_bound);
   uint32_t dst_track_end = dst_track_idx + num_selected_regions;
-  double current_beat_duration = beat_duration.load(std::memory_order_relaxed);
   double dst_min_pos = min_pos + relative_time_pos;
   double dst_max_pos = max_pos + relative_time_pos;
   bool track_overlapped = dst_track_end > src_track_idx && dst_track_idx < src_track_end;
@@ -653,7 +716,7 @@ MultiEditResult Engine::move_or_duplicate_region(
         assert(right_side_substitute_clip);
         new (right_side_substitute_clip) Clip(*clip);
         right_side_substitute_clip->min_time = reserve_max;
-        right_side_substitute_clip->start_offset = shift_clip_content(clip, right_shift_ofs, current_beat_duration);
+        right_side_substitute_clip->start_offset = shift_clip_content(clip, right_shift_ofs, tempo_map);
         substitute_clips.emplace_back(track_index, right_side_substitute_clip);
         result.modified_clips.emplace_back(track_index, right_side_substitute_clip);
         last_partially_selected_clip = right_side_substitute_clip;
@@ -673,7 +736,7 @@ MultiEditResult Engine::move_or_duplicate_region(
         Clip* right_side_substitute_clip = track->allocate_clip();
         assert(right_side_substitute_clip);
         new (right_side_substitute_clip) Clip(*clip);
-        right_side_substitute_clip->start_offset = shift_clip_content(clip, right_shift_ofs, current_beat_duration);
+        right_side_substitute_clip->start_offset = shift_clip_content(clip, right_shift_ofs, tempo_map);
         right_side_substitute_clip->min_time = reserve_max;
         substitute_clips.emplace_back(track_index, right_side_substitute_clip);
         result.modified_clips.emplace_back(track_index, right_side_substitute_clip);
@@ -815,13 +878,13 @@ MultiEditResult Engine::move_or_duplicate_region(
           const double length = (clip->max_time - min_time) + selected_region.range.last_offset;
           new_min_time = math::max(min_time + relative_time_pos, min_move);
           new_max_time = new_min_time + length;
-          new_start_ofs = shift_clip_content(clip, -shift_ofs, current_beat_duration);
+          new_start_ofs = shift_clip_content(clip, -shift_ofs, tempo_map);
         } else if (right_side_partially_selected) {
           const double shift_ofs = selected_region.range.first_offset;
           const double min_time = clip->min_time + shift_ofs;
           new_min_time = math::max(min_time + relative_time_pos, min_move);
           new_max_time = new_min_time + (clip->max_time - min_time);
-          new_start_ofs = shift_clip_content(clip, -shift_ofs, current_beat_duration);
+          new_start_ofs = shift_clip_content(clip, -shift_ofs, tempo_map);
           min_move = new_max_time;
         } else if (left_side_partially_selected) {
           const auto [min_time, max_time] = calc_move_clip(clip, relative_time_pos, min_move);
@@ -883,7 +946,6 @@ MultiEditResult Engine::resize_clips(
     double min_resize_pos,
     bool left_side,
     bool shift) {
-  double current_beat_duration = beat_duration.load(std::memory_order_relaxed);
   MultiEditResult result;
   std::unique_lock lock(editor_lock);
   min_resize_pos = math::max(min_resize_pos, 0.0);
@@ -901,7 +963,7 @@ MultiEditResult Engine::resize_clips(
     double clear_end_pos = 0.0;
     double actual_min_length = 0.0;
     const auto [new_min_time, new_max_time, new_start_ofs, new_speed] = calc_resize_clip(
-        resized_clip, relative_pos, resize_limit, min_length, min_resize_pos, current_beat_duration, left_side, shift, true);
+        resized_clip, relative_pos, resize_limit, min_length, min_resize_pos, tempo_map, left_side, shift, true);
 
     if (left_side) {
       clear_start_pos = new_min_time;
@@ -925,7 +987,7 @@ MultiEditResult Engine::resize_clips(
               result.modified_clips.emplace_back(track_index, clip);
             } else if (deleted_clips->left_side_partially_selected(j)) {
               double right_shift_ofs = clip->min_time - clear_end_pos;
-              clip->start_offset = shift_clip_content(clip, right_shift_ofs, current_beat_duration);
+              clip->start_offset = shift_clip_content(clip, right_shift_ofs, tempo_map);
               clip->min_time = clear_end_pos;
               result.modified_clips.emplace_back(track_index, clip);
             } else {
@@ -956,7 +1018,6 @@ MultiEditResult Engine::shift_clips(
     double relative_pos,
     double min_pos,
     double max_pos) {
-  double current_beat_duration = beat_duration.load(std::memory_order_relaxed);
   MultiEditResult result;
   std::unique_lock lock(editor_lock);
 
@@ -981,7 +1042,7 @@ MultiEditResult Engine::shift_clips(
         assert(substitute_clip);
         new (substitute_clip) Clip(*clip);
         substitute_clip->start_offset =
-            shift_clip_content(substitute_clip, right_shift_ofs + relative_pos, current_beat_duration);
+            shift_clip_content(substitute_clip, right_shift_ofs + relative_pos, tempo_map);
         substitute_clip->min_time = min_pos;
         substitute_clip->max_time = max_pos;
         result.modified_clips.emplace_back(track_index, substitute_clip);
@@ -992,7 +1053,7 @@ MultiEditResult Engine::shift_clips(
         assert(substitute_clip);
         new (substitute_clip) Clip(*clip);
         substitute_clip->min_time = max_pos;
-        substitute_clip->start_offset = shift_clip_content(substitute_clip, right_shift_ofs, current_beat_duration);
+        substitute_clip->start_offset = shift_clip_content(clip, right_shift_ofs, tempo_map);
         result.modified_clips.emplace_back(track_index, substitute_clip);
         track->clips.push_back(substitute_clip);
 
@@ -1004,7 +1065,7 @@ MultiEditResult Engine::shift_clips(
         assert(substitute_clip);
         new (substitute_clip) Clip(*clip);
         substitute_clip->start_offset =
-            shift_clip_content(substitute_clip, right_shift_ofs + relative_pos, current_beat_duration);
+            shift_clip_content(substitute_clip, right_shift_ofs + relative_pos, tempo_map);
         substitute_clip->min_time = min_pos;
         result.modified_clips.emplace_back(track_index, substitute_clip);
         track->clips.push_back(substitute_clip);
@@ -1015,17 +1076,17 @@ MultiEditResult Engine::shift_clips(
         Clip* substitute_clip = track->allocate_clip();
         assert(substitute_clip);
         new (substitute_clip) Clip(*clip);
-        substitute_clip->start_offset = shift_clip_content(substitute_clip, relative_pos, current_beat_duration);
+        substitute_clip->start_offset = shift_clip_content(substitute_clip, relative_pos, tempo_map);
         substitute_clip->max_time = max_pos;
         result.modified_clips.emplace_back(track_index, substitute_clip);
         track->clips.push_back(substitute_clip);
 
         double right_shift_ofs = clip->min_time - max_pos;
-        clip->start_offset = shift_clip_content(clip, right_shift_ofs, current_beat_duration);
+        clip->start_offset = shift_clip_content(clip, right_shift_ofs, tempo_map);
         clip->min_time = max_pos;
         result.modified_clips.emplace_back(track_index, clip);
       } else {
-        clip->start_offset = shift_clip_content(clip, relative_pos, current_beat_duration);
+        clip->start_offset = shift_clip_content(clip, relative_pos, tempo_map);
         result.modified_clips.emplace_back(track_index, clip);
       }
     }
@@ -1045,7 +1106,6 @@ MultiEditResult Engine::delete_region(
     double min_pos,
     double max_pos,
     bool should_update_tracks) {
-  double current_beat_duration = beat_duration.load(std::memory_order_relaxed);
   MultiEditResult result;
   std::unique_lock lock(editor_lock);
 
@@ -1070,7 +1130,7 @@ MultiEditResult Engine::delete_region(
         assert(substitute_clip);
         new (substitute_clip) Clip(*clip);
         substitute_clip->min_time = max_pos;
-        substitute_clip->start_offset = shift_clip_content(substitute_clip, right_shift_ofs, current_beat_duration);
+        substitute_clip->start_offset = shift_clip_content(clip, right_shift_ofs, tempo_map);
         track->clips.push_back(substitute_clip);
         result.modified_clips.emplace_back(track_index, substitute_clip);
 
@@ -1081,7 +1141,7 @@ MultiEditResult Engine::delete_region(
         result.modified_clips.emplace_back(track_index, clip);
       } else if (left_side_partially_selected) {
         double right_shift_ofs = clip->min_time - max_pos;
-        clip->start_offset = shift_clip_content(clip, right_shift_ofs, current_beat_duration);
+        clip->start_offset = shift_clip_content(clip, right_shift_ofs, tempo_map);
         clip->min_time = max_pos;
         result.modified_clips.emplace_back(track_index, clip);
       } else {
@@ -1327,6 +1387,8 @@ Vector<uint32_t> Engine::mute_selected_note(uint32_t track_id, uint32_t clip_id,
     }
   }
 
+  if (!note_ids.empty())
+    asset->data.mark_modified();
   return note_ids;
 }
 
@@ -1343,6 +1405,8 @@ MidiEditResult Engine::delete_marked_notes(uint32_t track_id, uint32_t clip_id,
   uint32_t flag = delete_selected ? MidiNoteFlags::Selected : MidiNoteFlags::Deleted;
   new_sequence.reserve(note_seq.size());
 
+  uint32_t first_removed_note = WB_INVALID_NOTE_ID;
+
   std::unique_lock lock(editor_lock);
   for (uint32_t note_id = 0; auto& note : note_seq) {
     bool skip = false;
@@ -1353,6 +1417,8 @@ MidiEditResult Engine::delete_marked_notes(uint32_t track_id, uint32_t clip_id,
       if (!delete_selected) {
         note.flags &= ~flag;
       }
+      if (first_removed_note == WB_INVALID_NOTE_ID)
+        first_removed_note = new_sequence.size();
       backup.push_back(note);
       continue;
     }
@@ -1362,11 +1428,26 @@ MidiEditResult Engine::delete_marked_notes(uint32_t track_id, uint32_t clip_id,
   note_seq = std::move(new_sequence);
 
   return {
-    .modified_notes = asset->data.update_channel(0),
+    .modified_notes = asset->data.update_channel(0, first_removed_note),
     .deleted_notes = std::move(backup),
   };
 }
 
+MidiEditResult
+Engine::transform_selected_notes(uint32_t track_id, uint32_t clip_id, const NoteTransform& transform) {
+  Clip* clip = get_midi_clip_(track_id, clip_id);
+  if (clip == nullptr)
+    return {};
+
+  MidiData* data = clip->get_midi_data();
+  BitSet selection;
+  if (get_note_selection(*data, selection) == 0)
+    return {};
+
+  std::unique_lock lock(editor_lock);
+  return apply_note_transform(*data, selection, transform);
+}
+
 NoteSelectResult
 Engine::select_note(uint32_t track_id, uint32_t clip_id, double min_pos, double max_pos, int16_t min_key, int16_t max_key) {
   Clip* clip = get_midi_clip_(track_id, clip_id);
@@ -1458,9 +1539,12 @@ void Engine::append_note_selection(
 }
 
 void Engine::set_clip_gain(Track* track, uint32_t clip_id, float gain) {
+  std::unique_lock lock(editor_lock);
   Clip* clip = track->clips[clip_id];
-  if (clip->is_audio())
+  if (clip->is_audio()) {
     clip->audio.gain = gain;
+    track->invalidate_playback_table();
+  }
 }
 
 PluginInterface* Engine::add_plugin_to_track(Track* track, PluginUID uid) {
@@ -1550,16 +1634,15 @@ void Engine::delete_plugin_from_track(Track* track) {
 }
 
 double Engine::get_song_length() const {
-  double max_length = std::numeric_limits<double>::min();
-  for (auto track : tracks) {
-    if (!track->clips.empty()) {
-      Clip* clip = track->clips.back();
-      max_length = math::max(max_length, clip->max_time);
-    } else {
-      max_length = math::max(max_length, 80.0);
-    }
+  // Only rescan the track ends when the longest track has been shortened or removed
+  if (song_length.dirty) {
+    double max_length = std::numeric_limits<double>::min();
+    for (auto track : tracks)
+      max_length = math::max(max_length, track->content_end);
+    song_length.length = max_length;
+    song_length.dirty = false;
   }
-  return max_length;
+  return song_length.length;
 }
 
 void Engine::update_audio_visualization(float frame_rate) {
@@ -1576,20 +1659,25 @@ void Engine::update_audio_visualization(float frame_rate) {
 void Engine::process(const AudioBuffer<float>& input_buffer, AudioBuffer<float>& output_buffer, double sample_rate) {
   ScopedPerformanceCounter counter;
   double buffer_duration = (double)output_buffer.n_samples / sample_rate;
-  double current_beat_duration = beat_duration.load(std::memory_order_relaxed);
   double current_playhead_position = playhead;
-  double buffer_duration_in_beats = buffer_duration / current_beat_duration;
-  double next_playhead_pos = playhead + buffer_duration_in_beats;
-  int64_t playhead_in_samples = beat_to_samples(playhead, sample_rate, current_beat_duration);
   double inv_ppq = 1.0 / ppq;
   bool currently_playing = playing.load(std::memory_order_relaxed);
+  WB_RT_CHECK_SCOPE();
 
   editor_lock.lock();
+  block_arena.reset();
+
+  // The tempo map is only edited while holding the editor lock
+  tempo_cursor.begin_block(&tempo_map, current_playhead_position, sample_rate);
+  double next_playhead_pos = tempo_cursor.time_to_beat(tempo_cursor.block_start_time + buffer_duration);
+  double buffer_duration_in_beats = next_playhead_pos - current_playhead_position;
+  int64_t playhead_in_samples = (int64_t)(tempo_cursor.block_start_time * sample_rate);
 
   for (uint32_t i = 0; i < tracks.size(); i++) {
     auto track = tracks[i];
     track->audio_event_buffer.resize(0);
     track->midi_event_list.clear();
+    track->event_bus.begin_block(block_arena);
     if (track->midi_voice_state.has_voice() && !currently_playing) {
       track->kill_all_voices(0, playhead);
     }
@@ -1604,7 +1692,7 @@ void Engine::process(const AudioBuffer<float>& input_buffer, AudioBuffer<float>&
         input_buffer,
         mixing_buffer,
         sample_rate,
-        current_beat_duration,
+        tempo_cursor,
         buffer_duration_in_beats,
         sample_position,
         current_playhead_position,
@@ -1613,11 +1701,15 @@ void Engine::process(const AudioBuffer<float>& input_buffer, AudioBuffer<float>&
         inv_ppq,
         playhead_in_samples,
         currently_playing);
-    output_buffer.mix(mixing_buffer);
+    for (uint32_t i = 0; i < output_buffer.n_channels; i++) {
+      dsp::mix(mixing_buffer.get_read_pointer(i), output_buffer.get_write_pointer(i), output_buffer.n_samples);
+    }
   }
 
+  sample_preview.process(output_buffer, sample_rate);
+
   if (currently_playing) {
-    sample_position += beat_to_samples(buffer_duration_in_beats, sample_rate, current_beat_duration);
+    sample_position += (double)output_buffer.n_samples;
     playhead = next_playhead_pos;
     playhead_ui.store(playhead, std::memory_order_release);
   }
@@ -1626,13 +1718,7 @@ void Engine::process(const AudioBuffer<float>& input_buffer, AudioBuffer<float>&
 
   for (uint32_t i = 0; i < output_buffer.n_channels; i++) {
     float* channel = output_buffer.get_write_pointer(i);
-    for (uint32_t j = 0; j < output_buffer.n_samples; j++) {
-      if (channel[j] > 1.0) {
-        channel[j] = 1.0;
-      } else if (channel[j] < -1.0) {
-        channel[j] = -1.0;
-      }
-    }
+    dsp::hard_clip(channel, channel, output_buffer.n_samples);
   }
 
   if (currently_playing && track_input_groups.size() != 0 && recording) {
@@ -1693,6 +1779,8 @@ void Engine::write_recorded_samples_(uint32_t num_samples) {
       }
       auto sample_data = track->recorded_samples->get_sample_data<float>();
       recorder_queue.read(i, sample_data, track->num_samples_written, 0, num_channels);
+      if (track->recorded_peaks)
+        track->recorded_peaks->append(&*track->recorded_samples, track->num_samples_written, num_samples);
       track->num_samples_written = required_size;
     }
   }
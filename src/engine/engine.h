@@ -7,10 +7,15 @@
 #include "clip_edit.h"
 #include "core/audio_buffer.h"
 #include "core/common.h"
+#include "core/memory.h"
 #include "core/thread.h"
 #include "core/timing.h"
 #include "etypes.h"
+#include "midi_transform.h"
 #include "plughost/plugin_manager.h"
+#include "sample_preview.h"
+#include "tempo_map.h"
+#include "track.h"
 
 namespace wb {
 
@@ -34,17 +39,22 @@ struct Engine {
   uint32_t audio_record_buffer_size = 64 * 1024;
   uint32_t audio_record_file_chunk_size = 8 * 1024;
   uint32_t audio_record_chunk_size = 256 * 1024;
+  uint64_t worker_thread_cpu_mask = 0;
+  size_t block_arena_size = 256 * 1024;
 
   std::string project_filename = "untitled.wb";
   ProjectInfo project_info;
   std::vector<Track*> tracks;
+  mutable SongLength song_length;
   mutable Spinlock editor_lock;
 
   double ppq = 96.0;
   volatile double playhead{};
   double playhead_start{};
   double sample_position{};
-  std::atomic<double> beat_duration;
+  std::atomic<double> beat_duration;  // At the initial tempo
+  TempoMap tempo_map;
+  TempoCursor tempo_cursor;  // Audio thread only
   std::atomic<double> playhead_ui;
   std::atomic_bool playing;
   std::atomic_bool playhead_updated;
@@ -55,8 +65,11 @@ struct Engine {
   Vector<uint32_t> active_record_tracks;
 
   AudioBuffer<float> mixing_buffer;
+  BlockArena block_arena;  // Scratch memory for the current audio block, reset on every process() call
   std::vector<OnBpmChangeFn> on_bpm_change_listener;
 
+  SamplePreviewPlayer sample_preview;
+
   AudioRecordQueue recorder_queue;
   Vector<Sample> recorded_samples;
   std::thread recorder_thread;
@@ -67,6 +80,18 @@ struct Engine {
 
   void set_bpm(double bpm);
 
+  /**
+   * @brief Add a tempo change, or replace the change at the same beat.
+   *
+   * @param beat Position of the change.
+   * @param bpm New tempo, clamped to the range TempoMap allows.
+   * @param ramp Change the tempo linearly until the next tempo change.
+   * @return false if the tempo is not a positive number.
+   */
+  bool add_tempo_point(double beat, double bpm, bool ramp);
+  void remove_tempo_point(uint32_t index);
+  bool add_time_signature(uint32_t bar, uint16_t numerator, uint16_t denominator);
+
   void set_playhead_position(double beat_position);
   
   void
@@ -100,6 +125,7 @@ struct Engine {
   void solo_track(uint32_t slot);
 
   void preview_sample(const std::filesystem::path& path);
+  void stop_preview();
 
   TrackEditResult add_clip_from_file(Track* track, const std::filesystem::path& path, double min_time);
 
@@ -215,6 +241,8 @@ struct Engine {
 
   MidiEditResult delete_marked_notes(uint32_t track_id, uint32_t clip_id, bool selected);
 
+  MidiEditResult transform_selected_notes(uint32_t track_id, uint32_t clip_id, const NoteTransform& transform);
+
   NoteSelectResult
   select_note(uint32_t track_id, uint32_t clip_id, double min_pos, double max_pos, int16_t min_key, int16_t max_key);
 
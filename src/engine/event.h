@@ -69,6 +69,7 @@ struct AudioEvent {
   double time;
   double speed;
   size_t sample_offset;
+  float gain;
   Clip* clip;
   Sample* sample;
 };
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "core/memory.h"
+#include "core/vector.h"
+#include "dsp/param_queue.h"
+#include "event.h"
+
+namespace wb {
+
+// Event producers. The order is also the merge priority for events sharing the same buffer offset.
+enum class EventSource : uint32_t {
+  Automation,
+  Live,
+  Clip,
+  Count,
+};
+
+enum class BusEventType : uint8_t {
+  Midi,
+  Param,
+  Audio,
+};
+
+struct BusEvent {
+  BusEventType type;
+  uint32_t buffer_offset;
+  union {
+    MidiEvent midi;
+    dsp::ParamValue param;
+    AudioEvent audio;
+  };
+};
+
+// Per-track event bus. Every producer appends to its own lane during the block, the lanes are then merged into one
+// stream ordered by buffer offset. The merge is stable: events with the same offset keep their producer order.
+struct TrackEventBus {
+  static constexpr uint32_t num_lanes = (uint32_t)EventSource::Count;
+  Vector<BusEvent> lanes[num_lanes];
+  Vector<BusEvent> fallback_events;  // Used when the block arena is not available or full
+  BlockArena* block_arena = nullptr;
+  BusEvent* events = nullptr;
+  uint32_t num_events = 0;
+  uint32_t num_dropped = 0;
+
+  inline void reserve(uint32_t capacity_per_lane) {
+    for (auto& lane : lanes)
+      lane.reserve(capacity_per_lane);
+    fallback_events.reserve(capacity_per_lane * num_lanes);
+  }
+
+  inline void begin_block(BlockArena& arena) {
+    clear();
+    block_arena = &arena;
+  }
+
+  inline void clear() {
+    for (auto& lane : lanes)
+      lane.resize(0);
+    events = nullptr;
+    num_events = 0;
+  }
+
+  inline BusEvent* push_(EventSource source, BusEventType type, uint32_t buffer_offset) {
+    Vector<BusEvent>& lane = lanes[(uint32_t)source];
+    // Never grow on the audio thread
+    if (lane.size() == lane.capacity()) [[unlikely]] {
+      num_dropped++;
+      return nullptr;
+    }
+    BusEvent* event = lane.emplace_back_raw();
+    event->type = type;
+    event->buffer_offset = buffer_offset;
+    return event;
+  }
+
+  inline void push_midi(EventSource source, const MidiEvent& midi) {
+    if (BusEvent* event = push_(source, BusEventType::Midi, midi.buffer_offset))
+      event->midi = midi;
+  }
+
+  inline void push_param(EventSource source, uint32_t sample_offset, uint32_t id, double value) {
+    if (BusEvent* event = push_(source, BusEventType::Param, sample_offset))
+      event->param = { sample_offset, id, value };
+  }
+
+  inline void push_audio(EventSource source, const AudioEvent& audio) {
+    if (BusEvent* event = push_(source, BusEventType::Audio, audio.buffer_offset))
+      event->audio = audio;
+  }
+
+  inline static void sort_lane_(Vector<BusEvent>& lane) {
+    // Producers mostly emit events in order, a stable insertion sort is close to linear here
+    for (uint32_t i = 1; i < lane.size(); i++) {
+      if (lane[i - 1].buffer_offset <= lane[i].buffer_offset)
+        continue;
+      BusEvent event = lane[i];
+      uint32_t j = i;
+      while (j > 0 && lane[j - 1].buffer_offset > event.buffer_offset) {
+        lane[j] = lane[j - 1];
+        j--;
+      }
+      lane[j] = event;
+    }
+  }
+
+  /**
+   * @brief Merge all lanes into a single stream ordered by buffer offset. The stream is valid until the block arena
+   * is reset.
+   */
+  inline void merge() {
+    uint32_t total = 0;
+    for (auto& lane : lanes) {
+      sort_lane_(lane);
+      total += lane.size();
+    }
+
+    events = block_arena ? block_arena->allocate_array<BusEvent>(total) : nullptr;
+    if (events == nullptr) [[unlikely]] {
+      fallback_events.resize_fast(total);
+      events = fallback_events.data();
+    }
+    num_events = total;
+
+    // The number of lanes is tiny, picking the smallest lane head is cheaper than maintaining a heap
+    uint32_t heads[num_lanes]{};
+    for (uint32_t i = 0; i < total; i++) {
+      uint32_t min_lane = num_lanes;
+      uint32_t min_offset = ~0U;
+      for (uint32_t lane_idx = 0; lane_idx < num_lanes; lane_idx++) {
+        const Vector<BusEvent>& lane = lanes[lane_idx];
+        if (heads[lane_idx] < lane.size() && lane[heads[lane_idx]].buffer_offset < min_offset) {
+          min_lane = lane_idx;
+          min_offset = lane[heads[lane_idx]].buffer_offset;
+        }
+      }
+      events[i] = lanes[min_lane][heads[min_lane]++];
+    }
+  }
+
+  inline const BusEvent* begin() const {
+    return events;
+  }
+
+  inline const BusEvent* end() const {
+    return events + num_events;
+  }
+};
+
+}  // namespace wb
@@ -0,0 +1,449 @@
+#include "file_index.h"
+
+#include <leveldb/db.h>
+#include <leveldb/write_batch.h>
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <unordered_set>
+
+#include "core/algorithm.h"
+#include "core/byte_buffer.h"
+#include "core/debug.h"
+#include "core/defer.h"
+#include "core/stream.h"
+#include "core/thread.h"
+#include "extern/xxhash.h"
+
+namespace ldb = leveldb;
+namespace fs = std::filesystem;
+
+namespace wb {
+
+static constexpr uint32_t file_index_version = 3;
+static constexpr uint32_t file_index_batch_size = 256;
+static constexpr size_t content_hash_block_size = 64 * 1024;
+static constexpr size_t full_hash_chunk_size = 1024 * 1024;
+
+FileIndex g_file_index;
+
+static std::string to_key_string(const fs::path& path) {
+  std::u8string str = path.generic_u8string();
+  return std::string(str.begin(), str.end());
+}
+
+static fs::path from_key_string(const char* data, size_t size) {
+  return fs::path(std::u8string((const char8_t*)data, size));
+}
+
+static std::string name_key(const std::string& filename, const std::string& path_key) {
+  std::string key;
+  key.reserve(filename.size() + path_key.size() + 2);
+  key.push_back('n');
+  key.append(filename);
+  key.push_back('\0');
+  key.append(path_key);
+  return key;
+}
+
+static std::string hash_key(uint64_t content_hash, const std::string& path_key) {
+  std::string key;
+  key.reserve(sizeof(uint64_t) + path_key.size() + 1);
+  key.push_back('h');
+  key.append((const char*)&content_hash, sizeof(uint64_t));
+  key.append(path_key);
+  return key;
+}
+
+static bool stat_file(const fs::path& path, FileIndexEntry& entry) {
+  std::error_code ec;
+  uint64_t size = fs::file_size(path, ec);
+  if (ec)
+    return false;
+  auto mtime = fs::last_write_time(path, ec);
+  if (ec)
+    return false;
+  entry.path = path;
+  entry.size = size;
+  entry.mtime = (int64_t)mtime.time_since_epoch().count();
+  entry.content_hash = 0;
+  entry.info.reset();
+  return true;
+}
+
+uint64_t compute_file_content_hash(const fs::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return 0;
+
+  std::error_code ec;
+  uint64_t size = fs::file_size(path, ec);
+  if (ec)
+    return 0;
+
+  // Hash the size, the head and the tail of the file in one go
+  auto buffer = std::make_unique<char[]>(sizeof(uint64_t) + content_hash_block_size * 2);
+  std::memcpy(buffer.get(), &size, sizeof(uint64_t));
+  uint64_t num_hashed = sizeof(uint64_t);
+
+  uint64_t head_size = std::min((uint64_t)content_hash_block_size, size);
+  if (!file.read(buffer.get() + num_hashed, (std::streamsize)head_size))
+    return 0;
+  num_hashed += head_size;
+
+  if (size > content_hash_block_size) {
+    uint64_t tail_offset = std::max((uint64_t)content_hash_block_size, size - content_hash_block_size);
+    uint64_t tail_size = size - tail_offset;
+    file.seekg((std::streamoff)tail_offset);
+    if (!file.read(buffer.get() + num_hashed, (std::streamsize)tail_size))
+      return 0;
+    num_hashed += tail_size;
+  }
+
+  // 0 is reserved for unknown hashes
+  uint64_t hash = XXH3_64bits(buffer.get(), num_hashed);
+  return hash != 0 ? hash : 1;
+}
+
+uint64_t compute_file_full_hash(const fs::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return 0;
+  XXH3_state_t* state = XXH3_createState();
+  if (state == nullptr)
+    return 0;
+  defer(XXH3_freeState(state));
+  XXH3_64bits_reset(state);
+  auto buffer = std::make_unique<char[]>(full_hash_chunk_size);
+  while (file) {
+    file.read(buffer.get(), full_hash_chunk_size);
+    if (file.gcount() > 0)
+      XXH3_64bits_update(state, buffer.get(), (size_t)file.gcount());
+  }
+  if (file.bad())
+    return 0;
+  uint64_t hash = XXH3_64bits_digest(state);
+  return hash != 0 ? hash : 1;
+}
+
+uint64_t compute_full_hash(const void* data, size_t size) {
+  uint64_t hash = XXH3_64bits(data, size);
+  return hash != 0 ? hash : 1;
+}
+
+bool is_sample_file_extension(const fs::path& ext) {
+  return any_of(ext, ".wav", ".wave", ".aiff", ".mp3", ".ogg", ".flac", ".aifc", ".aif", ".iff", ".8svx");
+}
+
+FileIndex::~FileIndex() {
+  close();
+}
+
+bool FileIndex::open(const fs::path& db_path) {
+  ldb::Options options;
+  options.create_if_missing = true;
+  ldb::Status status = ldb::DB::Open(options, db_path.string(), &db);
+  if (!status.ok()) {
+    Log::error("Cannot open file index {}", status.ToString());
+    db = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void FileIndex::close() {
+  stop_refresh.store(true, std::memory_order_relaxed);
+  wait_for_refresh();
+  if (db) {
+    delete db;
+    db = nullptr;
+  }
+}
+
+void FileIndex::refresh_async(const Vector<fs::path>& roots) {
+  if (!db)
+    return;
+  std::lock_guard lock(refresh_mtx);
+  for (const auto& root : roots)
+    pending_roots.push_back(root);
+  start_refresh_thread_();
+}
+
+void FileIndex::index_file_async(const fs::path& path) {
+  if (!db)
+    return;
+  std::lock_guard lock(refresh_mtx);
+  if (std::find(pending_files.begin(), pending_files.end(), path) != pending_files.end())
+    return;
+  pending_files.push_back(path);
+  start_refresh_thread_();
+}
+
+// Called with refresh_mtx held
+void FileIndex::start_refresh_thread_() {
+  if (refresh_running.load(std::memory_order_relaxed))
+    return;
+  if (refresh_thread.joinable())
+    refresh_thread.join();
+  stop_refresh.store(false, std::memory_order_relaxed);
+  refresh_running.store(true, std::memory_order_relaxed);
+  refresh_thread = std::thread([this] { refresh_thread_(); });
+}
+
+uint32_t FileIndex::refresh(const fs::path& root) {
+  if (!db)
+    return 0;
+
+  // Offline roots keep their entries, they may come back later
+  std::error_code ec;
+  if (!fs::is_directory(root, ec))
+    return 0;
+
+  std::unordered_set<std::string> seen_files;
+  ldb::WriteBatch batch;
+  uint32_t num_batched = 0;
+  uint32_t num_hashed = 0;
+  bool complete = true;
+
+  fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec);
+  for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+    if (stop_refresh.load(std::memory_order_relaxed)) {
+      complete = false;
+      break;
+    }
+    const fs::directory_entry& dir_entry = *it;
+    std::error_code entry_ec;
+    if (!dir_entry.is_regular_file(entry_ec) || !is_sample_file_extension(dir_entry.path().extension()))
+      continue;
+
+    std::string path_key = to_key_string(dir_entry.path());
+    FileIndexEntry entry;
+    seen_files.insert(path_key);
+    if (!update_file_(batch, dir_entry.path(), path_key, entry))
+      continue;
+
+    num_hashed++;
+    if (++num_batched >= file_index_batch_size) {
+      write_(batch);
+      batch.Clear();
+      num_batched = 0;
+    }
+  }
+  if (ec)
+    complete = false;
+  write_(batch);
+  batch.Clear();
+
+  if (!complete)
+    return num_hashed;
+
+  // Remove files that are no longer inside this root
+  std::string root_prefix = "p" + to_key_string(root);
+  if (root_prefix.back() != '/')
+    root_prefix.push_back('/');
+  std::unique_ptr<ldb::Iterator> iter(db->NewIterator({}));
+  for (iter->Seek(root_prefix); iter->Valid() && iter->key().starts_with(root_prefix); iter->Next()) {
+    ldb::Slice key = iter->key();
+    std::string path_key(key.data() + 1, key.size() - 1);
+    if (seen_files.contains(path_key))
+      continue;
+    if (auto entry = find_path(from_key_string(path_key.data(), path_key.size())))
+      remove_file_(batch, path_key, *entry);
+  }
+  iter.reset();
+  write_(batch);
+
+  return num_hashed;
+}
+
+void FileIndex::wait_for_refresh() {
+  if (refresh_thread.joinable())
+    refresh_thread.join();
+}
+
+std::optional<FileIndexEntry> FileIndex::find_path(const fs::path& path) const {
+  if (!db)
+    return {};
+
+  std::string value;
+  std::string key = "p" + to_key_string(path);
+  if (!db->Get({}, key, &value).ok())
+    return {};
+
+  ByteBuffer buffer((std::byte*)value.data(), value.size(), false);
+  uint32_t version;
+  FileIndexEntry entry{ .path = path };
+  if (!io_read(buffer, &version) || version != file_index_version || !io_read(buffer, &entry.size) ||
+      !io_read(buffer, &entry.mtime) || !io_read(buffer, &entry.content_hash))
+    return {};
+
+  bool has_info;
+  if (!io_read(buffer, &has_info))
+    return {};
+  if (has_info) {
+    SampleInfo& info = entry.info.emplace();
+    if (!io_read(buffer, &info.sample_count) || !io_read(buffer, &info.channel_count) ||
+        !io_read(buffer, &info.rate) || !io_read(buffer, &info.format))
+      return {};
+  }
+
+  return entry;
+}
+
+Vector<FileIndexEntry> FileIndex::find_by_name(const fs::path& filename) const {
+  std::string prefix = name_key(to_key_string(filename), {});
+  return find_prefix_(prefix);
+}
+
+Vector<FileIndexEntry> FileIndex::find_by_content_hash(uint64_t content_hash) const {
+  std::string prefix = hash_key(content_hash, {});
+  return find_prefix_(prefix);
+}
+
+std::optional<FileIndexEntry> FileIndex::find_current_path(const fs::path& path) const {
+  std::optional<FileIndexEntry> entry = find_path(path);
+  if (!entry)
+    return {};
+  FileIndexEntry current;
+  if (!stat_file(path, current) || current.size != entry->size || current.mtime != entry->mtime)
+    return {};
+  return entry;
+}
+
+uint64_t FileIndex::get_content_hash(const fs::path& path) const {
+  if (std::optional<FileIndexEntry> entry = find_current_path(path))
+    return entry->content_hash;
+  return compute_file_content_hash(path);
+}
+
+std::optional<SampleInfo> FileIndex::find_sample_info(const fs::path& path) const {
+  if (std::optional<FileIndexEntry> entry = find_current_path(path))
+    return entry->info;
+  return {};
+}
+
+std::optional<SampleInfo> FileIndex::get_sample_info(const fs::path& path) {
+  if (!db)
+    return Sample::get_file_info(path);
+  ldb::WriteBatch batch;
+  FileIndexEntry entry;
+  if (update_file_(batch, path, to_key_string(path), entry))
+    write_(batch);
+  return entry.info;
+}
+
+bool FileIndex::update_file_(
+    ldb::WriteBatch& batch,
+    const fs::path& path,
+    const std::string& path_key,
+    FileIndexEntry& entry) {
+  entry.content_hash = 0;
+  if (!stat_file(path, entry))
+    return false;
+
+  // Unchanged files are not hashed again
+  std::optional<FileIndexEntry> old_entry = find_path(path);
+  if (old_entry && old_entry->size == entry.size && old_entry->mtime == entry.mtime) {
+    entry.content_hash = old_entry->content_hash;
+    entry.info = old_entry->info;
+    return false;
+  }
+
+  entry.content_hash = compute_file_content_hash(path);
+  if (entry.content_hash == 0)
+    return false;
+  entry.info = Sample::get_file_info(path);
+
+  if (old_entry)
+    remove_file_(batch, path_key, *old_entry);
+
+  ByteBuffer value(64);
+  io_write(value, file_index_version);
+  io_write(value, entry.size);
+  io_write(value, entry.mtime);
+  io_write(value, entry.content_hash);
+  io_write(value, entry.info.has_value());
+  if (entry.info) {
+    io_write(value, entry.info->sample_count);
+    io_write(value, entry.info->channel_count);
+    io_write(value, entry.info->rate);
+    io_write(value, entry.info->format);
+  }
+  batch.Put("p" + path_key, ldb::Slice((const char*)value.data(), value.position()));
+  batch.Put(name_key(to_key_string(path.filename()), path_key), {});
+  batch.Put(hash_key(entry.content_hash, path_key), {});
+  return true;
+}
+
+void FileIndex::write_(ldb::WriteBatch& batch) {
+  db->Write({}, &batch);
+  version.fetch_add(1, std::memory_order_release);
+}
+
+void FileIndex::remove_file_(ldb::WriteBatch& batch, const std::string& path_key, const FileIndexEntry& entry) {
+  batch.Delete("p" + path_key);
+  batch.Delete(name_key(to_key_string(entry.path.filename()), path_key));
+  batch.Delete(hash_key(entry.content_hash, path_key));
+}
+
+Vector<FileIndexEntry> FileIndex::find_prefix_(const std::string& prefix) const {
+  Vector<FileIndexEntry> entries;
+  if (!db)
+    return entries;
+
+  Vector<fs::path> paths;
+  std::unique_ptr<ldb::Iterator> iter(db->NewIterator({}));
+  for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
+    ldb::Slice key = iter->key();
+    paths.push_back(from_key_string(key.data() + prefix.size(), key.size() - prefix.size()));
+  }
+  iter.reset();
+
+  for (const auto& path : paths)
+    if (auto entry = find_path(path))
+      entries.push_back(std::move(*entry));
+  return entries;
+}
+
+void FileIndex::refresh_thread_() {
+#ifndef NDEBUG
+  set_current_thread_name("Whitebox File Indexer");
+#endif
+
+  for (;;) {
+    fs::path root;
+    fs::path file;
+    {
+      std::lock_guard lock(refresh_mtx);
+      bool idle = pending_roots.empty() && pending_files.empty();
+      if (idle || stop_refresh.load(std::memory_order_relaxed)) {
+        pending_roots.clear();
+        pending_files.clear();
+        refresh_running.store(false, std::memory_order_relaxed);
+        return;
+      }
+      // Single files are requested by the UI, they go first
+      if (!pending_files.empty()) {
+        file = std::move(pending_files.back());
+        pending_files.pop_back();
+      } else {
+        root = std::move(pending_roots.back());
+        pending_roots.pop_back();
+      }
+    }
+
+    if (!file.empty()) {
+      ldb::WriteBatch batch;
+      FileIndexEntry entry;
+      if (update_file_(batch, file, to_key_string(file), entry))
+        write_(batch);
+      continue;
+    }
+
+    uint32_t num_hashed = refresh(root);
+    Log::info("File index updated: {} ({} files hashed)", root.string(), num_hashed);
+  }
+}
+
+}  // namespace wb
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "core/common.h"
+#include "core/vector.h"
+#include "dsp/sample.h"
+
+namespace leveldb {
+class DB;
+class WriteBatch;
+}  // namespace leveldb
+
+namespace wb {
+
+struct FileIndexEntry {
+  std::filesystem::path path;
+  uint64_t size;
+  int64_t mtime;
+  uint64_t content_hash;
+  std::optional<SampleInfo> info;  // Empty if the file cannot be decoded
+};
+
+// Persistent index of the sample files inside the user's library roots, stored in LevelDB. Files can be looked up by
+// path, filename or content hash without touching the file system, which turns missing sample resolution into a few
+// key lookups. The index is refreshed incrementally: files whose size and modification time did not change are not
+// hashed again.
+//
+// The index also caches the audio metadata of every file, so the browser can show sample lengths and start drag and
+// drop without opening a decoder. Getting the length of an MP3 file without a Xing header decodes the whole file, this
+// is done once by the background refresh.
+//
+// Keys:
+//   'p' + path                    -> version, size, mtime, content hash, sample info
+//   'n' + filename + '\0' + path  -> (empty)
+//   'h' + content hash + path     -> (empty)
+struct FileIndex {
+  leveldb::DB* db = nullptr;
+  std::thread refresh_thread;
+  std::mutex refresh_mtx;
+  Vector<std::filesystem::path> pending_roots;
+  Vector<std::filesystem::path> pending_files;
+  std::atomic_bool refresh_running;
+  std::atomic_bool stop_refresh;
+  std::atomic<uint32_t> version{};  // Incremented after every write, lets callers refresh cached lookups
+
+  FileIndex() = default;
+  FileIndex(const FileIndex&) = delete;
+  ~FileIndex();
+
+  bool open(const std::filesystem::path& db_path);
+  void close();
+
+  /**
+   * @brief Refresh the index of the given library roots on the background thread. Roots queued while a refresh is
+   * running are picked up by the same thread.
+   *
+   * @param roots Library root directories.
+   */
+  void refresh_async(const Vector<std::filesystem::path>& roots);
+
+  // Index a single file on the background thread, so that find_sample_info() can serve it without decoding it on the
+  // calling thread. Works for files outside the library roots as well.
+  void index_file_async(const std::filesystem::path& path);
+
+  /**
+   * @brief Refresh the index of a library root on the calling thread. Files that are no longer inside the root are
+   * removed from the index.
+   *
+   * @param root Library root directory.
+   * @return Number of files that have been (re)hashed.
+   */
+  uint32_t refresh(const std::filesystem::path& root);
+
+  void wait_for_refresh();
+
+  inline bool is_refreshing() const {
+    return refresh_running.load(std::memory_order_relaxed);
+  }
+
+  std::optional<FileIndexEntry> find_path(const std::filesystem::path& path) const;
+
+  // Like find_path(), but returns nothing if the file has changed since it was indexed.
+  std::optional<FileIndexEntry> find_current_path(const std::filesystem::path& path) const;
+  Vector<FileIndexEntry> find_by_name(const std::filesystem::path& filename) const;
+  Vector<FileIndexEntry> find_by_content_hash(uint64_t content_hash) const;
+
+  /**
+   * @brief Get the content hash of a file. The indexed hash is used if the file has not changed, otherwise the hash is
+   * computed. Files outside the library roots are not added to the index.
+   *
+   * @param path File path.
+   * @return Content hash, or 0 if the file cannot be read.
+   */
+  uint64_t get_content_hash(const std::filesystem::path& path) const;
+
+  // Get the cached sample info of a file without decoding it. Returns nothing if the file is not indexed or has
+  // changed since it was indexed.
+  std::optional<SampleInfo> find_sample_info(const std::filesystem::path& path) const;
+
+  /**
+   * @brief Get the sample info of a file. Files that are not indexed yet are decoded once and added to the index.
+   *
+   * @param path File path.
+   * @return Sample info, or nothing if the file cannot be decoded.
+   */
+  std::optional<SampleInfo> get_sample_info(const std::filesystem::path& path);
+
+  // Hash and probe the file if it is new or has changed since it was indexed. Returns true if the index has to be
+  // updated.
+  bool update_file_(
+      leveldb::WriteBatch& batch,
+      const std::filesystem::path& path,
+      const std::string& path_key,
+      FileIndexEntry& entry);
+  void remove_file_(leveldb::WriteBatch& batch, const std::string& path_key, const FileIndexEntry& entry);
+  void write_(leveldb::WriteBatch& batch);
+  Vector<FileIndexEntry> find_prefix_(const std::string& prefix) const;
+  void start_refresh_thread_();
+  void refresh_thread_();
+};
+
+// Hash of the file size, the first and the last 64 KiB of the file. Cheap enough to run over a whole sample library
+// while still telling apart files with the same name.
+uint64_t compute_file_content_hash(const std::filesystem::path& path);
+
+// Hash of the whole file, confirms that two files with the same content hash are identical. Returns 0 if the file
+// cannot be read.
+uint64_t compute_file_full_hash(const std::filesystem::path& path);
+
+// Full hash of a file that has already been read into memory, the same value as compute_file_full_hash()
+uint64_t compute_full_hash(const void* data, size_t size);
+
+bool is_sample_file_extension(const std::filesystem::path& ext);
+
+extern FileIndex g_file_index;
+
+}  // namespace wb
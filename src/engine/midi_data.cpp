@@ -1,6 +1,7 @@
 #include "midi_data.h"
 
 #include <algorithm>
+#include <atomic>
 
 #include "core/bit_manipulation.h"
 #include "core/core_math.h"
@@ -9,6 +10,8 @@
 
 namespace wb {
 
+static std::atomic_uint64_t version_counter;
+
 void MidiData::create_metadata(MidiNote* notes, uint32_t count) {
 #if WB_ENABLE_NOTE_METADATA
   if (first_free_id != WB_INVALID_NOTE_METADATA_ID) {
@@ -49,35 +52,85 @@ void MidiData::free_metadata(uint32_t id) {
 #endif
 }
 
-NoteSequenceID MidiData::find_note(double pos, uint16_t key, uint16_t channel) {
-  if (note_sequence.size() == 0)
-    return (uint32_t)-1;
+static bool compare_note_order(const MidiNote& a, const MidiNote& b) {
+  if (a.min_time != b.min_time) {
+    return a.min_time < b.min_time;
+  }
+  if (a.key != b.key) {
+    return a.key < b.key;
+  }
+  return a.velocity < b.velocity;
+}
 
-  uint32_t note_id = (uint32_t)-1;
-  for (uint32_t id = 0; const auto& note : note_sequence) {
-    if (pos >= note.min_time && pos < note.max_time && note.key == key) {
-      note_id = id;  // TODO: Should probably return multiple notes!
-      break;
+void MidiNoteIndex::update(const MidiNoteBuffer& notes, uint32_t first_note) {
+  uint32_t count = notes.size();
+  uint32_t num_blocks = (count + block_size - 1) >> block_shift;
+  uint32_t first_block = math::min(first_note >> block_shift, math::min(blocks.size(), num_blocks));
+  blocks.resize(num_blocks);
+
+  double prefix_max_end = first_block != 0 ? blocks[first_block - 1].prefix_max_end : 0.0;
+  for (uint32_t i = first_block; i < num_blocks; i++) {
+    uint32_t first_id = i << block_shift;
+    uint32_t last_id = math::min(first_id + block_size, count);
+    Block block{
+      .max_end = 0.0,
+      .min_key = MidiData::max_keys,
+      .max_key = 0,
+    };
+    for (uint32_t id = first_id; id < last_id; id++) {
+      const MidiNote& note = notes[id];
+      block.max_end = math::max(block.max_end, note.max_time);
+      block.min_key = math::min(block.min_key, note.key);
+      block.max_key = math::max(block.max_key, note.key);
     }
-    id++;
+    prefix_max_end = math::max(prefix_max_end, block.max_end);
+    block.prefix_max_end = prefix_max_end;
+    blocks[i] = block;
   }
 
-  return note_id;
+  num_notes = count;
 }
 
-Vector<uint32_t> MidiData::find_notes(double min_pos, double max_pos, uint16_t min_key, uint16_t max_key, uint16_t channel) {
-  Vector<uint32_t> notes;
-  for (uint32_t note_id = 0; const auto& note : note_sequence) {
-    if (note.max_time < min_pos || note.key < min_key || note.key > max_key) {
-      note_id++;
+uint32_t MidiNoteIndex::find_first_block(double pos) const {
+  auto it = std::lower_bound(
+      blocks.begin(), blocks.end(), pos, [](const Block& block, double pos) { return block.prefix_max_end < pos; });
+  return (uint32_t)(it - blocks.begin());
+}
+
+uint32_t MidiData::find_first_note(double pos) const {
+  const MidiNoteIndex::Block* blocks = note_index.blocks.data();
+  uint32_t num_blocks = note_index.blocks.size();
+  for (uint32_t i = note_index.find_first_block(pos); i < num_blocks; i++) {
+    if (blocks[i].max_end <= pos)
       continue;
+    uint32_t first_id = i << MidiNoteIndex::block_shift;
+    uint32_t last_id = math::min(first_id + MidiNoteIndex::block_size, note_sequence.size());
+    for (uint32_t id = first_id; id < last_id; id++) {
+      if (pos < note_sequence[id].max_time)
+        return id;
     }
-    if (note.min_time > max_pos) {
-      break;
-    }
-    notes.push_back(note_id);
-    note_id++;
   }
+  return WB_INVALID_NOTE_ID;
+}
+
+NoteSequenceID MidiData::find_note(double pos, uint16_t key, uint16_t channel) {
+  uint32_t note_id = (uint32_t)-1;
+  // TODO: Should probably return multiple notes!
+  note_index.query(note_sequence, pos, pos, (int16_t)key, (int16_t)key, [&](uint32_t id, const MidiNote& note) {
+    if (pos >= note.max_time)
+      return true;
+    note_id = id;
+    return false;
+  });
+  return note_id;
+}
+
+Vector<uint32_t> MidiData::find_notes(double min_pos, double max_pos, uint16_t min_key, uint16_t max_key, uint16_t channel) {
+  Vector<uint32_t> notes;
+  note_index.query(note_sequence, min_pos, max_pos, (int16_t)min_key, (int16_t)max_key, [&](uint32_t id, const MidiNote&) {
+    notes.push_back(id);
+    return true;
+  });
   return notes;
 }
 
@@ -89,41 +142,53 @@ void MidiData::query_notes(
     uint16_t channel,
     void* cb_userdata,
     NoteCallback cb) {
-  for (uint32_t note_id = 0; const auto& note : note_sequence) {
-    if (note.max_time < min_pos || note.key < min_key || note.key > max_key) {
-      note_id++;
-      continue;
-    }
-    if (note.min_time > max_pos) {
+  note_index.query(
+      note_sequence, min_pos, max_pos, (int16_t)min_key, (int16_t)max_key, [&](uint32_t id, const MidiNote& note) {
+        cb(cb_userdata, id, note);
+        return true;
+      });
+}
+
+void MidiData::mark_modified() {
+  version = version_counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+Vector<uint32_t> MidiData::update_channel(uint16_t channel, uint32_t first_removed_note) {
+  uint32_t num_notes = note_sequence.size();
+  mark_modified();
+
+  // Notes before the first modified, removed or appended note are still sorted and indexed
+  uint32_t first_changed = math::min(note_index.num_notes, num_notes);
+  if (num_notes < note_index.num_notes && first_removed_note == WB_INVALID_NOTE_ID)
+    first_changed = 0;
+  first_changed = math::min(first_changed, first_removed_note);
+  for (uint32_t i = 0; i < first_changed; i++) {
+    if (has_bit(note_sequence[i].flags, MidiNoteFlags::Modified)) {
+      first_changed = i;
       break;
     }
-    cb(cb_userdata, note_id, note);
-    note_id++;
   }
-}
 
-Vector<uint32_t> MidiData::update_channel(uint16_t channel) {
-  std::sort(note_sequence.begin(), note_sequence.end(), [](const MidiNote& a, const MidiNote& b) {
-    if (a.min_time != b.min_time) {
-      return a.min_time < b.min_time;
-    }
-    if (a.key != b.key) {
-      return a.key < b.key;
-    }
-    return a.velocity < b.velocity;
-  });
+  // A note edited in place without the Modified flag leaves the head out of order, sort everything in that case
+  MidiNote* begin = note_sequence.begin();
+  if (std::is_sorted_until(begin, begin + first_changed, compare_note_order) != begin + first_changed)
+    first_changed = 0;
+
+  // Sort the changed tail, then merge it with the untouched head if they overlap
+  MidiNote* mid = begin + first_changed;
+  MidiNote* end = note_sequence.end();
+  uint32_t first_sorted = first_changed;
+  std::sort(mid, end, compare_note_order);
+  if (mid != begin && mid != end && compare_note_order(*mid, *(mid - 1))) {
+    first_sorted = (uint32_t)(std::upper_bound(begin, mid, *mid, compare_note_order) - begin);
+    std::inplace_merge(begin + first_sorted, mid, end, compare_note_order);
+  }
 
-  Vector<uint32_t> modified_notes;
-  int16_t new_min_note = max_keys;
-  int16_t new_max_note = 0;
-  double length = 0;
-  uint32_t selected_count = 0;
+  note_index.update(note_sequence, first_sorted);
 
-  for (uint32_t i = 0; i < (uint32_t)note_sequence.size(); i++) {
+  Vector<uint32_t> modified_notes;
+  for (uint32_t i = first_sorted; i < num_notes; i++) {
     MidiNote& note = note_sequence[i];
-    length = math::max(length, note.max_time);
-    new_min_note = math::min(new_min_note, note.key);
-    new_max_note = math::max(new_max_note, note.key);
 #if WB_ENABLE_NOTE_METADATA
     note_metadata_pool[note.meta_id].note_id = i;
 #endif
@@ -131,12 +196,23 @@ Vector<uint32_t> MidiData::update_channel(uint16_t channel) {
       note.flags &= ~MidiNoteFlags::Modified;
       modified_notes.push_back(i);
     }
+  }
+
+  int16_t new_min_note = max_keys;
+  int16_t new_max_note = 0;
+  for (const auto& block : note_index.blocks) {
+    new_min_note = math::min(new_min_note, block.min_key);
+    new_max_note = math::max(new_max_note, block.max_key);
+  }
+
+  uint32_t selected_count = 0;
+  for (const auto& note : note_sequence) {
     if (has_bit(note.flags, MidiNoteFlags::Selected)) {
       selected_count++;
     }
   }
 
-  max_length = length;
+  max_length = note_index.blocks.size() != 0 ? note_index.blocks.back().prefix_max_end : 0.0;
   min_note = new_min_note;
   max_note = new_max_note;
   num_selected = selected_count;
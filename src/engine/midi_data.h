@@ -1,17 +1,85 @@
 #pragma once
 
+#include <algorithm>
+
 #include "core/midi.h"
 
 namespace wb {
 
 using NoteCallback = void (*)(void* userdata, uint32_t id, const MidiNote& note);
 
+// Interval index over a note sequence sorted by start time. Notes are grouped into fixed-size blocks, each block keeps
+// the latest end time and the key range of its notes. The running maximum of the end time never decreases, so the
+// first block that may contain a note overlapping a position is found with a binary search and blocks that cannot
+// match are skipped entirely.
+struct MidiNoteIndex {
+  static constexpr uint32_t block_shift = 5;
+  static constexpr uint32_t block_size = 1u << block_shift;
+
+  struct Block {
+    double max_end;         // Latest end time in this block
+    double prefix_max_end;  // Latest end time from the first block up to this block
+    int16_t min_key;
+    int16_t max_key;
+  };
+
+  Vector<Block> blocks;
+  uint32_t num_notes = 0;
+
+  /**
+   * @brief Update the blocks after the note sequence has changed.
+   *
+   * @param notes Note sequence sorted by start time.
+   * @param first_note First note that has changed. Blocks before this note are left untouched.
+   */
+  void update(const MidiNoteBuffer& notes, uint32_t first_note);
+
+  // Returns the first block whose notes may end after pos.
+  uint32_t find_first_block(double pos) const;
+
+  // Calls fn(note_id, note) for every note overlapping [min_pos, max_pos] within the key range, in sequence order.
+  // Stops as soon as fn returns false.
+  template<typename Fn>
+  void query(
+      const MidiNoteBuffer& notes,
+      double min_pos,
+      double max_pos,
+      int16_t min_key,
+      int16_t max_key,
+      Fn&& fn) const {
+    // Notes starting after max_pos are never visited
+    uint32_t end = (uint32_t)(std::upper_bound(
+                                  notes.begin(),
+                                  notes.end(),
+                                  max_pos,
+                                  [](double pos, const MidiNote& note) { return pos < note.min_time; }) -
+                              notes.begin());
+    for (uint32_t i = find_first_block(min_pos); i < blocks.size(); i++) {
+      const Block& block = blocks[i];
+      uint32_t first_id = i << block_shift;
+      if (first_id >= end)
+        break;
+      if (block.max_end < min_pos || block.max_key < min_key || block.min_key > max_key)
+        continue;
+      uint32_t last_id = std::min(first_id + block_size, end);
+      for (uint32_t id = first_id; id < last_id; id++) {
+        const MidiNote& note = notes[id];
+        if (note.max_time < min_pos || note.key < min_key || note.key > max_key)
+          continue;
+        if (!fn(id, note))
+          return;
+      }
+    }
+  }
+};
+
 struct MidiData {
   static constexpr int16_t max_keys = 132;
   static constexpr uint32_t max_channels = 16;
   double max_length = 0.0;
   MidiNoteBuffer note_sequence;
   MidiNoteMetadataPool note_metadata_pool;
+  MidiNoteIndex note_index;
   // std::array<MidiNoteBuffer, max_channels> channels;
   uint32_t first_free_id = WB_INVALID_NOTE_METADATA_ID;
   uint32_t num_free_metadata = 0;
@@ -23,8 +91,20 @@ struct MidiData {
   uint32_t min_note = 0;
   uint32_t max_note = 0;
 
+  // Changes every time the notes are committed with update_channel() or marked with mark_modified(). Versions are
+  // unique across all MIDI data, so saved copies of the note sequence can be reused as long as the version stays the
+  // same.
+  uint64_t version = 0;
+
+  // Edits that change notes in place without going through update_channel(), such as velocity or mute changes, must
+  // call this so the next autosave picks them up.
+  void mark_modified();
+
   void create_metadata(MidiNote* notes, uint32_t count);
   void free_metadata(uint32_t id);
+
+  // Returns the first note that ends after pos, or WB_INVALID_NOTE_ID. Used to seek the playback position.
+  uint32_t find_first_note(double pos) const;
   NoteSequenceID find_note(double pos, uint16_t key, uint16_t channel);
   Vector<uint32_t> find_notes(double min_pos, double max_pos, uint16_t min_key, uint16_t max_key, uint16_t channel);
   void query_notes(
@@ -35,7 +115,16 @@ struct MidiData {
       uint16_t channel,
       void* cb_userdata,
       NoteCallback cb);
-  Vector<uint32_t> update_channel(uint16_t channel);
+
+  /**
+   * @brief Sort the notes changed by an edit back into the sequence and update the note index. Notes flagged as
+   * Modified and notes appended at the end are treated as changed.
+   *
+   * @param channel Channel to update.
+   * @param first_removed_note First note position that has been removed from the sequence by the caller, if any.
+   * @return Positions of the modified notes.
+   */
+  Vector<uint32_t> update_channel(uint16_t channel, uint32_t first_removed_note = WB_INVALID_NOTE_ID);
 };
 
 }  // namespace wb
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "midi_transform.h"
+
+#include <random>
+
+#include "core/bit_manipulation.h"
+#include "core/core_math.h"
+#include "midi_data.h"
+
+namespace wb {
+
+static int16_t snap_key_to_scale(int16_t key, uint16_t scale_mask, int16_t root) {
+  auto in_scale = [&](int32_t k) {
+    int32_t pitch_class = ((k - root) % 12 + 12) % 12;
+    return (scale_mask >> pitch_class) & 1;
+  };
+  if (scale_mask == 0 || in_scale(key))
+    return key;
+  // Prefer snapping down on ties
+  for (int32_t distance = 1; distance < 12; distance++) {
+    if (key - distance >= 0 && in_scale(key - distance))
+      return (int16_t)(key - distance);
+    if (key + distance <= 127 && in_scale(key + distance))
+      return (int16_t)(key + distance);
+  }
+  return key;
+}
+
+static bool is_same_note(const MidiNote& a, const MidiNote& b) {
+  return a.min_time == b.min_time && a.max_time == b.max_time && a.key == b.key && a.velocity == b.velocity;
+}
+
+uint32_t get_note_selection(const MidiData& data, BitSet& selection) {
+  uint32_t num_notes = data.note_sequence.size();
+  uint32_t num_selected = 0;
+  selection.resize(num_notes);
+  selection.clear();
+  for (uint32_t i = 0; i < num_notes; i++) {
+    if (has_bit(data.note_sequence[i].flags, MidiNoteFlags::Selected)) {
+      selection.set(i);
+      num_selected++;
+    }
+  }
+  return num_selected;
+}
+
+MidiEditResult apply_note_transform(MidiData& data, const BitSet& selection, const NoteTransform& transform) {
+  MidiNoteBuffer& note_seq = data.note_sequence;
+  Vector<MidiNote> backup;
+
+  auto commit_note = [&](MidiNote& note, const MidiNote& old_note) {
+    if (is_same_note(note, old_note))
+      return;
+    backup.push_back(old_note);
+    note.flags |= MidiNoteFlags::Modified;
+  };
+
+  switch (transform.type) {
+    case NoteTransformType::Quantize: {
+      double grid = transform.quantize.grid;
+      double strength = (double)transform.quantize.strength;
+      if (grid <= 0.0)
+        break;
+      selection.for_each_set([&](uint32_t note_id) {
+        MidiNote& note = note_seq[note_id];
+        MidiNote old_note = note;
+        double length = note.max_time - note.min_time;
+        double quantized_start = std::round(note.min_time / grid) * grid;
+        double min_time = math::max(note.min_time + (quantized_start - note.min_time) * strength, 0.0);
+        double max_time = min_time + length;
+        if (transform.quantize.quantize_end) {
+          double quantized_end = math::max(std::round(max_time / grid) * grid, min_time + grid);
+          max_time += (quantized_end - max_time) * strength;
+        }
+        note.min_time = min_time;
+        note.max_time = max_time;
+        commit_note(note, old_note);
+      });
+      break;
+    }
+    case NoteTransformType::Humanize: {
+      std::mt19937 rng(transform.humanize.seed);
+      std::uniform_real_distribution<double> time_dist(-transform.humanize.time_amount, transform.humanize.time_amount);
+      std::uniform_real_distribution<float> velocity_dist(
+          -transform.humanize.velocity_amount, transform.humanize.velocity_amount);
+      selection.for_each_set([&](uint32_t note_id) {
+        MidiNote& note = note_seq[note_id];
+        MidiNote old_note = note;
+        double offset = math::max(time_dist(rng), -note.min_time);
+        note.min_time += offset;
+        note.max_time += offset;
+        note.velocity = math::clamp(note.velocity + velocity_dist(rng), 0.0f, 1.0f);
+        commit_note(note, old_note);
+      });
+      break;
+    }
+    case NoteTransformType::Transpose:
+      selection.for_each_set([&](uint32_t note_id) {
+        MidiNote& note = note_seq[note_id];
+        MidiNote old_note = note;
+        note.key = (int16_t)math::clamp((int32_t)note.key + transform.transpose.semitones, 0, 127);
+        commit_note(note, old_note);
+      });
+      break;
+    case NoteTransformType::ScaleVelocity:
+      selection.for_each_set([&](uint32_t note_id) {
+        MidiNote& note = note_seq[note_id];
+        MidiNote old_note = note;
+        note.velocity = math::clamp(note.velocity * transform.velocity.scale + transform.velocity.offset, 0.0f, 1.0f);
+        commit_note(note, old_note);
+      });
+      break;
+    case NoteTransformType::Legato: {
+      // Notes are sorted by start time. Walk backwards and extend each note up to the next distinct onset, notes
+      // starting at the same time (chords) share the same end.
+      double current_onset = std::numeric_limits<double>::max();
+      double next_onset = std::numeric_limits<double>::max();
+      selection.for_each_set_reverse([&](uint32_t note_id) {
+        MidiNote& note = note_seq[note_id];
+        if (note.min_time < current_onset) {
+          next_onset = current_onset;
+          current_onset = note.min_time;
+        }
+        if (next_onset == std::numeric_limits<double>::max())
+          return;
+        MidiNote old_note = note;
+        note.max_time = math::max(next_onset - transform.legato.gap, note.min_time);
+        commit_note(note, old_note);
+      });
+      break;
+    }
+    case NoteTransformType::SnapToScale:
+      selection.for_each_set([&](uint32_t note_id) {
+        MidiNote& note = note_seq[note_id];
+        MidiNote old_note = note;
+        note.key = snap_key_to_scale(note.key, transform.scale.scale_mask, transform.scale.root);
+        commit_note(note, old_note);
+      });
+      break;
+  }
+
+  if (backup.empty())
+    return {};
+
+  return MidiEditResult{
+    .modified_notes = data.update_channel(0),
+    .deleted_notes = std::move(backup),
+  };
+}
+
+}  // namespace wb
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "core/bitset.h"
+#include "core/common.h"
+#include "core/midi.h"
+
+namespace wb {
+
+struct MidiData;
+
+enum class NoteTransformType {
+  Quantize,
+  Humanize,
+  Transpose,
+  ScaleVelocity,
+  Legato,
+  SnapToScale,
+};
+
+struct NoteTransform {
+  NoteTransformType type;
+  union {
+    struct {
+      double grid;     // Grid size in beats
+      float strength;  // 0 = unchanged, 1 = fully quantized
+      bool quantize_end;
+    } quantize;
+    struct {
+      double time_amount;     // Maximum time offset in beats
+      float velocity_amount;  // Maximum velocity offset
+      uint32_t seed;
+    } humanize;
+    struct {
+      int16_t semitones;
+    } transpose;
+    struct {
+      float scale;
+      float offset;
+    } velocity;
+    struct {
+      double gap;  // Space left before the next note in beats
+    } legato;
+    struct {
+      uint16_t scale_mask;  // Bit n is set if the pitch class root + n belongs to the scale
+      int16_t root;
+    } scale;
+  };
+};
+
+/**
+ * @brief Build a selection set from the notes flagged as selected.
+ *
+ * @param data MIDI data.
+ * @param selection Selection set, one bit per note.
+ * @return Number of selected notes.
+ */
+uint32_t get_note_selection(const MidiData& data, BitSet& selection);
+
+/**
+ * @brief Apply a transform to every selected note in one pass, then sort the sequence once. Only notes that actually
+ * changed are stored in the result.
+ *
+ * @param data MIDI data.
+ * @param selection Selection set, one bit per note.
+ * @param transform Transform to apply.
+ * @return Edit result for undo.
+ */
+MidiEditResult apply_note_transform(MidiData& data, const BitSet& selection, const NoteTransform& transform);
+
+}  // namespace wb
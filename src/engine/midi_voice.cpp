@@ -1,62 +1,146 @@
 #include "midi_voice.h"
 
-#include <bit>
-
 #include "core/core_math.h"
 
 namespace wb {
 
-MidiVoiceState::MidiVoiceState() {
+MidiVoiceState::MidiVoiceState(uint32_t max_voices) {
+  set_max_voices(max_voices);
+}
+
+void MidiVoiceState::set_max_voices(uint32_t max_voices) {
+  assert(max_voices > 0);
   voices.resize(max_voices);
+  voice_start_order.resize(max_voices);
+  voice_heap_pos.resize(max_voices);
+  heap.reserve(max_voices);
+  free_voices.reserve(max_voices);
+  release_all();
 }
 
-bool MidiVoiceState::add_voice(MidiVoice&& voice) {
-  if (used_voices == max_voices)
-    return false;
+MidiVoiceAddResult MidiVoiceState::add_voice(const MidiVoice& voice, MidiVoice* stolen_voice) {
+  MidiVoiceAddResult result = MidiVoiceAddResult::Added;
+  uint32_t voice_idx;
 
-  // Find free voice. Allocate new one if there is any
-  double max_time = voice.max_time;
-  auto free_voice = static_cast<MidiVoice*>(free_voices.pop_next_item());
-  if (free_voice != nullptr) {
-    *free_voice = std::move(voice);
-    allocated_voices.push_item(free_voice);
+  if (free_voices.size() != 0) {
+    voice_idx = free_voices.back();
+    free_voices.pop_back();
   } else {
-    voices[max_used_voices] = std::move(voice);
-    allocated_voices.push_item(&voices[max_used_voices]);
-    if (max_used_voices != max_voices)
-      max_used_voices++;
+    if (steal_policy == MidiVoiceStealPolicy::None) {
+      stats.num_dropped++;
+      return MidiVoiceAddResult::Dropped;
+    }
+    voice_idx = find_steal_candidate_();
+    remove_heap_item_(voice_heap_pos[voice_idx]);
+    if (stolen_voice)
+      *stolen_voice = voices[voice_idx];
+    stats.num_stolen++;
+    result = MidiVoiceAddResult::Stolen;
   }
-  used_voices++;
 
-  return true;
+  voices[voice_idx] = voice;
+  voice_start_order[voice_idx] = next_start_order++;
+  uint32_t pos = heap.size();
+  heap.push_back(voice_idx);
+  voice_heap_pos[voice_idx] = pos;
+  sift_up_(pos);
+  stats.peak_voices = math::max(stats.peak_voices, heap.size());
+
+  return result;
 }
 
 MidiVoice* MidiVoiceState::release_voice(double timeout) {
-  auto active_voice = allocated_voices.next();
-  if (active_voice == nullptr)
+  if (heap.size() == 0)
     return nullptr;
 
-  auto shortest_voice = active_voice;
-  while (active_voice != nullptr) {
-    if (active_voice->max_time < shortest_voice->max_time && active_voice->max_time <= timeout)
-      shortest_voice = active_voice;
-    active_voice = active_voice->next();
-  }
-
-  if (shortest_voice->max_time > timeout)
+  uint32_t voice_idx = heap[0];
+  if (voices[voice_idx].max_time > timeout)
     return nullptr;
-  shortest_voice->remove_from_list();
-  free_voices.push_item(shortest_voice);
-  used_voices--;
 
-  return shortest_voice;
+  remove_heap_item_(0);
+  free_voices.push_back(voice_idx);
+  return &voices[voice_idx];
 }
 
 void MidiVoiceState::release_all() {
-  if (auto all_voices = allocated_voices.next()) {
-    all_voices->pluck_from_list();
-    free_voices.replace_next_item(all_voices);
+  uint32_t max_voices = voices.size();
+  heap.resize(0);
+  free_voices.resize(max_voices);
+  // Hand out the lowest indices first
+  for (uint32_t i = 0; i < max_voices; i++)
+    free_voices[i] = max_voices - i - 1;
+}
+
+void MidiVoiceState::remove_heap_item_(uint32_t pos) {
+  uint32_t last = heap.back();
+  heap.pop_back();
+  if (pos == heap.size())
+    return;
+  heap[pos] = last;
+  voice_heap_pos[last] = pos;
+  sift_up_(pos);
+  sift_down_(voice_heap_pos[last]);
+}
+
+void MidiVoiceState::sift_up_(uint32_t pos) {
+  uint32_t voice_idx = heap[pos];
+  double max_time = voices[voice_idx].max_time;
+  while (pos > 0) {
+    uint32_t parent = (pos - 1) / 2;
+    uint32_t parent_idx = heap[parent];
+    if (voices[parent_idx].max_time <= max_time)
+      break;
+    heap[pos] = parent_idx;
+    voice_heap_pos[parent_idx] = pos;
+    pos = parent;
+  }
+  heap[pos] = voice_idx;
+  voice_heap_pos[voice_idx] = pos;
+}
+
+void MidiVoiceState::sift_down_(uint32_t pos) {
+  uint32_t size = heap.size();
+  uint32_t voice_idx = heap[pos];
+  double max_time = voices[voice_idx].max_time;
+  while (true) {
+    uint32_t child = pos * 2 + 1;
+    if (child >= size)
+      break;
+    if (child + 1 < size && voices[heap[child + 1]].max_time < voices[heap[child]].max_time)
+      child++;
+    uint32_t child_idx = heap[child];
+    if (max_time <= voices[child_idx].max_time)
+      break;
+    heap[pos] = child_idx;
+    voice_heap_pos[child_idx] = pos;
+    pos = child;
+  }
+  heap[pos] = voice_idx;
+  voice_heap_pos[voice_idx] = pos;
+}
+
+uint32_t MidiVoiceState::find_steal_candidate_() const {
+  // Stealing only happens when the pool is full, the linear scans below are fine
+  switch (steal_policy) {
+    case MidiVoiceStealPolicy::Oldest: {
+      uint32_t candidate = heap[0];
+      for (uint32_t voice_idx : heap) {
+        if (voice_start_order[voice_idx] < voice_start_order[candidate])
+          candidate = voice_idx;
+      }
+      return candidate;
+    }
+    case MidiVoiceStealPolicy::Quietest: {
+      uint32_t candidate = heap[0];
+      for (uint32_t voice_idx : heap) {
+        if (voices[voice_idx].velocity < voices[candidate].velocity)
+          candidate = voice_idx;
+      }
+      return candidate;
+    }
+    default: break;
   }
+  return heap[0];
 }
 
-}  // namespace wb
\ No newline at end of file
+}  // namespace wb
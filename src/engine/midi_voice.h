@@ -3,34 +3,95 @@
 #include <limits>
 
 #include "core/common.h"
-#include "core/list.h"
 #include "core/vector.h"
 
 namespace wb {
 
-struct MidiVoice : public InplaceList<MidiVoice> {
+struct MidiVoice {
   double max_time;
   float velocity;
   uint16_t channel;
   int16_t key;
 };
 
+enum class MidiVoiceStealPolicy {
+  None,            // Drop new notes when the pool is full
+  EarliestRelease, // Steal the voice that would be released first
+  Oldest,          // Steal the voice that has been playing the longest
+  Quietest,        // Steal the voice with the lowest velocity
+};
+
+enum class MidiVoiceAddResult {
+  Added,
+  Stolen,
+  Dropped,
+};
+
+struct MidiVoiceStats {
+  uint32_t peak_voices;
+  uint64_t num_stolen;
+  uint64_t num_dropped;
+};
+
+/**
+ * @brief Preallocated voice pool. Active voices are kept in a min-heap ordered by note-off time, so releasing and
+ * stealing voices are O(log n). Nothing is allocated after the pool is created.
+ */
 struct MidiVoiceState {
-  static constexpr uint32_t max_voices = sizeof(uint64_t) * 8;
+  static constexpr uint32_t default_max_voices = 256;
   Vector<MidiVoice> voices;
-  InplaceList<MidiVoice> allocated_voices;
-  InplaceList<MidiVoice> free_voices;
-  uint64_t voice_mask{};
-  uint32_t used_voices{};
-  uint32_t max_used_voices{};
-
-  MidiVoiceState();
-  bool add_voice(MidiVoice&& voice);
+  Vector<uint64_t> voice_start_order;  // Note-on sequence number of each voice, used to find the oldest voice
+  Vector<uint32_t> voice_heap_pos;     // Position of each voice in the heap
+  Vector<uint32_t> heap;               // Active voice indices, min-heap on max_time
+  Vector<uint32_t> free_voices;
+  uint64_t next_start_order{};
+  MidiVoiceStealPolicy steal_policy = MidiVoiceStealPolicy::EarliestRelease;
+  MidiVoiceStats stats{};
+
+  MidiVoiceState(uint32_t max_voices = default_max_voices);
+
+  /**
+   * @brief Resize the voice pool. All active voices are discarded, do not call this while the track is processing.
+   *
+   * @param max_voices Maximum number of simultaneous voices.
+   */
+  void set_max_voices(uint32_t max_voices);
+
+  /**
+   * @brief Add a new voice. If the pool is full, a voice is stolen according to the steal policy.
+   *
+   * @param voice New voice.
+   * @param stolen_voice Receives the stolen voice when the result is MidiVoiceAddResult::Stolen.
+   * @return Add result.
+   */
+  MidiVoiceAddResult add_voice(const MidiVoice& voice, MidiVoice* stolen_voice);
+
+  /**
+   * @brief Release the voice that ends first if it ends at or before the timeout.
+   *
+   * @param timeout Time position in beats.
+   * @return Released voice or nullptr. The pointer stays valid until the next add_voice call.
+   */
   MidiVoice* release_voice(double timeout);
+
   void release_all();
+
+  inline uint32_t max_voices() const {
+    return voices.size();
+  }
+
+  inline uint32_t used_voices() const {
+    return heap.size();
+  }
+
   inline bool has_voice() const {
-    return used_voices != 0;
+    return heap.size() != 0;
   }
+
+  void remove_heap_item_(uint32_t pos);
+  void sift_up_(uint32_t pos);
+  void sift_down_(uint32_t pos);
+  uint32_t find_steal_candidate_() const;
 };
 
 }  // namespace wb
@@ -1,10 +1,15 @@
 #include "project.h"
 
+#include <type_traits>
+#include <unordered_map>
+
 #include "core/byte_buffer.h"
+#include "core/chunk_file.h"
 #include "core/fs.h"
 #include "core/serdes.h"
 #include "core/stream.h"
 #include "core/vector.h"
+#include "engine/file_index.h"
 #include "engine/track.h"
 #include "ui/browser.h"
 
@@ -12,14 +17,157 @@
 
 namespace wb {
 
-static constexpr uint32_t project_header_version = 1;
-static constexpr uint32_t project_info_version = 1;
-static constexpr uint32_t project_sample_table_version = 1;
-static constexpr uint32_t project_midi_table_version = 1;
-static constexpr uint32_t project_track_version = 1;
-static constexpr uint32_t project_clip_version = 2;
+static constexpr uint32_t project_magic = fourcc("WBPJ");
+static constexpr uint32_t project_version = 3;
+static constexpr uint32_t project_info_section = fourcc("INFO");
+static constexpr uint32_t project_tempo_section = fourcc("TMPO");
+static constexpr uint32_t project_sample_section = fourcc("SMPL");
+static constexpr uint32_t project_midi_section = fourcc("MIDI");
+static constexpr uint32_t project_track_section = fourcc("TRCK");
+static constexpr uint32_t project_clip_section = fourcc("CLIP");
+
+// Note arrays are copied straight from the file into MidiNoteBuffer
+static_assert(std::is_trivially_copyable_v<MidiNote> && sizeof(MidiNote) == 32, "MidiNote layout has changed");
+
+// Pick a relocation candidate found by content hash. The content hash only covers the head and the tail of the file,
+// so files padded with silence can collide. A candidate is accepted if it has the same filename, or the same size and
+// the same hash of the whole file.
+static std::optional<std::filesystem::path> pick_content_match(
+    const ProjectSampleRef& ref,
+    const Vector<FileIndexEntry>& candidates) {
+  std::filesystem::path filename = ref.path.filename();
+  for (const auto& candidate : candidates)
+    if (candidate.path.filename() == filename && std::filesystem::is_regular_file(candidate.path))
+      return candidate.path;
+  if (ref.full_hash == 0)
+    return {};
+  for (const auto& candidate : candidates) {
+    if (candidate.size == ref.size && std::filesystem::is_regular_file(candidate.path) &&
+        compute_file_full_hash(candidate.path) == ref.full_hash)
+      return candidate.path;
+  }
+  return {};
+}
 
-ProjectFileResult read_project_file(
+// Pick a relocation candidate found by filename. Candidates with the same size are preferred.
+static std::optional<std::filesystem::path> pick_name_match(
+    const ProjectSampleRef& ref,
+    const Vector<FileIndexEntry>& candidates) {
+  const FileIndexEntry* fallback = nullptr;
+  for (const auto& candidate : candidates) {
+    if (!std::filesystem::is_regular_file(candidate.path))
+      continue;
+    if (candidate.size == ref.size)
+      return candidate.path;
+    if (!fallback)
+      fallback = &candidate;
+  }
+  if (fallback)
+    return fallback->path;
+  return {};
+}
+
+using MissingFileMap = std::unordered_map<std::filesystem::path::string_type, std::optional<std::filesystem::path>>;
+
+// Record the first location of every missing filename found under root
+static void scan_missing_files(const std::filesystem::path& root, MissingFileMap& missing_files) {
+  std::error_code ec;
+  std::filesystem::recursive_directory_iterator it(root, std::filesystem::directory_options::skip_permission_denied, ec);
+  for (; !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+    std::error_code entry_ec;
+    if (!it->is_regular_file(entry_ec))
+      continue;
+    auto missing_file = missing_files.find(it->path().filename().native());
+    if (missing_file != missing_files.end() && !missing_file->second)
+      missing_file->second = it->path();
+  }
+}
+
+static void relocate_sample(ProjectSampleRef& ref, std::filesystem::path&& location) {
+  Log::info("Sample {} relocated to {}", ref.path.filename().string(), location.string());
+  ref.path = std::move(location);
+}
+
+// Resolve the location of missing samples. The project directory is scanned once for all missing files, anything
+// that is still missing is looked up in the file index by content hash and then by filename. The index may not be
+// open or may still be building, so samples it has no hit for are searched in one scan of the library roots.
+static void resolve_project_samples(const std::filesystem::path& filepath, Vector<ProjectSampleRef>& refs) {
+  MissingFileMap missing_files;
+  for (const auto& ref : refs)
+    if (!std::filesystem::is_regular_file(ref.path))
+      missing_files.emplace(ref.path.filename().native(), std::nullopt);
+  if (missing_files.empty())
+    return;
+
+  Log::info("Scanning {} missing files in project relative path", missing_files.size());
+  scan_missing_files(remove_filename_from_path(filepath), missing_files);
+
+  Vector<ProjectSampleRef*> unresolved_refs;
+  for (auto& ref : refs) {
+    if (std::filesystem::is_regular_file(ref.path))
+      continue;
+    std::filesystem::path filename = ref.path.filename();
+    std::optional<std::filesystem::path> location = missing_files[filename.native()];
+    if (!location && ref.content_hash != 0)
+      location = pick_content_match(ref, g_file_index.find_by_content_hash(ref.content_hash));
+    if (!location)
+      location = pick_name_match(ref, g_file_index.find_by_name(filename));
+    if (location)
+      relocate_sample(ref, std::move(*location));
+    else
+      unresolved_refs.push_back(&ref);
+  }
+  if (unresolved_refs.empty())
+    return;
+
+  Log::info("Scanning library for {} missing files", unresolved_refs.size());
+  for (const auto& directory : g_browser.directories)
+    scan_missing_files(*directory.first, missing_files);
+  for (ProjectSampleRef* ref : unresolved_refs) {
+    std::optional<std::filesystem::path>& location = missing_files[ref->path.filename().native()];
+    if (location)
+      relocate_sample(*ref, std::filesystem::path(*location));
+  }
+}
+
+static Vector<SampleAsset*> load_project_samples(
+    const std::filesystem::path& filepath,
+    Vector<ProjectSampleRef>& refs,
+    SampleTable& sample_table) {
+  resolve_project_samples(filepath, refs);
+
+  Vector<SampleAsset*> sample_assets;
+  sample_assets.reserve(refs.size());
+  for (uint32_t i = 0; i < refs.size(); i++) {
+    const std::filesystem::path& sample_path = refs[i].path;
+    Log::debug("({}) Loading sample: {}", i, sample_path.string());
+    if (!std::filesystem::is_regular_file(sample_path)) {
+      // TODO: Skip this sample if not found
+      Log::error("Cannot find sample: {}", sample_path.filename().string());
+      sample_assets.push_back(nullptr);
+      continue;
+    }
+    SampleAsset* asset = sample_table.load_from_file(sample_path);
+    if (asset == nullptr)
+      Log::error("Cannot open sample: {}", sample_path.filename().string());
+    sample_assets.push_back(asset);
+  }
+  return sample_assets;
+}
+
+static ProjectFileResult to_project_file_result(ChunkFileResult result) {
+  switch (result) {
+    case ChunkFileResult::Ok: return ProjectFileResult::Ok;
+    case ChunkFileResult::ErrCannotAccessFile: return ProjectFileResult::ErrCannotAccessFile;
+    case ChunkFileResult::ErrInvalidFormat: return ProjectFileResult::ErrInvalidFormat;
+    case ChunkFileResult::ErrIncompatibleVersion: return ProjectFileResult::ErrIncompatibleVersion;
+    case ChunkFileResult::ErrUnsupportedSection: return ProjectFileResult::ErrUnsupportedFeature;
+    default: break;
+  }
+  return ProjectFileResult::ErrCorruptedFile;
+}
+
+static ProjectFileResult import_msgpack_project_file(
     const std::filesystem::path& filepath,
     Engine& engine,
     SampleTable& sample_table,
@@ -44,6 +192,9 @@ ProjectFileResult read_project_file(
     double initial_bpm = project.map_find("bpm").as_number(120.0);
     double playhead_pos = project.map_find("playhead_pos").as_number(0.0);
 
+    engine.edit_lock();
+    engine.tempo_map.reset();
+    engine.edit_unlock();
     engine.set_bpm(initial_bpm);
     engine.set_playhead_position(playhead_pos);
     timeline.min_hscroll = project.map_find("timeline_view_min").as_number(0.0);
@@ -59,6 +210,7 @@ ProjectFileResult read_project_file(
     Vector<SampleAsset*> sample_assets;
     if (auto samples = project.map_find("sample_table")) {
       uint32_t count = samples.array_size();
+      Vector<ProjectSampleRef> sample_refs;
 
       for (uint32_t i = 0; i < count; i++) {
         std::string_view path_str = samples.array_get(i).as_str();
@@ -66,44 +218,10 @@ ProjectFileResult read_project_file(
           Log::error("Invalid path");
           return ProjectFileResult::ErrInvalidFormat;
         }
-
-        std::filesystem::path sample_path(path_str);
-        if (!std::filesystem::is_regular_file(sample_path)) {
-          std::filesystem::path filename = sample_path.filename();
-          bool found = false;
-          Log::info("File not found: {}", filename.string());
-          Log::info("Scanning {} in project relative path", filename.string());
-
-          // Find sample file relative to project file or scan
-          if (auto file = find_file_recursive(remove_filename_from_path(filepath), filename)) {
-            sample_path = file.value();
-            found = true;
-          } else {
-            Log::info("File {} not found in project relative path.", filename.string());
-            for (const auto& directory : g_browser.directories) {
-              Log::info("Scanning {} in user's directory: {}", filename.string(), directory.first->filename().string());
-              if (auto file = find_file_recursive(*directory.first, filename)) {
-                sample_path = file.value();
-                found = true;
-                break;
-              }
-            }
-          }
-
-          if (!found) {
-            // TODO: Skip this sample if not found
-            Log::error("Cannot find sample: {}", filename.string());
-            sample_assets.push_back(nullptr);
-            continue;
-          }
-        }
-
-        Log::debug("({}) Loading sample: {}", i, sample_path.string());
-        SampleAsset* asset = sample_table.load_from_file(sample_path);
-        if (asset == nullptr)
-          Log::error("Cannot open sample: {}", sample_path.filename().string());
-        sample_assets.push_back(asset);
+        sample_refs.push_back({ .path = std::filesystem::path(path_str), .size = 0, .content_hash = 0, .full_hash = 0 });
       }
+
+      sample_assets = load_project_samples(filepath, sample_refs, sample_table);
     }
 
     Vector<MidiAsset*> midi_assets;
@@ -210,6 +328,11 @@ ProjectFileResult read_project_file(
           }
 
           engine.tracks.push_back(track);
+    track->editor_lock = &engine.editor_lock;
+    track->set_song_length(&engine.song_length);
+          track->editor_lock = &engine.editor_lock;
+          track->editor_lock = &engine.editor_lock;
+    track->set_song_length(&engine.song_length);
         }
       }
     }
@@ -218,116 +341,427 @@ ProjectFileResult read_project_file(
   return ProjectFileResult::Ok;
 }
 
-ProjectFileResult write_project_file(
+static ProjectFileResult read_project_sections(
+    ChunkFileReader& reader,
     const std::filesystem::path& filepath,
     Engine& engine,
     SampleTable& sample_table,
     MidiTable& midi_table,
     TimelineWindow& timeline) {
-  File file;
-  if (!file.open(filepath, IOOpenMode::Write | IOOpenMode::Truncate))
-    return ProjectFileResult::ErrCannotAccessFile;
+  ByteBuffer section;
+
+  if (auto result = reader.get_section(project_info_section, section); result != ChunkFileResult::Ok)
+    return to_project_file_result(result);
+  PFProjectInfo info;
+  if (!section.read(&info, sizeof(PFProjectInfo)) || !io_read(section, &engine.project_info.author) ||
+      !io_read(section, &engine.project_info.title) || !io_read(section, &engine.project_info.genre) ||
+      !io_read(section, &engine.project_info.description) || !TempoMap::is_valid_bpm(info.initial_bpm))
+    return ProjectFileResult::ErrCorruptedFile;
+  engine.edit_lock();
+  engine.tempo_map.reset();
+  engine.edit_unlock();
+  engine.set_bpm(info.initial_bpm);
+  engine.set_playhead_position(info.playhead_pos);
+  timeline.min_hscroll = info.timeline_view_min;
+  timeline.max_hscroll = info.timeline_view_max;
+
+  if (reader.has_section(project_tempo_section)) {
+    if (auto result = reader.get_section(project_tempo_section, section); result != ChunkFileResult::Ok)
+      return to_project_file_result(result);
+    uint32_t count;
+    if (!io_read(section, &count))
+      return ProjectFileResult::ErrCorruptedFile;
+    for (uint32_t i = 0; i < count; i++) {
+      PFTempoPoint point;
+      if (!section.read(&point, sizeof(PFTempoPoint)) || !engine.add_tempo_point(point.beat, point.bpm, point.ramp != 0))
+        return ProjectFileResult::ErrCorruptedFile;
+    }
+    if (!io_read(section, &count))
+      return ProjectFileResult::ErrCorruptedFile;
+    for (uint32_t i = 0; i < count; i++) {
+      PFTimeSignature sig;
+      if (!section.read(&sig, sizeof(PFTimeSignature)))
+        return ProjectFileResult::ErrCorruptedFile;
+      if (!engine.add_time_signature(sig.bar, sig.numerator, sig.denominator))
+        return ProjectFileResult::ErrCorruptedFile;
+    }
+  }
 
+  Vector<SampleAsset*> sample_assets;
+  if (reader.has_section(project_sample_section)) {
+    if (auto result = reader.get_section(project_sample_section, section); result != ChunkFileResult::Ok)
+      return to_project_file_result(result);
+    uint32_t count;
+    if (!io_read(section, &count))
+      return ProjectFileResult::ErrCorruptedFile;
+    Vector<ProjectSampleRef> sample_refs;
+    std::string path_str;
+    for (uint32_t i = 0; i < count; i++) {
+      ProjectSampleRef ref{ .size = 0, .content_hash = 0, .full_hash = 0 };
+      path_str.clear();
+      if (!io_read(section, &path_str) || path_str.empty())
+        return ProjectFileResult::ErrCorruptedFile;
+      // Version 1 only stores the path
+      if (reader.version() >= 2 && (!io_read(section, &ref.size) || !io_read(section, &ref.content_hash)))
+        return ProjectFileResult::ErrCorruptedFile;
+      if (reader.version() >= 3 && !io_read(section, &ref.full_hash))
+        return ProjectFileResult::ErrCorruptedFile;
+      ref.path = std::filesystem::path(path_str);
+      sample_refs.push_back(std::move(ref));
+    }
+    sample_assets = load_project_samples(filepath, sample_refs, sample_table);
+  }
+
+  Vector<MidiAsset*> midi_assets;
+  if (reader.has_section(project_midi_section)) {
+    if (auto result = reader.get_section(project_midi_section, section); result != ChunkFileResult::Ok)
+      return to_project_file_result(result);
+    uint32_t count;
+    uint32_t reserved;
+    if (!io_read(section, &count) || !io_read(section, &reserved))
+      return ProjectFileResult::ErrCorruptedFile;
+    for (uint32_t i = 0; i < count; i++) {
+      PFMidiAsset asset_info;
+      if (!section.read(&asset_info, sizeof(PFMidiAsset)))
+        return ProjectFileResult::ErrCorruptedFile;
+      uint64_t note_bytes = (uint64_t)asset_info.note_count * sizeof(MidiNote);
+      if (asset_info.note_offset > section.size() || note_bytes > section.size() - asset_info.note_offset)
+        return ProjectFileResult::ErrCorruptedFile;
+
+      MidiAsset* asset = midi_table.create_midi();
+      MidiNoteBuffer& buffer = asset->data.note_sequence;
+      buffer.resize_fast(asset_info.note_count);
+      std::memcpy(buffer.data(), section.data() + asset_info.note_offset, note_bytes);
+      asset->data.create_metadata(buffer.data(), buffer.size());
+      asset->data.update_channel(0);
+      midi_assets.push_back(asset);
+    }
+  }
+
+  Vector<PFClipHeader> clip_headers;
+  Vector<std::string> clip_names;
+  if (reader.has_section(project_clip_section)) {
+    if (auto result = reader.get_section(project_clip_section, section); result != ChunkFileResult::Ok)
+      return to_project_file_result(result);
+    uint32_t count;
+    if (!io_read(section, &count))
+      return ProjectFileResult::ErrCorruptedFile;
+    clip_headers.resize(count);
+    clip_names.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+      if (!section.read(&clip_headers[i], sizeof(PFClipHeader)) || !io_read(section, &clip_names[i]))
+        return ProjectFileResult::ErrCorruptedFile;
+    }
+  }
+
+  if (auto result = reader.get_section(project_track_section, section); result != ChunkFileResult::Ok)
+    return to_project_file_result(result);
+  uint32_t track_count;
+  if (!io_read(section, &track_count))
+    return ProjectFileResult::ErrCorruptedFile;
+  for (uint32_t i = 0; i < track_count; i++) {
+    PFTrackHeader track_info;
+    std::string name;
+    if (!section.read(&track_info, sizeof(PFTrackHeader)) || !io_read(section, &name))
+      return ProjectFileResult::ErrCorruptedFile;
+    if (track_info.first_clip > clip_headers.size() || track_info.clip_count > clip_headers.size() - track_info.first_clip)
+      return ProjectFileResult::ErrCorruptedFile;
+
+    Track* track = new (std::nothrow) Track(
+        "",
+        Color(track_info.color),
+        track_info.view_height,
+        track_info.flags.shown,
+        {
+          .volume_db = track_info.volume_db,
+          .pan = track_info.pan,
+          .mute = track_info.flags.mute,
+          .solo = track_info.flags.solo,
+        });
+    assert(track != nullptr);
+    track->name = std::move(name);
+    track->clips.resize(track_info.clip_count);
+
+    for (uint32_t j = 0; j < track_info.clip_count; j++) {
+      const PFClipHeader& clip_info = clip_headers[track_info.first_clip + j];
+      Clip* clip = track->allocate_clip();
+      new (clip) Clip("", Color(clip_info.color), clip_info.min_time, clip_info.max_time, clip_info.start_offset);
+      clip->id = j;
+      clip->name = std::move(clip_names[track_info.first_clip + j]);
+      clip->set_active(clip_info.flags.active);
+      track->clips[j] = clip;
+
+      switch ((ClipType)clip_info.type) {
+        case ClipType::Audio:
+          if (clip_info.audio.asset_index < sample_assets.size()) {
+            clip->init_as_audio_clip({
+              .asset = sample_assets[clip_info.audio.asset_index],
+              .fade_start = clip_info.audio.fade_start,
+              .fade_end = clip_info.audio.fade_end,
+              .speed = clip_info.audio.speed,
+              .gain = clip_info.audio.gain,
+            });
+          }
+          break;
+        case ClipType::Midi:
+          if (clip_info.midi.asset_index < midi_assets.size()) {
+            clip->init_as_midi_clip({
+              .asset = midi_assets[clip_info.midi.asset_index],
+              .length = clip_info.midi.length,
+              .transpose = clip_info.midi.transpose,
+              .rate = clip_info.midi.rate,
+              .mode = (ClipMode)clip_info.midi.mode,
+            });
+          }
+          break;
+        default: break;
+      }
+    }
+
+    engine.tracks.push_back(track);
+    track->editor_lock = &engine.editor_lock;
+    track->set_song_length(&engine.song_length);
+  }
+
+  return ProjectFileResult::Ok;
+}
+
+ProjectFileResult read_project_file(
+    const std::filesystem::path& filepath,
+    Engine& engine,
+    SampleTable& sample_table,
+    MidiTable& midi_table,
+    TimelineWindow& timeline) {
+  if (!chunk_file_has_magic(filepath, project_magic))
+    return import_msgpack_project_file(filepath, engine, sample_table, midi_table, timeline);
+
+  ChunkFileReader reader;
+  if (auto result = reader.open(filepath, project_magic); result != ChunkFileResult::Ok)
+    return to_project_file_result(result);
+  if (reader.version() > project_version)
+    return ProjectFileResult::ErrIncompatibleVersion;
+
+  return read_project_sections(reader, filepath, engine, sample_table, midi_table, timeline);
+}
+
+void capture_project_snapshot(
+    ProjectSnapshot& snapshot,
+    const ProjectSnapshot* previous,
+    Engine& engine,
+    SampleTable& sample_table,
+    MidiTable& midi_table,
+    TimelineWindow& timeline) {
   std::unordered_map<MidiAsset*, uint32_t> midi_index_map;
   std::unordered_map<SampleAsset*, uint32_t> sample_index_map;
-  MsgpackWriter w(file);
-  w.write_map(1);
-  w.write_kv_map("wbpr", 10);
-  w.write_kv_num("version", 1);
-  w.write_kv_num("bpm", engine.get_bpm());
-  w.write_kv_num("playhead_pos", engine.playhead_pos());
-  w.write_kv_num("timeline_view_min", timeline.min_hscroll);
-  w.write_kv_num("timeline_view_max", timeline.max_hscroll);
-  w.write_kv_num("main_vol", 0.0f);
-
-  w.write_kv_map("project_info", 4);
-  {
-    w.write_kv_str("author", engine.project_info.author);
-    w.write_kv_str("title", engine.project_info.title);
-    w.write_kv_str("genre", engine.project_info.genre);
-    w.write_kv_str("desc", engine.project_info.description);
+  std::unordered_map<uint64_t, const ProjectSnapshot::MidiAsset*> previous_midi_assets;
+
+  snapshot.info = {
+    .initial_bpm = engine.get_bpm(),
+    .playhead_pos = engine.playhead_pos(),
+    .timeline_view_min = timeline.min_hscroll,
+    .timeline_view_max = timeline.max_hscroll,
+    .main_volume_db = 0.0f,
+  };
+  snapshot.project_info = engine.project_info;
+
+  snapshot.tempo_points.resize(0);
+  for (const TempoPoint& point : engine.tempo_map.tempo_points)
+    snapshot.tempo_points.push_back({ .beat = point.beat, .bpm = point.bpm, .ramp = point.ramp });
+  snapshot.time_signatures.resize(0);
+  for (const TimeSignature& sig : engine.tempo_map.time_signatures)
+    snapshot.time_signatures.push_back({ .bar = sig.bar, .numerator = sig.numerator, .denominator = sig.denominator });
+
+  // Files with the same content share the content, so its size and hash apply to every path
+  snapshot.samples.clear();
+  for (auto& sample : sample_table.samples) {
+    const SampleContent* content = sample.second.content;
+    sample_index_map.emplace(&sample.second, snapshot.samples.size());
+    snapshot.samples.push_back({
+      .path = sample.second.path,
+      .size = content->file_size,
+      .content_hash = content->content_hash,
+      .full_hash = content->full_hash,
+    });
   }
 
-  w.write_kv_array("sample_table", sample_table.samples.size());
-  {
-    uint32_t idx = 0;
-    for (auto& sample : sample_table.samples) {
-      std::string path = sample.second.sample_instance.path.string();
-      w.write_str(path);
-      sample_index_map.emplace(&sample.second, idx);
-      idx++;
+  if (previous) {
+    for (const auto& asset : previous->midi_assets)
+      if (asset.version != 0)
+        previous_midi_assets.emplace(asset.version, &asset);
+  }
+
+  snapshot.midi_assets.clear();
+  auto midi_asset_ptr = midi_table.allocated_assets.next_;
+  while (auto asset = static_cast<MidiAsset*>(midi_asset_ptr)) {
+    const MidiData& data = asset->data;
+    ProjectSnapshot::MidiAsset asset_snapshot{
+      .version = data.version,
+      .min_note = data.min_note,
+      .max_note = data.max_note,
+    };
+
+    // Unchanged note sequences are shared with the previous snapshot
+    auto previous_asset = previous_midi_assets.find(data.version);
+    if (previous_asset != previous_midi_assets.end()) {
+      asset_snapshot.notes = previous_asset->second->notes;
+    } else {
+      auto notes = std::make_shared<MidiNoteBuffer>();
+      notes->resize_fast(data.note_sequence.size());
+      std::memcpy(notes->data(), data.note_sequence.data(), data.note_sequence.size() * sizeof(MidiNote));
+      asset_snapshot.notes = std::move(notes);
     }
+
+    midi_index_map.emplace(asset, snapshot.midi_assets.size());
+    snapshot.midi_assets.push_back(std::move(asset_snapshot));
+    midi_asset_ptr = asset->next_;
   }
 
-  w.write_kv_array("midi_table", midi_table.midi_assets.num_allocated);
-  {
-    uint32_t idx = 0;
-    auto midi_asset_ptr = midi_table.allocated_assets.next_;
-    while (auto asset = static_cast<MidiAsset*>(midi_asset_ptr)) {
-      MidiData& data = asset->data;
-      w.write_map(3);
-      w.write_kv_num("min_note", data.min_note);
-      w.write_kv_num("max_note", data.max_note);
-      w.write_kv_array("notes", data.note_sequence.size());
-      for (const MidiNote& note : data.note_sequence) {
-        w.write_array(5);
-        w.write_num(note.min_time);
-        w.write_num(note.max_time);
-        w.write_num(note.key);
-        w.write_num(note.flags);
-        w.write_num(note.velocity);
+  snapshot.tracks.clear();
+  snapshot.track_names.clear();
+  snapshot.clips.clear();
+  snapshot.clip_names.clear();
+  for (Track* track : engine.tracks) {
+    PFTrackHeader track_info{};
+    track_info.flags.has_name = !track->name.empty();
+    track_info.flags.shown = track->shown;
+    track_info.flags.mute = track->ui_parameter_state.mute;
+    track_info.flags.solo = track->ui_parameter_state.solo;
+    track_info.color = track->color.to_uint32();
+    track_info.view_height = track->height;
+    track_info.volume_db = track->ui_parameter_state.volume_db;
+    track_info.pan = track->ui_parameter_state.pan;
+    track_info.first_clip = snapshot.clips.size();
+    track_info.clip_count = track->clips.size();
+    snapshot.tracks.push_back(track_info);
+    snapshot.track_names.push_back(track->name);
+
+    for (Clip* clip : track->clips) {
+      PFClipHeader clip_info{};
+      clip_info.type = (uint32_t)clip->type;
+      clip_info.flags.has_name = !clip->name.empty();
+      clip_info.flags.active = clip->is_active();
+      clip_info.color = clip->color.to_uint32();
+      clip_info.min_time = clip->min_time;
+      clip_info.max_time = clip->max_time;
+      clip_info.start_offset = clip->start_offset;
+
+      switch (clip->type) {
+        case ClipType::Audio: {
+          auto asset = sample_index_map.find(clip->audio.asset);
+          clip_info.audio = {
+            .fade_start = clip->audio.fade_start,
+            .fade_end = clip->audio.fade_end,
+            .speed = clip->audio.speed,
+            .asset_index = asset != sample_index_map.end() ? asset->second : WB_INVALID_ASSET_ID,
+            .gain = clip->audio.gain,
+          };
+          break;
+        }
+        case ClipType::Midi: {
+          auto asset = midi_index_map.find(clip->midi.asset);
+          clip_info.midi = {
+            .length = clip->midi.length,
+            .asset_index = asset != midi_index_map.end() ? asset->second : WB_INVALID_ASSET_ID,
+            .transpose = clip->midi.transpose,
+            .rate = clip->midi.rate,
+            .mode = (uint32_t)clip->midi.mode,
+          };
+          break;
+        }
+        default: WB_UNREACHABLE();
       }
-      midi_index_map.emplace(asset, idx);
-      midi_asset_ptr = asset->next_;
-      idx++;
+
+      snapshot.clips.push_back(clip_info);
+      snapshot.clip_names.push_back(clip->name);
     }
   }
+}
 
-  w.write_kv_array("tracks", engine.tracks.size());
+void encode_project_snapshot(const ProjectSnapshot& snapshot, ByteBuffer& dst) {
+  ChunkFileWriter writer;
+
+  ByteBuffer& info = writer.begin_section(project_info_section);
+  info.write(&snapshot.info, sizeof(PFProjectInfo));
+  io_write(info, snapshot.project_info.author);
+  io_write(info, snapshot.project_info.title);
+  io_write(info, snapshot.project_info.genre);
+  io_write(info, snapshot.project_info.description);
+  writer.end_section();
+
+  ByteBuffer& tempo = writer.begin_section(project_tempo_section);
+  io_write(tempo, snapshot.tempo_points.size());
+  tempo.write(snapshot.tempo_points.data(), snapshot.tempo_points.size() * sizeof(PFTempoPoint));
+  io_write(tempo, snapshot.time_signatures.size());
+  tempo.write(snapshot.time_signatures.data(), snapshot.time_signatures.size() * sizeof(PFTimeSignature));
+  writer.end_section();
+
+  ByteBuffer& samples = writer.begin_section(project_sample_section);
+  io_write(samples, snapshot.samples.size());
+  for (const ProjectSampleRef& sample : snapshot.samples) {
+    io_write(samples, sample.path.string());
+    io_write(samples, sample.size);
+    io_write(samples, sample.content_hash);
+    io_write(samples, sample.full_hash);
+  }
+  writer.end_section();
+
+  ByteBuffer& midi = writer.begin_section(project_midi_section);
   {
-    for (Track* track : engine.tracks) {
-      w.write_map(9);
-      w.write_kv_str("name", track->name);
-      w.write_kv_num("col", track->color.to_uint32());
-      w.write_kv_num("height", track->height);
-      w.write_kv_num("vol", track->ui_parameter_state.volume_db);
-      w.write_kv_num("pan", track->ui_parameter_state.pan);
-      w.write_kv_bool("mute", track->ui_parameter_state.mute);
-      w.write_kv_bool("solo", track->ui_parameter_state.solo);
-      w.write_kv_bool("shown", track->shown);
-
-      w.write_kv_array("clips", track->clips.size());
-      for (Clip* clip : track->clips) {
-        w.write_map(8);
-        w.write_kv_num("type", (uint8_t)clip->type);
-        w.write_kv_str("name", clip->name);
-        w.write_kv_num("col", clip->color.to_uint32());
-        w.write_kv_bool("active", clip->is_active());
-        w.write_kv_num("start", clip->min_time);
-        w.write_kv_num("end", clip->max_time);
-        w.write_kv_num("ofs", clip->start_offset);
-
-        switch (clip->type) {
-          case ClipType::Audio:
-            w.write_kv_map("data", 4);
-            w.write_kv_num("asset_id", sample_index_map[clip->audio.asset]);
-            w.write_kv_num("fstart", clip->audio.fade_start);
-            w.write_kv_num("fend", clip->audio.fade_end);
-            w.write_kv_num("gain", clip->audio.gain);
-            break;
-          case ClipType::Midi:
-            w.write_kv_map("data", 3);
-            w.write_kv_num("asset_id", midi_index_map[clip->midi.asset]);
-            w.write_kv_num("trans", clip->midi.transpose);
-            w.write_kv_num("rate", clip->midi.rate);
-            break;
-          default: WB_UNREACHABLE();
-        }
-      }
+    // The note arrays are placed right after the asset records
+    uint64_t note_offset = sizeof(uint32_t) * 2 + snapshot.midi_assets.size() * sizeof(PFMidiAsset);
+    io_write(midi, snapshot.midi_assets.size());
+    io_write(midi, 0u);
+    for (const auto& asset : snapshot.midi_assets) {
+      PFMidiAsset asset_info{
+        .note_offset = note_offset,
+        .note_count = asset.notes->size(),
+        .min_note = asset.min_note,
+        .max_note = asset.max_note,
+      };
+      midi.write(&asset_info, sizeof(PFMidiAsset));
+      note_offset += asset.notes->size() * sizeof(MidiNote);
     }
+    for (const auto& asset : snapshot.midi_assets)
+      midi.write(asset.notes->data(), asset.notes->size() * sizeof(MidiNote));
   }
+  writer.end_section();
 
+  ByteBuffer& clips = writer.begin_section(project_clip_section);
+  io_write(clips, snapshot.clips.size());
+  for (uint32_t i = 0; i < snapshot.clips.size(); i++) {
+    clips.write(&snapshot.clips[i], sizeof(PFClipHeader));
+    io_write(clips, snapshot.clip_names[i]);
+  }
+  writer.end_section();
+
+  ByteBuffer& tracks = writer.begin_section(project_track_section);
+  io_write(tracks, snapshot.tracks.size());
+  for (uint32_t i = 0; i < snapshot.tracks.size(); i++) {
+    tracks.write(&snapshot.tracks[i], sizeof(PFTrackHeader));
+    io_write(tracks, snapshot.track_names[i]);
+  }
+  writer.end_section();
+
+  writer.finalize(project_magic, project_version, dst);
+}
+
+ProjectFileResult write_project_snapshot(const std::filesystem::path& filepath, const ProjectSnapshot& snapshot) {
+  ByteBuffer buffer;
+  encode_project_snapshot(snapshot, buffer);
+  if (!write_file_atomic(filepath, buffer.data(), buffer.position()))
+    return ProjectFileResult::ErrCannotAccessFile;
   return ProjectFileResult::Ok;
 }
 
+ProjectFileResult write_project_file(
+    const std::filesystem::path& filepath,
+    Engine& engine,
+    SampleTable& sample_table,
+    MidiTable& midi_table,
+    TimelineWindow& timeline) {
+  ProjectSnapshot snapshot;
+  capture_project_snapshot(snapshot, nullptr, engine, sample_table, midi_table, timeline);
+  return write_project_snapshot(filepath, snapshot);
+}
+
 }  // namespace wb
\ No newline at end of file
@@ -1,34 +1,54 @@
 #pragma once
 
 #include <filesystem>
+#include <memory>
 #include <unordered_map>
 
 #include "assets_table.h"
+#include "core/byte_buffer.h"
 #include "core/common.h"
 #include "engine.h"
 #include "ui/timeline.h"
 
 namespace wb {
 
-struct alignas(8) PFHeader {
-  uint32_t magic_numbers;
-  uint32_t version;
-  uint32_t track_count;
-  uint32_t sample_count;
-  uint32_t midi_count;
-  uint32_t ppq;
+// Project file sections. Records are stored in little-endian and followed by their variable-sized data (names and
+// strings are prefixed with a uint32_t byte count).
+
+// INFO: PFProjectInfo followed by the author, title, genre and description strings.
+struct alignas(8) PFProjectInfo {
   double initial_bpm;
   double playhead_pos;
   double timeline_view_min;
   double timeline_view_max;
   float main_volume_db;
+  uint32_t reserved;
+};
+
+// TMPO: uint32_t tempo point count followed by PFTempoPoint records, then uint32_t time signature count followed by
+// PFTimeSignature records. Projects without this section have a single tempo, the initial BPM in INFO.
+struct alignas(8) PFTempoPoint {
+  double beat;
+  double bpm;
+  uint32_t ramp;
+  uint32_t reserved;
+};
+
+struct alignas(4) PFTimeSignature {
+  uint32_t bar;
+  uint16_t numerator;
+  uint16_t denominator;
 };
 
-struct PFMidiAsset {
-  double max_length;
-  uint32_t channel_count;
-  uint32_t min_note = 0;
-  uint32_t max_note = 0;
+// SMPL: uint32_t sample count followed by the path, the file size, the content hash (version 2) and the hash of the
+// whole file (version 3) of each sample.
+// MIDI: uint32_t asset count, padding, PFMidiAsset records, then the raw MidiNote arrays referenced by note_offset.
+struct alignas(8) PFMidiAsset {
+  uint64_t note_offset;  // Offset from the start of the section, 8-byte aligned
+  uint32_t note_count;
+  uint32_t min_note;
+  uint32_t max_note;
+  uint32_t reserved;
 };
 
 union alignas(4) PFTrackFlags {
@@ -41,15 +61,16 @@ union alignas(4) PFTrackFlags {
   uint32_t u32;
 };
 
+// TRCK: uint32_t track count followed by PFTrackHeader records and the track names.
 struct alignas(8) PFTrackHeader {
-  uint32_t magic_numbers;
-  uint32_t version;
   PFTrackFlags flags;
-  uint32_t color;  // TODO: Use uint32_t color
+  uint32_t color;
   float view_height;
   float volume_db;
   float pan;
+  uint32_t first_clip;  // Index into the CLIP section
   uint32_t clip_count;
+  uint32_t reserved;
 };
 
 union alignas(4) PFClipFlags {
@@ -64,20 +85,25 @@ union alignas(4) PFClipFlags {
 struct alignas(8) PFAudioClip {
   double fade_start;
   double fade_end;
+  double speed;
   uint32_t asset_index;
   float gain;
 };
 
 struct alignas(8) PFMidiClip {
+  double length;
   uint32_t asset_index;
+  int16_t transpose;
+  int16_t rate;
+  uint32_t mode;
 };
 
+// CLIP: uint32_t clip count followed by PFClipHeader records and the clip names.
 struct alignas(8) PFClipHeader {
-  uint32_t magic_numbers;
-  uint32_t version;
-  ClipType type;
+  uint32_t type;
   PFClipFlags flags;
   uint32_t color;
+  uint32_t reserved;
   double min_time;
   double max_time;
   double start_offset;
@@ -94,14 +120,48 @@ enum class ProjectFileResult {
   ErrEndOfFile,
   ErrIncompatibleVersion,
   ErrInvalidFormat,
+  ErrUnsupportedFeature,
+};
+
+// Sample file reference. The size and the hashes are used to find the file again if it has been moved.
+struct ProjectSampleRef {
+  std::filesystem::path path;
+  uint64_t size;          // 0 if unknown
+  uint64_t content_hash;  // 0 if unknown
+  uint64_t full_hash;     // 0 if unknown
+};
+
+// Copy of the project state that can be written without touching the engine. Note sequences are immutable once
+// captured, unchanged sequences are shared between consecutive snapshots.
+struct ProjectSnapshot {
+  struct MidiAsset {
+    uint64_t version;
+    uint32_t min_note;
+    uint32_t max_note;
+    std::shared_ptr<const MidiNoteBuffer> notes;
+  };
+
+  PFProjectInfo info;
+  ProjectInfo project_info;
+  Vector<PFTempoPoint> tempo_points;
+  Vector<PFTimeSignature> time_signatures;
+  Vector<ProjectSampleRef> samples;
+  Vector<MidiAsset> midi_assets;
+  Vector<PFTrackHeader> tracks;
+  Vector<std::string> track_names;
+  Vector<PFClipHeader> clips;
+  Vector<std::string> clip_names;
 };
 
+// Reads a project file. Projects saved in the legacy msgpack format are imported.
 ProjectFileResult read_project_file(
     const std::filesystem::path& filepath,
     Engine& engine,
     SampleTable& sample_table,
     MidiTable& midi_table,
     TimelineWindow& timeline);
+
+// Writes the project in the chunked project format.
 ProjectFileResult write_project_file(
     const std::filesystem::path& filepath,
     Engine& engine,
@@ -109,4 +169,20 @@ ProjectFileResult write_project_file(
     MidiTable& midi_table,
     TimelineWindow& timeline);
 
+// Captures the project state. The caller must prevent the engine from being modified while capturing. Note sequences
+// that have not changed since the previous snapshot are shared with it, previous can be null.
+void capture_project_snapshot(
+    ProjectSnapshot& snapshot,
+    const ProjectSnapshot* previous,
+    Engine& engine,
+    SampleTable& sample_table,
+    MidiTable& midi_table,
+    TimelineWindow& timeline);
+
+// Encodes the snapshot in the chunked project format. Can be called from any thread.
+void encode_project_snapshot(const ProjectSnapshot& snapshot, ByteBuffer& dst);
+
+// Writes the snapshot into a project file. Can be called from any thread.
+ProjectFileResult write_project_snapshot(const std::filesystem::path& filepath, const ProjectSnapshot& snapshot);
+
 }  // namespace wb
\ No newline at end of file
@@ -0,0 +1,375 @@
+#include "sample_preview.h"
+
+#include <cstring>
+
+#include "core/core_math.h"
+#include "core/debug.h"
+
+namespace fs = std::filesystem;
+
+namespace wb {
+
+enum class PreviewFetchResult {
+  Ok,
+  Underrun,
+  EndOfStream,
+};
+
+static int64_t get_file_mtime(const fs::path& path) {
+  std::error_code ec;
+  auto mtime = fs::last_write_time(path, ec);
+  if (ec)
+    return 0;
+  return (int64_t)mtime.time_since_epoch().count();
+}
+
+// Fetch the next source frame, either from the head or from the ring buffer.
+static PreviewFetchResult fetch_preview_frame(
+    SamplePreviewVoice& voice,
+    uint32_t num_channels,
+    uint64_t ring_available,
+    float* frame) {
+  const SamplePreviewHead& head = *voice.head;
+  if (voice.source_pos < head.num_frames) {
+    std::memcpy(frame, head.data.data() + voice.source_pos * head.channels, num_channels * sizeof(float));
+    voice.source_pos++;
+    return PreviewFetchResult::Ok;
+  }
+
+  uint64_t ring_pos = voice.source_pos - head.num_frames;
+  if (head.complete)
+    return PreviewFetchResult::EndOfStream;
+  if (ring_pos >= ring_available) {
+    if (voice.end_of_stream.load(std::memory_order_acquire) &&
+        ring_pos >= voice.frames_written.load(std::memory_order_acquire))
+      return PreviewFetchResult::EndOfStream;
+    return PreviewFetchResult::Underrun;
+  }
+
+  const float* src = voice.ring.data() + (ring_pos % voice.ring_frames) * head.channels;
+  std::memcpy(frame, src, num_channels * sizeof(float));
+  voice.source_pos++;
+  return PreviewFetchResult::Ok;
+}
+
+static void mix_preview_voice(
+    SamplePreviewVoice& voice,
+    AudioBuffer<float>& output_buffer,
+    double sample_rate,
+    float gain) {
+  const SamplePreviewHead& head = *voice.head;
+  uint32_t num_channels = math::min(head.channels, max_preview_channels);
+  uint64_t ring_available = head.complete ? 0 : voice.frames_written.load(std::memory_order_acquire);
+  double ratio = (double)head.sample_rate / sample_rate;
+
+  if (!voice.primed) {
+    PreviewFetchResult result = fetch_preview_frame(voice, num_channels, ring_available, voice.next_frame);
+    if (result == PreviewFetchResult::EndOfStream)
+      voice.finished.store(true, std::memory_order_relaxed);
+    if (result != PreviewFetchResult::Ok)
+      return;
+    voice.primed = true;
+    voice.frac = 1.0;
+  }
+
+  // Linear interpolation between the previous and the next source frame
+  for (uint32_t i = 0; i < output_buffer.n_samples; i++) {
+    PreviewFetchResult result = PreviewFetchResult::Ok;
+    while (voice.frac >= 1.0) {
+      float frame[max_preview_channels];
+      result = fetch_preview_frame(voice, num_channels, ring_available, frame);
+      if (result != PreviewFetchResult::Ok)
+        break;
+      std::memcpy(voice.prev_frame, voice.next_frame, num_channels * sizeof(float));
+      std::memcpy(voice.next_frame, frame, num_channels * sizeof(float));
+      voice.frac -= 1.0;
+    }
+
+    if (result == PreviewFetchResult::EndOfStream) {
+      voice.finished.store(true, std::memory_order_relaxed);
+      break;
+    } else if (result == PreviewFetchResult::Underrun) {
+      break;
+    }
+
+    float t = (float)voice.frac;
+    for (uint32_t c = 0; c < output_buffer.n_channels; c++) {
+      uint32_t src_channel = c % num_channels;
+      float a = voice.prev_frame[src_channel];
+      float b = voice.next_frame[src_channel];
+      output_buffer.get_write_pointer(c)[i] += (a + (b - a) * t) * gain;
+    }
+    voice.frac += ratio;
+  }
+
+  if (voice.source_pos > head.num_frames)
+    voice.frames_read.store(voice.source_pos - head.num_frames, std::memory_order_release);
+}
+
+SamplePreviewPlayer::~SamplePreviewPlayer() {
+  shutdown();
+}
+
+bool SamplePreviewPlayer::play(const fs::path& path) {
+  int64_t mtime = get_file_mtime(path);
+  auto new_voice = std::make_shared<SamplePreviewVoice>();
+
+  // A cached head lets the voice start right away, the streaming thread opens the file later
+  if (auto head = find_head_(path, mtime)) {
+    new_voice->head = std::move(head);
+  } else {
+    std::unique_ptr<dsp::AudioDecoder> decoder = dsp::open_audio_decoder(path);
+    if (!decoder) {
+      Log::error("Cannot open sample file {}", path.string());
+      return false;
+    }
+    new_voice->head = decode_head_(path, mtime, *decoder);
+    if (!new_voice->head) {
+      Log::error("Cannot decode sample file {}", path.string());
+      return false;
+    }
+    new_voice->decoder = std::move(decoder);
+    insert_head_(new_voice->head);
+  }
+
+  start_voice_(std::move(new_voice));
+  return true;
+}
+
+bool SamplePreviewPlayer::play(const fs::path& path, std::unique_ptr<dsp::AudioDecoder> decoder) {
+  auto new_voice = std::make_shared<SamplePreviewVoice>();
+  new_voice->head = decode_head_(path, get_file_mtime(path), *decoder);
+  if (!new_voice->head)
+    return false;
+  new_voice->decoder = std::move(decoder);
+  insert_head_(new_voice->head);
+  start_voice_(std::move(new_voice));
+  return true;
+}
+
+void SamplePreviewPlayer::stop() {
+  voice_lock.lock();
+  active_voice = nullptr;
+  voice_lock.unlock();
+
+  std::shared_ptr<SamplePreviewVoice> old_voice;
+  {
+    std::lock_guard lock(mtx);
+    old_voice = std::move(voice);
+  }
+}
+
+void SamplePreviewPlayer::prefetch(const fs::path& path) {
+  if (find_head_(path, get_file_mtime(path)))
+    return;
+  std::lock_guard lock(mtx);
+  pending_prefetches.push_back(path);
+  if (!stream_thread.joinable())
+    stream_thread = std::thread([this] { stream_thread_(); });
+  cv.notify_one();
+}
+
+void SamplePreviewPlayer::shutdown() {
+  stop();
+  {
+    std::lock_guard lock(mtx);
+    stop_stream_thread = true;
+    cv.notify_all();
+  }
+  if (stream_thread.joinable())
+    stream_thread.join();
+  stop_stream_thread = false;
+
+  std::lock_guard lock(cache_mtx);
+  head_cache_map.clear();
+  head_cache.clear();
+  head_cache_bytes = 0;
+}
+
+bool SamplePreviewPlayer::is_playing() const {
+  return voice && !voice->finished.load(std::memory_order_relaxed);
+}
+
+void SamplePreviewPlayer::process(AudioBuffer<float>& output_buffer, double sample_rate) {
+  // Never wait here, the UI thread only holds the lock to swap the voice
+  if (!voice_lock.try_lock())
+    return;
+  SamplePreviewVoice* current_voice = active_voice;
+  if (current_voice && !current_voice->finished.load(std::memory_order_relaxed))
+    mix_preview_voice(*current_voice, output_buffer, sample_rate, gain);
+  voice_lock.unlock();
+}
+
+std::shared_ptr<const SamplePreviewHead> SamplePreviewPlayer::find_head_(const fs::path& path, int64_t mtime) {
+  std::lock_guard lock(cache_mtx);
+  auto item = head_cache_map.find(path.native());
+  if (item == head_cache_map.end())
+    return nullptr;
+
+  // The file has changed since the head was decoded
+  if ((*item->second)->mtime != mtime) {
+    head_cache_bytes -= (*item->second)->byte_size();
+    head_cache.erase(item->second);
+    head_cache_map.erase(item);
+    return nullptr;
+  }
+
+  head_cache.splice(head_cache.begin(), head_cache, item->second);
+  return head_cache.front();
+}
+
+void SamplePreviewPlayer::insert_head_(std::shared_ptr<const SamplePreviewHead> head) {
+  std::lock_guard lock(cache_mtx);
+  auto item = head_cache_map.find(head->path.native());
+  if (item != head_cache_map.end()) {
+    head_cache_bytes -= (*item->second)->byte_size();
+    head_cache.erase(item->second);
+    head_cache_map.erase(item);
+  }
+
+  head_cache_bytes += head->byte_size();
+  head_cache.push_front(std::move(head));
+  head_cache_map.emplace(head_cache.front()->path.native(), head_cache.begin());
+
+  // Evict the least recently used heads, voices keep their own reference
+  while (head_cache_bytes > max_head_cache_bytes && head_cache.size() > 1) {
+    const auto& lru = head_cache.back();
+    head_cache_bytes -= lru->byte_size();
+    head_cache_map.erase(lru->path.native());
+    head_cache.pop_back();
+  }
+}
+
+std::shared_ptr<const SamplePreviewHead> SamplePreviewPlayer::decode_head_(
+    const fs::path& path,
+    int64_t mtime,
+    dsp::AudioDecoder& decoder) {
+  if (decoder.channels == 0 || decoder.sample_rate == 0)
+    return nullptr;
+
+  uint32_t max_frames = head_frames;
+  if (decoder.num_frames != 0)
+    max_frames = (uint32_t)math::min((uint64_t)max_frames, decoder.num_frames);
+
+  auto head = std::make_shared<SamplePreviewHead>();
+  head->path = path;
+  head->mtime = mtime;
+  head->channels = decoder.channels;
+  head->sample_rate = decoder.sample_rate;
+  head->data.resize(max_frames * decoder.channels);
+
+  // Compressed decoders may return fewer frames than requested
+  uint32_t num_frames = 0;
+  while (num_frames < max_frames) {
+    size_t num_read = decoder.read_f32(
+        head->data.data() + (size_t)num_frames * decoder.channels, decoder.channels, max_frames - num_frames);
+    if (num_read == 0)
+      break;
+    num_frames += (uint32_t)num_read;
+  }
+  if (num_frames == 0)
+    return nullptr;
+
+  head->num_frames = num_frames;
+  head->complete = num_frames < head_frames || num_frames == decoder.num_frames;
+  head->data.resize(num_frames * decoder.channels);
+  return head;
+}
+
+void SamplePreviewPlayer::start_voice_(std::shared_ptr<SamplePreviewVoice>&& new_voice) {
+  const SamplePreviewHead& head = *new_voice->head;
+  if (!head.complete) {
+    new_voice->ring_frames = math::max(stream_chunk_frames * 2, (uint32_t)(head.sample_rate * ring_duration_sec));
+    new_voice->ring.resize(new_voice->ring_frames * head.channels);
+  } else {
+    new_voice->decoder.reset();
+    new_voice->end_of_stream.store(true, std::memory_order_relaxed);
+  }
+
+  voice_lock.lock();
+  active_voice = new_voice.get();
+  voice_lock.unlock();
+
+  // The previous voice is released outside of the lock, the streaming thread may still hold it for a moment
+  std::shared_ptr<SamplePreviewVoice> old_voice;
+  {
+    std::lock_guard lock(mtx);
+    old_voice = std::move(voice);
+    voice = std::move(new_voice);
+    if (!stream_thread.joinable())
+      stream_thread = std::thread([this] { stream_thread_(); });
+    cv.notify_one();
+  }
+}
+
+void SamplePreviewPlayer::fill_ring_(SamplePreviewVoice& target_voice) {
+  const SamplePreviewHead& head = *target_voice.head;
+  if (!target_voice.decoder) {
+    target_voice.decoder = dsp::open_audio_decoder(head.path);
+    if (!target_voice.decoder || target_voice.decoder->channels != head.channels ||
+        !target_voice.decoder->seek(head.num_frames)) {
+      target_voice.end_of_stream.store(true, std::memory_order_release);
+      return;
+    }
+  }
+
+  while (!target_voice.end_of_stream.load(std::memory_order_relaxed)) {
+    uint64_t frames_written = target_voice.frames_written.load(std::memory_order_relaxed);
+    uint64_t frames_read = target_voice.frames_read.load(std::memory_order_acquire);
+    uint64_t free_frames = target_voice.ring_frames - (frames_written - frames_read);
+    if (free_frames < stream_chunk_frames)
+      break;
+
+    uint32_t offset = (uint32_t)(frames_written % target_voice.ring_frames);
+    uint32_t num_frames = math::min(stream_chunk_frames, target_voice.ring_frames - offset);
+    float* dst = target_voice.ring.data() + (size_t)offset * head.channels;
+    size_t num_read = target_voice.decoder->read_f32(dst, head.channels, num_frames);
+    if (num_read == 0) {
+      target_voice.decoder.reset();
+      target_voice.end_of_stream.store(true, std::memory_order_release);
+      break;
+    }
+    target_voice.frames_written.store(frames_written + num_read, std::memory_order_release);
+  }
+}
+
+void SamplePreviewPlayer::stream_thread_() {
+#ifndef NDEBUG
+  set_current_thread_name("Whitebox Preview Streamer");
+#endif
+
+  for (;;) {
+    std::shared_ptr<SamplePreviewVoice> current_voice;
+    Vector<fs::path> prefetches;
+    {
+      std::unique_lock lock(mtx);
+      auto has_work = [this] {
+        return stop_stream_thread || !pending_prefetches.empty() ||
+               (voice && !voice->end_of_stream.load(std::memory_order_relaxed));
+      };
+      // While streaming, the ring buffer is topped up periodically
+      if (voice && !voice->end_of_stream.load(std::memory_order_relaxed))
+        cv.wait_for(lock, std::chrono::milliseconds(5));
+      else
+        cv.wait(lock, has_work);
+      if (stop_stream_thread)
+        break;
+      current_voice = voice;
+      prefetches = std::move(pending_prefetches);
+    }
+
+    if (current_voice && !current_voice->end_of_stream.load(std::memory_order_relaxed))
+      fill_ring_(*current_voice);
+
+    for (const auto& path : prefetches) {
+      int64_t mtime = get_file_mtime(path);
+      if (find_head_(path, mtime))
+        continue;
+      if (std::unique_ptr<dsp::AudioDecoder> decoder = dsp::open_audio_decoder(path))
+        if (auto head = decode_head_(path, mtime, *decoder))
+          insert_head_(std::move(head));
+    }
+  }
+}
+
+}  // namespace wb
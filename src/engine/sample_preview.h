@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "core/audio_buffer.h"
+#include "core/common.h"
+#include "core/thread.h"
+#include "core/vector.h"
+#include "dsp/codec.h"
+
+namespace wb {
+
+static constexpr uint32_t max_preview_channels = 8;
+
+// The first frames of a sample, decoded ahead of time so playback can start without waiting for the disk.
+struct SamplePreviewHead {
+  std::filesystem::path path;
+  int64_t mtime;
+  uint32_t channels;
+  uint32_t sample_rate;
+  uint32_t num_frames;  // Number of frames in data
+  bool complete;        // The whole sample fits in the head
+  Vector<float> data;   // Interleaved
+
+  inline size_t byte_size() const {
+    return data.size() * sizeof(float);
+  }
+};
+
+struct SamplePreviewVoice {
+  std::shared_ptr<const SamplePreviewHead> head;
+  std::unique_ptr<dsp::AudioDecoder> decoder;  // Owned by the streaming thread
+  Vector<float> ring;                          // Interleaved frames that follow the head
+  uint32_t ring_frames = 0;
+  alignas(64) std::atomic_uint64_t frames_written;  // Written by the streaming thread
+  alignas(64) std::atomic_uint64_t frames_read;     // Written by the audio thread
+  std::atomic_bool end_of_stream;
+  std::atomic_bool finished;
+
+  // Audio thread state
+  uint64_t source_pos = 0;
+  double frac = 1.0;
+  bool primed = false;
+  float prev_frame[max_preview_channels]{};
+  float next_frame[max_preview_channels]{};
+};
+
+// Plays a sample file straight from disk for auditioning in the browser. The head of the file is decoded on the
+// calling thread (or taken from an LRU cache), so playback starts on the next audio block. The rest of the file is
+// decoded by a streaming thread into a ring buffer, the audio thread mixes and resamples the voice into the output.
+struct SamplePreviewPlayer {
+  static constexpr uint32_t head_frames = 16384;
+  static constexpr uint32_t stream_chunk_frames = 4096;
+  static constexpr double ring_duration_sec = 2.0;
+
+  Spinlock voice_lock;                           // Guards active_voice, held by the audio thread while mixing
+  SamplePreviewVoice* active_voice = nullptr;    // Read by the audio thread
+  std::shared_ptr<SamplePreviewVoice> voice;     // Current voice, shared with the streaming thread
+  float gain = 1.0f;
+
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::thread stream_thread;
+  Vector<std::filesystem::path> pending_prefetches;
+  bool stop_stream_thread = false;
+
+  std::mutex cache_mtx;
+  std::list<std::shared_ptr<const SamplePreviewHead>> head_cache;  // Most recently used first
+  std::unordered_map<std::filesystem::path::string_type, decltype(head_cache)::iterator> head_cache_map;
+  size_t head_cache_bytes = 0;
+  size_t max_head_cache_bytes = 16 << 20;
+
+  SamplePreviewPlayer() = default;
+  SamplePreviewPlayer(const SamplePreviewPlayer&) = delete;
+  ~SamplePreviewPlayer();
+
+  /**
+   * @brief Start previewing a sample file. The previous preview is stopped.
+   *
+   * @param path Sample file path.
+   * @return True if the file can be decoded.
+   */
+  bool play(const std::filesystem::path& path);
+
+  /**
+   * @brief Start previewing from a decoder. The decoder must be positioned at the first frame.
+   *
+   * @param path Sample path, used as the head cache key.
+   * @param decoder Opened decoder.
+   */
+  bool play(const std::filesystem::path& path, std::unique_ptr<dsp::AudioDecoder> decoder);
+
+  // Stop the preview immediately.
+  void stop();
+
+  // Decode the head of a file in the background, so a later play() can start without touching the disk.
+  void prefetch(const std::filesystem::path& path);
+
+  void shutdown();
+
+  bool is_playing() const;
+
+  /**
+   * @brief Mix the preview voice into the output buffer. Called from the audio thread.
+   *
+   * @param output_buffer Output buffer.
+   * @param sample_rate Device sample rate.
+   */
+  void process(AudioBuffer<float>& output_buffer, double sample_rate);
+
+  std::shared_ptr<const SamplePreviewHead> find_head_(const std::filesystem::path& path, int64_t mtime);
+  void insert_head_(std::shared_ptr<const SamplePreviewHead> head);
+  std::shared_ptr<const SamplePreviewHead> decode_head_(
+      const std::filesystem::path& path,
+      int64_t mtime,
+      dsp::AudioDecoder& decoder);
+  void start_voice_(std::shared_ptr<SamplePreviewVoice>&& new_voice);
+  void fill_ring_(SamplePreviewVoice& target_voice);
+  void stream_thread_();
+};
+
+}  // namespace wb
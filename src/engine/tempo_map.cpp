@@ -0,0 +1,221 @@
+#include "tempo_map.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace wb {
+
+TempoMap::TempoMap() {
+  reset();
+}
+
+bool TempoMap::set_initial_tempo(double bpm) {
+  if (!is_valid_bpm(bpm))
+    return false;
+  tempo_points[0].bpm = math::clamp(bpm, min_bpm, max_bpm);
+  update_segments_();
+  return true;
+}
+
+bool TempoMap::add_tempo_point(double beat, double bpm, bool ramp) {
+  if (!is_valid_bpm(bpm) || !std::isfinite(beat))
+    return false;
+  bpm = math::clamp(bpm, min_bpm, max_bpm);
+  beat = math::max(beat, 0.0);
+  auto it = std::lower_bound(tempo_points.begin(), tempo_points.end(), beat, [](const TempoPoint& point, double beat) {
+    return point.beat < beat;
+  });
+  if (it != tempo_points.end() && it->beat == beat) {
+    it->bpm = bpm;
+    it->ramp = ramp;
+  } else {
+    tempo_points.emplace(it, TempoPoint{ .beat = beat, .bpm = bpm, .ramp = ramp });
+  }
+  update_segments_();
+  return true;
+}
+
+void TempoMap::remove_tempo_point(uint32_t index) {
+  // The first point defines the initial tempo and cannot be removed
+  if (index == 0 || index >= tempo_points.size())
+    return;
+  tempo_points.erase_at(index);
+  update_segments_();
+}
+
+bool TempoMap::add_time_signature(uint32_t bar, uint16_t numerator, uint16_t denominator) {
+  if (numerator == 0 || denominator == 0)
+    return false;
+  auto it = std::lower_bound(
+      time_signatures.begin(), time_signatures.end(), bar, [](const TimeSignature& sig, uint32_t bar) {
+        return sig.bar < bar;
+      });
+  if (it != time_signatures.end() && it->bar == bar) {
+    it->numerator = numerator;
+    it->denominator = denominator;
+  } else {
+    time_signatures.emplace(it, TimeSignature{ .bar = bar, .numerator = numerator, .denominator = denominator });
+  }
+  update_segments_();
+  return true;
+}
+
+void TempoMap::remove_time_signature(uint32_t index) {
+  if (index == 0 || index >= time_signatures.size())
+    return;
+  time_signatures.erase_at(index);
+  update_segments_();
+}
+
+void TempoMap::reset() {
+  tempo_points.resize(0);
+  tempo_points.push_back({ .beat = 0.0, .bpm = default_bpm, .ramp = false });
+  time_signatures.resize(0);
+  time_signatures.push_back({ .bar = 0, .numerator = 4, .denominator = 4 });
+  update_segments_();
+}
+
+double TempoMap::beat_to_time(double beat) const {
+  return segment_beat_to_time(segments[find_segment(beat)], beat);
+}
+
+double TempoMap::time_to_beat(double time) const {
+  return segment_time_to_beat(segments[find_segment_by_time(time)], time);
+}
+
+double TempoMap::get_bpm_at(double beat) const {
+  const TempoSegment& segment = segments[find_segment(beat)];
+  return segment.bpm + segment.bpm_slope * math::max(beat - segment.start_beat, 0.0);
+}
+
+BarPosition TempoMap::beat_to_bar(double beat) const {
+  if (beat < 0.0)
+    return { 0, beat };
+  const TimeSignatureSegment& segment = signature_segments[find_signature_segment(beat)];
+  double num_bars = std::floor((beat - segment.start_beat) / segment.beats_per_bar);
+  return {
+    .bar = segment.start_bar + (uint32_t)num_bars,
+    .beat = beat - segment.start_beat - num_bars * segment.beats_per_bar,
+  };
+}
+
+double TempoMap::bar_to_beat(uint32_t bar) const {
+  auto it = std::upper_bound(
+      signature_segments.begin(), signature_segments.end(), bar, [](uint32_t bar, const TimeSignatureSegment& segment) {
+        return bar < segment.start_bar;
+      });
+  const TimeSignatureSegment& segment = *(it - 1);
+  return segment.start_beat + (double)(bar - segment.start_bar) * segment.beats_per_bar;
+}
+
+uint32_t TempoMap::find_segment(double beat) const {
+  auto it = std::upper_bound(segments.begin(), segments.end(), beat, [](double beat, const TempoSegment& segment) {
+    return beat < segment.start_beat;
+  });
+  return it == segments.begin() ? 0 : (uint32_t)(it - segments.begin()) - 1;
+}
+
+uint32_t TempoMap::find_segment_by_time(double time) const {
+  auto it = std::upper_bound(segments.begin(), segments.end(), time, [](double time, const TempoSegment& segment) {
+    return time < segment.start_time;
+  });
+  return it == segments.begin() ? 0 : (uint32_t)(it - segments.begin()) - 1;
+}
+
+uint32_t TempoMap::find_signature_segment(double beat) const {
+  auto it = std::upper_bound(
+      signature_segments.begin(), signature_segments.end(), beat, [](double beat, const TimeSignatureSegment& segment) {
+        return beat < segment.start_beat;
+      });
+  return it == signature_segments.begin() ? 0 : (uint32_t)(it - signature_segments.begin()) - 1;
+}
+
+void TempoMap::update_segments_() {
+  segments.resize(tempo_points.size());
+  double time = 0.0;
+  for (uint32_t i = 0; i < tempo_points.size(); i++) {
+    const TempoPoint& point = tempo_points[i];
+    TempoSegment& segment = segments[i];
+    segment.start_beat = point.beat;
+    segment.start_time = time;
+    segment.bpm = point.bpm;
+    segment.bpm_slope = 0.0;
+    if (i + 1 < tempo_points.size()) {
+      const TempoPoint& next = tempo_points[i + 1];
+      if (point.ramp)
+        segment.bpm_slope = (next.bpm - point.bpm) / (next.beat - point.beat);
+      time = segment_beat_to_time(segment, next.beat);
+    }
+  }
+
+  signature_segments.resize(time_signatures.size());
+  double beat = 0.0;
+  for (uint32_t i = 0; i < time_signatures.size(); i++) {
+    const TimeSignature& sig = time_signatures[i];
+    TimeSignatureSegment& segment = signature_segments[i];
+    if (i > 0) {
+      const TimeSignatureSegment& prev = signature_segments[i - 1];
+      beat = prev.start_beat + (double)(sig.bar - prev.start_bar) * prev.beats_per_bar;
+    }
+    segment.start_beat = beat;
+    segment.start_bar = sig.bar;
+    segment.numerator = sig.numerator;
+    segment.denominator = sig.denominator;
+    segment.beats_per_bar = (double)sig.numerator * 4.0 / (double)sig.denominator;
+  }
+}
+
+// With the tempo bpm0 + k * x after x beats, the time is the integral of 60 / tempo:
+//   t(x) = 60 / k * ln(1 + k * x / bpm0)
+//   x(t) = bpm0 / k * (exp(k * t / 60) - 1)
+double segment_beat_to_time(const TempoSegment& segment, double beat) {
+  double x = beat - segment.start_beat;
+  if (segment.bpm_slope == 0.0 || x <= 0.0)
+    return segment.start_time + x * 60.0 / segment.bpm;
+  double k = segment.bpm_slope;
+  return segment.start_time + 60.0 / k * std::log1p(k * x / segment.bpm);
+}
+
+double segment_time_to_beat(const TempoSegment& segment, double time) {
+  double t = time - segment.start_time;
+  if (segment.bpm_slope == 0.0 || t <= 0.0)
+    return segment.start_beat + t * segment.bpm / 60.0;
+  double k = segment.bpm_slope;
+  return segment.start_beat + segment.bpm / k * std::expm1(k * t / 60.0);
+}
+
+void TempoCursor::begin_block(const TempoMap* tempo_map, double start_beat, double rate) {
+  if (map != tempo_map || segment >= tempo_map->segments.size())
+    segment = 0;
+  map = tempo_map;
+  sample_rate = rate;
+  block_start_time = beat_to_time(start_beat);
+}
+
+double TempoCursor::beat_to_time(double beat) {
+  const Vector<TempoSegment>& segments = map->segments;
+  uint32_t last = segments.size() - 1;
+  if (beat < segments[segment].start_beat || (segment < last && beat >= segments[segment + 1].start_beat)) {
+    if (segment < last && beat >= segments[segment + 1].start_beat &&
+        (segment + 1 == last || beat < segments[segment + 2].start_beat))
+      segment++;
+    else
+      segment = map->find_segment(beat);
+  }
+  return segment_beat_to_time(segments[segment], beat);
+}
+
+double TempoCursor::time_to_beat(double time) {
+  const Vector<TempoSegment>& segments = map->segments;
+  uint32_t last = segments.size() - 1;
+  if (time < segments[segment].start_time || (segment < last && time >= segments[segment + 1].start_time)) {
+    if (segment < last && time >= segments[segment + 1].start_time &&
+        (segment + 1 == last || time < segments[segment + 2].start_time))
+      segment++;
+    else
+      segment = map->find_segment_by_time(time);
+  }
+  return segment_time_to_beat(segments[segment], time);
+}
+
+}  // namespace wb
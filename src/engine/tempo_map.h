@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cmath>
+
+#include "core/common.h"
+#include "core/vector.h"
+
+namespace wb {
+
+struct TempoPoint {
+  double beat;
+  double bpm;
+  bool ramp;  // The tempo changes linearly until the next point instead of jumping there
+};
+
+struct TimeSignature {
+  uint32_t bar;
+  uint16_t numerator;
+  uint16_t denominator;
+};
+
+// Precomputed span between two tempo points. The tempo is bpm + bpm_slope * (beat - start_beat) inside the segment,
+// the last segment keeps its tempo forever.
+struct TempoSegment {
+  double start_beat;
+  double start_time;  // Cumulative time in seconds at start_beat
+  double bpm;
+  double bpm_slope;   // BPM per beat, 0 for a constant tempo
+};
+
+struct TimeSignatureSegment {
+  double start_beat;
+  uint32_t start_bar;
+  uint16_t numerator;
+  uint16_t denominator;
+  double beats_per_bar;  // Beats are quarter notes
+};
+
+struct BarPosition {
+  uint32_t bar;
+  double beat;  // Beats since the start of the bar
+};
+
+// Tempo and time signature changes of the project. Beats and seconds are converted in O(log n) by searching the
+// precomputed segments, tempo ramps are integrated analytically. Edited on the UI thread while holding the engine's
+// editor lock, the audio thread reads it through TempoCursor.
+struct TempoMap {
+  static constexpr double default_bpm = 120.0;
+  static constexpr double min_bpm = 1.0;
+  static constexpr double max_bpm = 999.0;
+
+  Vector<TempoPoint> tempo_points;        // Sorted by beat, the first point is at beat 0
+  Vector<TimeSignature> time_signatures;  // Sorted by bar, the first one is at bar 0
+  Vector<TempoSegment> segments;
+  Vector<TimeSignatureSegment> signature_segments;
+
+  TempoMap();
+
+  // Replace the tempo of the first point. Projects with a single tempo only have that point.
+  bool set_initial_tempo(double bpm);
+
+  /**
+   * @brief Add a tempo change, or replace the change at the same beat.
+   *
+   * @param beat Position of the change.
+   * @param bpm New tempo, clamped to [min_bpm, max_bpm].
+   * @param ramp Change the tempo linearly until the next point.
+   * @return false if the tempo is not a positive number, the map is left unchanged.
+   */
+  bool add_tempo_point(double beat, double bpm, bool ramp = false);
+  void remove_tempo_point(uint32_t index);
+
+  // Add a time signature change, or replace the change at the same bar. Returns false and leaves the map unchanged if
+  // the numerator or the denominator is zero.
+  bool add_time_signature(uint32_t bar, uint16_t numerator, uint16_t denominator);
+  void remove_time_signature(uint32_t index);
+
+  void reset();
+
+  double beat_to_time(double beat) const;
+  double time_to_beat(double time) const;
+  double get_bpm_at(double beat) const;
+  BarPosition beat_to_bar(double beat) const;
+  double bar_to_beat(uint32_t bar) const;
+
+  inline double beat_to_samples(double beat, double sample_rate) const {
+    return beat_to_time(beat) * sample_rate;
+  }
+
+  inline double samples_to_beat(double samples, double sample_rate) const {
+    return time_to_beat(samples / sample_rate);
+  }
+
+  // Zero, negative and non-finite tempos would make the segment conversions divide by zero or produce NaN
+  static inline bool is_valid_bpm(double bpm) {
+    return std::isfinite(bpm) && bpm > 0.0;
+  }
+
+  inline double get_initial_bpm() const {
+    return tempo_points[0].bpm;
+  }
+
+  uint32_t find_segment(double beat) const;
+  uint32_t find_segment_by_time(double time) const;
+  uint32_t find_signature_segment(double beat) const;
+  void update_segments_();
+};
+
+/**
+ * @brief Convert a position inside a segment.
+ */
+double segment_beat_to_time(const TempoSegment& segment, double beat);
+double segment_time_to_beat(const TempoSegment& segment, double time);
+
+// Cached lookup for the audio thread. Positions inside an audio block are close together, so the segment of the
+// previous lookup and its neighbour are tried before searching the whole map.
+struct TempoCursor {
+  const TempoMap* map = nullptr;
+  double sample_rate = 0.0;
+  double block_start_time = 0.0;
+  uint32_t segment = 0;
+
+  /**
+   * @brief Start converting positions of a new audio block.
+   *
+   * @param tempo_map Tempo map, must not change until the block has been processed.
+   * @param start_beat Position of the first sample of the block.
+   * @param rate Output sample rate.
+   */
+  void begin_block(const TempoMap* tempo_map, double start_beat, double rate);
+
+  double beat_to_time(double beat);
+  double time_to_beat(double time);
+
+  // Number of samples from the start of the block to beat, negative before the block
+  inline double samples_from_start(double beat) {
+    return (beat_to_time(beat) - block_start_time) * sample_rate;
+  }
+
+  inline double samples_between(double from_beat, double to_beat) {
+    return (beat_to_time(to_beat) - beat_to_time(from_beat)) * sample_rate;
+  }
+
+  inline double get_bpm_at(double beat) {
+    beat_to_time(beat);
+    const TempoSegment& seg = map->segments[segment];
+    return seg.bpm + seg.bpm_slope * (beat - seg.start_beat);
+  }
+};
+
+}  // namespace wb
@@ -4,11 +4,14 @@
 
 #include "assets_table.h"
 #include "clip_edit.h"
+#include "clip_render.h"
 #include "core/core_math.h"
 #include "core/debug.h"
 #include "core/panning_law.h"
 #include "core/queue.h"
+#include "core/rt_log.h"
 #include "dsp/dsp_ops.h"
+#include "gfx/waveform_visual.h"
 #include "plughost/plugin_manager.h"
 
 #ifndef _NDEBUG
@@ -21,6 +24,7 @@
 namespace wb {
 Track::Track() {
   track_msg_queue.set_capacity(64);
+  reserve_event_buffers();
   set_volume(0.0f);
   set_pan(0.0f);
   set_mute(false);
@@ -32,6 +36,7 @@ Track::Track(const std::string& name, const Color& color, float height, bool sho
       height(height),
       shown(shown) {
   track_msg_queue.set_capacity(64);
+  reserve_event_buffers();
   set_volume(track_param.volume_db);
   set_pan(track_param.pan);
   set_mute(track_param.mute);
@@ -42,6 +47,8 @@ Track::~Track() {
     clip->~Clip();
     clip_allocator.free(clip);
   }
+  if (recorded_peaks)
+    delete recorded_peaks;
 }
 
 void Track::set_volume(float db) {
@@ -156,27 +163,134 @@ std::optional<ClipQueryResult> Track::query_clip_by_range(double min, double max
   };
 }
 
+void Track::insert_clip(Clip* clip) {
+  auto it = std::upper_bound(clips.begin(), clips.end(), clip->min_time, [](double time_pos, const Clip* clip) {
+    return time_pos < clip->min_time;
+  });
+  uint32_t idx = (uint32_t)(it - clips.begin());
+  clips.emplace_at(idx, clip);
+  for (uint32_t i = idx; i < (uint32_t)clips.size(); i++) {
+    clips[i]->id = i;
+  }
+  update_content_end_();
+}
+
 void Track::update_clip_ordering() {
-  Vector<Clip*> new_cliplist;
-  if (has_deleted_clips) {
-    for (auto clip : clips) {
-      if (clip->is_deleted()) {
-        deleted_clips.push_back(clip);
-        continue;
-      }
-      new_cliplist.push_back(clip);
-    }
-    has_deleted_clips = false;
-    clips = std::move(new_cliplist);
-    for (auto clip : deleted_clips) {
+  uint32_t num_clips = (uint32_t)clips.size();
+  uint32_t num_kept = 0;
+  uint32_t first_changed = num_clips;
+  Clip* last_kept = nullptr;
+
+  // Compact the list in place, dropping deleted clips and pulling out clips that break the ordering. Edits only touch
+  // a few clips, so the remaining list is still sorted and only the displaced clips have to be sorted.
+  unordered_clips.resize(0);
+  for (uint32_t i = 0; i < num_clips; i++) {
+    Clip* clip = clips[i];
+    if (has_deleted_clips && clip->is_deleted()) {
       destroy_clip(clip);
+      first_changed = math::min(first_changed, num_kept);
+      continue;
+    }
+    // A clip moved forward stays in place but is larger than its successors, take it out before it pushes them out.
+    bool displaced = (last_kept && clip->min_time < last_kept->min_time) ||
+                     (i + 1 < num_clips && clip->min_time > clips[i + 1]->min_time);
+    if (displaced) {
+      unordered_clips.push_back(clip);
+      first_changed = math::min(first_changed, num_kept);
+      continue;
     }
-    deleted_clips.resize(0);
+    if (clip->id != num_kept)
+      first_changed = math::min(first_changed, num_kept);
+    clips[num_kept++] = clip;
+    last_kept = clip;
   }
-  std::sort(clips.begin(), clips.end(), [](const Clip* a, const Clip* b) { return a->min_time < b->min_time; });
-  for (uint32_t i = 0; i < (uint32_t)clips.size(); i++) {
+  has_deleted_clips = false;
+
+  // Merge the displaced clips back from the end so the list does not need a temporary copy
+  uint32_t num_unordered = (uint32_t)unordered_clips.size();
+  uint32_t new_size = num_kept + num_unordered;
+  if (num_unordered > 0) {
+    std::sort(unordered_clips.begin(), unordered_clips.end(), [](const Clip* a, const Clip* b) {
+      return a->min_time < b->min_time;
+    });
+    int32_t kept_idx = (int32_t)num_kept - 1;
+    int32_t unordered_idx = (int32_t)num_unordered - 1;
+    int32_t write_idx = (int32_t)new_size - 1;
+    while (unordered_idx >= 0) {
+      if (kept_idx >= 0 && clips[kept_idx]->min_time > unordered_clips[unordered_idx]->min_time) {
+        clips[write_idx--] = clips[kept_idx--];
+      } else {
+        clips[write_idx--] = unordered_clips[unordered_idx--];
+      }
+    }
+    first_changed = math::min(first_changed, (uint32_t)(write_idx + 1));
+  }
+
+  clips.resize(new_size);
+  for (uint32_t i = first_changed; i < new_size; i++) {
     clips[i]->id = i;
   }
+  update_content_end_();
+}
+
+void Track::set_song_length(SongLength* aggregate) {
+  song_length = aggregate;
+  update_content_end_();
+  if (song_length)
+    song_length->update(content_end, content_end);
+}
+
+void Track::update_content_end_() {
+  // Clips do not overlap, so the last clip in the ordered list is also the one that ends last
+  double old_end = content_end;
+  content_end = clips.empty() ? SongLength::empty_track_length : clips.back()->max_time;
+  if (song_length)
+    song_length->update(old_end, content_end);
+}
+
+void Track::invalidate_playback_table() {
+  assert((!editor_lock || editor_lock->is_locked()) && "Playback table must be edited while holding the editor lock");
+  playback_table.reserve((uint32_t)clips.size());
+  // Compressed samples are decoded through the sampler's block cache, which must exist before the audio thread
+  // plays one
+  if (!sampler.has_block_cache()) {
+    for (Clip* clip : clips) {
+      if (clip->is_audio() && clip->audio.asset && clip->audio.asset->content->sample_instance.is_compressed()) {
+        sampler.allocate_block_cache();
+        break;
+      }
+    }
+  }
+  playback_table_dirty.store(true, std::memory_order_release);
+}
+
+void Track::update_playback_table() {
+  uint32_t num_clips = (uint32_t)clips.size();
+  ClipPlaybackTable& table = playback_table;
+  table.resize(num_clips);
+  for (uint32_t i = 0; i < num_clips; i++) {
+    Clip* clip = clips[i];
+    table.min_time[i] = clip->min_time;
+    table.max_time[i] = clip->max_time;
+    table.start_offset[i] = clip->start_offset;
+    table.clip[i] = clip;
+    if (clip->is_audio()) {
+      table.speed[i] = clip->audio.speed;
+      table.gain[i] = clip->audio.gain;
+      table.sample[i] = &clip->audio.asset->content->sample_instance;
+    } else {
+      table.speed[i] = 1.0;
+      table.gain[i] = 1.0f;
+      table.sample[i] = nullptr;
+    }
+  }
+
+  // Pick up gain changes of the sample that is currently playing
+  if (current_audio_event.type == EventType::PlaySample && event_state.clip_idx) {
+    uint32_t idx = *event_state.clip_idx;
+    if (idx < num_clips && table.clip[idx] == current_audio_event.clip)
+      current_audio_event.gain = table.gain[idx];
+  }
 }
 
 std::optional<uint32_t> Track::find_next_clip(double time_pos, uint32_t hint) {
@@ -217,7 +331,15 @@ void Track::prepare_effect_buffer(uint32_t num_channels, uint32_t num_samples) {
   effect_buffer.resize_channel(num_channels);
 }
 
+void Track::reserve_event_buffers() {
+  audio_event_buffer.reserve(max_audio_events_per_block);
+  midi_event_list.events.reserve(max_midi_events_per_block);
+  param_queue.values.reserve(max_param_changes_per_block);
+  event_bus.reserve(max_midi_events_per_block);
+}
+
 void Track::reset_playback_state(double time_pos, bool refresh_voices) {
+  invalidate_playback_table();
   if (!refresh_voices) {
     std::optional<uint32_t> next_clip = find_next_clip(time_pos);
     event_state.current_clip_idx.reset();
@@ -225,7 +347,6 @@ void Track::reset_playback_state(double time_pos, bool refresh_voices) {
     event_state.clip_idx = next_clip;
     event_state.midi_note_idx = 0;
     event_state.partially_ended = false;
-    midi_voice_state.voice_mask = 0;
     midi_voice_state.release_all();
   }
   event_state.refresh_voice = refresh_voices;
@@ -251,23 +372,28 @@ void Track::stop() {
   };
   audio_event_buffer.resize(0);
   midi_event_list.clear();
+  event_bus.clear();
   stop_record();
-  // midi_voice_state.voice_mask = 0;
 }
 
 void Track::process_event(
     double start_time,
     double end_time,
     double sample_position,
-    double beat_duration,
+    TempoCursor& tempo,
     double buffer_duration,
     double sample_rate,
     double ppq,
     double inv_ppq,
     uint32_t buffer_size) {
-  if (clips.size() == 0) {
+  if (playback_table_dirty.exchange(false, std::memory_order_acquire)) [[unlikely]]
+    update_playback_table();
+
+  const ClipPlaybackTable& table = playback_table;
+  uint32_t num_clips = table.size();
+  if (num_clips == 0) {
     if (event_state.refresh_voice) {
-      audio_event_buffer.push_back({
+      event_bus.push_audio(EventSource::Clip, {
         .type = EventType::StopSample,
         .buffer_offset = 0,
         .time = start_time,
@@ -283,7 +409,6 @@ void Track::process_event(
     return;
   }
 
-  uint32_t num_clips = (uint32_t)clips.size();
   if (event_state.refresh_voice) [[unlikely]] {
     std::optional<uint32_t> clip_at_playhead = find_next_clip(start_time);
     // TODO: Skip if refreshing the same clip
@@ -291,11 +416,13 @@ void Track::process_event(
       if (event_state.clip_idx) {
         uint32_t idx = *event_state.clip_idx;
         if (idx < num_clips) {
-          Clip* clip = clips[*clip_at_playhead];
-          Clip* current_clip = clips[idx];
-          if (clip != current_clip && start_time >= clip->min_time && start_time <= clip->max_time) {
-            if (clip->is_audio()) {
-              audio_event_buffer.push_back({
+          uint32_t clip_idx = *clip_at_playhead;
+          double clip_min_time = table.min_time[clip_idx];
+          double clip_max_time = table.max_time[clip_idx];
+          bool clip_is_audio = table.sample[clip_idx] != nullptr;
+          if (clip_idx != idx && start_time >= clip_min_time && start_time <= clip_max_time) {
+            if (clip_is_audio) {
+              event_bus.push_audio(EventSource::Clip, {
                 .type = EventType::StopSample,
                 .buffer_offset = 0,
                 .time = start_time,
@@ -306,9 +433,9 @@ void Track::process_event(
             event_state.clip_idx = *clip_at_playhead;
             event_state.midi_note_idx = 0;
             event_state.partially_ended = false;
-          } else if (clip == current_clip && (start_time < clip->min_time || start_time > clip->max_time)) {
-            if (clip->is_audio()) {
-              audio_event_buffer.push_back({
+          } else if (clip_idx == idx && (start_time < clip_min_time || start_time > clip_max_time)) {
+            if (clip_is_audio) {
+              event_bus.push_audio(EventSource::Clip, {
                 .type = EventType::StopSample,
                 .buffer_offset = 0,
                 .time = start_time,
@@ -326,7 +453,7 @@ void Track::process_event(
         event_state.midi_note_idx = 0;
       }
     } else {
-      audio_event_buffer.push_back({
+      event_bus.push_audio(EventSource::Clip, {
         .type = EventType::StopSample,
         .buffer_offset = 0,
         .time = start_time,
@@ -346,73 +473,79 @@ void Track::process_event(
 
   uint32_t next_clip = *event_state.clip_idx;
   while (next_clip < num_clips) {
-    Clip* clip = clips[next_clip];
-    double min_time = clip->min_time;
-    double max_time = clip->max_time;
+    double min_time = table.min_time[next_clip];
+    double max_time = table.max_time[next_clip];
 
     if (min_time > end_time)
       break;
 
-    bool is_audio = clip->is_audio();
+    Clip* clip = table.clip[next_clip];
+    Sample* sample = table.sample[next_clip];
+    double start_offset = table.start_offset[next_clip];
+    double speed = table.speed[next_clip];
+    bool is_audio = sample != nullptr;
     if (min_time >= start_time) {  // Started from beginning
       if (is_audio) {
-        double offset_from_start = beat_to_samples(min_time - start_time, sample_rate, beat_duration);
+        double offset_from_start = tempo.samples_from_start(min_time);
         double sample_offset = sample_position + offset_from_start;
         uint32_t buffer_offset = (uint32_t)((uint64_t)sample_offset % (uint64_t)buffer_size);
-        audio_event_buffer.push_back({
+        event_bus.push_audio(EventSource::Clip, {
           .type = EventType::PlaySample,
           .buffer_offset = buffer_offset,
           .time = min_time,
-          .speed = clip->audio.speed,
-          .sample_offset = (size_t)clip->start_offset,
+          .speed = speed,
+          .sample_offset = (size_t)start_offset,
+          .gain = table.gain[next_clip],
           .clip = clip,
-          .sample = &clip->audio.asset->sample_instance,
+          .sample = sample,
         });
       } else {
-        event_state.midi_note_idx = clip->midi.asset->find_first_note(clip->start_offset, 0);
+        event_state.midi_note_idx = clip->midi.asset->find_first_note(start_offset, 0);
       }
       clip->internal_state_changed = false;
     } else if (start_time > min_time && !event_state.partially_ended) {  // Partially started (started in the middle)
       double relative_start_time = start_time - min_time;
       if (is_audio) {
-        double sample_pos = beat_to_samples(relative_start_time, sample_rate, beat_duration);
-        size_t sample_offset = (size_t)(clip->start_offset + (sample_pos * clip->audio.speed));
-        audio_event_buffer.push_back({
+        double sample_pos = tempo.samples_between(min_time, start_time);
+        size_t sample_offset = (size_t)(start_offset + (sample_pos * speed));
+        event_bus.push_audio(EventSource::Clip, {
           .type = EventType::PlaySample,
           .buffer_offset = 0,
           .time = start_time,
-          .speed = clip->audio.speed,
+          .speed = speed,
           .sample_offset = sample_offset,
+          .gain = table.gain[next_clip],
           .clip = clip,
-          .sample = &clip->audio.asset->sample_instance,
+          .sample = sample,
         });
       } else {
-        double actual_start_offset = relative_start_time + clip->start_offset;
+        double actual_start_offset = relative_start_time + start_offset;
         event_state.midi_note_idx = clip->midi.asset->find_first_note(actual_start_offset, 0);
       }
       clip->internal_state_changed = false;
     } else if (clip->internal_state_changed && event_state.partially_ended) {
       double relative_start_time = start_time - min_time;
       if (is_audio) {
-        double sample_pos = beat_to_samples(relative_start_time, sample_rate, beat_duration);
-        size_t sample_offset = (size_t)(clip->start_offset + (sample_pos * clip->audio.speed));
-        audio_event_buffer.push_back({
+        double sample_pos = tempo.samples_between(min_time, start_time);
+        size_t sample_offset = (size_t)(start_offset + (sample_pos * speed));
+        event_bus.push_audio(EventSource::Clip, {
           .type = EventType::StopSample,
           .buffer_offset = 0,
           .time = start_time,
         });
-        audio_event_buffer.push_back({
+        event_bus.push_audio(EventSource::Clip, {
           .type = EventType::PlaySample,
           .buffer_offset = 0,
           .time = start_time,
-          .speed = clip->audio.speed,
+          .speed = speed,
           .sample_offset = sample_offset,
+          .gain = table.gain[next_clip],
           .clip = clip,
-          .sample = &clip->audio.asset->sample_instance,
+          .sample = sample,
         });
       } else {
         kill_all_voices(0, start_time);
-        double actual_start_offset = relative_start_time + clip->start_offset;
+        double actual_start_offset = relative_start_time + start_offset;
         event_state.midi_note_idx = clip->midi.asset->find_first_note(actual_start_offset, 0);
       }
       clip->internal_state_changed = false;
@@ -420,23 +553,23 @@ void Track::process_event(
 
     if (max_time <= end_time) {  // Reaching the end of the clip
       if (is_audio) {
-        double offset_from_start = beat_to_samples(max_time - start_time, sample_rate, beat_duration);
+        double offset_from_start = tempo.samples_from_start(max_time);
         double sample_offset = sample_position + offset_from_start;
         uint32_t buffer_offset = (uint32_t)((uint64_t)sample_offset % (uint64_t)buffer_size);
-        audio_event_buffer.push_back({
+        event_bus.push_audio(EventSource::Clip, {
           .type = EventType::StopSample,
           .buffer_offset = buffer_offset,
           .time = max_time,
         });
       } else {
         process_midi_event(
-            clip, start_time, max_time, sample_position, beat_duration, sample_rate, ppq, inv_ppq, buffer_size);
+            clip, start_time, max_time, sample_position, tempo, sample_rate, ppq, inv_ppq, buffer_size);
       }
       event_state.partially_ended = false;
     } else {
       if (!is_audio) {
         process_midi_event(
-            clip, start_time, end_time, sample_position, beat_duration, sample_rate, ppq, inv_ppq, buffer_size);
+            clip, start_time, end_time, sample_position, tempo, sample_rate, ppq, inv_ppq, buffer_size);
       }
       event_state.partially_ended = true;
       break;
@@ -455,7 +588,7 @@ void Track::process_midi_event(
     double start_time,
     double end_time,
     double sample_position,
-    double beat_duration,
+    TempoCursor& tempo,
     double sample_rate,
     double ppq,
     double inv_ppq,
@@ -479,10 +612,10 @@ void Track::process_midi_event(
       break;
 
     while (auto voice = midi_voice_state.release_voice(min_time)) {
-      double offset_from_start = beat_to_samples(voice->max_time - start_time, sample_rate, beat_duration);
+      double offset_from_start = tempo.samples_from_start(voice->max_time);
       double sample_offset = sample_position + offset_from_start;
       uint32_t buffer_offset = (uint32_t)((uint64_t)sample_offset % (uint64_t)buffer_size);
-      midi_event_list.push_event({
+      event_bus.push_midi(EventSource::Clip, {
         .type = MidiEventType::NoteOff,
         .buffer_offset = buffer_offset,
         .time = voice->max_time,
@@ -493,14 +626,16 @@ void Track::process_midi_event(
         },
       });
 #if WB_DBG_LOG_NOTE_EVENT
-      char note_str[8]{};
-      fmt::format_to_n(
-          note_str, std::size(note_str), "{}{}", get_midi_note_scale(voice->key), get_midi_note_octave(voice->key));
-      Log::debug("Note off: {} length: {} at: {}", note_str, voice->max_time, buffer_offset);
+      RtLog::debug(
+          "Note off: {}{} length: {} at: {}",
+          get_midi_note_scale(voice->key),
+          get_midi_note_octave(voice->key),
+          voice->max_time,
+          buffer_offset);
 #endif
     }
 
-    double offset_from_start = beat_to_samples(min_time - start_time, sample_rate, beat_duration);
+    double offset_from_start = tempo.samples_from_start(min_time);
     double sample_offset = sample_position + offset_from_start;
     uint32_t buffer_offset = (uint32_t)((uint64_t)sample_offset % (uint64_t)buffer_size);
     int16_t key = note.key + semitone_offset;
@@ -511,20 +646,37 @@ void Track::process_midi_event(
       continue;
     }
 
-    bool voice_added = midi_voice_state.add_voice({
-      .max_time = max_time,
-      .velocity = note.velocity,
-      .channel = 0,
-      .key = key,
-    });
+    MidiVoice stolen_voice;
+    MidiVoiceAddResult add_result = midi_voice_state.add_voice(
+        {
+          .max_time = max_time,
+          .velocity = note.velocity,
+          .channel = 0,
+          .key = key,
+        },
+        &stolen_voice);
 
     // Skip if we have reached maximum voices
-    if (!voice_added) {
+    if (add_result == MidiVoiceAddResult::Dropped) {
       midi_note_idx++;
       continue;
     }
 
-    midi_event_list.push_event({
+    // End the stolen voice right before the new note starts
+    if (add_result == MidiVoiceAddResult::Stolen) {
+      event_bus.push_midi(EventSource::Clip, {
+        .type = MidiEventType::NoteOff,
+        .buffer_offset = buffer_offset,
+        .time = min_time,
+        .note_off = {
+          .channel = stolen_voice.channel,
+          .key = stolen_voice.key,
+          .velocity = stolen_voice.velocity,
+        },
+      });
+    }
+
+    event_bus.push_midi(EventSource::Clip, {
       .type = MidiEventType::NoteOn,
       .buffer_offset = buffer_offset,
       .time = min_time,
@@ -536,19 +688,23 @@ void Track::process_midi_event(
     });
 
 #if WB_DBG_LOG_NOTE_EVENT
-    char note_str[8]{};
-    fmt::format_to_n(note_str, std::size(note_str), "{}{}", get_midi_note_scale(note.key), get_midi_note_octave(key));
-    Log::debug("Note on: {} {} -> {} at {}", note_str, min_time, max_time, buffer_offset);
+    RtLog::debug(
+        "Note on: {}{} {} -> {} at {}",
+        get_midi_note_scale(key),
+        get_midi_note_octave(key),
+        min_time,
+        max_time,
+        buffer_offset);
 #endif
 
     midi_note_idx++;
   }
 
   while (auto voice = midi_voice_state.release_voice(end_time)) {
-    double offset_from_start = beat_to_samples(voice->max_time - start_time, sample_rate, beat_duration);
+    double offset_from_start = tempo.samples_from_start(voice->max_time);
     double sample_offset = sample_position + offset_from_start;
     uint32_t buffer_offset = (uint32_t)((uint64_t)sample_offset % (uint64_t)buffer_size);
-    midi_event_list.push_event({
+    event_bus.push_midi(EventSource::Clip, {
       .type = MidiEventType::NoteOff,
       .buffer_offset = buffer_offset,
       .time = voice->max_time,
@@ -559,10 +715,12 @@ void Track::process_midi_event(
       },
     });
 #if WB_DBG_LOG_NOTE_EVENT
-    char note_str[8]{};
-    fmt::format_to_n(
-        note_str, std::size(note_str), "{}{}", get_midi_note_scale(voice->key), get_midi_note_octave(voice->key));
-    Log::debug("Note off: {} length: {} at: {}", note_str, voice->max_time, buffer_offset);
+    RtLog::debug(
+        "Note off: {}{} length: {} at: {}",
+        get_midi_note_scale(voice->key),
+        get_midi_note_octave(voice->key),
+        voice->max_time,
+        buffer_offset);
 #endif
   }
 
@@ -571,7 +729,7 @@ void Track::process_midi_event(
 
 void Track::kill_all_voices(uint32_t buffer_offset, double time_pos) {
   while (auto voice = midi_voice_state.release_voice(std::numeric_limits<double>::max())) {
-    midi_event_list.push_event({
+    event_bus.push_midi(EventSource::Clip, {
       .type = MidiEventType::NoteOff,
       .buffer_offset = buffer_offset,
       .time = time_pos,
@@ -584,11 +742,24 @@ void Track::kill_all_voices(uint32_t buffer_offset, double time_pos) {
   }
 }
 
+void Track::dispatch_events() {
+  event_bus.merge();
+  for (const BusEvent& event : event_bus) {
+    switch (event.type) {
+      case BusEventType::Midi: midi_event_list.push_event(event.midi); break;
+      case BusEventType::Param:
+        param_queue.push_back_value(event.param.sample_offset, event.param.id, event.param.value);
+        break;
+      case BusEventType::Audio: audio_event_buffer.push_back(event.audio); break;
+    }
+  }
+}
+
 void Track::process(
     const AudioBuffer<float>& input_buffer,
     AudioBuffer<float>& output_buffer,
     double sample_rate,
-    double beat_duration,
+    TempoCursor& tempo,
     double buffer_duration_in_beats,
     double sample_position,
     double start_time,
@@ -606,7 +777,7 @@ void Track::process(
         start_time,
         end_time,
         sample_position,
-        beat_duration,
+        tempo,
         buffer_duration_in_beats,
         sample_rate,
         ppq,
@@ -614,13 +785,15 @@ void Track::process(
         output_buffer.n_samples);
   }
 
+  dispatch_events();
+
   // Process received parameter value
   for (uint32_t i = 0; i < param_queue.values.size(); i++) {
     dsp::ParamValue& value = param_queue.values[i];
     switch (value.id) {
       case TrackParameter_Volume: parameter_state.volume = (float)value.value;
 #ifdef WB_DBG_LOG_PARAMETER_UPDATE
-        Log::debug("Volume changed: {} {}", parameter_state.volume, math::linear_to_db(parameter_state.volume));
+        RtLog::debug("Volume changed: {} {}", parameter_state.volume, math::linear_to_db(parameter_state.volume));
 #endif
         break;
       case TrackParameter_Pan: {
@@ -629,14 +802,14 @@ void Track::process(
         parameter_state.pan_coeffs[0] = pan.left;
         parameter_state.pan_coeffs[1] = pan.right;
 #ifdef WB_DBG_LOG_PARAMETER_UPDATE
-        Log::debug(
+        RtLog::debug(
             "Pan changed: {} {} {}", parameter_state.pan, parameter_state.pan_coeffs[0], parameter_state.pan_coeffs[1]);
 #endif
         break;
       }
       case TrackParameter_Mute: parameter_state.mute = value.value > 0.0 ? 1.0f : 0.0f;
 #ifdef WB_DBG_LOG_PARAMETER_UPDATE
-        Log::debug("Mute changed: {}", parameter_state.mute);
+        RtLog::debug("Mute changed: {}", parameter_state.mute);
 #endif
         break;
     }
@@ -654,7 +827,7 @@ void Track::process(
     process_info.output_buffer = &output_buffer;
     process_info.input_event_list = &midi_event_list;
     process_info.sample_rate = sample_rate;
-    process_info.tempo = 60.0 / beat_duration;
+    process_info.tempo = tempo.get_bpm_at(start_time);
     process_info.project_time_in_ppq = start_time;
     process_info.project_time_in_samples = playhead_in_samples;
     process_info.playing = playing;
@@ -673,7 +846,7 @@ void Track::process(
           case EventType::None: break;
           case EventType::StopSample: break;
           case EventType::PlaySample: {
-            float gain = current_audio_event.clip->audio.gain;
+            float gain = current_audio_event.gain;
             Sample* sample = current_audio_event.sample;
             sampler.stream(sample, output_buffer.n_channels, event_length, start_sample, gain, write_buffer.channel_buffers);
             break;
@@ -684,10 +857,17 @@ void Track::process(
           case EventType::None: break;
           case EventType::StopSample: break;
           case EventType::PlaySample: {
-            assert(next_event->clip && "Clip is nullptr");
             assert(next_event->sample && "Sample is nullptr");
+            // Play the pre-rendered copy once it is ready, it already has the speed and sample rate applied
+            if (next_event->clip && next_event->clip->is_audio()) {
+              const SampleContent* content = next_event->clip->audio.asset->content;
+              if (SampleRender* render = find_sample_render(content, next_event->speed, (uint32_t)sample_rate)) {
+                next_event->sample = &*render->sample;
+                next_event->sample_offset = (size_t)((double)next_event->sample_offset / render->ratio);
+                next_event->speed = 1.0;
+              }
+            }
             // prepare sampler state
-            float gain = next_event->clip->audio.gain;
             Sample* sample = next_event->sample;
             sampler.reset_state(
                 dsp::ResamplerType::Linear,
@@ -701,8 +881,8 @@ void Track::process(
 
 #if WB_DBG_LOG_AUDIO_EVENT
         switch (event->type) {
-          case EventType::StopSample: Log::debug("{}: Stop {} {}", name, event->time, event->buffer_offset); break;
-          case EventType::PlaySample: Log::debug("{}: Play {} {}", name, event->time, event->buffer_offset); break;
+          case EventType::StopSample: RtLog::debug("{}: Stop {} {}", RtLogString(name), event->time, event->buffer_offset); break;
+          case EventType::PlaySample: RtLog::debug("{}: Play {} {}", RtLogString(name), event->time, event->buffer_offset); break;
           default: break;
         }
 #endif
@@ -713,7 +893,7 @@ void Track::process(
         uint32_t event_length = write_buffer.n_samples - start_sample;
 
         if (current_audio_event.type == EventType::PlaySample) {
-          float gain = current_audio_event.clip->audio.gain;
+          float gain = current_audio_event.gain;
           Sample* sample = current_audio_event.sample;
           sampler.stream(sample, output_buffer.n_channels, event_length, start_sample, gain, write_buffer.channel_buffers);
         }
@@ -728,8 +908,8 @@ void Track::process(
   float volume = parameter_state.mute ? 0.0f : parameter_state.volume;
   for (uint32_t i = 0; i < output_buffer.n_channels; i++) {
     float* buf = output_buffer.channel_buffers[i];
-    dsp::apply_gain(buf, output_buffer.n_samples, volume * parameter_state.pan_coeffs[i]);
-    level_meter[i].push_samples(output_buffer, i);
+    float peak = dsp::apply_gain_peak(buf, output_buffer.n_samples, volume * parameter_state.pan_coeffs[i]);
+    level_meter[i].push_level(peak);
   }
 
   param_queue.clear();
@@ -775,13 +955,13 @@ void Track::process_track_messages(double time) {
   while (track_msg_queue.pop(msg)) {
     switch (msg.type) {
       case TrackMessage::ParamChange:
-        param_queue.push_back_value(0, msg.plugin_param_change.id, msg.plugin_param_change.value);
+        event_bus.push_param(EventSource::Automation, 0, msg.plugin_param_change.id, msg.plugin_param_change.value);
         break;
       case TrackMessage::PluginParamChange:
         msg.plugin_param_change.plugin->transfer_param(msg.plugin_param_change.id, msg.plugin_param_change.value);
         break;
       case TrackMessage::MidiNoteOn:
-        midi_event_list.push_event({
+        event_bus.push_midi(EventSource::Live, {
           .type = MidiEventType::NoteOn,
           .buffer_offset = 0,
           .time = time,
@@ -791,10 +971,10 @@ void Track::process_track_messages(double time) {
             .velocity = msg.midi_note_on.velocity,
           },
         });
-        Log::debug("MidiNoteOn: {} {}", msg.midi_note_on.key, time);
+        RtLog::debug("MidiNoteOn: {} {}", msg.midi_note_on.key, time);
         break;
       case TrackMessage::MidiNoteOff:
-        midi_event_list.push_event({
+        event_bus.push_midi(EventSource::Live, {
           .type = MidiEventType::NoteOff,
           .buffer_offset = 0,
           .time = time,
@@ -804,7 +984,7 @@ void Track::process_track_messages(double time) {
             .velocity = msg.midi_note_on.velocity,
           },
         });
-        Log::debug("MidiNoteOff: {} {}", msg.midi_note_off.key, time);
+        RtLog::debug("MidiNoteOff: {} {}", msg.midi_note_off.key, time);
         break;
       default: break;
     }
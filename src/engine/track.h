@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <limits>
 #include <numbers>
 #include <optional>
 #include <random>
@@ -10,14 +11,17 @@
 #include "core/audio_buffer.h"
 #include "core/bit_manipulation.h"
 #include "core/memory.h"
+#include "core/thread.h"
 #include "core/vector.h"
 #include "dsp/param_queue.h"
 #include "dsp/sampler.h"
 #include "etypes.h"
 #include "event.h"
+#include "event_bus.h"
 #include "event_list.h"
 #include "midi_voice.h"
 #include "plughost/plugin_interface.h"
+#include "tempo_map.h"
 #include "test_synth.h"
 #include "track_input.h"
 #include "vu_meter.h"
@@ -25,6 +29,7 @@
 namespace wb {
 
 struct Track;
+struct LiveWaveform;
 
 enum TrackParameter {
   TrackParameter_Volume,
@@ -33,6 +38,66 @@ enum TrackParameter {
   TrackParameter_Max,
 };
 
+/**
+ * @brief Song length aggregated over all tracks. Tracks report their end when their clip list changes, the length only
+ * has to be recomputed from the track ends when the longest track gets shorter or is removed.
+ */
+struct SongLength {
+  static constexpr double empty_track_length = 80.0;
+  double length = std::numeric_limits<double>::min();
+  bool dirty = false;
+
+  inline void update(double old_end, double new_end) {
+    if (new_end >= length)
+      length = new_end;
+    else if (old_end >= length)
+      dirty = true;
+  }
+
+  inline void remove(double end) {
+    if (end >= length)
+      dirty = true;
+  }
+};
+
+/**
+ * @brief Structure-of-arrays copy of the clip list holding only what the audio thread needs for playback. Row i
+ * mirrors Track::clips[i]. The editor thread marks the table dirty and the audio thread rebuilds it before use.
+ */
+struct ClipPlaybackTable {
+  Vector<double> min_time;
+  Vector<double> max_time;
+  Vector<double> start_offset;
+  Vector<double> speed;
+  Vector<float> gain;
+  Vector<Sample*> sample;  // nullptr for MIDI clips
+  Vector<Clip*> clip;
+
+  inline uint32_t size() const {
+    return min_time.size();
+  }
+
+  inline void reserve(uint32_t n) {
+    min_time.reserve(n);
+    max_time.reserve(n);
+    start_offset.reserve(n);
+    speed.reserve(n);
+    gain.reserve(n);
+    sample.reserve(n);
+    clip.reserve(n);
+  }
+
+  inline void resize(uint32_t n) {
+    min_time.resize_fast(n);
+    max_time.resize_fast(n);
+    start_offset.resize_fast(n);
+    speed.resize_fast(n);
+    gain.resize_fast(n);
+    sample.resize_fast(n);
+    clip.resize_fast(n);
+  }
+};
+
 struct TrackEventState {
   std::optional<uint32_t> current_clip_idx;
   std::optional<uint32_t> clip_idx;
@@ -88,6 +153,10 @@ struct TrackMessage {
 };
 
 struct Track {
+  static constexpr uint32_t max_audio_events_per_block = 256;
+  static constexpr uint32_t max_midi_events_per_block = 1024;
+  static constexpr uint32_t max_param_changes_per_block = 256;
+
   std::string name;
   Color color{ 0.3f, 0.3f, 0.3f, 1.0f };
   float height = 60.0f;
@@ -101,13 +170,21 @@ struct Track {
   double record_max_time = 0.0;
   size_t num_samples_written = 0;
   std::optional<Sample> recorded_samples;
+  LiveWaveform* recorded_peaks = nullptr;
 
   Pool<Clip> clip_allocator;
   Vector<Clip*> clips;
-  Vector<Clip*> deleted_clips;
+  Vector<Clip*> unordered_clips;
   bool has_deleted_clips = false;
+  double content_end = SongLength::empty_track_length;  // End of the last clip, kept up to date by clip list edits
+  SongLength* song_length = nullptr;
+  const Spinlock* editor_lock = nullptr;  // Must be held while the clip list is edited, unchecked when not set
+
+  ClipPlaybackTable playback_table;
+  std::atomic_bool playback_table_dirty{ true };
 
   TrackEventState event_state{};
+  TrackEventBus event_bus;
   Vector<AudioEvent> audio_event_buffer;
   AudioEvent current_audio_event{};
   AudioBuffer<float> effect_buffer{};
@@ -178,8 +255,41 @@ struct Track {
    */
   std::optional<ClipQueryResult> query_clip_by_range(double min, double max) const;
 
+  /**
+   * @brief Insert clip into the clip list while keeping the list sorted. The clip must not overlap other clips.
+   *
+   * @param clip Clip to insert.
+   */
+  void insert_clip(Clip* clip);
+
+  /**
+   * @brief Restore clip ordering after the clip list has been edited. Removes deleted clips and only reorders and
+   * renumbers the clips that have been changed.
+   */
   void update_clip_ordering();
 
+  /**
+   * @brief Attach the track to a song length aggregate. The track reports its end to the aggregate whenever the clip
+   * list changes.
+   *
+   * @param aggregate Song length aggregate, usually the engine's.
+   */
+  void set_song_length(SongLength* aggregate);
+
+  /**
+   * @brief Mark the playback table as outdated after the clip list or clip properties have been changed. Reserves the
+   * table storage so the audio thread does not have to allocate when rebuilding it. The editor lock must be held, the
+   * audio thread reads the table while processing.
+   */
+  void invalidate_playback_table();
+
+  void update_content_end_();
+
+  /**
+   * @brief Rebuild the playback table from the clip list. Called from the audio thread.
+   */
+  void update_playback_table();
+
   /**
    * @brief Find next clip at a given time position.
    *
@@ -191,6 +301,11 @@ struct Track {
 
   void prepare_effect_buffer(uint32_t num_channels, uint32_t num_samples);
 
+  /**
+   * @brief Reserve per-block event storage up front, so that the audio thread does not need to grow them.
+   */
+  void reserve_event_buffers();
+
   /**
    * @brief Reset playback state. When the playback state changes, this must be called to update the playback state and
    * make sure everything keep sync.
@@ -221,7 +336,7 @@ struct Track {
       double start_time,
       double end_time,
       double sample_position,
-      double beat_duration,
+      TempoCursor& tempo,
       double buffer_duration,
       double sample_rate,
       double ppq,
@@ -233,7 +348,7 @@ struct Track {
       double start_time,
       double end_time,
       double sample_position,
-      double beat_duration,
+      TempoCursor& tempo,
       double sample_rate,
       double ppq,
       double inv_ppq,
@@ -241,18 +356,24 @@ struct Track {
 
   void kill_all_voices(uint32_t buffer_offset, double time_pos);
 
+  /**
+   * @brief Merge the event bus and hand the ordered events to the MIDI event list, parameter queue and sampler.
+   */
+  void dispatch_events();
+
   /**
    * @brief Process audio block.
    *
    * @param output_buffer Position in beats.
    * @param sample_rate Sample rate.
+   * @param tempo Tempo map lookup for this block, events are placed by converting their beat position with it.
    * @param playing Should play the track.
    */
   void process(
       const AudioBuffer<float>& input_buffer,
       AudioBuffer<float>& output_buffer,
       double sample_rate,
-      double beat_duration,
+      TempoCursor& tempo,
       double buffer_duration_in_beats,
       double sample_position,
       double start_time,
@@ -5,6 +5,7 @@
 #include "core/audio_buffer.h"
 #include "core/core_math.h"
 #include "core/debug.h"
+#include "dsp/dsp_ops.h"
 
 namespace wb {
 
@@ -18,11 +19,11 @@ struct VUMeter {
   float current_level = 0.0f;
 
   void push_samples(const AudioBuffer<float>& buffer, uint32_t channel) {
-    const float* samples = buffer.get_read_pointer(channel);
-    float new_level = 0.0f;
-    for (uint32_t i = 0; i < buffer.n_samples; i++) {
-      new_level = math::max(new_level, math::abs(samples[i]));
-    }
+    push_level(dsp::find_abs_maximum(buffer.get_read_pointer(channel), buffer.n_samples));
+  }
+
+  // Report the peak of a block that has already been measured, see dsp::apply_gain_peak()
+  void push_level(float new_level) {
     float old_level = level.load(std::memory_order_relaxed);
     while (old_level < new_level &&
            level.compare_exchange_weak(old_level, new_level, std::memory_order_release, std::memory_order_relaxed))
@@ -1173,10 +1173,10 @@ void GPURendererVK::unmap_buffer(GPUBuffer* buffer) {
   vmaFlushAllocation(allocator_, allocation, 0, VK_WHOLE_SIZE);
 }
 
-void* GPURendererVK::begin_upload_data(GPUBuffer* buffer, size_t upload_size) {
+void* GPURendererVK::begin_upload_data(GPUBuffer* buffer, size_t upload_size, size_t dst_offset) {
   assert(!inside_render_pass);
   assert(current_upload_item_ == nullptr);
-  assert(buffer->size <= upload_size);
+  assert(dst_offset + upload_size <= buffer->size);
 
   VmaAllocationCreateInfo alloc_info{
     .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
@@ -1198,6 +1198,7 @@ void* GPURendererVK::begin_upload_data(GPUBuffer* buffer, size_t upload_size) {
   GPUUploadItemVK& upload = pending_uploads_.emplace_back();
   upload.type = GPUUploadItemVK::Buffer;
   upload.width = upload_size;
+  upload.dst_offset = dst_offset;
   upload.src_buffer = staging_buffer;
   upload.src_allocation = allocation;
   upload.dst_buffer = impl->buffer[impl->active_id];
@@ -1364,6 +1365,7 @@ void GPURendererVK::enqueue_resource_upload_(VkBuffer buffer, uint32_t size, con
   GPUUploadItemVK& upload = pending_uploads_.emplace_back();
   upload.type = GPUUploadItemVK::Buffer;
   upload.width = size;
+  upload.dst_offset = 0;
   upload.src_buffer = staging_buffer;
   upload.src_allocation = allocation;
   upload.dst_buffer = buffer;
@@ -1431,7 +1433,10 @@ void GPURendererVK::submit_pending_uploads_() {
 
     switch (item.type) {
       case GPUUploadItemVK::Buffer: {
-        VkBufferCopy region{ .size = (VkDeviceSize)item.width };
+        VkBufferCopy region{
+          .dstOffset = (VkDeviceSize)item.dst_offset,
+          .size = (VkDeviceSize)item.width,
+        };
         vkCmdCopyBuffer(upload_cb, item.src_buffer, item.dst_buffer, 1, &region);
         emit_memory_barrier = true;
         break;
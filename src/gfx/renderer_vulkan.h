@@ -57,7 +57,8 @@ struct GPUViewportDataVK : public GPUViewportData {
 struct GPUUploadItemVK {
   enum { Buffer, Image };
 
-  size_t width;  // If this is a buffer upload, this will be the size of the buffer
+  size_t width;       // If this is a buffer upload, this will be the size of the buffer
+  size_t dst_offset;  // Destination offset of the buffer upload
   uint32_t height;
   uint32_t type;
   VkBool32 should_stall;
@@ -254,7 +255,7 @@ struct GPURendererVK : public GPURenderer {
 
   void* map_buffer(GPUBuffer* buffer) override;
   void unmap_buffer(GPUBuffer* buffer) override;
-  void* begin_upload_data(GPUBuffer* buffer, size_t upload_size) override;
+  void* begin_upload_data(GPUBuffer* buffer, size_t upload_size, size_t dst_offset = 0) override;
   void end_upload_data() override;
 
   void begin_render(GPUTexture* render_target, const ImVec4& clear_color) override;
@@ -94,6 +94,43 @@ static void summarize_for_mipmaps_impl(
       }
       break;
     }
+    case AudioFormat::I24: {
+      for (size_t i = 0; i < output_count; i += 2) {
+        size_t idx = i * block_count;
+        size_t chunk_length = std::min(chunk_count, sample_count - idx);
+        T min_val = std::numeric_limits<T>::max();
+        T max_val = std::numeric_limits<T>::min();
+        size_t min_idx = 0;
+        size_t max_idx = 0;
+
+        static constexpr double conv_div_min = (double)std::numeric_limits<T>::min() / -8388608.0;
+        static constexpr double conv_div_max = (double)std::numeric_limits<T>::max() / 8388607.0;
+        const std::byte* chunk = &sample_data[i * block_count * 3];
+        for (size_t j = 0; j < chunk_length; j++) {
+          int32_t sample = read_packed_i24(chunk + j * 3);
+          double conv = (double)sample * (sample >= 0 ? conv_div_max : conv_div_min);
+          T value = (T)conv;
+
+          if (value < min_val) {
+            min_val = value;
+            min_idx = j;
+          }
+          if (value > max_val) {
+            max_val = value;
+            max_idx = j;
+          }
+        }
+
+        if (max_idx < min_idx) {
+          output_data[i] = max_val;
+          output_data[i + 1] = min_val;
+        } else {
+          output_data[i] = min_val;
+          output_data[i + 1] = max_val;
+        }
+      }
+      break;
+    }
     case AudioFormat::I32: {
       const int32_t* sample = (const int32_t*)sample_data;
       for (size_t i = 0; i < output_count; i += 2) {
@@ -247,6 +284,165 @@ WaveformVisual* WaveformVisual::create(Sample* sample, WaveformVisualQuality qua
   return ret;
 }
 
+static void reserve_live_peaks(Vector<int16_t>& peaks, uint32_t count) {
+  if (count > peaks.capacity()) {
+    uint32_t new_capacity = std::max(peaks.capacity() * 2, LiveWaveform::min_capacity);
+    peaks.reserve(std::max(new_capacity, count));
+  }
+  peaks.resize_fast(count);
+}
+
+LiveWaveform::LiveWaveform(uint32_t channels, int32_t sample_rate) : channels_(channels) {
+  assert(channels <= max_channels);
+  visual.sample_count = 0;
+  visual.mipmap_count = 0;
+  visual.channels = (int32_t)channels;
+  visual.sample_rate = sample_rate;
+  visual.quality = WaveformVisualQuality::High;
+  visual.cpu_accessible = false;
+}
+
+void LiveWaveform::append(const Sample* sample, size_t first_frame, size_t num_frames) {
+  const size_t total_frames = first_frame + num_frames;
+  const size_t elem_size = get_audio_format_size(sample->format);
+
+  // Same number of mip-maps as WaveformVisual::create would generate for this length
+  uint32_t target_levels = 0;
+  for (size_t n = total_frames; n > 64 && target_levels < max_levels; n /= 4)
+    target_levels++;
+
+  lock_.lock();
+
+  // The first level summarizes 2 frames into one peak pair. Only the new frames and the last partially filled pair are
+  // summarized again.
+  Level& base = levels_[0];
+  uint32_t first_pair = (uint32_t)(first_frame / 2);
+  uint32_t end_pair = (uint32_t)((total_frames + 1) / 2);
+  size_t frame_offset = (size_t)first_pair * 2;
+  for (uint32_t i = 0; i < channels_; i++) {
+    Vector<int16_t>& peaks = base.peaks[i];
+    reserve_live_peaks(peaks, end_pair * 2);
+    summarize_for_mipmaps_impl(
+        sample->format,
+        total_frames - frame_offset,
+        sample->sample_data[i] + frame_offset * elem_size,
+        2,
+        1,
+        (end_pair - first_pair) * 2,
+        peaks.data() + frame_offset);
+  }
+  base.dirty_min = std::min(base.dirty_min, first_pair * 2);
+  base.count = end_pair * 2;
+
+  // Each higher level is built from the previous level (4 pairs -> 1 pair), so only the changed tail is touched.
+  uint32_t changed_pair = first_pair;
+  for (uint32_t level = 1; level < target_levels; level++) {
+    const Level& parent = levels_[level - 1];
+    uint32_t first = levels_[level].count != 0 ? changed_pair / 4 : 0;
+    uint32_t end = (parent.count / 2 + 3) / 4;
+    append_level_(level, first, end - first);
+    changed_pair = first;
+  }
+
+  num_levels_ = std::max(num_levels_, target_levels);
+  frames_written_ = total_frames;
+  lock_.unlock();
+}
+
+void LiveWaveform::append_level_(uint32_t level, uint32_t first_pair, uint32_t num_pairs) {
+  const Level& parent = levels_[level - 1];
+  Level& current = levels_[level];
+  const uint32_t end_pair = first_pair + num_pairs;
+
+  for (uint32_t i = 0; i < channels_; i++) {
+    const int16_t* src = parent.peaks[i].data();
+    Vector<int16_t>& peaks = current.peaks[i];
+    reserve_live_peaks(peaks, end_pair * 2);
+    int16_t* dst = peaks.data();
+
+    for (uint32_t pair = first_pair; pair < end_pair; pair++) {
+      // Peak pairs are stored in temporal order, so the order of the extremas is preserved.
+      uint32_t begin = pair * 8;
+      uint32_t end = std::min(begin + 8, parent.count);
+      int16_t min_val = std::numeric_limits<int16_t>::max();
+      int16_t max_val = std::numeric_limits<int16_t>::min();
+      uint32_t min_idx = 0;
+      uint32_t max_idx = 0;
+      for (uint32_t j = begin; j < end; j++) {
+        if (src[j] < min_val) {
+          min_val = src[j];
+          min_idx = j;
+        }
+        if (src[j] > max_val) {
+          max_val = src[j];
+          max_idx = j;
+        }
+      }
+      if (max_idx < min_idx) {
+        dst[pair * 2] = max_val;
+        dst[pair * 2 + 1] = min_val;
+      } else {
+        dst[pair * 2] = min_val;
+        dst[pair * 2 + 1] = max_val;
+      }
+    }
+  }
+
+  current.dirty_min = std::min(current.dirty_min, first_pair * 2);
+  current.count = end_pair * 2;
+}
+
+WaveformVisual* LiveWaveform::update() {
+  lock_.lock();
+
+  for (uint32_t i = 0; i < num_levels_; i++) {
+    Level& level = levels_[i];
+    if (i == visual.mipmaps.size())
+      visual.mipmaps.push_back({ .data = nullptr, .count = 0 });
+
+    WaveformMipmap& mip = visual.mipmaps[i];
+    if (level.count > mip.count) {
+      // Out of space, recreate the buffer and upload everything again
+      uint32_t capacity = std::max(mip.count * 2, min_capacity);
+      while (capacity < level.count)
+        capacity *= 2;
+      if (mip.data)
+        g_renderer->destroy_buffer(mip.data);
+      mip.data = g_renderer->create_buffer(GPUBufferUsage::Storage, (size_t)capacity * channels_ * sizeof(int16_t), false);
+      assert(mip.data && "Cannot create buffer");
+      mip.count = capacity;
+
+      // The capacity is the channel stride seen by the shader, zero the unfilled tail so it never reads garbage
+      size_t filled_size = (size_t)level.count * sizeof(int16_t);
+      size_t channel_size = (size_t)capacity * sizeof(int16_t);
+      for (uint32_t c = 0; c < channels_; c++) {
+        void* upload_ptr = g_renderer->begin_upload_data(mip.data, channel_size, channel_size * c);
+        std::memcpy(upload_ptr, level.peaks[c].data(), filled_size);
+        std::memset((uint8_t*)upload_ptr + filled_size, 0, channel_size - filled_size);
+        g_renderer->end_upload_data();
+      }
+      level.dirty_min = level.count;
+    }
+
+    if (level.dirty_min < level.count) {
+      size_t upload_size = (size_t)(level.count - level.dirty_min) * sizeof(int16_t);
+      for (uint32_t c = 0; c < channels_; c++) {
+        size_t dst_offset = ((size_t)mip.count * c + level.dirty_min) * sizeof(int16_t);
+        void* upload_ptr = g_renderer->begin_upload_data(mip.data, upload_size, dst_offset);
+        std::memcpy(upload_ptr, level.peaks[c].data() + level.dirty_min, upload_size);
+        g_renderer->end_upload_data();
+      }
+      level.dirty_min = level.count;
+    }
+  }
+
+  visual.sample_count = frames_written_;
+  visual.mipmap_count = (int32_t)num_levels_;
+  lock_.unlock();
+
+  return num_levels_ > 0 ? &visual : nullptr;
+}
+
 void gfx_draw_waveform(const WaveformDrawCmd& command) {
 }
 
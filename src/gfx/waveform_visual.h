@@ -1,6 +1,7 @@
 #pragma once
 
 #include "core/common.h"
+#include "core/thread.h"
 #include "core/vector.h"
 
 namespace wb {
@@ -63,6 +64,49 @@ struct WaveformVisual {
   static WaveformVisual* create(Sample* sample, WaveformVisualQuality quality);
 };
 
+// Peak pyramid that can be extended while the source sample is still being written (e.g. recording). The writer
+// thread only summarizes newly appended frames, the UI thread then uploads the peaks that changed since the last
+// update. The layout of each mip-map is identical to WaveformVisual, except the channel stride is the capacity of
+// the GPU buffer instead of the number of peaks.
+struct LiveWaveform {
+  static constexpr uint32_t max_channels = 2;
+  static constexpr uint32_t max_levels = 16;
+  static constexpr uint32_t min_capacity = 4096;
+
+  struct Level {
+    Vector<int16_t> peaks[max_channels];
+    uint32_t count = 0;      // Number of valid peak values per channel
+    uint32_t dirty_min = 0;  // First peak value that has not been uploaded yet
+  };
+
+  Level levels_[max_levels];
+  uint32_t num_levels_ = 0;
+  uint32_t channels_ = 0;
+  size_t frames_written_ = 0;
+  Spinlock lock_;
+  WaveformVisual visual{};
+
+  LiveWaveform(uint32_t channels, int32_t sample_rate);
+
+  /**
+   * @brief Summarize newly written frames. Called from the writer thread.
+   *
+   * @param sample Source sample. Frames before first_frame must be left unchanged.
+   * @param first_frame First frame to summarize.
+   * @param num_frames Number of frames appended.
+   */
+  void append(const Sample* sample, size_t first_frame, size_t num_frames);
+
+  /**
+   * @brief Upload dirty peak ranges to the GPU buffers. Called from the UI thread.
+   *
+   * @return The visual with the current sample count, or nullptr if there are not enough frames to display.
+   */
+  WaveformVisual* update();
+
+  void append_level_(uint32_t level, uint32_t first_pair, uint32_t num_pairs);
+};
+
 void gfx_draw_waveform(const WaveformDrawCmd& command);
 void gfx_draw_waveform_batch(
     const Vector<WaveformDrawCmd>& commands,
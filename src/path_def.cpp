@@ -19,6 +19,10 @@ const std::filesystem::path devpath{ std::filesystem::current_path() };
 const std::filesystem::path wbpath{ devpath / ".whitebox" };
 const std::filesystem::path imgui_ini_path{ wbpath / "ui.ini" };
 const std::filesystem::path settings_json_path{ wbpath / "settings.json" };
+const std::filesystem::path history_spill_path{ wbpath / "history.journal" };
+const std::filesystem::path autosave_path{ wbpath / "autosave" };
+const std::filesystem::path file_index_path{ wbpath / "file_index" };
+const std::filesystem::path browser_cache_path{ wbpath / "browser.cache" };
 
 const std::array<std::filesystem::path, 2> vst3_search_path{
 #if defined(WB_PLATFORM_WINDOWS)
@@ -10,6 +10,10 @@ extern const std::filesystem::path devpath;
 extern const std::filesystem::path wbpath;
 extern const std::filesystem::path imgui_ini_path;
 extern const std::filesystem::path settings_json_path;
+extern const std::filesystem::path history_spill_path;
+extern const std::filesystem::path autosave_path;
+extern const std::filesystem::path file_index_path;
+extern const std::filesystem::path browser_cache_path;
 extern const std::array<std::filesystem::path, 2> vst3_search_path;
 
 }  // namespace wb::path_def
\ No newline at end of file
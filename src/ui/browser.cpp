@@ -1,172 +1,247 @@
 #include "browser.h"
 
+#include <imgui_stdlib.h>
+
 #include "controls.h"
-#include "core/algorithm.h"
+#include "core/debug.h"
 #include "core/fs.h"
 #include "dialogs.h"
 #include "dsp/sample.h"
+#include "engine/engine.h"
+#include "engine/file_index.h"
 #include "file_dialog.h"
 #include "file_dropper.h"
+#include "path_def.h"
 #include "window.h"
 
 namespace fs = std::filesystem;
 
 namespace wb {
 
-static std::pair<double, double> get_item_content_info(const std::filesystem::path& path) {
-  if (auto length = Sample::get_file_info(path)) {
-    return {
-      (double)length->sample_count,
-      (double)length->rate,
-    };
+// Served from the file index, the file is never decoded on the UI thread. Files that have not been indexed yet are
+// handed to the indexer thread and false is returned until it has caught up.
+static bool get_item_content_info(const std::filesystem::path& path, BrowserFilePayload& payload) {
+  std::optional<FileIndexEntry> entry = g_file_index.find_current_path(path);
+  if (!entry) {
+    g_file_index.index_file_async(path);
+    return false;
+  }
+  if (entry->info) {
+    payload.content_length = (double)entry->info->sample_count;
+    payload.sample_rate = (double)entry->info->rate;
   }
-  return {};
+  return true;
 }
 
 BrowserWindow::BrowserWindow() {
 }
 
+void BrowserWindow::init() {
+  index.load(path_def::browser_cache_path);
+  index.start();
+}
+
+void BrowserWindow::shutdown() {
+  index.stop();
+  if (!index.save(path_def::browser_cache_path))
+    Log::warn("Cannot write browser cache");
+}
+
 void BrowserWindow::add_directory(const std::filesystem::path& path) {
   if (fs::is_directory(path) && !directory_set.contains(path)) {
-    auto [iterator, already_exists] = directory_set.emplace(path);
-    if (already_exists) {
-      directories.emplace_back(
-          iterator,
-          BrowserItem{
-            .name = path.filename().u8string(),
-            .root_dir = true,
-          });
+    auto [iterator, inserted] = directory_set.emplace(path);
+    if (inserted) {
+      directories.emplace_back(iterator, index.add_root(path));
+      g_file_index.refresh_async({ path });
     }
   }
 }
 
 void BrowserWindow::remove_directory(std::vector<BrowserWindow::DirectoryRefItem>::iterator dir) {
+  index.remove_root(dir->second);
   directory_set.erase(dir->first);
   directories.erase(dir);
 }
 
 void BrowserWindow::sort_directory() {
   std::stable_sort(directories.begin(), directories.end(), [](const DirectoryRefItem& a, const DirectoryRefItem& b) {
-    return a.second.name < b.second.name;
+    return a.first->filename() < b.first->filename();
   });
 }
 
-void BrowserWindow::glob_path(const std::filesystem::path& path, BrowserItem& item) {
-  item.dir_items.emplace();
-  item.file_items.emplace();
-  for (const auto& dir_entry : fs::directory_iterator(path, fs::directory_options::skip_permission_denied)) {
-    if (dir_entry.is_directory()) {
-      BrowserItem& child_item = item.dir_items->emplace_back(
-          BrowserItem::Directory, BrowserItem::Unknown, &item, FileSize(), dir_entry.path().filename().generic_u8string());
-    } else if (dir_entry.is_regular_file()) {
-      std::filesystem::path filename{ dir_entry.path().filename() };
-      std::filesystem::path ext{ filename.extension() };
-      BrowserItem::FileType file_type{};
-      if (any_of(ext, ".wav", ".wave", ".aiff", ".mp3", ".ogg", ".aifc", ".aif", ".iff", ".8svx")) {
-        file_type = BrowserItem::Sample;
-      } else if (any_of(ext, ".mid", ".midi")) {
-        file_type = BrowserItem::Midi;
-      } else {
+void BrowserWindow::update_search() {
+  if (search_text.empty()) {
+    search_results.clear();
+    return;
+  }
+  std::u8string_view query((const char8_t*)search_text.data(), search_text.size());
+  index.search(query, search_results);
+  search_generation = index.generation;
+}
+
+void BrowserWindow::preview_file(uint32_t node_id) {
+  if (index.nodes[node_id].file_type != BrowserNode::Sample)
+    return;
+  g_engine.preview_sample(index.get_path(node_id));
+
+  // Scrubbing through a folder with the arrow keys starts from cached heads
+  for (int32_t direction : { -1, 1 }) {
+    uint32_t adjacent = find_adjacent_file(node_id, direction);
+    if (adjacent != browser_invalid_node && index.nodes[adjacent].file_type == BrowserNode::Sample)
+      g_engine.sample_preview.prefetch(index.get_path(adjacent));
+  }
+}
+
+uint32_t BrowserWindow::find_adjacent_file(uint32_t node_id, int32_t direction) const {
+  if (!search_text.empty()) {
+    for (uint32_t i = 0; i < search_results.size(); i++) {
+      if (search_results[i].node != node_id)
         continue;
-      }
-      BrowserItem& child_item = item.file_items->emplace_back(
-          BrowserItem::File, file_type, &item, FileSize(dir_entry.file_size()), filename.generic_u8string());
+      int64_t adjacent = (int64_t)i + direction;
+      if (adjacent < 0 || adjacent >= (int64_t)search_results.size())
+        return browser_invalid_node;
+      uint32_t adjacent_node = search_results[(uint32_t)adjacent].node;
+      return index.is_valid(adjacent_node) ? adjacent_node : browser_invalid_node;
     }
+    return browser_invalid_node;
   }
+
+  uint32_t parent = index.nodes[node_id].parent;
+  if (parent == browser_invalid_node)
+    return browser_invalid_node;
+  const Vector<uint32_t>& siblings = index.nodes[parent].children;
+  const uint32_t* it = std::find(siblings.begin(), siblings.end(), node_id);
+  if (it == siblings.end())
+    return browser_invalid_node;
+  int64_t adjacent = (int64_t)(it - siblings.begin()) + direction;
+  if (adjacent < 0 || adjacent >= (int64_t)siblings.size() ||
+      index.nodes[siblings[(uint32_t)adjacent]].type != BrowserNode::File)
+    return browser_invalid_node;
+  return siblings[(uint32_t)adjacent];
 }
 
-void BrowserWindow::render_item(const std::filesystem::path& root_path, BrowserItem& item) {
+void BrowserWindow::render_node(uint32_t node_id) {
+  const BrowserNode& node = index.nodes[node_id];
+  if (node.type == BrowserNode::File) {
+    render_file_node(node_id, node.name.c_str());
+    return;
+  }
+
   ImGui::TableNextRow();
   ImGui::TableSetColumnIndex(0);
 
-  if (item.type == BrowserItem::Directory) {
-    constexpr ImGuiTreeNodeFlags flags =
-        ImGuiTreeNodeFlags_SpanFullWidth | ImGuiTreeNodeFlags_FramePadding | ImGuiTreeNodeFlags_SpanAllColumns;
-    ImGui::PushID((const void*)item.name.data());
-    ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(GImGui->Style.FramePadding.x, 2.0f));
-    bool directory_open = ImGui::TreeNodeEx("##browser_dir", flags, (const char*)item.name.data());
-    ImGui::PopStyleVar();
+  constexpr ImGuiTreeNodeFlags flags =
+      ImGuiTreeNodeFlags_SpanFullWidth | ImGuiTreeNodeFlags_FramePadding | ImGuiTreeNodeFlags_SpanAllColumns;
+  bool root_dir = node.parent == browser_invalid_node;
+  std::u8string root_name;
+  if (root_dir)
+    root_name = std::filesystem::path(node.name).filename().u8string();
+  ImGui::PushID((int)node_id);
+  ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(GImGui->Style.FramePadding.x, 2.0f));
+  bool directory_open =
+      ImGui::TreeNodeEx("##browser_dir", flags, "%s", (const char*)(root_dir ? root_name.c_str() : node.name.c_str()));
+  ImGui::PopStyleVar();
 
-    if (ImGui::IsItemClicked(ImGuiMouseButton_Right)) {
-      context_menu_path = item.get_file_path(root_path);
-      context_menu_item = &item;
-      open_context_menu = true;
-    }
+  if (ImGui::IsItemClicked(ImGuiMouseButton_Right)) {
+    context_menu_path = index.get_path(node_id);
+    context_menu_node = node_id;
+    open_context_menu = true;
+  }
 
-    if (!item.open && directory_open) {
-      auto path_from_root_dir = item.get_file_path(root_path);
-      glob_path(path_from_root_dir, item);
-      item.open = directory_open;
+  if (directory_open) {
+    // Only the visible part of the file list is rendered, directories can contain thousands of files
+    const Vector<uint32_t>& children = index.nodes[node_id].children;
+    uint32_t num_dirs = 0;
+    while (num_dirs < children.size() && index.nodes[children[num_dirs]].type == BrowserNode::Directory)
+      render_node(children[num_dirs++]);
+    ImGuiListClipper clipper;
+    clipper.Begin((int)(children.size() - num_dirs));
+    while (clipper.Step()) {
+      for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+        uint32_t child = children[num_dirs + i];
+        render_file_node(child, index.nodes[child].name.c_str());
+      }
     }
+    ImGui::TreePop();
+  }
+  ImGui::PopID();
+}
 
-    if (item.open && !directory_open) {
-      item.dir_items.reset();
-      item.file_items.reset();
-      item.open = directory_open;
-    }
+void BrowserWindow::render_file_node(uint32_t node_id, const char8_t* label) {
+  ImGui::TableNextRow();
+  ImGui::TableSetColumnIndex(0);
 
-    if (directory_open) {
-      if (item.dir_items)
-        for (auto& directory_item : *item.dir_items)
-          render_item(root_path, directory_item);
-      if (item.file_items)
-        for (auto& file_item : *item.file_items)
-          render_item(root_path, file_item);
-      ImGui::TreePop();
-    }
-    ImGui::PopID();
-  } else {
-    ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen |
-                               ImGuiTreeNodeFlags_SpanFullWidth | ImGuiTreeNodeFlags_FramePadding |
-                               ImGuiTreeNodeFlags_SpanAllColumns;
+  ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen |
+                             ImGuiTreeNodeFlags_SpanFullWidth | ImGuiTreeNodeFlags_FramePadding |
+                             ImGuiTreeNodeFlags_SpanAllColumns;
 
-    if (&item == selected_item)
-      flags |= ImGuiTreeNodeFlags_Selected;
+  if (node_id == selected_node)
+    flags |= ImGuiTreeNodeFlags_Selected;
 
-    ImGui::PushID((const void*)item.name.data());
-    ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(GImGui->Style.FramePadding.x, 2.0f));
-    ImGui::TreeNodeEx("##browser_item", flags, (const char*)item.name.data());
-    ImGui::PopStyleVar();
+  ImGui::PushID((int)node_id);
+  ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(GImGui->Style.FramePadding.x, 2.0f));
+  ImGui::TreeNodeEx("##browser_item", flags, "%s", (const char*)label);
+  ImGui::PopStyleVar();
 
-    if (ImGui::IsItemClicked(ImGuiMouseButton_Left)) {
-      selected_item = &item;
-    }
+  if (ImGui::IsItemClicked(ImGuiMouseButton_Left)) {
+    selected_node = node_id;
+    preview_file(node_id);
+  }
 
-    if (ImGui::IsItemClicked(ImGuiMouseButton_Right)) {
-      context_menu_path = item.get_file_path(root_path);
-      context_menu_item = &item;
-      open_context_menu = true;
-    }
+  if (ImGui::IsItemClicked(ImGuiMouseButton_Right)) {
+    context_menu_path = index.get_path(node_id);
+    context_menu_node = node_id;
+    open_context_menu = true;
+  }
 
-    if (ImGui::BeginDragDropSource()) {
-      dragging_item = &item;
-      is_dragging_item = true;
-      if (last_dragged_item != dragging_item) {
-        last_dragged_item = dragging_item;
-        if (last_dragged_item != nullptr) {
-          auto path = item.get_file_path(root_path);
-          auto [length, sample_rate] = get_item_content_info(path);
-          drop_payload.type = item.file_type;
-          drop_payload.content_length = length;
-          drop_payload.sample_rate = sample_rate;
-          drop_payload.path = std::move(path);
-        }
-      }
+  const BrowserNode& node = index.nodes[node_id];
+  if (node.file_type == BrowserNode::Sample && ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) {
+    // Look the info up again when the file index has been written, the file may have been (re)indexed since
+    uint32_t file_index_version = g_file_index.version.load(std::memory_order_acquire);
+    if (hovered_node != node_id || hovered_info_version != file_index_version) {
+      hovered_node = node_id;
+      hovered_info_version = file_index_version;
+      hovered_info = g_file_index.find_sample_info(index.get_path(node_id));
+    }
+    if (hovered_info)
+      ImGui::SetTooltip(
+          "%.2f s, %u Hz, %u ch", hovered_info->duration(), hovered_info->rate, hovered_info->channel_count);
+  }
 
-      BrowserFilePayload* payload = &drop_payload;
-      ImGui::SetDragDropPayload("WB_FILEDROP", &payload, sizeof(BrowserFilePayload*), ImGuiCond_Once);
-      ImGui::TextUnformatted((const char*)item.name.c_str(), (const char*)item.name.c_str() + item.name.size());
-      ImGui::EndDragDropSource();
+  if (ImGui::BeginDragDropSource()) {
+    dragging_node = node_id;
+    is_dragging_item = true;
+    if (last_dragged_node != dragging_node) {
+      last_dragged_node = dragging_node;
+      drop_payload.type = node.file_type;
+      drop_payload.content_length = 0.0;
+      drop_payload.sample_rate = 0.0;
+      drop_payload.path = index.get_path(node_id);
+      drop_payload_pending = node.file_type == BrowserNode::Sample;
     }
+    // Polled while dragging until the length is known, MIDI files have no sample info
+    if (drop_payload_pending)
+      drop_payload_pending = !get_item_content_info(drop_payload.path, drop_payload);
+
+    BrowserFilePayload* payload = &drop_payload;
+    ImGui::SetDragDropPayload("WB_FILEDROP", &payload, sizeof(BrowserFilePayload*), ImGuiCond_Once);
+    ImGui::TextUnformatted((const char*)node.name.c_str(), (const char*)node.name.c_str() + node.name.size());
+    ImGui::EndDragDropSource();
+  }
 
-    ImGui::TableSetColumnIndex(1);
-    ImGui::Text("%.2f %s", item.size.value, item.size.unit);
+  FileSize size(node.size);
+  ImGui::TableSetColumnIndex(1);
+  ImGui::Text("%.2f %s", size.value, size.unit);
 
-    ImGui::PopID();
-  }
+  ImGui::PopID();
 }
 
 void BrowserWindow::render() {
+  // The search runs again once per generation, results may point to removed nodes until then
+  index.apply_updates();
+  if (!search_text.empty() && search_generation != index.generation)
+    update_search();
+
   if (!controls::begin_window("Browser", &g_browser_window_open)) {
     controls::end_window();
     return;
@@ -183,8 +258,13 @@ void BrowserWindow::render() {
     sort_directory();
   }
 
+  ImGui::SameLine();
+  ImGui::SetNextItemWidth(-FLT_MIN);
+  if (ImGui::InputTextWithHint("##search", "Search files", &search_text))
+    update_search();
+
   is_dragging_item = false;
-  dragging_item = nullptr;
+  dragging_node = browser_invalid_node;
 
   static constexpr auto table_flags =
       ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY;
@@ -198,11 +278,23 @@ void BrowserWindow::render() {
     ImGui::TableHeadersRow();
 
     ImGui::PushStyleVar(ImGuiStyleVar_IndentSpacing, 8.0f);
-    for (uint32_t i = 0; i < directories.size(); i++) {
-      auto& dir = directories[i];
-      render_item(*dir.first, dir.second);
-      if (context_menu_item == &dir.second && context_menu_item->root_dir)
-        selected_root_dir = i;
+    if (!search_text.empty()) {
+      ImGuiListClipper clipper;
+      clipper.Begin((int)search_results.size());
+      while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+          uint32_t node = search_results[i].node;
+          if (index.is_valid(node))
+            render_file_node(node, index.nodes[node].name.c_str());
+        }
+      }
+    } else {
+      for (uint32_t i = 0; i < directories.size(); i++) {
+        auto& dir = directories[i];
+        render_node(dir.second);
+        if (context_menu_node == dir.second)
+          selected_root_dir = i;
+      }
     }
     ImGui::PopStyleVar();
 
@@ -221,8 +313,31 @@ void BrowserWindow::render() {
   }
   ImGui::PopStyleVar();
 
-  if (!is_dragging_item && last_dragged_item != nullptr) {
-    last_dragged_item = nullptr;
+  // Arrow keys move the selection and preview the next file, escape stops the preview
+  if (ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows)) {
+    if (index.is_valid(selected_node)) {
+      int32_t direction = 0;
+      if (ImGui::IsKeyPressed(ImGuiKey_DownArrow))
+        direction = 1;
+      else if (ImGui::IsKeyPressed(ImGuiKey_UpArrow))
+        direction = -1;
+      uint32_t adjacent = direction != 0 ? find_adjacent_file(selected_node, direction) : browser_invalid_node;
+      if (adjacent != browser_invalid_node) {
+        selected_node = adjacent;
+        preview_file(adjacent);
+      }
+    }
+    if (ImGui::IsKeyPressed(ImGuiKey_Escape))
+      g_engine.stop_preview();
+  }
+
+  if (index.is_scanning())
+    ImGui::TextDisabled("Indexing... (%u files)", index.num_files);
+  else
+    ImGui::TextDisabled("%u files", index.num_files);
+
+  if (!is_dragging_item && last_dragged_node != browser_invalid_node) {
+    last_dragged_node = browser_invalid_node;
   }
 
   if (open_context_menu) {
@@ -232,14 +347,19 @@ void BrowserWindow::render() {
 
   bool confirm_remove_directory = false;
 
-  if (ImGui::BeginPopup("browser_context_menu")) {
+  // The node may have been removed by the indexer while the menu is open
+  if (!index.is_valid(context_menu_node))
+    context_menu_node = browser_invalid_node;
+
+  if (context_menu_node != browser_invalid_node && ImGui::BeginPopup("browser_context_menu")) {
+    const BrowserNode& context_node = index.nodes[context_menu_node];
     ImGui::MenuItem("Copy path");
 
     if (ImGui::MenuItem("Open parent folder")) {
       explore_folder(context_menu_path.parent_path());
     }
 
-    if (context_menu_item->type == BrowserItem::Directory) {
+    if (context_node.type == BrowserNode::Directory) {
       if (ImGui::MenuItem("Open directory")) {
         explore_folder(context_menu_path);
       }
@@ -249,8 +369,11 @@ void BrowserWindow::render() {
       }
     }
 
-    if (context_menu_item->root_dir) {
+    if (context_node.parent == browser_invalid_node) {
       ImGui::Separator();
+      if (ImGui::MenuItem("Refresh")) {
+        index.rescan(context_menu_node);
+      }
       if (ImGui::MenuItem("Remove from browser")) {
         confirm_remove_directory = true;
       }
@@ -258,7 +381,7 @@ void BrowserWindow::render() {
 
     ImGui::EndPopup();
   } else {
-    context_menu_item = nullptr;
+    context_menu_node = browser_invalid_node;
   }
 
   if (confirm_remove_directory) {
@@ -4,9 +4,12 @@
 
 #include <filesystem>
 #include <optional>
+#include <string>
 #include <unordered_set>
 
+#include "browser_index.h"
 #include "core/common.h"
+#include "dsp/sample.h"
 #include "engine/track.h"
 
 namespace wb {
@@ -35,46 +38,8 @@ struct FileSize {
   }
 };
 
-struct BrowserItem {
-  enum Type {
-    Directory,
-    File,
-  };
-
-  enum FileType {
-    Unknown,
-    Sample,
-    Midi,
-  };
-
-  Type type;
-  FileType file_type;
-  BrowserItem* parent;
-  FileSize size;
-  std::u8string name;
-  bool root_dir;
-  bool open;
-  std::optional<std::vector<BrowserItem>> dir_items;
-  std::optional<std::vector<BrowserItem>> file_items;
-
-  std::filesystem::path get_file_path(const std::filesystem::path& root) const {
-    std::filesystem::path ret;
-    const BrowserItem* item = this;
-    while (item != nullptr) {
-      ret = (item != this) ? std::filesystem::path(item->name) / ret : std::filesystem::path(item->name);
-      item = item->parent;
-    }
-    return root.parent_path() / ret;
-  }
-};
-
-struct BrowserDir {
-  std::filesystem::path path;
-  BrowserItem item;
-};
-
 struct BrowserFilePayload {
-  BrowserItem::FileType type;
+  BrowserNode::FileType type;
   double content_length;
   double sample_rate;
   std::filesystem::path path;
@@ -82,27 +47,46 @@ struct BrowserFilePayload {
 
 struct BrowserWindow {
   using DirectorySet = std::unordered_set<std::filesystem::path>;
-  using DirectoryRefItem = std::pair<DirectorySet::iterator, BrowserItem>;
+  using DirectoryRefItem = std::pair<DirectorySet::iterator, uint32_t>;  // Root path, root node
   DirectorySet directory_set;
   std::vector<DirectoryRefItem> directories;
+  BrowserIndex index;
+
+  std::string search_text;
+  Vector<BrowserSearchResult> search_results;
+  uint64_t search_generation = 0;
 
   bool open_context_menu = false;
   std::filesystem::path context_menu_path;
-  BrowserItem* context_menu_item = nullptr;
+  uint32_t context_menu_node = browser_invalid_node;
   uint32_t selected_root_dir;
 
   bool is_dragging_item = false;
-  BrowserItem* last_dragged_item = nullptr;
-  BrowserItem* dragging_item = nullptr;
-  BrowserItem* selected_item = nullptr;
+  uint32_t last_dragged_node = browser_invalid_node;
+  uint32_t dragging_node = browser_invalid_node;
+  uint32_t selected_node = browser_invalid_node;
   BrowserFilePayload drop_payload;
+  bool drop_payload_pending = false;  // Waiting for the file index to provide the sample length
+  uint32_t hovered_node = browser_invalid_node;
+  std::optional<SampleInfo> hovered_info;
+  uint32_t hovered_info_version = 0;
 
   BrowserWindow();
+
+  // Load the cached directory tree and start indexing. Directories have to be added before this.
+  void init();
+  void shutdown();
   void add_directory(const std::filesystem::path& path);
   void remove_directory(std::vector<DirectoryRefItem>::iterator dir);
   void sort_directory();
-  void glob_path(const std::filesystem::path& path, BrowserItem& item);
-  void render_item(const std::filesystem::path& root_path, BrowserItem& item);
+  void update_search();
+
+  // Play a sample file through the engine's preview voice and prefetch its neighbours.
+  void preview_file(uint32_t node_id);
+  uint32_t find_adjacent_file(uint32_t node_id, int32_t direction) const;
+
+  void render_node(uint32_t node_id);
+  void render_file_node(uint32_t node_id, const char8_t* label);
   void render();
 };
 
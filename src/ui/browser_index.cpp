@@ -0,0 +1,737 @@
+#include "browser_index.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_set>
+
+#include "core/algorithm.h"
+#include "core/byte_buffer.h"
+#include "core/debug.h"
+#include "core/fs.h"
+#include "core/stream.h"
+#include "core/thread.h"
+#include "engine/file_index.h"
+
+#ifdef WB_PLATFORM_LINUX
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace wb {
+
+static constexpr uint32_t browser_index_magic = fourcc("WBBI");
+static constexpr uint32_t browser_index_version = 1;
+static constexpr uint32_t browser_index_max_depth = 256;
+
+static inline int compare_entry(BrowserNode::Type a_type, std::u8string_view a_name, BrowserNode::Type b_type,
+                                std::u8string_view b_name) {
+  if (a_type != b_type)
+    return a_type < b_type ? -1 : 1;
+  return a_name.compare(b_name);
+}
+
+static inline char8_t to_lower_ascii(char8_t ch) {
+  return (ch >= u8'A' && ch <= u8'Z') ? ch + (u8'a' - u8'A') : ch;
+}
+
+static inline bool is_word_boundary(std::u8string_view name, size_t pos) {
+  if (pos == 0)
+    return true;
+  char8_t prev = name[pos - 1];
+  return prev == u8' ' || prev == u8'_' || prev == u8'-' || prev == u8'.' || prev == u8'(' || prev == u8'[';
+}
+
+int32_t browser_match_score(std::u8string_view name, std::u8string_view query) {
+  if (query.empty())
+    return 0;
+  if (query.size() > name.size())
+    return -1;
+
+  // Shorter names rank higher among matches of the same kind
+  int32_t length_penalty = (int32_t)std::min<size_t>(name.size(), 200) / 4;
+
+  for (size_t pos = 0; pos + query.size() <= name.size(); pos++) {
+    size_t i = 0;
+    while (i < query.size() && to_lower_ascii(name[pos + i]) == query[i])
+      i++;
+    if (i == query.size()) {
+      int32_t score = 2000 - (int32_t)std::min<size_t>(pos, 100) - length_penalty;
+      if (pos == 0)
+        score += 500;
+      else if (is_word_boundary(name, pos))
+        score += 200;
+      return score;
+    }
+  }
+
+  // Subsequence match, consecutive characters and word starts are rewarded
+  int32_t score = 0;
+  size_t query_pos = 0;
+  size_t last_match = std::u8string_view::npos;
+  for (size_t pos = 0; pos < name.size() && query_pos < query.size(); pos++) {
+    if (to_lower_ascii(name[pos]) != query[query_pos])
+      continue;
+    score += 10;
+    if (last_match != std::u8string_view::npos && last_match + 1 == pos)
+      score += 15;
+    if (is_word_boundary(name, pos))
+      score += 20;
+    last_match = pos;
+    query_pos++;
+  }
+  if (query_pos != query.size())
+    return -1;
+  return std::clamp(score - length_penalty, 0, 1999);
+}
+
+BrowserNode::FileType browser_file_type(const fs::path& ext) {
+  if (is_sample_file_extension(ext))
+    return BrowserNode::Sample;
+  if (any_of(ext, ".mid", ".midi"))
+    return BrowserNode::Midi;
+  return BrowserNode::Unknown;
+}
+
+BrowserIndex::~BrowserIndex() {
+  stop();
+}
+
+void BrowserIndex::start() {
+  if (worker.joinable())
+    return;
+
+#ifdef WB_PLATFORM_LINUX
+  inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd < 0)
+    Log::warn("Cannot initialize inotify, browser directories will not be updated automatically");
+#endif
+
+  {
+    std::lock_guard lock(mtx);
+    for (uint32_t root : roots)
+      pending_scans.push_back(get_path(root));
+  }
+  stop_worker.store(false, std::memory_order_relaxed);
+  worker = std::thread([this] { worker_thread_(); });
+}
+
+void BrowserIndex::stop() {
+  if (!worker.joinable())
+    return;
+  stop_worker.store(true, std::memory_order_relaxed);
+  {
+    std::lock_guard lock(mtx);
+    cv.notify_all();
+  }
+  worker.join();
+
+#ifdef WB_PLATFORM_LINUX
+  if (inotify_fd >= 0) {
+    close(inotify_fd);
+    inotify_fd = -1;
+  }
+  watches.clear();
+#endif
+}
+
+uint32_t BrowserIndex::add_root(const fs::path& path) {
+  std::u8string name = path.generic_u8string();
+  for (uint32_t root : roots)
+    if (nodes[root].name == name)
+      return root;
+
+  uint32_t root = create_node_(
+      browser_invalid_node,
+      Entry{
+        .name = std::move(name),
+        .size = 0,
+        .type = BrowserNode::Directory,
+        .file_type = BrowserNode::Unknown,
+      });
+  roots.push_back(root);
+  version++;
+
+  if (worker.joinable()) {
+    std::lock_guard lock(mtx);
+    pending_scans.push_back(path);
+    cv.notify_all();
+  }
+  return root;
+}
+
+void BrowserIndex::remove_root(uint32_t root) {
+  auto it = std::find(roots.begin(), roots.end(), root);
+  if (it == roots.end())
+    return;
+  fs::path path = get_path(root);
+  roots.erase(it);
+  free_node_(root);
+  version++;
+
+  if (worker.joinable()) {
+    std::lock_guard lock(mtx);
+    pending_unwatches.push_back(std::move(path));
+    cv.notify_all();
+  }
+}
+
+void BrowserIndex::rescan(uint32_t root) {
+  if (!worker.joinable() || !is_valid(root))
+    return;
+  std::lock_guard lock(mtx);
+  pending_scans.push_back(get_path(root));
+  cv.notify_all();
+}
+
+bool BrowserIndex::apply_updates(uint32_t max_entries) {
+  if (update_offset == applying_updates.size()) {
+    applying_updates.clear();
+    update_offset = 0;
+    std::lock_guard lock(mtx);
+    if (updates.empty())
+      return false;
+    std::swap(applying_updates, updates);
+  }
+
+  uint32_t num_entries = 0;
+  uint64_t old_version = version;
+  while (update_offset < applying_updates.size() && num_entries < max_entries) {
+    Update& update = applying_updates[update_offset++];
+    if (update.kind == Update::Sync) {
+      generation++;
+      continue;
+    }
+    uint32_t node = find_node(update.path);
+    if (!is_valid(node))
+      continue;
+    switch (update.kind) {
+      case Update::Scan:
+        if (nodes[node].type == BrowserNode::Directory) {
+          num_entries += update.entries.size();
+          merge_scan_(node, update.entries);
+        }
+        break;
+      case Update::Add:
+        if (nodes[node].type == BrowserNode::Directory && !update.entries.empty())
+          add_entry_(node, update.entries[0]);
+        num_entries++;
+        break;
+      case Update::Remove:
+        if (nodes[node].parent != browser_invalid_node)
+          remove_node_(node);
+        num_entries++;
+        break;
+      default: break;
+    }
+  }
+
+  return version != old_version;
+}
+
+void BrowserIndex::search(std::u8string_view query, Vector<BrowserSearchResult>& results, uint32_t max_results)
+    const {
+  results.clear();
+  std::u8string lowercase_query(query);
+  for (auto& ch : lowercase_query)
+    ch = to_lower_ascii(ch);
+
+  for (uint32_t i = 0; i < nodes.size(); i++) {
+    const BrowserNode& node = nodes[i];
+    if (!node.alive || node.type != BrowserNode::File)
+      continue;
+    int32_t score = browser_match_score(node.name, lowercase_query);
+    if (score >= 0)
+      results.push_back({ .node = i, .score = score });
+  }
+
+  auto compare_result = [this](const BrowserSearchResult& a, const BrowserSearchResult& b) {
+    if (a.score != b.score)
+      return a.score > b.score;
+    return nodes[a.node].name < nodes[b.node].name;
+  };
+  if (results.size() > max_results) {
+    std::partial_sort(results.begin(), results.begin() + max_results, results.end(), compare_result);
+    results.resize(max_results);
+  } else {
+    std::sort(results.begin(), results.end(), compare_result);
+  }
+}
+
+fs::path BrowserIndex::get_path(uint32_t node) const {
+  if (!is_valid(node))
+    return {};
+  Vector<uint32_t> path_nodes;
+  while (node != browser_invalid_node) {
+    path_nodes.push_back(node);
+    node = nodes[node].parent;
+  }
+  fs::path path;
+  for (uint32_t i = path_nodes.size(); i > 0; i--)
+    path /= nodes[path_nodes[i - 1]].name;
+  return path;
+}
+
+uint32_t BrowserIndex::find_node(const fs::path& path) const {
+  std::u8string path_str = path.generic_u8string();
+  while (path_str.size() > 1 && path_str.back() == u8'/')
+    path_str.pop_back();
+
+  for (uint32_t root : roots) {
+    std::u8string_view root_name = nodes[root].name;
+    if (!path_str.starts_with(root_name))
+      continue;
+    std::u8string_view relative = std::u8string_view(path_str).substr(root_name.size());
+    if (relative.empty())
+      return root;
+    if (relative.front() != u8'/' && root_name.back() != u8'/')
+      continue;
+
+    // Walk down the tree one path component at a time
+    uint32_t node = root;
+    while (!relative.empty() && node != browser_invalid_node) {
+      if (relative.front() == u8'/')
+        relative.remove_prefix(1);
+      size_t separator = relative.find(u8'/');
+      std::u8string_view component = relative.substr(0, separator);
+      relative = separator != std::u8string_view::npos ? relative.substr(separator) : std::u8string_view();
+      if (component.empty())
+        continue;
+      uint32_t child = find_child_(node, BrowserNode::Directory, component);
+      if (child == browser_invalid_node && relative.empty())
+        child = find_child_(node, BrowserNode::File, component);
+      node = child;
+    }
+    if (node != browser_invalid_node)
+      return node;
+  }
+
+  return browser_invalid_node;
+}
+
+static void write_node(ByteBuffer& buffer, const BrowserIndex& index, uint32_t node_id) {
+  const BrowserNode& node = index.nodes[node_id];
+  io_write(buffer, node.name);
+  io_write(buffer, node.size);
+  io_write(buffer, node.type);
+  io_write(buffer, node.file_type);
+  io_write(buffer, node.children.size());
+  for (uint32_t child : node.children)
+    write_node(buffer, index, child);
+}
+
+static bool read_node(ByteBuffer& buffer, BrowserIndex& index, uint32_t parent, uint32_t depth, uint32_t* node_id) {
+  BrowserIndex::Entry entry;
+  uint32_t num_children;
+  if (depth > browser_index_max_depth || !io_read(buffer, &entry.name) || !io_read(buffer, &entry.size) ||
+      !io_read(buffer, &entry.type) || !io_read(buffer, &entry.file_type) || !io_read(buffer, &num_children))
+    return false;
+  if (entry.type > BrowserNode::File || num_children > buffer.size() - buffer.position())
+    return false;
+
+  uint32_t node = index.create_node_(parent, entry);
+  *node_id = node;
+  index.nodes[node].children.reserve(num_children);
+  for (uint32_t i = 0; i < num_children; i++) {
+    uint32_t child = browser_invalid_node;
+    bool success = read_node(buffer, index, node, depth + 1, &child);
+    if (child != browser_invalid_node)
+      index.nodes[node].children.push_back(child);
+    if (!success)
+      return false;
+  }
+  return true;
+}
+
+bool BrowserIndex::save(const fs::path& path) const {
+  ByteBuffer buffer(64 * 1024);
+  io_write(buffer, browser_index_magic);
+  io_write(buffer, browser_index_version);
+  io_write(buffer, roots.size());
+  for (uint32_t root : roots)
+    write_node(buffer, *this, root);
+  return write_file_atomic(path, buffer.data(), buffer.position());
+}
+
+bool BrowserIndex::load(const fs::path& path) {
+  MappedFile file;
+  if (!file.open(path))
+    return false;
+
+  ByteBuffer buffer;
+  buffer.wrap((std::byte*)file.data(), file.size());
+  uint32_t magic, file_version, num_roots;
+  if (!io_read(buffer, &magic) || magic != browser_index_magic || !io_read(buffer, &file_version) ||
+      file_version != browser_index_version || !io_read(buffer, &num_roots))
+    return false;
+
+  for (uint32_t i = 0; i < num_roots; i++) {
+    uint32_t cached_root = browser_invalid_node;
+    bool success = read_node(buffer, *this, browser_invalid_node, 0, &cached_root);
+    if (cached_root == browser_invalid_node)
+      return false;
+
+    // Move the cached tree into the root added by the browser
+    BrowserNode& cached = nodes[cached_root];
+    auto root = std::find_if(roots.begin(), roots.end(), [&](uint32_t root) { return nodes[root].name == cached.name; });
+    if (success && root != roots.end() && nodes[*root].children.empty()) {
+      for (uint32_t child : cached.children)
+        nodes[child].parent = *root;
+      nodes[*root].children = std::move(cached.children);
+    }
+    free_node_(cached_root);
+    if (!success) {
+      Log::warn("Browser index cache is corrupted: {}", path.string());
+      return false;
+    }
+  }
+
+  version++;
+  return true;
+}
+
+uint32_t BrowserIndex::create_node_(uint32_t parent, const Entry& entry) {
+  uint32_t id;
+  if (!free_nodes.empty()) {
+    id = free_nodes.back();
+    free_nodes.pop_back();
+  } else {
+    id = nodes.size();
+    nodes.emplace_back();
+  }
+  BrowserNode& node = nodes[id];
+  node.name = entry.name;
+  node.parent = parent;
+  node.size = entry.size;
+  node.type = entry.type;
+  node.file_type = entry.file_type;
+  node.alive = true;
+  if (entry.type == BrowserNode::File)
+    num_files++;
+  return id;
+}
+
+void BrowserIndex::free_node_(uint32_t node_id) {
+  BrowserNode& node = nodes[node_id];
+  for (uint32_t child : node.children)
+    free_node_(child);
+  if (node.type == BrowserNode::File)
+    num_files--;
+  node.name.clear();
+  node.children.clear();
+  node.parent = browser_invalid_node;
+  node.alive = false;
+  free_nodes.push_back(node_id);
+}
+
+uint32_t BrowserIndex::find_child_(uint32_t parent, BrowserNode::Type type, std::u8string_view name) const {
+  const Vector<uint32_t>& children = nodes[parent].children;
+  auto it = std::lower_bound(children.begin(), children.end(), name, [&](uint32_t child, std::u8string_view name) {
+    return compare_entry(nodes[child].type, nodes[child].name, type, name) < 0;
+  });
+  if (it != children.end() && nodes[*it].type == type && nodes[*it].name == name)
+    return *it;
+  return browser_invalid_node;
+}
+
+void BrowserIndex::merge_scan_(uint32_t dir, Vector<Entry>& entries) {
+  std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+    return compare_entry(a.type, a.name, b.type, b.name) < 0;
+  });
+
+  // Both lists are sorted, unchanged nodes are kept so the UI state attached to them survives the scan
+  Vector<uint32_t> old_children = std::move(nodes[dir].children);
+  Vector<uint32_t> new_children;
+  new_children.reserve(entries.size());
+  uint32_t i = 0;
+  uint32_t j = 0;
+  while (i < old_children.size() || j < entries.size()) {
+    int cmp;
+    if (i == old_children.size())
+      cmp = 1;
+    else if (j == entries.size())
+      cmp = -1;
+    else
+      cmp = compare_entry(nodes[old_children[i]].type, nodes[old_children[i]].name, entries[j].type, entries[j].name);
+
+    if (cmp < 0) {
+      free_node_(old_children[i++]);
+    } else if (cmp > 0) {
+      new_children.push_back(create_node_(dir, entries[j++]));
+    } else {
+      BrowserNode& node = nodes[old_children[i]];
+      node.size = entries[j].size;
+      node.file_type = entries[j].file_type;
+      new_children.push_back(old_children[i]);
+      i++;
+      j++;
+    }
+  }
+
+  nodes[dir].children = std::move(new_children);
+  version++;
+}
+
+void BrowserIndex::add_entry_(uint32_t dir, const Entry& entry) {
+  Vector<uint32_t>& children = nodes[dir].children;
+  auto it = std::lower_bound(children.begin(), children.end(), entry, [&](uint32_t child, const Entry& entry) {
+    return compare_entry(nodes[child].type, nodes[child].name, entry.type, entry.name) < 0;
+  });
+  if (it != children.end() && nodes[*it].type == entry.type && nodes[*it].name == entry.name) {
+    nodes[*it].size = entry.size;
+    nodes[*it].file_type = entry.file_type;
+  } else {
+    uint32_t index = (uint32_t)(it - children.begin());
+    uint32_t node = create_node_(dir, entry);
+    nodes[dir].children.emplace_at(index, node);
+  }
+  version++;
+}
+
+void BrowserIndex::remove_node_(uint32_t node) {
+  Vector<uint32_t>& siblings = nodes[nodes[node].parent].children;
+  auto it = std::find(siblings.begin(), siblings.end(), node);
+  if (it != siblings.end())
+    siblings.erase(it);
+  free_node_(node);
+  version++;
+}
+
+void BrowserIndex::push_update_(Update&& update) {
+  std::lock_guard lock(mtx);
+  updates.push_back(std::move(update));
+}
+
+void BrowserIndex::scan_directory_(const fs::path& root) {
+  // Long scans are synced periodically, so the search picks up files while indexing without running every frame
+  static constexpr auto sync_interval = std::chrono::milliseconds(500);
+  Vector<fs::path> stack;
+  std::unordered_set<fs::path::string_type> visited_links;
+  stack.push_back(root);
+  auto last_sync = std::chrono::steady_clock::now();
+
+  while (!stack.empty() && !stop_worker.load(std::memory_order_relaxed)) {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_sync >= sync_interval) {
+      push_update_({ .kind = Update::Sync });
+      last_sync = now;
+    }
+
+    fs::path dir = std::move(stack.back());
+    stack.pop_back();
+    watch_directory_(dir);
+
+    Update update{ .kind = Update::Scan, .path = dir };
+    std::error_code ec;
+    fs::directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec);
+    for (; !ec && it != fs::directory_iterator(); it.increment(ec)) {
+      const fs::directory_entry& dir_entry = *it;
+      std::error_code entry_ec;
+      if (dir_entry.is_directory(entry_ec)) {
+        // Symlinked directories are followed once to avoid cycles
+        if (dir_entry.is_symlink(entry_ec)) {
+          fs::path target = fs::canonical(dir_entry.path(), entry_ec);
+          if (entry_ec || !visited_links.insert(target.native()).second)
+            continue;
+        }
+        update.entries.push_back({
+          .name = dir_entry.path().filename().generic_u8string(),
+          .size = 0,
+          .type = BrowserNode::Directory,
+          .file_type = BrowserNode::Unknown,
+        });
+        stack.push_back(dir_entry.path());
+      } else if (dir_entry.is_regular_file(entry_ec)) {
+        fs::path filename = dir_entry.path().filename();
+        BrowserNode::FileType file_type = browser_file_type(filename.extension());
+        if (file_type == BrowserNode::Unknown)
+          continue;
+        uint64_t size = dir_entry.file_size(entry_ec);
+        update.entries.push_back({
+          .name = filename.generic_u8string(),
+          .size = entry_ec ? 0 : size,
+          .type = BrowserNode::File,
+          .file_type = file_type,
+        });
+      }
+    }
+
+    push_update_(std::move(update));
+  }
+}
+
+#ifdef WB_PLATFORM_LINUX
+
+void BrowserIndex::watch_directory_(const fs::path& path) {
+  if (inotify_fd < 0)
+    return;
+  static constexpr uint32_t watch_mask =
+      IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ONLYDIR | IN_EXCL_UNLINK;
+  int wd = inotify_add_watch(inotify_fd, path.c_str(), watch_mask);
+  if (wd < 0) {
+    if (errno == ENOSPC)
+      Log::warn("inotify watch limit reached, {} will not be updated automatically", path.string());
+    return;
+  }
+  watches[wd] = path;
+}
+
+void BrowserIndex::unwatch_directory_(const fs::path& path) {
+  std::string prefix = path.generic_string();
+  if (prefix.empty() || prefix.back() != '/')
+    prefix.push_back('/');
+  for (auto it = watches.begin(); it != watches.end();) {
+    std::string watch_path = it->second.generic_string();
+    if (watch_path == path.generic_string() || watch_path.starts_with(prefix)) {
+      inotify_rm_watch(inotify_fd, it->first);
+      it = watches.erase(it);
+    } else {
+      it++;
+    }
+  }
+}
+
+void BrowserIndex::read_events_() {
+  if (inotify_fd < 0) {
+    std::unique_lock lock(mtx);
+    cv.wait_for(lock, std::chrono::milliseconds(100));
+    return;
+  }
+
+  pollfd poll_fd{ .fd = inotify_fd, .events = POLLIN, .revents = 0 };
+  if (poll(&poll_fd, 1, 100) <= 0)
+    return;
+
+  alignas(inotify_event) char buffer[16384];
+  bool overflow = false;
+  for (;;) {
+    ssize_t num_read = read(inotify_fd, buffer, sizeof(buffer));
+    if (num_read <= 0)
+      break;
+
+    for (char* ptr = buffer; ptr < buffer + num_read;) {
+      const inotify_event* event = (const inotify_event*)ptr;
+      ptr += sizeof(inotify_event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        overflow = true;
+        continue;
+      }
+
+      auto watch = watches.find(event->wd);
+      if (watch == watches.end())
+        continue;
+      if (event->mask & IN_IGNORED) {
+        watches.erase(watch);
+        continue;
+      }
+      if (event->len == 0)
+        continue;
+
+      fs::path dir = watch->second;
+      fs::path path = dir / event->name;
+      if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        // Watches of a moved directory follow the inode and would keep reporting the old paths. Drop them, the
+        // destination is rescanned and watched again on IN_MOVED_TO.
+        if ((event->mask & (IN_MOVED_FROM | IN_ISDIR)) == (IN_MOVED_FROM | IN_ISDIR))
+          unwatch_directory_(path);
+        push_update_({ .kind = Update::Remove, .path = std::move(path) });
+      } else if (event->mask & IN_ISDIR) {
+        if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+          Update update{ .kind = Update::Add, .path = std::move(dir) };
+          update.entries.push_back({
+            .name = path.filename().generic_u8string(),
+            .size = 0,
+            .type = BrowserNode::Directory,
+            .file_type = BrowserNode::Unknown,
+          });
+          push_update_(std::move(update));
+          scan_directory_(path);
+        }
+      } else if (event->mask & (IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE)) {
+        BrowserNode::FileType file_type = browser_file_type(path.extension());
+        std::error_code ec;
+        uint64_t size = fs::file_size(path, ec);
+        if (file_type == BrowserNode::Unknown || ec)
+          continue;
+        Update update{ .kind = Update::Add, .path = std::move(dir) };
+        update.entries.push_back({
+          .name = path.filename().generic_u8string(),
+          .size = size,
+          .type = BrowserNode::File,
+          .file_type = file_type,
+        });
+        push_update_(std::move(update));
+      }
+    }
+  }
+
+  // Events have been lost. The scan is recursive, so every root is scanned once instead of every watched directory.
+  if (overflow) {
+    Log::warn("inotify queue overflow, rescanning browser directories");
+    for (const auto& root : scanned_roots)
+      scan_directory_(root);
+  }
+  push_update_({ .kind = Update::Sync });
+}
+
+#else
+
+// No file system notifications, directories are only updated by rescan()
+
+void BrowserIndex::watch_directory_(const fs::path& path) {
+}
+
+void BrowserIndex::unwatch_directory_(const fs::path& path) {
+}
+
+void BrowserIndex::read_events_() {
+  std::unique_lock lock(mtx);
+  cv.wait_for(lock, std::chrono::milliseconds(100));
+}
+
+#endif
+
+void BrowserIndex::worker_thread_() {
+#ifndef NDEBUG
+  set_current_thread_name("Whitebox Browser Indexer");
+#endif
+
+  while (!stop_worker.load(std::memory_order_relaxed)) {
+    Vector<fs::path> scans;
+    Vector<fs::path> unwatches;
+    {
+      std::lock_guard lock(mtx);
+      scans = std::move(pending_scans);
+      unwatches = std::move(pending_unwatches);
+    }
+
+    // Only roots are queued, subdirectories are scanned directly by the watcher
+    for (const auto& path : unwatches) {
+      unwatch_directory_(path);
+      auto root = std::find(scanned_roots.begin(), scanned_roots.end(), path);
+      if (root != scanned_roots.end())
+        scanned_roots.erase(root);
+    }
+
+    if (!scans.empty()) {
+      scanning.store(true, std::memory_order_relaxed);
+      for (const auto& path : scans) {
+        if (std::find(scanned_roots.begin(), scanned_roots.end(), path) == scanned_roots.end())
+          scanned_roots.push_back(path);
+        scan_directory_(path);
+      }
+      push_update_({ .kind = Update::Sync });
+      scanning.store(false, std::memory_order_relaxed);
+      continue;
+    }
+
+    read_events_();
+  }
+}
+
+}  // namespace wb
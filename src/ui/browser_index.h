@@ -0,0 +1,170 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "core/common.h"
+#include "core/vector.h"
+
+namespace wb {
+
+static constexpr uint32_t browser_invalid_node = ~0U;
+
+struct BrowserNode {
+  enum Type : uint8_t {
+    Directory,
+    File,
+  };
+
+  enum FileType : uint8_t {
+    Unknown,
+    Sample,
+    Midi,
+  };
+
+  std::u8string name;        // Root nodes store the full root path
+  uint32_t parent;
+  Vector<uint32_t> children;  // Directories first, then files, both sorted by name
+  uint64_t size;
+  Type type;
+  FileType file_type;
+  bool alive;
+};
+
+struct BrowserSearchResult {
+  uint32_t node;
+  int32_t score;
+};
+
+// In-memory tree of the browser's library roots. Directory enumeration and file system watching are done by a
+// background thread, which only produces updates. The tree itself is owned by the UI thread and updates are merged
+// into it by apply_updates(), so rendering never waits on the file system.
+//
+// Directories are only watched on Linux (inotify). On other platforms changes show up when the root is scanned again
+// with rescan().
+//
+// The tree is saved between runs. A cached root is shown immediately and reconciled by one background scan.
+struct BrowserIndex {
+  struct Entry {
+    std::u8string name;
+    uint64_t size;
+    BrowserNode::Type type;
+    BrowserNode::FileType file_type;
+  };
+
+  struct Update {
+    enum Kind : uint8_t {
+      Scan,    // Replace the contents of a directory
+      Add,     // Add or update a single entry
+      Remove,  // Remove a file or a directory
+      Sync,    // End of a scan or of a batch of file system events
+    };
+    Kind kind;
+    std::filesystem::path path;
+    Vector<Entry> entries;
+  };
+
+  Vector<BrowserNode> nodes;
+  Vector<uint32_t> free_nodes;
+  Vector<uint32_t> roots;
+  uint64_t version = 0;     // Changes whenever the tree is modified
+  uint64_t generation = 0;  // Changes when a scan or a batch of events has been merged, at most a few times a second
+  uint32_t num_files = 0;
+
+  std::thread worker;
+  std::mutex mtx;
+  std::condition_variable cv;
+  Vector<std::filesystem::path> pending_scans;
+  Vector<std::filesystem::path> pending_unwatches;
+  Vector<std::filesystem::path> scanned_roots;  // Owned by the background thread
+  Vector<Update> updates;           // Produced by the background thread
+  Vector<Update> applying_updates;  // Being merged by the UI thread
+  uint32_t update_offset = 0;
+  std::atomic_bool stop_worker;
+  std::atomic_bool scanning;
+
+#ifdef WB_PLATFORM_LINUX
+  int inotify_fd = -1;
+  std::unordered_map<int, std::filesystem::path> watches;
+#endif
+
+  BrowserIndex() = default;
+  BrowserIndex(const BrowserIndex&) = delete;
+  ~BrowserIndex();
+
+  // Start the background thread and scan every root.
+  void start();
+  void stop();
+
+  /**
+   * @brief Add a library root. The root is scanned in the background once the index has been started.
+   *
+   * @param path Root directory.
+   * @return Root node.
+   */
+  uint32_t add_root(const std::filesystem::path& path);
+  void remove_root(uint32_t root);
+
+  // Scan the root again, useful on platforms without file system notifications.
+  void rescan(uint32_t root);
+
+  /**
+   * @brief Merge updates produced by the background thread into the tree. Must be called from the UI thread.
+   *
+   * @param max_entries Maximum number of directory entries to merge, the rest is merged by the next call.
+   * @return True if the tree has been modified.
+   */
+  bool apply_updates(uint32_t max_entries = 4096);
+
+  /**
+   * @brief Search all indexed files by name. Substring matches rank first, then fuzzy (subsequence) matches.
+   * Matching is case-insensitive.
+   *
+   * @param query Search query.
+   * @param results Receives the matching files sorted by score.
+   * @param max_results Maximum number of results.
+   */
+  void search(std::u8string_view query, Vector<BrowserSearchResult>& results, uint32_t max_results = 1000) const;
+
+  std::filesystem::path get_path(uint32_t node) const;
+  uint32_t find_node(const std::filesystem::path& path) const;
+
+  inline bool is_valid(uint32_t node) const {
+    return node < nodes.size() && nodes[node].alive;
+  }
+
+  inline bool is_scanning() const {
+    return scanning.load(std::memory_order_relaxed);
+  }
+
+  bool save(const std::filesystem::path& path) const;
+
+  // Load the cached tree of the roots that have been added so far. Cached roots that are not in the browser anymore
+  // are dropped.
+  bool load(const std::filesystem::path& path);
+
+  uint32_t create_node_(uint32_t parent, const Entry& entry);
+  void free_node_(uint32_t node);
+  uint32_t find_child_(uint32_t parent, BrowserNode::Type type, std::u8string_view name) const;
+  void merge_scan_(uint32_t dir, Vector<Entry>& entries);
+  void add_entry_(uint32_t dir, const Entry& entry);
+  void remove_node_(uint32_t node);
+  void push_update_(Update&& update);
+  void scan_directory_(const std::filesystem::path& root);
+  void watch_directory_(const std::filesystem::path& path);
+  void unwatch_directory_(const std::filesystem::path& path);
+  void read_events_();
+  void worker_thread_();
+};
+
+// Fuzzy match score of a name against a lowercase query, or -1 if the name does not match.
+int32_t browser_match_score(std::u8string_view name, std::u8string_view query);
+
+BrowserNode::FileType browser_file_type(const std::filesystem::path& ext);
+
+}  // namespace wb
@@ -185,6 +185,17 @@ static void clip_editor_mute_selected_notes(bool should_mute) {
   force_redraw = true;
 }
 
+static void clip_editor_transform_selected_notes(const std::string& name, const NoteTransform& transform) {
+  MidiTransformNoteCmd* cmd = new MidiTransformNoteCmd();
+  cmd->track_id = current_track_id.value();
+  cmd->clip_id = current_clip_id.value();
+  cmd->transform = transform;
+  g_cmd_manager.execute(name, cmd);
+  g_timeline.redraw_screen();
+  clip_editor_recalculate_length();
+  force_redraw = true;
+}
+
 static void clip_editor_prepare_move() {
   MidiData* midi_data = current_clip->get_midi_data();
   uint32_t num_selected = midi_data->num_selected;
@@ -1697,7 +1708,28 @@ static void clip_editor_render_context_menu() {
       }
     }
     ImGui::Separator();
-    ImGui::MenuItem("Quantize");
+    bool has_selection = midi_data->num_selected > 0;
+    NoteTransform transform;
+    if (ImGui::MenuItem("Quantize", nullptr, false, has_selection)) {
+      transform.type = NoteTransformType::Quantize;
+      transform.quantize = { .grid = 1.0 / clip_editor_base.beat_division, .strength = 1.0f, .quantize_end = false };
+      clip_editor_transform_selected_notes("Clip editor: Quantize", transform);
+    }
+    if (ImGui::MenuItem("Legato", nullptr, false, has_selection)) {
+      transform.type = NoteTransformType::Legato;
+      transform.legato = { .gap = 0.0 };
+      clip_editor_transform_selected_notes("Clip editor: Legato", transform);
+    }
+    if (ImGui::MenuItem("Transpose octave up", nullptr, false, has_selection)) {
+      transform.type = NoteTransformType::Transpose;
+      transform.transpose = { .semitones = 12 };
+      clip_editor_transform_selected_notes("Clip editor: Transpose", transform);
+    }
+    if (ImGui::MenuItem("Transpose octave down", nullptr, false, has_selection)) {
+      transform.type = NoteTransformType::Transpose;
+      transform.transpose = { .semitones = -12 };
+      clip_editor_transform_selected_notes("Clip editor: Transpose", transform);
+    }
     ImGui::EndPopup();
   }
 }
@@ -1,17 +1,335 @@
 #include "command.h"
 
+#include "core/stream.h"
 #include "engine/clip_edit.h"
 #include "engine/engine.h"
 #include "engine/track.h"
 
 namespace wb {
 
+// Undo journal records. Clips and notes are stored as field-level deltas against the previous record of the same list,
+// consecutive records usually come from the same edit and only differ in their position.
+
+struct ClipRecordField {
+  enum : uint16_t {
+    Delta = 1 << 0,  // Missing fields are copied from the previous record
+    Id = 1 << 1,
+    Asset = 1 << 2,
+    Name = 1 << 3,
+    Color = 1 << 4,
+    Active = 1 << 5,
+    MinTime = 1 << 6,
+    MaxTime = 1 << 7,
+    StartOffset = 1 << 8,
+    Content = 1 << 9,
+    All = Id | Asset | Name | Color | Active | MinTime | MaxTime | StartOffset | Content,
+  };
+};
+
+struct NoteRecordField {
+  enum : uint8_t {
+    MinTime = 1 << 0,
+    MaxTime = 1 << 1,  // Otherwise the length of the previous note is used
+    MetaId = 1 << 2,
+    Key = 1 << 3,
+    Flags = 1 << 4,
+    Velocity = 1 << 5,
+  };
+};
+
+static void* get_clip_asset(const Clip& clip) {
+  switch (clip.type) {
+    case ClipType::Audio: return clip.audio.asset;
+    case ClipType::Midi: return clip.midi.asset;
+    default: break;
+  }
+  return nullptr;
+}
+
+static void set_clip_asset(Clip& clip, ClipType type, void* asset) {
+  switch (clip.type) {
+    case ClipType::Audio:
+      if (clip.audio.asset)
+        clip.audio.asset->release();
+      break;
+    case ClipType::Midi:
+      if (clip.midi.asset)
+        clip.midi.asset->release();
+      break;
+    default: break;
+  }
+  clip.type = type;
+  switch (type) {
+    case ClipType::Audio:
+      clip.audio.asset = (SampleAsset*)asset;
+      clip.audio.asset->add_ref();
+      break;
+    case ClipType::Midi:
+      clip.midi.asset = (MidiAsset*)asset;
+      clip.midi.asset->add_ref();
+      break;
+    default: break;
+  }
+}
+
+static bool is_same_clip_content(const Clip& a, const Clip& b) {
+  switch (a.type) {
+    case ClipType::Audio:
+      return a.audio.fade_start == b.audio.fade_start && a.audio.fade_end == b.audio.fade_end &&
+             a.audio.speed == b.audio.speed && a.audio.gain == b.audio.gain;
+    case ClipType::Midi:
+      return a.midi.length == b.midi.length && a.midi.transpose == b.midi.transpose && a.midi.rate == b.midi.rate &&
+             a.midi.mode == b.midi.mode;
+    default: break;
+  }
+  return true;
+}
+
+static void write_clip_record(ByteBuffer& buffer, const Clip& clip, const Clip* prev) {
+  uint16_t fields = ClipRecordField::All;
+  if (prev && prev->type == clip.type) {
+    fields = ClipRecordField::Delta;
+    if (clip.id != prev->id)
+      fields |= ClipRecordField::Id;
+    if (get_clip_asset(clip) != get_clip_asset(*prev))
+      fields |= ClipRecordField::Asset;
+    if (clip.name != prev->name)
+      fields |= ClipRecordField::Name;
+    if (std::memcmp(&clip.color, &prev->color, sizeof(Color)) != 0)
+      fields |= ClipRecordField::Color;
+    if (clip.is_active() != prev->is_active())
+      fields |= ClipRecordField::Active;
+    if (clip.min_time != prev->min_time)
+      fields |= ClipRecordField::MinTime;
+    if (clip.max_time != prev->max_time)
+      fields |= ClipRecordField::MaxTime;
+    if (clip.start_offset != prev->start_offset)
+      fields |= ClipRecordField::StartOffset;
+    if (!is_same_clip_content(clip, *prev))
+      fields |= ClipRecordField::Content;
+  }
+
+  io_write(buffer, fields);
+  if (fields & ClipRecordField::Id)
+    io_write(buffer, clip.id);
+  if (fields & ClipRecordField::Asset) {
+    io_write(buffer, clip.type);
+    io_write(buffer, (uint64_t)(uintptr_t)get_clip_asset(clip));
+  }
+  if (fields & ClipRecordField::Name) {
+    io_write(buffer, (uint32_t)clip.name.size());
+    buffer.write(clip.name.data(), clip.name.size());
+  }
+  if (fields & ClipRecordField::Color)
+    buffer.write(&clip.color, sizeof(Color));
+  if (fields & ClipRecordField::Active)
+    io_write(buffer, (uint8_t)clip.is_active());
+  if (fields & ClipRecordField::MinTime)
+    io_write(buffer, clip.min_time);
+  if (fields & ClipRecordField::MaxTime)
+    io_write(buffer, clip.max_time);
+  if (fields & ClipRecordField::StartOffset)
+    io_write(buffer, clip.start_offset);
+  if (fields & ClipRecordField::Content) {
+    switch (clip.type) {
+      case ClipType::Audio:
+        io_write(buffer, clip.audio.fade_start);
+        io_write(buffer, clip.audio.fade_end);
+        io_write(buffer, clip.audio.speed);
+        io_write(buffer, clip.audio.gain);
+        break;
+      case ClipType::Midi:
+        io_write(buffer, clip.midi.length);
+        io_write(buffer, clip.midi.transpose);
+        io_write(buffer, clip.midi.rate);
+        io_write(buffer, clip.midi.mode);
+        break;
+      default: break;
+    }
+  }
+}
+
+static void read_clip_record(ByteBuffer& buffer, Clip& clip, const Clip* prev) {
+  uint16_t fields = 0;
+  io_read(buffer, &fields);
+  if ((fields & ClipRecordField::Delta) && prev)
+    clip = *prev;
+
+  if (fields & ClipRecordField::Id)
+    io_read(buffer, &clip.id);
+  if (fields & ClipRecordField::Asset) {
+    ClipType type{};
+    uint64_t asset = 0;
+    io_read(buffer, &type);
+    io_read(buffer, &asset);
+    set_clip_asset(clip, type, (void*)(uintptr_t)asset);
+  }
+  if (fields & ClipRecordField::Name) {
+    uint32_t name_size = 0;
+    io_read(buffer, &name_size);
+    clip.name.resize(name_size);
+    buffer.read(clip.name.data(), name_size);
+  }
+  if (fields & ClipRecordField::Color)
+    buffer.read(&clip.color, sizeof(Color));
+  if (fields & ClipRecordField::Active) {
+    uint8_t active = 0;
+    io_read(buffer, &active);
+    clip.set_active(active != 0);
+  }
+  if (fields & ClipRecordField::MinTime)
+    io_read(buffer, &clip.min_time);
+  if (fields & ClipRecordField::MaxTime)
+    io_read(buffer, &clip.max_time);
+  if (fields & ClipRecordField::StartOffset)
+    io_read(buffer, &clip.start_offset);
+  if (fields & ClipRecordField::Content) {
+    switch (clip.type) {
+      case ClipType::Audio:
+        io_read(buffer, &clip.audio.fade_start);
+        io_read(buffer, &clip.audio.fade_end);
+        io_read(buffer, &clip.audio.speed);
+        io_read(buffer, &clip.audio.gain);
+        break;
+      case ClipType::Midi:
+        io_read(buffer, &clip.midi.length);
+        io_read(buffer, &clip.midi.transpose);
+        io_read(buffer, &clip.midi.rate);
+        io_read(buffer, &clip.midi.mode);
+        break;
+      default: break;
+    }
+  }
+}
+
+static void write_note_records(ByteBuffer& buffer, const Vector<MidiNote>& notes) {
+  MidiNote prev{};
+  io_write(buffer, notes.size());
+  for (const auto& note : notes) {
+    uint8_t fields = 0;
+    double max_time = note.min_time + (prev.max_time - prev.min_time);
+    if (note.min_time != prev.min_time)
+      fields |= NoteRecordField::MinTime;
+    if (note.max_time != max_time)
+      fields |= NoteRecordField::MaxTime;
+    if (note.meta_id != prev.meta_id)
+      fields |= NoteRecordField::MetaId;
+    if (note.key != prev.key)
+      fields |= NoteRecordField::Key;
+    if (note.flags != prev.flags)
+      fields |= NoteRecordField::Flags;
+    if (note.velocity != prev.velocity)
+      fields |= NoteRecordField::Velocity;
+
+    io_write(buffer, fields);
+    if (fields & NoteRecordField::MinTime)
+      io_write(buffer, note.min_time);
+    if (fields & NoteRecordField::MaxTime)
+      io_write(buffer, note.max_time);
+    if (fields & NoteRecordField::MetaId)
+      io_write(buffer, note.meta_id);
+    if (fields & NoteRecordField::Key)
+      io_write(buffer, note.key);
+    if (fields & NoteRecordField::Flags)
+      io_write(buffer, note.flags);
+    if (fields & NoteRecordField::Velocity)
+      io_write(buffer, note.velocity);
+    prev = note;
+  }
+}
+
+static void read_note_records(ByteBuffer& buffer, Vector<MidiNote>& notes) {
+  MidiNote prev{};
+  uint32_t num_notes = 0;
+  io_read(buffer, &num_notes);
+  notes.resize(num_notes);
+  for (auto& note : notes) {
+    uint8_t fields = 0;
+    io_read(buffer, &fields);
+    note = prev;
+    note.max_time = prev.max_time - prev.min_time;
+    if (fields & NoteRecordField::MinTime)
+      io_read(buffer, &note.min_time);
+    note.max_time += note.min_time;
+    if (fields & NoteRecordField::MaxTime)
+      io_read(buffer, &note.max_time);
+    if (fields & NoteRecordField::MetaId)
+      io_read(buffer, &note.meta_id);
+    if (fields & NoteRecordField::Key)
+      io_read(buffer, &note.key);
+    if (fields & NoteRecordField::Flags)
+      io_read(buffer, &note.flags);
+    if (fields & NoteRecordField::Velocity)
+      io_read(buffer, &note.velocity);
+    prev = note;
+  }
+}
+
+// Note ids are stored as sorted ranges, edits usually touch a contiguous block of notes.
+static void write_note_ids(ByteBuffer& buffer, const Vector<uint32_t>& ids) {
+  Vector<uint32_t> sorted_ids;
+  Vector<Pair<uint32_t, uint32_t>> ranges;
+  sorted_ids.resize_fast(ids.size());
+  std::copy(ids.begin(), ids.end(), sorted_ids.begin());
+  std::sort(sorted_ids.begin(), sorted_ids.end());
+  for (uint32_t id : sorted_ids) {
+    if (!ranges.empty() && ranges.back().first + ranges.back().second == id) {
+      ranges.back().second++;
+    } else {
+      ranges.push_back({ id, 1 });
+    }
+  }
+  io_write(buffer, ranges);
+}
+
+static void read_note_ids(ByteBuffer& buffer, Vector<uint32_t>& ids) {
+  Vector<Pair<uint32_t, uint32_t>> ranges;
+  io_read(buffer, &ranges);
+  ids.clear();
+  for (const auto& range : ranges) {
+    for (uint32_t i = 0; i < range.second; i++)
+      ids.push_back(range.first + i);
+  }
+}
+
+//
+
+void ClipAssetRefs::hold(const Clip& clip) {
+  switch (clip.type) {
+    case ClipType::Audio:
+      if (clip.audio.asset &&
+          std::find(sample_assets.begin(), sample_assets.end(), clip.audio.asset) == sample_assets.end()) {
+        clip.audio.asset->add_ref();
+        sample_assets.push_back(clip.audio.asset);
+      }
+      break;
+    case ClipType::Midi:
+      if (clip.midi.asset && std::find(midi_assets.begin(), midi_assets.end(), clip.midi.asset) == midi_assets.end()) {
+        clip.midi.asset->add_ref();
+        midi_assets.push_back(clip.midi.asset);
+      }
+      break;
+    default: break;
+  }
+}
+
+void ClipAssetRefs::release() {
+  for (auto asset : sample_assets)
+    asset->release();
+  for (auto asset : midi_assets)
+    asset->release();
+  sample_assets.clear();
+  midi_assets.clear();
+}
+
+//
+
 void TrackHistory::backup(TrackEditResult&& edit_result) {
   deleted_clips = std::move(edit_result.deleted_clips);
-  added_clips.reserve(edit_result.added_clips.size());
+  added_clips.resize(edit_result.added_clips.size());
   modified_clips.resize(edit_result.modified_clips.size());
-  for (uint32_t i = 0; i < (uint32_t)edit_result.added_clips.size(); i++)
-    added_clips.push_back(*edit_result.added_clips[i]);
+  for (uint32_t i = 0; i < (uint32_t)added_clips.size(); i++)
+    added_clips[i] = edit_result.added_clips[i]->id;
   for (uint32_t i = 0; i < (uint32_t)modified_clips.size(); i++)
     modified_clips[i] = edit_result.modified_clips[i]->id;
 }
@@ -32,8 +350,8 @@ void TrackHistory::undo(Track* track) {
       continue;
     }
 
-    for (const auto& added_clip : added_clips) {
-      if (added_clip.id == clip->id) {
+    for (auto id : added_clips) {
+      if (id == clip->id) {
         should_skip = true;
         break;
       }
@@ -54,6 +372,39 @@ void TrackHistory::undo(Track* track) {
   track->clips = std::move(new_cliplist);
 }
 
+void TrackHistory::save_state(ByteBuffer& buffer) {
+  io_write(buffer, deleted_clips.size());
+  for (uint32_t i = 0; i < deleted_clips.size(); i++) {
+    write_clip_record(buffer, deleted_clips[i], i > 0 ? &deleted_clips[i - 1] : nullptr);
+  }
+  io_write(buffer, added_clips);
+  io_write(buffer, modified_clips);
+}
+
+void TrackHistory::load_state(ByteBuffer& buffer) {
+  uint32_t num_deleted_clips = 0;
+  io_read(buffer, &num_deleted_clips);
+  deleted_clips.clear();
+  deleted_clips.reserve(num_deleted_clips);
+  for (uint32_t i = 0; i < num_deleted_clips; i++) {
+    Clip& clip = deleted_clips.emplace_back();
+    read_clip_record(buffer, clip, i > 0 ? &deleted_clips[i - 1] : nullptr);
+  }
+  added_clips.clear();
+  modified_clips.clear();
+  io_read(buffer, &added_clips);
+  io_read(buffer, &modified_clips);
+  asset_refs.release();
+}
+
+void TrackHistory::release_state() {
+  for (const auto& clip : deleted_clips)
+    asset_refs.hold(clip);
+  deleted_clips.clear();
+  added_clips.clear();
+  modified_clips.clear();
+}
+
 //
 
 bool TrackAddCmd::execute() {
@@ -96,6 +447,19 @@ void ClipAddFromFileCmd::undo() {
   track->reset_playback_state(g_engine.playhead, true);
 }
 
+bool ClipAddFromFileCmd::save_state(ByteBuffer& buffer) {
+  history.save_state(buffer);
+  return true;
+}
+
+void ClipAddFromFileCmd::load_state(ByteBuffer& buffer) {
+  history.load_state(buffer);
+}
+
+void ClipAddFromFileCmd::release_state() {
+  history.release_state();
+}
+
 //
 
 bool ClipRenameCmd::execute() {
@@ -161,25 +525,43 @@ void ClipMoveCmd::undo() {
   }
 }
 
+bool ClipMoveCmd::save_state(ByteBuffer& buffer) {
+  src_track_history.save_state(buffer);
+  dst_track_history.save_state(buffer);
+  return true;
+}
+
+void ClipMoveCmd::load_state(ByteBuffer& buffer) {
+  src_track_history.load_state(buffer);
+  dst_track_history.load_state(buffer);
+}
+
+void ClipMoveCmd::release_state() {
+  src_track_history.release_state();
+  dst_track_history.release_state();
+}
+
 //
 
 bool ClipShiftCmd::execute() {
   Track* track = g_engine.tracks[track_id];
   Clip* clip = track->clips[clip_id];
   g_engine.edit_lock();
-  clip->start_offset = shift_clip_content(clip, relative_pos, last_beat_duration);
+  old_start_offset = clip->start_offset;
+  clip->start_offset = shift_clip_content(clip, relative_pos, g_engine.tempo_map);
   clip->internal_state_changed = true;
+  track->invalidate_playback_table();
   g_engine.edit_unlock();
   return true;
 }
 
 void ClipShiftCmd::undo() {
-  double beat_duration = g_engine.get_beat_duration();
   Track* track = g_engine.tracks[track_id];
   Clip* clip = track->clips[clip_id];
   g_engine.edit_lock();
-  clip->start_offset = shift_clip_content(clip, -relative_pos, last_beat_duration);
+  clip->start_offset = old_start_offset;
   clip->internal_state_changed = true;
+  track->invalidate_playback_table();
   g_engine.edit_unlock();
 }
 
@@ -204,6 +586,19 @@ void ClipResizeCmd::undo() {
   track->reset_playback_state(g_engine.playhead, true);
 }
 
+bool ClipResizeCmd::save_state(ByteBuffer& buffer) {
+  history.save_state(buffer);
+  return true;
+}
+
+void ClipResizeCmd::load_state(ByteBuffer& buffer) {
+  history.load_state(buffer);
+}
+
+void ClipResizeCmd::release_state() {
+  history.release_state();
+}
+
 //
 
 bool ClipDuplicateCmd::execute() {
@@ -229,6 +624,19 @@ void ClipDuplicateCmd::undo() {
   track->reset_playback_state(g_engine.playhead, true);
 }
 
+bool ClipDuplicateCmd::save_state(ByteBuffer& buffer) {
+  track_history.save_state(buffer);
+  return true;
+}
+
+void ClipDuplicateCmd::load_state(ByteBuffer& buffer) {
+  track_history.load_state(buffer);
+}
+
+void ClipDuplicateCmd::release_state() {
+  track_history.release_state();
+}
+
 //
 
 bool ClipDeleteCmd::execute() {
@@ -247,6 +655,19 @@ void ClipDeleteCmd::undo() {
   track->reset_playback_state(g_engine.playhead, true);
 }
 
+bool ClipDeleteCmd::save_state(ByteBuffer& buffer) {
+  history.save_state(buffer);
+  return true;
+}
+
+void ClipDeleteCmd::load_state(ByteBuffer& buffer) {
+  history.load_state(buffer);
+}
+
+void ClipDeleteCmd::release_state() {
+  history.release_state();
+}
+
 //
 
 bool ClipDeleteRegionCmd::execute() {
@@ -255,6 +676,7 @@ bool ClipDeleteRegionCmd::execute() {
   if (last_track < first_track)
     std::swap(first_track, last_track);
 
+  histories.clear();
   std::unique_lock editor_lock(g_engine.editor_lock);
   for (uint32_t i = first_track; i <= last_track; i++) {
     Track* track = g_engine.tracks[i];
@@ -281,6 +703,27 @@ void ClipDeleteRegionCmd::undo() {
   }
 }
 
+bool ClipDeleteRegionCmd::save_state(ByteBuffer& buffer) {
+  io_write(buffer, histories.size());
+  for (auto& history : histories)
+    history.save_state(buffer);
+  return true;
+}
+
+void ClipDeleteRegionCmd::load_state(ByteBuffer& buffer) {
+  uint32_t num_histories = 0;
+  io_read(buffer, &num_histories);
+  histories.clear();
+  histories.reserve(num_histories);
+  for (uint32_t i = 0; i < num_histories; i++)
+    histories.emplace_back().load_state(buffer);
+}
+
+void ClipDeleteRegionCmd::release_state() {
+  for (auto& history : histories)
+    history.release_state();
+}
+
 //
 
 bool ClipAdjustGainCmd::execute() {
@@ -366,6 +809,40 @@ void ClipCmd::clean_edit_result() {
   modified_clips.clear();
 }
 
+bool ClipCmd::save_state(ByteBuffer& buffer) {
+  io_write(buffer, deleted_clips.size());
+  for (uint32_t i = 0; i < deleted_clips.size(); i++) {
+    io_write(buffer, deleted_clips[i].first);
+    write_clip_record(buffer, deleted_clips[i].second, i > 0 ? &deleted_clips[i - 1].second : nullptr);
+  }
+  io_write(buffer, added_clips);
+  io_write(buffer, modified_clips);
+  return true;
+}
+
+void ClipCmd::load_state(ByteBuffer& buffer) {
+  uint32_t num_deleted_clips = 0;
+  io_read(buffer, &num_deleted_clips);
+  deleted_clips.clear();
+  deleted_clips.reserve(num_deleted_clips);
+  for (uint32_t i = 0; i < num_deleted_clips; i++) {
+    auto& deleted_clip = deleted_clips.emplace_back();
+    io_read(buffer, &deleted_clip.first);
+    read_clip_record(buffer, deleted_clip.second, i > 0 ? &deleted_clips[i - 1].second : nullptr);
+  }
+  added_clips.clear();
+  modified_clips.clear();
+  io_read(buffer, &added_clips);
+  io_read(buffer, &modified_clips);
+  asset_refs.release();
+}
+
+void ClipCmd::release_state() {
+  for (const auto& deleted_clip : deleted_clips)
+    asset_refs.hold(deleted_clip.second);
+  clean_edit_result();
+}
+
 //
 
 bool CreateMidiClipCmd::execute() {
@@ -477,15 +954,18 @@ void MidiCmd::undo(uint32_t channel) {
   MidiNoteBuffer new_sequence;
   new_sequence.reserve(note_sequence.size());
 
+  BitSet modified_set(note_sequence.size());
+  for (uint32_t id : modified_notes) {
+    modified_set.set(id);
+  }
+
+  uint32_t first_removed_note = WB_INVALID_NOTE_ID;
   for (uint32_t note_id = 0; const auto& note : note_sequence) {
-    bool skip = false;
-    for (uint32_t id : modified_notes) {
-      if (id == note_id) {
-        skip = true;
-      }
-    }
+    bool skip = modified_set.get(note_id);
     if (!skip) {
       new_sequence.push_back(note);
+    } else if (first_removed_note == WB_INVALID_NOTE_ID) {
+      first_removed_note = note_id;
     }
     note_id++;
   }
@@ -495,7 +975,23 @@ void MidiCmd::undo(uint32_t channel) {
   // Restore deleted notes
   MidiNote* restored_notes = note_sequence.append(deleted_notes.begin(), deleted_notes.end());
   midi_data->create_metadata(restored_notes, deleted_notes.size());
-  midi_data->update_channel(channel);
+  midi_data->update_channel(channel, first_removed_note);
+}
+
+bool MidiCmd::save_state(ByteBuffer& buffer) {
+  write_note_ids(buffer, modified_notes);
+  write_note_records(buffer, deleted_notes);
+  return true;
+}
+
+void MidiCmd::load_state(ByteBuffer& buffer) {
+  read_note_ids(buffer, modified_notes);
+  read_note_records(buffer, deleted_notes);
+}
+
+void MidiCmd::release_state() {
+  modified_notes.clear();
+  deleted_notes.clear();
 }
 
 //
@@ -595,6 +1091,22 @@ void MidiSelectNoteCmd::undo() {
   }
 }
 
+bool MidiSelectNoteCmd::save_state(ByteBuffer& buffer) {
+  write_note_ids(buffer, result.selected);
+  write_note_ids(buffer, result.deselected);
+  return true;
+}
+
+void MidiSelectNoteCmd::load_state(ByteBuffer& buffer) {
+  read_note_ids(buffer, result.selected);
+  read_note_ids(buffer, result.deselected);
+}
+
+void MidiSelectNoteCmd::release_state() {
+  result.selected.clear();
+  result.deselected.clear();
+}
+
 //
 
 bool MidiSelectOrDeselectNotesCmd::execute() {
@@ -621,6 +1133,22 @@ void MidiSelectOrDeselectNotesCmd::undo() {
   }
 }
 
+bool MidiSelectOrDeselectNotesCmd::save_state(ByteBuffer& buffer) {
+  write_note_ids(buffer, result.selected);
+  write_note_ids(buffer, result.deselected);
+  return true;
+}
+
+void MidiSelectOrDeselectNotesCmd::load_state(ByteBuffer& buffer) {
+  read_note_ids(buffer, result.selected);
+  read_note_ids(buffer, result.deselected);
+}
+
+void MidiSelectOrDeselectNotesCmd::release_state() {
+  result.selected.clear();
+  result.deselected.clear();
+}
+
 //
 
 bool MidiAppendNoteSelectionCmd::execute() {
@@ -652,6 +1180,7 @@ bool MidiMuteNoteCmd::execute() {
         note_seq[note_id].flags &= ~MidiNoteFlags::Muted;
       }
     }
+    data->mark_modified();
   }
   return !note_ids.empty();
 }
@@ -672,6 +1201,7 @@ void MidiMuteNoteCmd::undo() {
       note_seq[note_id].flags |= MidiNoteFlags::Muted;
     }
   }
+  data->mark_modified();
 }
 
 //
@@ -688,6 +1218,18 @@ void MidiDeleteNoteCmd::undo() {
 
 //
 
+bool MidiTransformNoteCmd::execute() {
+  backup(g_engine.transform_selected_notes(track_id, clip_id, transform));
+  return !deleted_notes.empty();
+}
+
+void MidiTransformNoteCmd::undo() {
+  std::unique_lock lock(g_engine.editor_lock);
+  MidiCmd::undo(0);
+}
+
+//
+
 bool MidiChangeNoteVelocityCmd::execute() {
   Track* track = g_engine.tracks[track_id];
   Clip* clip = track->clips[clip_id];
@@ -696,6 +1238,7 @@ bool MidiChangeNoteVelocityCmd::execute() {
   std::unique_lock lock(g_engine.editor_lock);
   old_velocity = note_seq[note_id].velocity;
   note_seq[note_id].velocity += relative_velocity;
+  data->mark_modified();
   return true;
 }
 
@@ -706,6 +1249,7 @@ void MidiChangeNoteVelocityCmd::undo() {
   MidiNoteBuffer& note_seq = data->note_sequence;
   std::unique_lock lock(g_engine.editor_lock);
   note_seq[note_id].velocity = old_velocity;
+  data->mark_modified();
 }
 
 //
@@ -720,6 +1264,7 @@ bool MidiChangeSelectedNoteVelocityCmd::execute() {
   for (const auto [id, vel] : old_velocity) {
     note_seq[id].velocity = vel + relative_velocity;
   }
+  data->mark_modified();
 
   return true;
 }
@@ -734,6 +1279,7 @@ void MidiChangeSelectedNoteVelocityCmd::undo() {
   for (const auto [id, vel] : old_velocity) {
     note_seq[id].velocity = vel;
   }
+  data->mark_modified();
 }
 
 }  // namespace wb
\ No newline at end of file
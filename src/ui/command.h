@@ -2,29 +2,64 @@
 
 #include <string>
 
+#include "core/byte_buffer.h"
 #include "core/color.h"
 #include "core/common.h"
 #include "core/list.h"
+#include "core/undo_journal.h"
 #include "engine/clip.h"
 #include "engine/etypes.h"
+#include "engine/midi_transform.h"
 
 namespace wb {
 
+// Keeps the assets of journaled clips alive while the clips only exist as undo journal records.
+struct ClipAssetRefs {
+  Vector<SampleAsset*> sample_assets;
+  Vector<MidiAsset*> midi_assets;
+
+  ClipAssetRefs() = default;
+  ClipAssetRefs(ClipAssetRefs&&) = default;
+  ~ClipAssetRefs() {
+    release();
+  }
+  void hold(const Clip& clip);
+  void release();
+};
+
 struct TrackHistory {
   Vector<Clip> deleted_clips;
-  Vector<Clip> added_clips;
+  Vector<uint32_t> added_clips;
   Vector<uint32_t> modified_clips;
+  ClipAssetRefs asset_refs;
 
   void backup(TrackEditResult&& edit_result);
   void undo(Track* track);
+  void save_state(ByteBuffer& buffer);
+  void load_state(ByteBuffer& buffer);
+  void release_state();
 };
 
 struct Command : public InplaceList<Command> {
   std::string name;
+  uint64_t journal_id = WB_INVALID_JOURNAL_ENTRY;
   virtual ~Command() {
   }
   virtual bool execute() = 0;
   virtual void undo() = 0;
+
+  // Serialize the undo state into the journal. Returns false if the command keeps its state in memory.
+  virtual bool save_state(ByteBuffer& buffer) {
+    return false;
+  }
+
+  // Restore the undo state written by save_state(), called right before undo().
+  virtual void load_state(ByteBuffer& buffer) {
+  }
+
+  // Free the in-memory undo state once it has been written into the journal.
+  virtual void release_state() {
+  }
 };
 
 struct TrackAddCmd : public Command {
@@ -52,6 +87,9 @@ struct ClipAddFromFileCmd : public Command {
 
   bool execute() override;
   void undo() override;
+  bool save_state(ByteBuffer& buffer) override;
+  void load_state(ByteBuffer& buffer) override;
+  void release_state() override;
 };
 
 struct ClipRenameCmd : public Command {
@@ -84,13 +122,16 @@ struct ClipMoveCmd : public Command {
 
   bool execute() override;
   void undo() override;
+  bool save_state(ByteBuffer& buffer) override;
+  void load_state(ByteBuffer& buffer) override;
+  void release_state() override;
 };
 
 struct ClipShiftCmd : public Command {
   uint32_t track_id;
   uint32_t clip_id;
   double relative_pos;
-  double last_beat_duration;
+  double old_start_offset;  // Shifting back may not land on the same sample under tempo changes or clamping
 
   bool execute() override;
   void undo() override;
@@ -104,11 +145,13 @@ struct ClipResizeCmd : public Command {
   bool stretch;
   double relative_pos;
   double min_length;
-  double last_beat_duration;
   TrackHistory history;
 
   bool execute() override;
   void undo() override;
+  bool save_state(ByteBuffer& buffer) override;
+  void load_state(ByteBuffer& buffer) override;
+  void release_state() override;
 };
 
 struct ClipDuplicateCmd : public Command {
@@ -120,6 +163,9 @@ struct ClipDuplicateCmd : public Command {
 
   bool execute() override;
   void undo() override;
+  bool save_state(ByteBuffer& buffer) override;
+  void load_state(ByteBuffer& buffer) override;
+  void release_state() override;
 };
 
 struct ClipDeleteCmd : public Command {
@@ -129,6 +175,9 @@ struct ClipDeleteCmd : public Command {
 
   bool execute() override;
   void undo() override;
+  bool save_state(ByteBuffer& buffer) override;
+  void load_state(ByteBuffer& buffer) override;
+  void release_state() override;
 };
 
 struct ClipDeleteRegionCmd : public Command {
@@ -140,6 +189,9 @@ struct ClipDeleteRegionCmd : public Command {
 
   bool execute() override;
   void undo() override;
+  bool save_state(ByteBuffer& buffer) override;
+  void load_state(ByteBuffer& buffer) override;
+  void release_state() override;
 };
 
 struct ClipAdjustGainCmd : public Command {
@@ -157,9 +209,14 @@ struct ClipCmd : public Command {
   Vector<Pair<uint32_t, uint32_t>> added_clips;
   Vector<Pair<uint32_t, uint32_t>> modified_clips;
 
+  ClipAssetRefs asset_refs;
+
   void backup(MultiEditResult&& edit_result);
   void undo(uint32_t begin_track, uint32_t end_track);
   void clean_edit_result();
+  bool save_state(ByteBuffer& buffer) override;
+  void load_state(ByteBuffer& buffer) override;
+  void release_state() override;
 };
 
 struct CreateMidiClipCmd : public ClipCmd {
@@ -242,6 +299,9 @@ struct MidiCmd : public Command {
 
   void backup(MidiEditResult&& edit_result);
   void undo(uint32_t channel);
+  bool save_state(ByteBuffer& buffer) override;
+  void load_state(ByteBuffer& buffer) override;
+  void release_state() override;
 };
 
 struct MidiAddNoteCmd : public MidiCmd {
@@ -304,6 +364,9 @@ struct MidiSelectNoteCmd : public Command {
 
   bool execute() override;
   void undo() override;
+  bool save_state(ByteBuffer& buffer) override;
+  void load_state(ByteBuffer& buffer) override;
+  void release_state() override;
 };
 
 struct MidiSelectOrDeselectNotesCmd : public Command {
@@ -314,6 +377,9 @@ struct MidiSelectOrDeselectNotesCmd : public Command {
 
   bool execute() override;
   void undo() override;
+  bool save_state(ByteBuffer& buffer) override;
+  void load_state(ByteBuffer& buffer) override;
+  void release_state() override;
 };
 
 struct MidiAppendNoteSelectionCmd : public Command {
@@ -343,6 +409,13 @@ struct MidiDeleteNoteCmd : public MidiCmd {
   void undo() override;
 };
 
+struct MidiTransformNoteCmd : public MidiCmd {
+  NoteTransform transform;
+
+  bool execute() override;
+  void undo() override;
+};
+
 struct MidiChangeNoteVelocityCmd : public Command {
   uint32_t track_id;
   uint32_t clip_id;
@@ -1,13 +1,14 @@
 #include "command_manager.h"
 
+#include "core/debug.h"
 #include "engine/engine.h"
 #include "engine/track.h"
 
 namespace wb {
 CommandManager g_cmd_manager;
 
-void CommandManager::init(uint32_t max_items) {
-  max_history = max_items;
+void CommandManager::init(const UndoJournalConfig& journal_config) {
+  journal.init(journal_config);
 }
 
 bool CommandManager::execute(const std::string& name, Command* cmd) {
@@ -18,12 +19,6 @@ bool CommandManager::execute(const std::string& name, Command* cmd) {
 
   cmd->name = name;
 
-  if (num_history == max_history) {
-    if (Command* cmd = static_cast<Command*>(commands.pop_next_item())) {
-      delete cmd;
-    }
-  }
-
   if (current_command == nullptr) {
     commands.push_item(cmd);
   } else {
@@ -36,10 +31,11 @@ bool CommandManager::execute(const std::string& name, Command* cmd) {
   current_command = cmd;
   last_command = cmd;
   is_modified = true;
+  ++num_changes;
+  ++num_history;
 
-  if (num_history < max_history) {
-    ++num_history;
-  }
+  save_command_state_(cmd);
+  trim_history_();
 
   return true;
 }
@@ -47,20 +43,35 @@ bool CommandManager::execute(const std::string& name, Command* cmd) {
 void CommandManager::undo() {
   if (locked || num_history == 0)
     return;
+  if (current_command->journal_id != WB_INVALID_JOURNAL_ENTRY) {
+    if (!journal.pop(current_command->journal_id, journal_record)) {
+      Log::error("Cannot restore undo history of \"{}\"", current_command->name);
+      reset();
+      signal_history_update_listeners();
+      return;
+    }
+    ByteBuffer buffer(journal_record.data(), journal_record.size(), false);
+    current_command->load_state(buffer);
+    current_command->journal_id = WB_INVALID_JOURNAL_ENTRY;
+  }
   current_command->undo();
   current_command = current_command->prev();
   is_modified = true;
+  ++num_changes;
   --num_history;
   signal_history_update_listeners();
 }
 
 void CommandManager::redo() {
-  if (locked || num_history == max_history || current_command == last_command)
+  if (locked || current_command == last_command)
     return;
   current_command = current_command->next();
   current_command->execute();
   is_modified = true;
+  ++num_changes;
   ++num_history;
+  save_command_state_(current_command);
+  trim_history_();
   signal_history_update_listeners();
 }
 
@@ -71,11 +82,45 @@ void CommandManager::reset(bool empty_project) {
   while (Command* cmd = static_cast<Command*>(commands.pop_next_item())) {
     delete cmd;
   }
+  journal.clear();
   num_history = 0;
   current_command = nullptr;
   last_command = nullptr;
 }
 
+void CommandManager::save_command_state_(Command* cmd) {
+  journal_buffer.reset();
+  if (!cmd->save_state(journal_buffer))
+    return;
+  uint64_t id = journal.push(journal_buffer.data(), (uint32_t)journal_buffer.position());
+  if (id != WB_INVALID_JOURNAL_ENTRY) {
+    cmd->journal_id = id;
+    cmd->release_state();
+  }
+}
+
+void CommandManager::trim_history_() {
+  // Commands can only be undone in order, everything up to the last command that lost its journal record is removed.
+  uint64_t first_id = journal.first_id();
+  uint32_t num_expired = 0;
+  uint32_t position = 0;
+  for (Command* cmd = commands.next(); cmd != nullptr; cmd = cmd->next()) {
+    position++;
+    if (cmd->journal_id != WB_INVALID_JOURNAL_ENTRY) {
+      if (cmd->journal_id >= first_id)
+        break;
+      num_expired = position;
+    }
+    if (cmd == current_command)
+      break;
+  }
+
+  for (uint32_t i = 0; i < num_expired; i++) {
+    delete static_cast<Command*>(commands.pop_next_item());
+    --num_history;
+  }
+}
+
 void CommandManager::signal_history_update_listeners() {
   for (auto& listener : on_history_update_listener) {
     listener();
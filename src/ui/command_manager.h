@@ -4,6 +4,8 @@
 #include <string>
 
 #include "command.h"
+#include "core/byte_buffer.h"
+#include "core/undo_journal.h"
 #include "core/vector.h"
 
 namespace wb {
@@ -15,18 +17,27 @@ struct CommandManager {
   InplaceList<Command> commands;
   Command* current_command{};
   Command* last_command{};
-  uint32_t max_history = 0;
+  UndoJournal journal;
+  ByteBuffer journal_buffer;
+  Vector<std::byte> journal_record;
   uint32_t num_history = 0;
-  uint32_t num_histories_used = 0;
+  uint64_t num_changes = 0;  // Incremented on every execute, undo and redo
   bool is_modified = false;
   bool locked = false;
 
-  void init(uint32_t max_items);
+  /**
+   * @brief Initialize the command history. The history is bounded by the journal budget instead of a command count.
+   *
+   * @param journal_config Memory and spill file budget of the undo journal.
+   */
+  void init(const UndoJournalConfig& journal_config);
   bool execute(const std::string& name, Command* cmd);
   void undo();
   void redo();
   void reset(bool empty_project = false);
   void signal_history_update_listeners();
+  void save_command_state_(Command* cmd);
+  void trim_history_();
 
   void lock() {
     locked = true;
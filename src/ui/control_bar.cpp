@@ -179,7 +179,14 @@ void main_control_bar() {
   // Tempo
   ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(frame_padding.x, 8.5f));
   float tempo = (float)g_engine.get_bpm();
-  if (ImGui::DragFloat("##tempo_drag", &tempo, 1.0f, 0.0f, 0.0f, "%.2f BPM", ImGuiSliderFlags_Vertical)) {
+  if (ImGui::DragFloat(
+          "##tempo_drag",
+          &tempo,
+          1.0f,
+          (float)TempoMap::min_bpm,
+          (float)TempoMap::max_bpm,
+          "%.2f BPM",
+          ImGuiSliderFlags_Vertical | ImGuiSliderFlags_AlwaysClamp)) {
     g_engine.set_bpm((double)tempo);
   }
   controls::item_tooltip("Tempo (BPM)");
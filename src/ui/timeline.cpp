@@ -24,8 +24,16 @@
 #endif
 
 namespace wb {
+
 TimelineWindow g_timeline;
 
+// Waveforms are drawn at one scale per clip. The average tempo over the clip puts both of its ends at the right time.
+static double get_clip_beat_duration(const TempoMap& tempo_map, double min_time, double max_time) {
+  if (max_time <= min_time)
+    return 60.0 / tempo_map.get_bpm_at(min_time);
+  return (tempo_map.beat_to_time(max_time) - tempo_map.beat_to_time(min_time)) / (max_time - min_time);
+}
+
 void TimelineWindow::init() {
   g_engine.add_on_bpm_change_listener([this](double bpm, double beat_duration) { force_redraw = true; });
   g_cmd_manager.add_on_history_update_listener([this] { force_redraw = true; });
@@ -62,12 +70,11 @@ void TimelineWindow::render() {
 
   ImGui::PopStyleVar();
 
-  redraw = force_redraw;
+  redraw = force_redraw || g_engine.is_recording();  // Keep redrawing while the recorded waveform grows
   if (force_redraw)
     force_redraw = false;
 
   playhead = g_engine.playhead_ui.load(std::memory_order_relaxed);
-  beat_duration = g_engine.beat_duration.load(std::memory_order_relaxed);
   ppq = g_engine.ppq;
   inv_ppq = 1.0 / ppq;
 
@@ -727,7 +734,6 @@ void TimelineWindow::render_track_lanes() {
   }
 
   const double scroll_pos_x = std::round((min_hscroll * song_length) / view_scale);
-  const double sample_scale = view_scale * beat_duration;
   const ImU32 gridline_color = Color(ImGui::GetColorU32(ImGuiCol_Separator)).change_alpha(0.85f).to_uint32();
 
   // Map mouse position to time position
@@ -878,8 +884,10 @@ void TimelineWindow::render_track_lanes() {
       // Highlight drop target
       double highlight_pos = mouse_at_gridline;  // Snap to grid
       double length = 1.0;
-      if (drop_payload_data->type == BrowserItem::Sample) {
-        length = samples_to_beat(drop_payload_data->content_length, drop_payload_data->sample_rate, beat_duration);
+      if (drop_payload_data->type == BrowserNode::Sample && drop_payload_data->content_length > 0.0) {
+        const TempoMap& tempo_map = g_engine.tempo_map;
+        double duration = drop_payload_data->content_length / drop_payload_data->sample_rate;
+        length = tempo_map.time_to_beat(tempo_map.beat_to_time(highlight_pos) + duration) - highlight_pos;
       }
 
       const double min_pos = highlight_pos * clip_scale;
@@ -912,7 +920,7 @@ void TimelineWindow::render_track_lanes() {
     if (edit_command != TimelineCommand::None) {
       render_edited_clips(mouse_at_gridline);
     }
-    draw_clips(clip_draw_cmd, sample_scale, offset_y);
+    draw_clips(clip_draw_cmd, offset_y);
 
     // Draw selection range
     if (selecting_range || range_selected) {
@@ -1105,6 +1113,7 @@ void TimelineWindow::render_track(
     double mouse_at_gridline,
     bool track_hovered,
     bool is_mouse_in_selection_range) {
+  const TempoMap& tempo_map = g_engine.tempo_map;
   bool is_track_selected = math::in_range(id, first_selected_track, last_selected_track);
   const float height = track->get_height();
   const bool mini_clip = height > 30.0f;
@@ -1157,10 +1166,8 @@ void TimelineWindow::render_track(
         if (select_status != ClipSelectStatus::NotSelected) {
           if (move_or_shift_cmd) {
             if (select_status == ClipSelectStatus::PartiallySelected) {
-              bool is_audio = clip->is_audio();
               bool right_side_partially_selected = selected_region->range.right_side_partially_selected(i);
               bool left_side_partially_selected = selected_region->range.left_side_partially_selected(i);
-              const double sample_rate = clip->get_asset_sample_rate();
 
               if (right_side_partially_selected && left_side_partially_selected) {
                 // Carve the center of the clip
@@ -1170,8 +1177,7 @@ void TimelineWindow::render_track(
                 const double lhs_start_ofs = start_offset;
                 const double rhs_min_time = max_time + selected_region->range.last_offset;
                 const double rhs_max_time = max_time;
-                const double rhs_start_ofs =
-                    calc_clip_shift(is_audio, start_offset, lhs_min_time - rhs_min_time, beat_duration, sample_rate);
+                const double rhs_start_ofs = shift_clip_content(clip, lhs_min_time - rhs_min_time, tempo_map);
 
                 // Draw lhs clip
                 render_clip(clip, lhs_min_time, lhs_max_time, lhs_start_ofs, 1.0, track_pos_y, height);
@@ -1181,8 +1187,7 @@ void TimelineWindow::render_track(
                   const double clip_min_time = lhs_max_time;
                   const double clip_max_time = rhs_min_time;
                   const double shift_offset = lhs_min_time - lhs_max_time + relative_pos;
-                  double clip_start_offset = calc_clip_shift(
-                      clip->is_audio(), start_offset, shift_offset, beat_duration, clip->get_asset_sample_rate());
+                  double clip_start_offset = shift_clip_content(clip, shift_offset, tempo_map);
                   render_clip(clip, clip_min_time, clip_max_time, clip_start_offset, 1.0, track_pos_y, height);
                 }
 
@@ -1196,15 +1201,13 @@ void TimelineWindow::render_track(
                 if (edit_command == TimelineCommand::ClipShift) {
                   const double max_time2 = clip->max_time;
                   const double shift_offset = min_time - max_time + relative_pos;
-                  const double rhs_start_ofs = calc_clip_shift(
-                      clip->is_audio(), start_offset, shift_offset, beat_duration, clip->get_asset_sample_rate());
+                  const double rhs_start_ofs = shift_clip_content(clip, shift_offset, tempo_map);
                   render_clip(clip, max_time, max_time2, rhs_start_ofs, 1.0, track_pos_y, height);
                 }
                 continue;
               } else if (left_side_partially_selected) {
                 if (edit_command == TimelineCommand::ClipShift) {
-                  const double new_start_offset = calc_clip_shift(
-                      clip->is_audio(), start_offset, relative_pos, beat_duration, clip->get_asset_sample_rate());
+                  const double new_start_offset = shift_clip_content(clip, relative_pos, tempo_map);
                   render_clip(
                       clip,
                       min_time,
@@ -1217,15 +1220,13 @@ void TimelineWindow::render_track(
                 // Carve the left side of the clip
                 const double rhs_min_time = max_time + selected_region->range.last_offset;
                 const double rhs_max_time = max_time;
-                const double rhs_start_ofs =
-                    calc_clip_shift(is_audio, start_offset, min_time - rhs_min_time, beat_duration, sample_rate);
+                const double rhs_start_ofs = shift_clip_content(clip, min_time - rhs_min_time, tempo_map);
                 render_clip(clip, rhs_min_time, rhs_max_time, rhs_start_ofs, 1.0, track_pos_y, height);
                 continue;
               }
             } else if (select_status == ClipSelectStatus::Selected) {
               if (edit_command == TimelineCommand::ClipShift) {
-                start_offset = calc_clip_shift(
-                    clip->is_audio(), start_offset, relative_pos, beat_duration, clip->get_asset_sample_rate());
+                start_offset = shift_clip_content(clip, relative_pos, tempo_map);
               } else {
                 continue;
               }
@@ -1365,6 +1366,7 @@ void TimelineWindow::render_track(
       cmd->start_offset = start_offset;
       cmd->min_pos_x = min_pos_x;
       cmd->max_pos_x = max_pos_x;
+      cmd->beat_duration = get_clip_beat_duration(tempo_map, min_time, max_time);
       cmd->min_pos_y = track_pos_y;
       cmd->height = height;
       cmd->draw_flags = shown_in_clip_editor ? ClipDrawCmd::Highlighted : 0;
@@ -1372,7 +1374,7 @@ void TimelineWindow::render_track(
       if (clip->is_audio()) {
         cmd->speed = clip->audio.speed;
         cmd->gain = clip->audio.gain;
-        cmd->audio = clip->audio.asset->peaks;
+        cmd->audio = clip->audio.asset->content->peaks;
       } else {
         cmd->gain = 0.0f;
         cmd->midi = &clip->midi.asset->data;
@@ -1397,10 +1399,65 @@ void TimelineWindow::render_track(
     im_draw_rect_filled(
         layer3_draw_list, min_clamped_pos_x, track_pos_y, max_clamped_pos_x, track_pos_y + height, highlight_color);
     layer2_draw_list->AddText(ImVec2(min_clamped_pos_x + 4.0f, track_pos_y + 2.0f), text_transparent_color, "Recording...");
+    if (redraw && mini_clip && track->recorded_peaks)
+      draw_recorded_waveform(track, min_pos_x, max_pos_x, track_pos_y, height);
+  }
+}
+
+void TimelineWindow::draw_recorded_waveform(
+    Track* track,
+    double min_pos_x,
+    double max_pos_x,
+    float track_pos_y,
+    float height) {
+  static constexpr double log_base4 = 1.0 / 1.3862943611198906;  // 1.0 / log(4.0)
+  WaveformVisual* waveform = track->recorded_peaks->update();
+  if (!waveform)
+    return;
+
+  const float min_draw_x = timeline_bounds_min_x;
+  const double beat_duration =
+      get_clip_beat_duration(g_engine.tempo_map, track->record_min_time, track->record_max_time);
+  const double scale_x = (beat_duration / clip_scale) * (double)waveform->sample_rate;
+  const double inv_scale_x = 1.0 / scale_x;
+  const double mip_index = std::log(scale_x * 0.5) * log_base4;
+  const int32_t index = math::clamp((int32_t)mip_index, 0, waveform->mipmap_count - 1);
+  const double mip_scale = std::pow(4.0, mip_index - (double)index) * 2.0;
+  const double waveform_len = (double)waveform->sample_count * inv_scale_x;
+  const double rel_min_x = min_pos_x - (double)min_draw_x;
+  const double rel_max_x = max_pos_x - (double)min_draw_x;
+  const double draw_min_x = math::max(rel_min_x, 0.0);
+  const double draw_max_x = math::min(math::min(rel_max_x, rel_min_x + waveform_len), (double)(timeline_width + 2.0));
+  const double draw_count = math::max(draw_max_x - draw_min_x, 0.0);
+  if (draw_count == 0.0)
+    return;
+
+  const double start_idx = std::round(math::max(-rel_min_x, 0.0));
+  const float content_min_y = track_pos_y + font->FontSize + 4.0f - timeline_bounds_min_y;
+  const float content_height = track_pos_y + height - timeline_bounds_min_y - content_min_y;
+  const float channel_height = std::floor(content_height / (float)waveform->channels);
+  for (int32_t i = 0; i < waveform->channels; i++) {
+    const float pos_y = content_min_y + channel_height * (float)i;
+    waveform_cmd_list1.push_back({
+      .waveform_vis = waveform,
+      .min_x = (float)math::round(draw_min_x),
+      .min_y = pos_y,
+      .max_x = (float)math::round(draw_max_x),
+      .max_y = pos_y + channel_height,
+      .gain = 1.0f,
+      .scale_x = (float)mip_scale,
+      .gap_size = 1.0f,
+      .color = text_transparent_color,
+      .mip_index = index,
+      .channel = (uint32_t)i,
+      .start_idx = (uint32_t)start_idx,
+      .draw_count = (uint32_t)draw_count + 2,
+    });
   }
 }
 
 void TimelineWindow::render_edited_clips(double mouse_at_gridline) {
+  const TempoMap& tempo_map = g_engine.tempo_map;
   const double relative_pos = mouse_at_gridline - initial_time_pos;
 
   if (edited_clip) {
@@ -1425,7 +1482,7 @@ void TimelineWindow::render_edited_clips(double mouse_at_gridline) {
       case TimelineCommand::ClipResizeLeft: {
         const double min_length = 1.0 / beat_division;
         auto [new_min_time, new_max_time, new_start_offset, _] =
-            calc_resize_clip(edited_clip, relative_pos, edited_clip->max_time, min_length, 0.0, beat_duration, true);
+            calc_resize_clip(edited_clip, relative_pos, edited_clip->max_time, min_length, 0.0, tempo_map, true);
         start_offset = new_start_offset;
         min_time = new_min_time;
         break;
@@ -1433,14 +1490,14 @@ void TimelineWindow::render_edited_clips(double mouse_at_gridline) {
       case TimelineCommand::ClipResizeRight: {
         const double min_length = 1.0 / beat_division;
         auto [new_min_time, new_max_time, new_start_offset, _] =
-            calc_resize_clip(edited_clip, relative_pos, edited_clip->min_time, min_length, 0.0, beat_duration, false);
+            calc_resize_clip(edited_clip, relative_pos, edited_clip->min_time, min_length, 0.0, tempo_map, false);
         max_time = new_max_time;
         break;
       }
       case TimelineCommand::ClipStretchLeft: {
         const double min_length = 1.0 / beat_division;
         auto [new_min_time, new_max_time, new_start_offset, new_speed] = calc_resize_clip(
-            edited_clip, relative_pos, edited_clip->max_time, min_length, 0.0, beat_duration, true, true, true);
+            edited_clip, relative_pos, edited_clip->max_time, min_length, 0.0, tempo_map, true, true, true);
         min_time = new_min_time;
         speed = new_speed;
         break;
@@ -1448,7 +1505,7 @@ void TimelineWindow::render_edited_clips(double mouse_at_gridline) {
       case TimelineCommand::ClipStretchRight: {
         const double min_length = 1.0 / beat_division;
         auto [new_min_time, new_max_time, new_start_offset, new_speed] = calc_resize_clip(
-            edited_clip, relative_pos, edited_clip->min_time, min_length, 0.0, beat_duration, false, false, true);
+            edited_clip, relative_pos, edited_clip->min_time, min_length, 0.0, tempo_map, false, false, true);
         max_time = new_max_time;
         speed = new_speed;
         break;
@@ -1456,7 +1513,7 @@ void TimelineWindow::render_edited_clips(double mouse_at_gridline) {
       case TimelineCommand::ClipShiftLeft: {
         const double min_length = 1.0 / beat_division;
         auto [new_min_time, new_max_time, rel_offset, _] =
-            calc_resize_clip(edited_clip, relative_pos, edited_clip->max_time, min_length, 0.0, beat_duration, true, true);
+            calc_resize_clip(edited_clip, relative_pos, edited_clip->max_time, min_length, 0.0, tempo_map, true, true);
         start_offset = rel_offset;
         min_time = new_min_time;
         break;
@@ -1464,13 +1521,13 @@ void TimelineWindow::render_edited_clips(double mouse_at_gridline) {
       case TimelineCommand::ClipShiftRight: {
         const double min_length = 1.0 / beat_division;
         auto [new_min_time, new_max_time, rel_offset, _] =
-            calc_resize_clip(edited_clip, relative_pos, edited_clip->min_time, min_length, 0.0, beat_duration, false, true);
+            calc_resize_clip(edited_clip, relative_pos, edited_clip->min_time, min_length, 0.0, tempo_map, false, true);
         start_offset = rel_offset;
         max_time = new_max_time;
         break;
       }
       case TimelineCommand::ClipShift: {
-        start_offset = shift_clip_content(edited_clip, relative_pos, beat_duration);
+        start_offset = shift_clip_content(edited_clip, relative_pos, tempo_map);
         break;
       }
       case TimelineCommand::ClipAdjustGain: {
@@ -1536,8 +1593,7 @@ void TimelineWindow::render_edited_clips(double mouse_at_gridline) {
             const double min_time_moved = math::max(new_min_time + relative_pos, min_move);
             const double length = (max_time - new_min_time) + selected_region.range.last_offset;
             const double max_time_moved = min_time_moved + length;
-            const double new_start_ofs = calc_clip_shift(
-                clip->is_audio(), start_offset, min_time - new_min_time, beat_duration, clip->get_asset_sample_rate());
+            const double new_start_ofs = shift_clip_content(clip, min_time - new_min_time, tempo_map);
             min_time = min_time_moved;
             max_time = max_time_moved;
             start_offset = new_start_ofs;
@@ -1545,8 +1601,7 @@ void TimelineWindow::render_edited_clips(double mouse_at_gridline) {
             const double new_min_time = min_time + selected_region.range.first_offset;
             const double min_time_moved = math::max(new_min_time + relative_pos, min_move);
             const double max_time_moved = min_time_moved + (max_time - new_min_time);
-            const double new_start_ofs = calc_clip_shift(
-                clip->is_audio(), start_offset, min_time - new_min_time, beat_duration, clip->get_asset_sample_rate());
+            const double new_start_ofs = shift_clip_content(clip, min_time - new_min_time, tempo_map);
             min_time = min_time_moved;
             max_time = max_time_moved;
             min_move = max_time_moved;
@@ -1582,6 +1637,7 @@ void TimelineWindow::render_edited_clips(double mouse_at_gridline) {
           cmd->start_offset = start_offset;
           cmd->min_pos_x = min_pos_x;
           cmd->max_pos_x = max_pos_x;
+          cmd->beat_duration = get_clip_beat_duration(tempo_map, min_time, max_time);
           cmd->min_pos_y = track_pos_y;
           cmd->height = height;
           cmd->draw_flags = ClipDrawCmd::Layer2;
@@ -1589,7 +1645,7 @@ void TimelineWindow::render_edited_clips(double mouse_at_gridline) {
           if (clip->is_audio()) {
             cmd->speed = clip->audio.speed;
             cmd->gain = clip->audio.gain;
-            cmd->audio = clip->audio.asset->peaks;
+            cmd->audio = clip->audio.asset->content->peaks;
           } else {
             cmd->gain = 0.0f;
             cmd->midi = &clip->midi.asset->data;
@@ -1607,7 +1663,7 @@ void TimelineWindow::render_edited_clips(double mouse_at_gridline) {
               clip_resize_limit,
               min_length,
               clip_min_resize_pos,
-              beat_duration,
+              tempo_map,
               left_side,
               shift_mode,
               true);
@@ -1641,6 +1697,7 @@ void TimelineWindow::render_clip(
     cmd->start_offset = start_offset;
     cmd->min_pos_x = min_pos_x;
     cmd->max_pos_x = max_pos_x;
+    cmd->beat_duration = get_clip_beat_duration(g_engine.tempo_map, min_time, max_time);
     cmd->speed = speed;
     cmd->min_pos_y = track_pos_y;
     cmd->height = height;
@@ -1648,7 +1705,7 @@ void TimelineWindow::render_clip(
 
     if (clip->is_audio()) {
       cmd->gain = clip->audio.gain;
-      cmd->audio = clip->audio.asset->peaks;
+      cmd->audio = clip->audio.asset->content->peaks;
     } else {
       cmd->gain = 0.0f;
       cmd->midi = &clip->midi.asset->data;
@@ -1656,7 +1713,7 @@ void TimelineWindow::render_clip(
   }
 }
 
-void TimelineWindow::draw_clips(const Vector<ClipDrawCmd>& clip_cmd_list, double sample_scale, float offset_y) {
+void TimelineWindow::draw_clips(const Vector<ClipDrawCmd>& clip_cmd_list, float offset_y) {
   constexpr ImDrawListFlags draw_list_aa_flags =
       ImDrawListFlags_AntiAliasedFill | ImDrawListFlags_AntiAliasedLinesUseTex | ImDrawListFlags_AntiAliasedLines;
 
@@ -1723,7 +1780,7 @@ void TimelineWindow::draw_clips(const Vector<ClipDrawCmd>& clip_cmd_list, double
           WaveformVisual* waveform = cmd.audio;
           if (!waveform)
             break;
-          const double scale_x = sample_scale * (double)waveform->sample_rate * cmd.speed;
+          const double scale_x = (cmd.beat_duration / clip_scale) * (double)waveform->sample_rate * cmd.speed;
           const double inv_scale_x = 1.0 / scale_x;
           double mip_index = std::log(scale_x * 0.5) * log_base4;  // Scale -> Index
           const int32_t index = math::clamp((int32_t)mip_index, 0, waveform->mipmap_count - 1);
@@ -1986,7 +2043,6 @@ void TimelineWindow::apply_edit(double mouse_at_gridline) {
             cmd->left_side = true;
             cmd->relative_pos = relative_pos;
             cmd->min_length = 1.0 / beat_division;
-            cmd->last_beat_duration = beat_duration;
             g_cmd_manager.execute("Resize clip", cmd);
           }
           finish_edit();
@@ -2002,7 +2058,6 @@ void TimelineWindow::apply_edit(double mouse_at_gridline) {
             cmd->left_side = false;
             cmd->relative_pos = relative_pos;
             cmd->min_length = 1.0 / beat_division;
-            cmd->last_beat_duration = beat_duration;
             g_cmd_manager.execute("Resize clip", cmd);
           }
           finish_edit();
@@ -2020,7 +2075,6 @@ void TimelineWindow::apply_edit(double mouse_at_gridline) {
             cmd->shift = true;
             cmd->relative_pos = relative_pos;
             cmd->min_length = 1.0 / beat_division;
-            cmd->last_beat_duration = beat_duration;
             g_cmd_manager.execute("Stretch clip", cmd);
           }
           finish_edit();
@@ -2038,7 +2092,6 @@ void TimelineWindow::apply_edit(double mouse_at_gridline) {
             cmd->shift = false;
             cmd->relative_pos = relative_pos;
             cmd->min_length = 1.0 / beat_division;
-            cmd->last_beat_duration = beat_duration;
             g_cmd_manager.execute("Stretch clip", cmd);
           }
           finish_edit();
@@ -2055,7 +2108,6 @@ void TimelineWindow::apply_edit(double mouse_at_gridline) {
             cmd->shift = true;
             cmd->relative_pos = relative_pos;
             cmd->min_length = 1.0 / beat_division;
-            cmd->last_beat_duration = beat_duration;
             g_cmd_manager.execute("Resize and shift clip", cmd);
           }
           finish_edit();
@@ -2072,7 +2124,6 @@ void TimelineWindow::apply_edit(double mouse_at_gridline) {
             cmd->shift = true;
             cmd->relative_pos = relative_pos;
             cmd->min_length = 1.0 / beat_division;
-            cmd->last_beat_duration = beat_duration;
             g_cmd_manager.execute("Resize and shift clip", cmd);
           }
           finish_edit();
@@ -2086,7 +2137,6 @@ void TimelineWindow::apply_edit(double mouse_at_gridline) {
             cmd->track_id = edit_src_track_id.value();
             cmd->clip_id = edited_clip->id;
             cmd->relative_pos = relative_pos;
-            cmd->last_beat_duration = beat_duration;
             g_cmd_manager.execute("Shift clip", cmd);
           }
           finish_edit();
@@ -2233,6 +2283,7 @@ bool TimelineWindow::prepare_resize_for_selected_range(Clip* src_clip, bool dir)
     return false;
   }
 
+  const TempoMap& tempo_map = g_engine.tempo_map;
   double resize_pos = dir ? src_clip->max_time : src_clip->min_time;
   if (selection_start_pos > resize_pos || selection_end_pos < resize_pos) {
     return false;
@@ -2269,9 +2320,8 @@ bool TimelineWindow::prepare_resize_for_selected_range(Clip* src_clip, bool dir)
             if (dir) {
               resize_limit = math::max(resize_limit, clip->min_time);
             } else {
-              double start_offset = clip->get_start_offset(beat_duration);
               resize_limit = math::min(resize_limit, clip->max_time);
-              min_resize_pos = math::max(min_resize_pos, time_pos - start_offset);
+              min_resize_pos = math::max(min_resize_pos, get_clip_content_start(clip, tempo_map));
             }
             break;
           }
@@ -2280,11 +2330,10 @@ bool TimelineWindow::prepare_resize_for_selected_range(Clip* src_clip, bool dir)
         Clip* clip = track->clips[selected_region.range.first];
         if (!dir) {
           if (clip->min_time == resize_pos && selected_region.range.first_offset <= 0.0) {
-            double start_offset = clip->get_start_offset(beat_duration);
             should_resize = true;
             clip_id = clip->id;
             resize_limit = math::min(resize_limit, clip->max_time);
-            min_resize_pos = math::max(min_resize_pos, clip->min_time - start_offset);
+            min_resize_pos = math::max(min_resize_pos, get_clip_content_start(clip, tempo_map));
           }
         } else {
           if (clip->max_time == resize_pos && selected_region.range.last_offset >= 0.0) {
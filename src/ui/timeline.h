@@ -37,6 +37,7 @@ struct ClipDrawCmd {
   double min_pos_x;
   double max_pos_x;
   double speed;
+  double beat_duration;  // Seconds per beat over the clip
   float min_pos_y;
   float height;
   float gain;
@@ -52,8 +53,6 @@ struct TimelineWindow : public TimelineBase {
   static constexpr uint32_t highlight_color = 0x9F555555;
   static constexpr float track_separator_height = 2.0f;
 
-  double beat_duration = 1.0;
-
   ImU32 text_color{};
   ImU32 text_transparent_color{};
   ImU32 splitter_color{};
@@ -168,7 +167,8 @@ struct TimelineWindow : public TimelineBase {
       float track_pos_y,
       float height,
       uint32_t draw_flags = 0);
-  void draw_clips(const Vector<ClipDrawCmd>& clip_cmd_list, double sample_scale, float offset_y);
+  void draw_clips(const Vector<ClipDrawCmd>& clip_cmd_list, float offset_y);
+  void draw_recorded_waveform(Track* track, double min_pos_x, double max_pos_x, float track_pos_y, float height);
   void draw_clip_overlay(ImVec2 pos, float size, float alpha, const Color& col, const char* caption);
   void apply_edit(double mouse_at_gridline);
   void query_selected_range();
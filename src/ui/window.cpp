@@ -28,11 +28,13 @@ bool g_project_info_window_open = false;
 bool g_performance_counter_window_open = true;
 
 void init_windows() {
+  g_browser.init();
   g_timeline.init();
   clip_editor_init();
 }
 
 void shutdown_windows() {
+  g_browser.shutdown();
   g_timeline.shutdown();
   clip_editor_shutdown();
 }
@@ -87,6 +89,11 @@ void history_window() {
 
   if (ImGui::Button("Clear All"))
     g_cmd_manager.reset();
+  ImGui::SameLine();
+  ImGui::Text(
+      "%.2f MB in memory, %.2f MB on disk",
+      (double)g_cmd_manager.journal.memory_used() / (1024.0 * 1024.0),
+      (double)g_cmd_manager.journal.spill_used() / (1024.0 * 1024.0));
 
   ImVec2 space = ImGui::GetContentRegionAvail();
 
@@ -119,6 +126,29 @@ void asset_window() {
   }
 
   ImVec2 space = ImGui::GetContentRegionAvail();
+  uint32_t sample_id = 0;
+  if (ImGui::BeginListBox("##sample_listbox", ImVec2(-FLT_MIN, space.y * 0.5f))) {
+    for (auto& [hash, sample_asset] : g_sample_table.samples) {
+      const Sample& sample = sample_asset.content->sample_instance;
+      size_t memory_size = sample.get_memory_size();
+      size_t saved_size = sample.get_unpacked_memory_size() - memory_size;
+      char tmp[256]{};
+      fmt::format_to_n(
+          tmp,
+          sizeof(tmp) - 1,
+          "{} {} KiB (saved {} KiB) Refcount: {}",
+          sample.name,
+          memory_size >> 10,
+          saved_size >> 10,
+          sample_asset.ref_count);
+      ImGui::PushID(sample_id);
+      ImGui::Selectable(tmp);
+      ImGui::PopID();
+      sample_id++;
+    }
+    ImGui::EndListBox();
+  }
+
   uint32_t midi_id = 0;
   if (ImGui::BeginListBox("##midi_listbox", ImVec2(-FLT_MIN, space.y * 0.5f))) {
     auto asset = g_midi_table.allocated_assets.next_;
@@ -0,0 +1,773 @@
+// Headless engine benchmark. Builds synthetic sessions in memory, drives Engine::process and the hot paths used by the
+// audio thread, the editor and file streaming, then writes the results as JSON so they can be compared across versions.
+//
+// Usage: whitebox-bench [-o results.json] [--blocks N] [--buffer-size N] [--tracks N] [--clips N] [--notes N]
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <random>
+#include <string>
+
+#include "core/async_io.h"
+#include "core/audio_buffer.h"
+#include "core/fs.h"
+#include "core/rt_check.h"
+#include "core/rt_log.h"
+#include "core/timing.h"
+#include "dsp/dsp_ops.h"
+#include "dsp/sampler.h"
+#include "engine/assets_table.h"
+#include "engine/engine.h"
+#include "engine/track.h"
+#include "extern/json.hpp"
+#include "gfx/waveform_visual.h"
+
+static std::atomic_uint64_t num_allocations;
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !WB_RT_CHECK
+// Count every heap allocation, not only operator new: Vector, AudioBuffer and the C libraries allocate through
+// malloc/realloc/aligned_alloc. These replace the libc entry points and forward to the glibc allocator, operator new
+// ends up here as well.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+
+void* malloc(size_t size) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+  if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+    return EINVAL;
+  void* new_ptr = memalign(alignment, size);
+  if (new_ptr == nullptr)
+    return ENOMEM;
+  *ptr = new_ptr;
+  return 0;
+}
+}
+#else
+// Other C libraries cannot be replaced this portably, and the real-time checker already replaces the glibc entry
+// points. Only operator new is counted there.
+void* operator new(size_t size) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size == 0 ? 1 : size))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+  return operator new(size, tag);
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+#endif
+
+namespace wb {
+
+struct BenchOptions {
+  std::string output_path = "whitebox_bench.json";
+  uint32_t buffer_size = 512;
+  uint32_t sample_rate = 44100;
+  uint32_t num_blocks = 2000;
+  uint32_t num_warmup_blocks = 64;
+  uint32_t num_tracks = 0;  // 0 means run the predefined sessions
+  uint32_t num_clips = 32;
+  uint32_t num_notes = 512;
+};
+
+struct SessionDesc {
+  const char* name;
+  uint32_t num_audio_tracks;
+  uint32_t num_midi_tracks;
+  uint32_t clips_per_track;
+  uint32_t notes_per_clip;
+};
+
+struct BenchTimings {
+  Vector<uint64_t> ticks;
+
+  void reserve(uint32_t count) {
+    ticks.reserve(count);
+  }
+
+  void add(uint64_t duration) {
+    ticks.push_back(duration);
+  }
+
+  // Converts the collected timings into ns statistics
+  nlohmann::ordered_json summarize(double items_per_iteration = 1.0) {
+    nlohmann::ordered_json result;
+    if (ticks.size() == 0)
+      return result;
+    std::sort(ticks.begin(), ticks.end());
+    uint64_t total = 0;
+    for (auto duration : ticks)
+      total += duration;
+    double mean_ns = tm_ticks_to_ns(total) / (double)ticks.size();
+    result["iterations"] = ticks.size();
+    result["mean_ns"] = mean_ns;
+    result["median_ns"] = tm_ticks_to_ns(ticks[ticks.size() / 2]);
+    result["p99_ns"] = tm_ticks_to_ns(ticks[(uint32_t)((double)(ticks.size() - 1) * 0.99)]);
+    result["min_ns"] = tm_ticks_to_ns(ticks.front());
+    result["max_ns"] = tm_ticks_to_ns(ticks.back());
+    if (items_per_iteration != 1.0)
+      result["mean_ns_per_item"] = mean_ns / items_per_iteration;
+    return result;
+  }
+};
+
+static std::mt19937 rng(0x5eed);
+static SampleHash next_sample_hash = 1;
+
+// Quiet noise over a sine, so the sample compresses like real material
+static Sample create_test_sample(AudioFormat format, uint32_t sample_rate, uint32_t channels, size_t count) {
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  Sample sample(format, sample_rate);
+  sample.name = "bench";
+  sample.resize(count, channels);
+  for (uint32_t c = 0; c < channels; c++) {
+    for (size_t i = 0; i < count; i++) {
+      float value = std::sin((float)i * 0.01f) * 0.5f + dist(rng) * 0.01f;
+      switch (format) {
+        case AudioFormat::I16: sample.get_write_pointer<int16_t>(c)[i] = (int16_t)(value * 32767.0f); break;
+        case AudioFormat::I24:
+          write_packed_i24(sample.get_write_pointer<std::byte>(c) + i * 3, (int32_t)(value * 8388607.0f));
+          break;
+        case AudioFormat::I32: sample.get_write_pointer<int32_t>(c)[i] = (int32_t)(value * 2147483647.0f); break;
+        case AudioFormat::F32: sample.get_write_pointer<float>(c)[i] = value; break;
+        default: WB_UNREACHABLE();
+      }
+    }
+  }
+  return sample;
+}
+
+// The assets are kept alive so they survive clip deletion while running the edit benchmarks. No waveform peaks are
+// created since there is no renderer.
+static SampleAsset* create_test_sample_asset(AudioFormat format, uint32_t sample_rate, size_t count) {
+  SampleHash hash = next_sample_hash++;
+  SampleContent* content =
+      g_sample_table.create_content_(0, 0, 0, create_test_sample(format, sample_rate, 2, count), nullptr);
+  SampleAsset* asset = g_sample_table.create_asset_(hash, {}, content);
+  asset->keep_alive = true;
+  return asset;
+}
+
+static MidiAsset* create_test_midi_asset(uint32_t num_notes, double length) {
+  std::uniform_int_distribution<int16_t> key_dist(36, 96);
+  std::uniform_real_distribution<double> pos_dist(0.0, length - 1.0);
+  std::uniform_real_distribution<double> length_dist(0.125, 1.0);
+  MidiAsset* asset = g_midi_table.create_midi();
+  Vector<MidiNote> notes;
+  notes.reserve(num_notes);
+  for (uint32_t i = 0; i < num_notes; i++) {
+    double min_time = pos_dist(rng);
+    notes.push_back({
+      .min_time = min_time,
+      .max_time = min_time + length_dist(rng),
+      .key = key_dist(rng),
+      .velocity = 0.8f,
+    });
+  }
+  std::sort(notes.begin(), notes.end(), [](const MidiNote& a, const MidiNote& b) { return a.min_time < b.min_time; });
+  MidiNote* added_notes = asset->data.note_sequence.append(notes.begin(), notes.end());
+  asset->data.create_metadata(added_notes, num_notes);
+  asset->data.update_channel(0);
+  asset->data.max_length = length;
+  asset->keep_alive = true;
+  return asset;
+}
+
+// Audio clips are 2 beats long with a 1 beat gap, each clip uses a different format, sample rate and speed.
+static void build_session(const SessionDesc& desc) {
+  static constexpr AudioFormat formats[] = { AudioFormat::I16, AudioFormat::I24, AudioFormat::I32, AudioFormat::F32 };
+  static constexpr double speeds[] = { 1.0, 1.0, 0.5, 1.25, 2.0 };
+  static constexpr uint32_t sample_rates[] = { 44100, 48000, 96000 };
+  const double clip_length = 2.0;
+  const double clip_spacing = 3.0;
+
+  Vector<SampleAsset*> assets;
+  for (uint32_t i = 0; i < std::size(formats); i++) {
+    for (uint32_t j = 0; j < std::size(sample_rates); j++) {
+      // Long enough for a 2 beat clip at 60 BPM played at 2x speed
+      assets.push_back(create_test_sample_asset(formats[i], sample_rates[j], sample_rates[j] * 5));
+    }
+  }
+
+  for (uint32_t i = 0; i < desc.num_audio_tracks; i++) {
+    Track* track = g_engine.add_track("Audio " + std::to_string(i));
+    for (uint32_t j = 0; j < desc.clips_per_track; j++) {
+      SampleAsset* asset = assets[(i + j) % assets.size()];
+      double min_time = (double)j * clip_spacing;
+      asset->add_ref();
+      g_engine.add_audio_clip(
+          track,
+          "Clip",
+          min_time,
+          min_time + clip_length,
+          0.0,
+          {
+            .asset = asset,
+            .speed = speeds[(i + j) % std::size(speeds)],
+            .gain = 1.0f,
+          });
+    }
+  }
+
+  double song_length = std::max((double)desc.clips_per_track * clip_spacing, 4.0);
+  for (uint32_t i = 0; i < desc.num_midi_tracks; i++) {
+    Track* track = g_engine.add_track("MIDI " + std::to_string(i));
+    MidiAsset* asset = create_test_midi_asset(desc.notes_per_clip, song_length);
+    g_engine.add_midi_clip(
+        track,
+        "MIDI Clip",
+        0.0,
+        song_length,
+        0.0,
+        {
+          .asset = asset,
+          .length = song_length,
+        });
+  }
+}
+
+static void clear_session() {
+  g_engine.stop();
+  g_engine.clear_all();
+  g_sample_table.samples.clear();
+  g_sample_table.contents.clear();
+}
+
+static nlohmann::ordered_json run_engine_session(const SessionDesc& desc, const BenchOptions& options) {
+  clear_session();
+  build_session(desc);
+
+  AudioBuffer<float> input_buffer(options.buffer_size, 2);
+  AudioBuffer<float> output_buffer(options.buffer_size, 2);
+  double sample_rate = (double)options.sample_rate;
+  BenchTimings timings;
+  timings.reserve(options.num_blocks);
+
+  g_engine.set_playhead_position(0.0);
+  g_engine.play();
+
+  for (uint32_t i = 0; i < options.num_warmup_blocks; i++)
+    g_engine.process(input_buffer, output_buffer, sample_rate);
+
+  uint64_t allocations_before = num_allocations.load(std::memory_order_relaxed);
+  for (uint32_t i = 0; i < options.num_blocks; i++) {
+    uint64_t start = tm_get_ticks();
+    g_engine.process(input_buffer, output_buffer, sample_rate);
+    timings.add(tm_get_ticks() - start);
+  }
+  uint64_t num_block_allocations = num_allocations.load(std::memory_order_relaxed) - allocations_before;
+
+  nlohmann::ordered_json result;
+  result["name"] = desc.name;
+  result["audio_tracks"] = desc.num_audio_tracks;
+  result["midi_tracks"] = desc.num_midi_tracks;
+  result["clips_per_track"] = desc.clips_per_track;
+  result["notes_per_clip"] = desc.notes_per_clip;
+  result["block"] = timings.summarize();
+
+  // Fraction of the block duration spent processing, below 1.0 means faster than real-time
+  double block_duration_ns = tm_sec_to_ns((double)options.buffer_size / sample_rate);
+  result["realtime_factor"] = result["block"]["mean_ns"].get<double>() / block_duration_ns;
+  result["realtime_factor_p99"] = result["block"]["p99_ns"].get<double>() / block_duration_ns;
+  result["allocations"] = num_block_allocations;
+  result["allocations_per_block"] = (double)num_block_allocations / (double)options.num_blocks;
+
+  clear_session();
+  return result;
+}
+
+// Integer formats are measured again after compressing the sample in memory
+static nlohmann::ordered_json bench_sampler_stream(const BenchOptions& options) {
+  static constexpr AudioFormat formats[] = { AudioFormat::I16, AudioFormat::I24, AudioFormat::I32, AudioFormat::F32 };
+  static constexpr double speeds[] = { 1.0, 1.5 };
+  const uint32_t num_iterations = 4000;
+  nlohmann::ordered_json results = nlohmann::ordered_json::array();
+  AudioBuffer<float> output_buffer(options.buffer_size, 2);
+
+  for (auto format : formats) {
+    Sample sample = create_test_sample(format, options.sample_rate, 2, options.sample_rate * 30);
+    for (bool compressed : { false, true }) {
+      if (compressed && !sample.compress())
+        continue;
+      for (auto speed : speeds) {
+        dsp::Sampler sampler;
+        BenchTimings timings;
+        timings.reserve(num_iterations);
+        sampler.reset_state(dsp::ResamplerType::Linear, 0.0, speed, sample.sample_rate, sample.sample_rate);
+        for (uint32_t i = 0; i < num_iterations; i++) {
+          if (sampler.sample_offset_ + (double)options.buffer_size * speed + 2.0 >= (double)sample.count)
+            sampler.sample_offset_ = 0.0;
+          uint64_t start = tm_get_ticks();
+          sampler.stream(&sample, 2, options.buffer_size, 0, 1.0f, output_buffer.channel_buffers);
+          timings.add(tm_get_ticks() - start);
+          sampler.sample_offset_ += (double)options.buffer_size * sampler.playback_speed_;
+        }
+        nlohmann::ordered_json result = timings.summarize(options.buffer_size);
+        result["format"] = get_audio_format_string(format);
+        result["speed"] = speed;
+        result["compressed"] = compressed;
+        result["memory_size"] = sample.get_memory_size();
+        results.push_back(std::move(result));
+      }
+    }
+  }
+
+  return results;
+}
+
+static nlohmann::ordered_json bench_audio_buffer_mix(const BenchOptions& options) {
+  const uint32_t num_iterations = 20000;
+  AudioBuffer<float> src_buffer(options.buffer_size, 2);
+  AudioBuffer<float> dst_buffer(options.buffer_size, 2);
+  BenchTimings timings;
+  timings.reserve(num_iterations);
+  for (uint32_t i = 0; i < num_iterations; i++) {
+    uint64_t start = tm_get_ticks();
+    dst_buffer.mix(src_buffer);
+    timings.add(tm_get_ticks() - start);
+  }
+  return timings.summarize(options.buffer_size);
+}
+
+// Every kernel table the CPU supports, timed on one block of options.buffer_size samples
+static nlohmann::ordered_json bench_dsp_ops(const BenchOptions& options) {
+  const uint32_t num_iterations = 20000;
+  const uint32_t count = options.buffer_size;
+  AudioBuffer<float> src_buffer(count, 2);
+  AudioBuffer<float> dst_buffer(count, 2);
+  std::uniform_real_distribution<float> dist(-1.5f, 1.5f);
+  for (uint32_t i = 0; i < count; i++) {
+    src_buffer.set_sample(0, i, dist(rng));
+    src_buffer.set_sample(1, i, dist(rng));
+  }
+  const float* src = src_buffer.get_read_pointer(0);
+  float* dst = dst_buffer.get_write_pointer(0);
+  float* dst2 = dst_buffer.get_write_pointer(1);
+
+  auto measure = [&](auto&& fn) {
+    BenchTimings timings;
+    timings.reserve(num_iterations);
+    for (uint32_t i = 0; i < num_iterations; i++) {
+      uint64_t start = tm_get_ticks();
+      fn();
+      timings.add(tm_get_ticks() - start);
+    }
+    return timings.summarize(count);
+  };
+
+  nlohmann::ordered_json results = nlohmann::ordered_json::array();
+  for (auto level : { dsp::SIMDLevel::Scalar, dsp::SIMDLevel::SSE2, dsp::SIMDLevel::AVX2, dsp::SIMDLevel::AVX512 }) {
+    dsp::DSPOps ops;
+    if (!dsp::get_dsp_ops(level, ops))
+      continue;
+    // Peaks are accumulated so the calls cannot be dropped
+    float peak = 0.0f;
+    nlohmann::ordered_json result;
+    result["level"] = dsp::get_simd_level_name(level);
+    result["find_abs_maximum"] = measure([&] { peak += ops.find_abs_maximum(src, count); });
+    result["apply_gain"] = measure([&] { ops.apply_gain(dst, count, 0.999f); });
+    result["hard_clip"] = measure([&] { ops.hard_clip(src, dst, count, 1.0f); });
+    result["mix"] = measure([&] { ops.mix(src, dst, count); });
+    result["mix_gain_ramp"] = measure([&] { ops.mix_gain_ramp(src, dst, count, 0.5f, 0.25f); });
+    result["pan_accumulate"] = measure([&] { ops.pan_accumulate(src, dst, dst2, count, 0.7f, 0.7f); });
+    result["hard_clip_peak"] = measure([&] { peak += ops.hard_clip_peak(src, dst, count, 1.0f); });
+    result["apply_gain_peak"] = measure([&] { peak += ops.apply_gain_peak(dst, count, 0.999f); });
+    result["checksum"] = peak;
+    results.push_back(std::move(result));
+  }
+  return results;
+}
+
+static nlohmann::ordered_json bench_waveform_peaks(const BenchOptions& options) {
+  const uint32_t num_iterations = 20;
+  const size_t num_frames = (size_t)options.sample_rate * 60;
+  Sample sample = create_test_sample(AudioFormat::F32, options.sample_rate, 2, num_frames);
+  BenchTimings full_timings;
+  BenchTimings incremental_timings;
+
+  // Build the whole peak pyramid at once (loading a file) and block by block (recording)
+  for (uint32_t i = 0; i < num_iterations; i++) {
+    LiveWaveform waveform(2, (int32_t)options.sample_rate);
+    uint64_t start = tm_get_ticks();
+    waveform.append(&sample, 0, num_frames);
+    full_timings.add(tm_get_ticks() - start);
+  }
+
+  for (uint32_t i = 0; i < num_iterations; i++) {
+    LiveWaveform waveform(2, (int32_t)options.sample_rate);
+    uint64_t start = tm_get_ticks();
+    for (size_t frame = 0; frame < num_frames; frame += options.buffer_size)
+      waveform.append(&sample, frame, std::min((size_t)options.buffer_size, num_frames - frame));
+    incremental_timings.add(tm_get_ticks() - start);
+  }
+
+  nlohmann::ordered_json result;
+  result["frames"] = num_frames;
+  result["full"] = full_timings.summarize((double)num_frames);
+  result["incremental"] = incremental_timings.summarize((double)num_frames);
+  return result;
+}
+
+static Vector<SelectedTrackRegion> select_region(double min_pos, double max_pos) {
+  Vector<SelectedTrackRegion> selected_track_regions;
+  for (auto track : g_engine.tracks) {
+    auto query_result = track->query_clip_by_range(min_pos, max_pos);
+    selected_track_regions.push_back({
+      .has_clip_selected = query_result.has_value(),
+      .range = query_result ? query_result.value() : ClipQueryResult{},
+    });
+  }
+  return selected_track_regions;
+}
+
+static nlohmann::ordered_json bench_edit_operations(const BenchOptions& options) {
+  const uint32_t num_iterations = 50;
+  SessionDesc desc{
+    .name = "edit",
+    .num_audio_tracks = 16,
+    .num_midi_tracks = 0,
+    .clips_per_track = 256,
+  };
+  BenchTimings move_timings;
+  BenchTimings duplicate_timings;
+  BenchTimings delete_timings;
+
+  // The selection cuts through clips on both sides so the partial selection paths are taken too
+  const double min_pos = 100.5;
+  const double max_pos = 400.5;
+
+  clear_session();
+  build_session(desc);
+  for (uint32_t i = 0; i < num_iterations; i++) {
+    double offset = (i % 2) == 0 ? 1.5 : -1.5;
+    double sel_min = (i % 2) == 0 ? min_pos : min_pos + 1.5;
+    double sel_max = (i % 2) == 0 ? max_pos : max_pos + 1.5;
+    auto selection = select_region(sel_min, sel_max);
+    uint64_t start = tm_get_ticks();
+    g_engine.move_or_duplicate_region(selection, 0, 0, sel_min, sel_max, offset, false);
+    move_timings.add(tm_get_ticks() - start);
+  }
+
+  for (uint32_t i = 0; i < num_iterations; i++) {
+    clear_session();
+    build_session(desc);
+    auto selection = select_region(min_pos, max_pos);
+    uint64_t start = tm_get_ticks();
+    g_engine.move_or_duplicate_region(selection, 0, 0, min_pos, max_pos, max_pos - min_pos, true);
+    duplicate_timings.add(tm_get_ticks() - start);
+  }
+
+  for (uint32_t i = 0; i < num_iterations; i++) {
+    clear_session();
+    build_session(desc);
+    auto selection = select_region(min_pos, max_pos);
+    uint64_t start = tm_get_ticks();
+    g_engine.delete_region(selection, 0, min_pos, max_pos);
+    delete_timings.add(tm_get_ticks() - start);
+  }
+
+  clear_session();
+
+  nlohmann::ordered_json result;
+  result["tracks"] = desc.num_audio_tracks;
+  result["clips_per_track"] = desc.clips_per_track;
+  result["move_region"] = move_timings.summarize();
+  result["duplicate_region"] = duplicate_timings.summarize();
+  result["delete_region"] = delete_timings.summarize();
+  return result;
+}
+
+static constexpr uint32_t file_read_chunk_size = 256 * 1024;
+static constexpr uint32_t file_read_queue_depth = 32;
+
+static double get_throughput_mb_per_s(const nlohmann::ordered_json& timings, uint64_t num_bytes) {
+  return (double)num_bytes / timings["mean_ns"].get<double>() * 1000.0;
+}
+
+// Reads the whole file in chunks, keeping up to file_read_queue_depth requests in flight
+static nlohmann::ordered_json bench_async_read(
+    AsyncIO* io,
+    const std::filesystem::path& path,
+    bool direct,
+    bool registered,
+    uint32_t num_iterations) {
+  Vector<void*> buffers;
+  Vector<size_t> sizes;
+  for (uint32_t i = 0; i < file_read_queue_depth; i++) {
+    buffers.push_back(allocate_io_buffer(file_read_chunk_size));
+    sizes.push_back(file_read_chunk_size);
+  }
+  registered = registered && io->register_buffers(buffers.data(), sizes.data(), buffers.size());
+
+  AsyncFile file;
+  BenchTimings timings;
+  if (file.open(path, IOOpenMode::Read, direct)) {
+    AsyncIORequest requests[file_read_queue_depth];
+    AsyncIORequest* batch[file_read_queue_depth];
+    for (uint32_t i = 0; i < num_iterations; i++) {
+      uint64_t start = tm_get_ticks();
+      for (uint64_t offset = 0; offset < file.size();) {
+        uint32_t num_requests = 0;
+        for (; num_requests < file_read_queue_depth && offset < file.size(); num_requests++) {
+          AsyncIORequest& request = requests[num_requests];
+          request.op = AsyncIOOp::Read;
+          request.buffer_index = registered ? (int32_t)num_requests : -1;
+          request.file = &file;
+          request.offset = offset;
+          request.buffer = buffers[num_requests];
+          request.size = file_read_chunk_size;
+          batch[num_requests] = &request;
+          offset += file_read_chunk_size;
+        }
+        io->submit(batch, num_requests);
+        io->wait_idle();
+      }
+      timings.add(tm_get_ticks() - start);
+    }
+  }
+
+  nlohmann::ordered_json result = timings.summarize();
+  result["direct"] = file.is_direct();
+  result["registered_buffers"] = registered;
+  if (timings.ticks.size() > 0)
+    result["mb_per_s"] = get_throughput_mb_per_s(result, file.size());
+  file.close();
+  if (registered)
+    io->unregister_buffers();
+  for (auto buffer : buffers)
+    free_io_buffer(buffer);
+  return result;
+}
+
+// Streams a large file through File and through each AsyncIO backend. Cached runs read from the page cache after the
+// first iteration, direct runs bypass it where the file system allows.
+static nlohmann::ordered_json bench_file_read(const BenchOptions& options) {
+  const uint32_t num_iterations = 8;
+  const uint64_t file_size = 64 * 1024 * 1024;
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "whitebox_bench_read.bin";
+  nlohmann::ordered_json result;
+
+  Vector<std::byte> chunk;
+  chunk.resize(file_read_chunk_size);
+  for (uint32_t i = 0; i < file_read_chunk_size; i++)
+    chunk[i] = (std::byte)rng();
+  {
+    File file;
+    if (!file.open(path, IOOpenMode::Write | IOOpenMode::Truncate)) {
+      std::fprintf(stderr, "Cannot create %s\n", path.string().c_str());
+      return result;
+    }
+    for (uint64_t offset = 0; offset < file_size; offset += file_read_chunk_size)
+      file.write(chunk.data(), file_read_chunk_size);
+  }
+
+  BenchTimings file_timings;
+  for (uint32_t i = 0; i < num_iterations; i++) {
+    File file;
+    if (!file.open(path, IOOpenMode::Read))
+      break;
+    uint64_t start = tm_get_ticks();
+    while (file.read(chunk.data(), file_read_chunk_size) == file_read_chunk_size) {
+    }
+    file_timings.add(tm_get_ticks() - start);
+  }
+
+  result["file_size"] = file_size;
+  result["chunk_size"] = file_read_chunk_size;
+  result["queue_depth"] = file_read_queue_depth;
+  result["file"] = file_timings.summarize();
+  if (file_timings.ticks.size() > 0)
+    result["file"]["mb_per_s"] = get_throughput_mb_per_s(result["file"], file_size);
+
+  AsyncIO* thread_pool = create_async_io(file_read_queue_depth, false);
+  result["thread_pool"] = bench_async_read(thread_pool, path, false, false, num_iterations);
+  result["thread_pool_direct"] = bench_async_read(thread_pool, path, true, false, num_iterations);
+  delete thread_pool;
+
+  if (AsyncIO* io_uring = create_async_io_uring(file_read_queue_depth)) {
+    result["io_uring"] = bench_async_read(io_uring, path, false, false, num_iterations);
+    result["io_uring_registered"] = bench_async_read(io_uring, path, false, true, num_iterations);
+    result["io_uring_direct"] = bench_async_read(io_uring, path, true, true, num_iterations);
+    delete io_uring;
+  }
+
+  std::filesystem::remove(path);
+  return result;
+}
+
+static bool parse_options(int argc, char** argv, BenchOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    auto parse_u32 = [&](uint32_t& dst) {
+      if (value == nullptr)
+        return false;
+      dst = (uint32_t)std::strtoul(value, nullptr, 10);
+      i++;
+      return true;
+    };
+
+    bool ok = true;
+    if (std::strcmp(arg, "-o") == 0 && value) {
+      options.output_path = value;
+      i++;
+    } else if (std::strcmp(arg, "--blocks") == 0) {
+      ok = parse_u32(options.num_blocks);
+    } else if (std::strcmp(arg, "--buffer-size") == 0) {
+      ok = parse_u32(options.buffer_size);
+    } else if (std::strcmp(arg, "--tracks") == 0) {
+      ok = parse_u32(options.num_tracks);
+    } else if (std::strcmp(arg, "--clips") == 0) {
+      ok = parse_u32(options.num_clips);
+    } else if (std::strcmp(arg, "--notes") == 0) {
+      ok = parse_u32(options.num_notes);
+    } else {
+      ok = false;
+    }
+
+    if (!ok) {
+      std::fprintf(
+          stderr,
+          "Usage: %s [-o results.json] [--blocks N] [--buffer-size N] [--tracks N] [--clips N] [--notes N]\n",
+          argv[0]);
+      return false;
+    }
+  }
+  return options.buffer_size != 0 && options.num_blocks != 0;
+}
+
+}  // namespace wb
+
+int main(int argc, char** argv) {
+  using namespace wb;
+
+  BenchOptions options;
+  if (!parse_options(argc, argv, options))
+    return 1;
+
+  // The real-time logger is not started, messages from the audio path are dropped instead of being printed
+  rt_log_register_thread("Benchmark");
+  dsp::init_dsp_ops();
+  g_engine.set_audio_channel_config(0, 2, options.buffer_size, options.sample_rate);
+  g_engine.set_bpm(120.0);
+
+  Vector<SessionDesc> sessions;
+  if (options.num_tracks != 0) {
+    uint32_t num_midi_tracks = options.num_tracks / 2;
+    sessions.push_back({
+      .name = "custom",
+      .num_audio_tracks = options.num_tracks - num_midi_tracks,
+      .num_midi_tracks = num_midi_tracks,
+      .clips_per_track = options.num_clips,
+      .notes_per_clip = options.num_notes,
+    });
+  } else {
+    sessions.push_back({ "small", 4, 4, 16, 256 });
+    sessions.push_back({ "medium", 16, 16, 64, 1024 });
+    sessions.push_back({ "large", 64, 64, 128, 4096 });
+  }
+
+  nlohmann::ordered_json results;
+  results["version"] = 1;
+#ifdef NDEBUG
+  results["build"] = "release";
+#else
+  results["build"] = "debug";
+#endif
+  results["buffer_size"] = options.buffer_size;
+  results["sample_rate"] = options.sample_rate;
+
+  nlohmann::ordered_json& session_results = results["engine_process"];
+  session_results = nlohmann::ordered_json::array();
+  for (const auto& session : sessions) {
+    std::printf("Running session \"%s\"...\n", session.name);
+    session_results.push_back(run_engine_session(session, options));
+  }
+
+  std::printf("Running micro-benchmarks...\n");
+  nlohmann::ordered_json& micro_results = results["micro"];
+  micro_results["sampler_stream"] = bench_sampler_stream(options);
+  micro_results["audio_buffer_mix"] = bench_audio_buffer_mix(options);
+  micro_results["dsp_ops"] = bench_dsp_ops(options);
+  micro_results["waveform_peaks"] = bench_waveform_peaks(options);
+  micro_results["edit"] = bench_edit_operations(options);
+  micro_results["file_read"] = bench_file_read(options);
+
+  std::ofstream file(options.output_path);
+  if (!file.is_open()) {
+    std::fprintf(stderr, "Cannot open %s\n", options.output_path.c_str());
+    return 1;
+  }
+  file << results.dump(2) << '\n';
+
+  for (const auto& session : session_results) {
+    std::printf(
+        "%-8s %10.0f ns/block  rtf %.4f  allocations %llu\n",
+        session["name"].get<std::string>().c_str(),
+        session["block"]["mean_ns"].get<double>(),
+        session["realtime_factor"].get<double>(),
+        (unsigned long long)session["allocations"].get<uint64_t>());
+  }
+  std::printf("Results written to %s\n", options.output_path.c_str());
+
+  g_midi_table.shutdown();
+  return 0;
+}
@@ -0,0 +1,103 @@
+#include <filesystem>
+#include <fstream>
+
+#include "catch_amalgamated.hpp"
+#include "engine/assets_table.h"
+#include "engine/file_index.h"
+
+namespace fs = std::filesystem;
+
+static void write_u16(std::ofstream& file, uint16_t value) {
+  file.write((const char*)&value, sizeof(value));
+}
+
+static void write_u32(std::ofstream& file, uint32_t value) {
+  file.write((const char*)&value, sizeof(value));
+}
+
+// 16-bit mono WAV file with a 300 KB padding chunk in front of the audio data, large enough for its middle to be
+// skipped by the quick content hash. The audio is kept under one waveform mip-map, so no renderer is needed for the
+// peaks.
+static void write_test_file(const fs::path& path, char middle) {
+  static constexpr uint32_t num_frames = 64;
+  std::string padding(300 * 1024, 'x');
+  padding[padding.size() / 2] = middle;
+  uint32_t data_size = num_frames * sizeof(int16_t);
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write("RIFF", 4);
+  write_u32(file, 4 + (8 + 16) + (8 + (uint32_t)padding.size()) + (8 + data_size));
+  file.write("WAVE", 4);
+  file.write("fmt ", 4);
+  write_u32(file, 16);
+  write_u16(file, 1);  // PCM
+  write_u16(file, 1);
+  write_u32(file, 44100);
+  write_u32(file, 44100 * sizeof(int16_t));
+  write_u16(file, sizeof(int16_t));
+  write_u16(file, 16);
+  file.write("JUNK", 4);
+  write_u32(file, (uint32_t)padding.size());
+  file.write(padding.data(), padding.size());
+  file.write("data", 4);
+  write_u32(file, data_size);
+  for (uint32_t i = 0; i < num_frames; i++)
+    write_u16(file, (uint16_t)(int16_t)(i * 256));
+}
+
+TEST_CASE("Sample table") {
+  fs::path temp_dir = fs::temp_directory_path() / "wb_test_assets_table";
+  fs::remove_all(temp_dir);
+  fs::create_directories(temp_dir);
+  write_test_file(temp_dir / "kick.wav", 'a');
+  write_test_file(temp_dir / "kick_copy.wav", 'a');
+  write_test_file(temp_dir / "kick_edit.wav", 'b');
+
+  wb::SampleTable table;
+  wb::SampleAsset* kick = table.load_from_file(temp_dir / "kick.wav");
+  wb::SampleAsset* kick_copy = table.load_from_file(temp_dir / "kick_copy.wav");
+  wb::SampleAsset* kick_edit = table.load_from_file(temp_dir / "kick_edit.wav");
+  REQUIRE(kick != nullptr);
+  REQUIRE(kick_copy != nullptr);
+  REQUIRE(kick_edit != nullptr);
+
+  SECTION("Identical files share content") {
+    REQUIRE(kick != kick_copy);
+    REQUIRE(kick->content == kick_copy->content);
+    REQUIRE(kick->content->sample_instance.count == 64);
+    REQUIRE(kick->content->file_size == fs::file_size(temp_dir / "kick.wav"));
+    REQUIRE(kick->content->num_assets == 2);
+    REQUIRE(kick_copy->path == temp_dir / "kick_copy.wav");
+    REQUIRE(table.samples.size() == 3);
+    REQUIRE(table.contents.size() == 2);
+  }
+
+  SECTION("Same quick hash, different content") {
+    REQUIRE(kick->content->content_hash == kick_edit->content->content_hash);
+    REQUIRE(kick->content != kick_edit->content);
+    REQUIRE(kick->content->full_hash == wb::compute_file_full_hash(temp_dir / "kick.wav"));
+    REQUIRE(kick_edit->content->full_hash == wb::compute_file_full_hash(temp_dir / "kick_edit.wav"));
+  }
+
+  SECTION("Same path") {
+    REQUIRE(table.load_from_file(temp_dir / "kick.wav") == kick);
+    REQUIRE(kick->ref_count == 2);
+    kick->release();
+  }
+
+  SECTION("Release") {
+    kick->release();
+    REQUIRE(table.samples.size() == 2);
+    REQUIRE(table.contents.size() == 2);
+    REQUIRE(kick_copy->content->num_assets == 1);
+    REQUIRE(kick_copy->content->source_path == temp_dir / "kick.wav");
+
+    kick_copy->release();
+    kick_edit->release();
+    REQUIRE(table.samples.empty());
+    REQUIRE(table.contents.empty());
+  }
+
+  table.shutdown();
+  fs::remove_all(temp_dir);
+}
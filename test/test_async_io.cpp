@@ -0,0 +1,104 @@
+#include <cstring>
+#include <filesystem>
+#include <memory>
+
+#include "catch_amalgamated.hpp"
+#include "core/async_io.h"
+
+static constexpr uint32_t block_size = wb::AsyncIO::direct_alignment * 4;
+static constexpr uint32_t num_blocks = 16;
+
+static void fill_block(void* buffer, uint32_t block) {
+  uint32_t* values = (uint32_t*)buffer;
+  for (uint32_t i = 0; i < block_size / sizeof(uint32_t); i++)
+    values[i] = block * 0x10000 + i;
+}
+
+static void count_completion(wb::AsyncIORequest* request) {
+  ((std::atomic_uint32_t*)request->userdata)->fetch_add(1, std::memory_order_relaxed);
+}
+
+static void test_async_io(wb::AsyncIO* io) {
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "whitebox_test_async_io.bin";
+  void* buffers[num_blocks];
+  size_t sizes[num_blocks];
+  wb::AsyncIORequest requests[num_blocks];
+  wb::AsyncIORequest* batch[num_blocks];
+  for (uint32_t i = 0; i < num_blocks; i++) {
+    buffers[i] = wb::allocate_io_buffer(block_size);
+    sizes[i] = block_size;
+    batch[i] = &requests[i];
+  }
+
+  // Write every block in one batch, then read them back in reverse into other buffers
+  wb::AsyncFile file;
+  REQUIRE(file.open(path, wb::IOOpenMode::Read | wb::IOOpenMode::Write | wb::IOOpenMode::Truncate));
+  std::atomic_uint32_t num_completed = 0;
+  for (uint32_t i = 0; i < num_blocks; i++) {
+    fill_block(buffers[i], i);
+    requests[i].op = wb::AsyncIOOp::Write;
+    requests[i].file = &file;
+    requests[i].offset = (uint64_t)i * block_size;
+    requests[i].buffer = buffers[i];
+    requests[i].size = block_size;
+    requests[i].callback = count_completion;
+    requests[i].userdata = &num_completed;
+  }
+  io->submit(batch, num_blocks);
+  io->wait_idle();
+  REQUIRE(num_completed == num_blocks);
+  for (auto& request : requests)
+    REQUIRE(request.result == block_size);
+  file.close();
+
+  // Cached, into registered buffers and bypassing the page cache
+  for (uint32_t mode = 0; mode < 3; mode++) {
+    bool registered = mode == 1 && io->register_buffers(buffers, sizes, num_blocks);
+    bool direct = mode == 2;
+    REQUIRE(file.open(path, wb::IOOpenMode::Read, direct));
+    REQUIRE(file.size() == (uint64_t)block_size * num_blocks);
+    for (uint32_t i = 0; i < num_blocks; i++) {
+      std::memset(buffers[i], 0, block_size);
+      requests[i].op = wb::AsyncIOOp::Read;
+      requests[i].buffer_index = registered ? i : -1;
+      requests[i].offset = (uint64_t)(num_blocks - i - 1) * block_size;
+      requests[i].callback = nullptr;
+    }
+    io->submit(batch, num_blocks);
+    auto expected = std::make_unique<uint32_t[]>(block_size / sizeof(uint32_t));
+    for (uint32_t i = 0; i < num_blocks; i++) {
+      requests[i].wait();
+      REQUIRE(requests[i].result == block_size);
+      fill_block(expected.get(), num_blocks - i - 1);
+      REQUIRE(std::memcmp(buffers[i], expected.get(), block_size) == 0);
+    }
+
+    // Reads past the end of the file are short
+    if (!file.is_direct()) {
+      requests[0].offset = (uint64_t)block_size * num_blocks - 100;
+      io->submit(&requests[0]);
+      requests[0].wait();
+      REQUIRE(requests[0].result == 100);
+    }
+    file.close();
+    io->unregister_buffers();
+  }
+
+  for (auto buffer : buffers)
+    wb::free_io_buffer(buffer);
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("Async I/O thread pool") {
+  wb::AsyncIO* io = wb::create_async_io_thread_pool(8, 4);
+  test_async_io(io);
+  delete io;
+}
+
+TEST_CASE("Async I/O io_uring") {
+  wb::AsyncIO* io = wb::create_async_io_uring(8);
+  if (io == nullptr)
+    SKIP("io_uring is not available");
+  test_async_io(io);
+  delete io;
+}
@@ -73,4 +73,21 @@ TEST_CASE("AudioBuffer resize channel") {
       REQUIRE(buffer.get_read_pointer(c) != nullptr);
     }
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("AudioBuffer memory lock") {
+  wb::AudioBuffer<float> buffer(256, 2);
+  buffer.lock_memory();
+  REQUIRE(buffer.memory_locked);
+
+  // Resizing swaps the locked pages for the new ones
+  buffer.resize(512);
+  buffer.resize_channel(4);
+  buffer.resize_channel(1);
+  REQUIRE(buffer.memory_locked);
+  REQUIRE(buffer.n_samples == 512);
+  REQUIRE(buffer.n_channels == 1);
+
+  buffer.unlock_memory();
+  REQUIRE(!buffer.memory_locked);
+}
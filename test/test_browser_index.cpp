@@ -0,0 +1,137 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include "catch_amalgamated.hpp"
+#include "ui/browser_index.h"
+
+namespace fs = std::filesystem;
+
+static void write_test_file(const fs::path& path, size_t size) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  std::string content(size, 'x');
+  file.write(content.data(), content.size());
+}
+
+// Merge updates until the condition is satisfied or the timeout has elapsed
+template<typename Fn>
+static bool wait_for_index(wb::BrowserIndex& index, Fn&& condition) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (std::chrono::steady_clock::now() < deadline) {
+    index.apply_updates();
+    if (condition())
+      return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+TEST_CASE("Browser index match score") {
+  REQUIRE(wb::browser_match_score(u8"Kick 01.wav", u8"kick") > wb::browser_match_score(u8"Big Kick.wav", u8"kick"));
+  REQUIRE(wb::browser_match_score(u8"Big Kick.wav", u8"kick") > wb::browser_match_score(u8"Kcik.wav", u8"kck"));
+  REQUIRE(wb::browser_match_score(u8"snare.wav", u8"sn.wav") >= 0);
+  REQUIRE(wb::browser_match_score(u8"snare.wav", u8"kick") == -1);
+}
+
+TEST_CASE("Browser index") {
+  fs::path temp_dir = fs::temp_directory_path() / "wb_test_browser_index";
+  fs::path library = temp_dir / "library";
+  fs::remove_all(temp_dir);
+  fs::create_directories(library / "drums" / "kicks");
+  fs::create_directories(library / "keys");
+  write_test_file(library / "drums" / "kicks" / "Kick 01.wav", 100);
+  write_test_file(library / "drums" / "snare.wav", 200);
+  write_test_file(library / "keys" / "piano.mid", 300);
+  write_test_file(library / "keys" / "readme.txt", 10);
+
+  wb::BrowserIndex index;
+  uint32_t root = index.add_root(library);
+  index.start();
+  REQUIRE(wait_for_index(index, [&] { return index.num_files == 3; }));
+  // The end of the scan starts a new search generation
+  REQUIRE(wait_for_index(index, [&] { return index.generation != 0; }));
+
+  const wb::BrowserNode& root_node = index.nodes[root];
+  REQUIRE(root_node.children.size() == 2);
+  REQUIRE(index.nodes[root_node.children[0]].name == u8"drums");
+  REQUIRE(index.nodes[root_node.children[1]].name == u8"keys");
+
+  uint32_t snare = index.find_node(library / "drums" / "snare.wav");
+  REQUIRE(index.is_valid(snare));
+  REQUIRE(index.nodes[snare].size == 200);
+  REQUIRE(index.nodes[snare].file_type == wb::BrowserNode::Sample);
+  REQUIRE(index.get_path(snare) == library / "drums" / "snare.wav");
+  REQUIRE(index.find_node(library / "keys" / "readme.txt") == wb::browser_invalid_node);
+
+  wb::Vector<wb::BrowserSearchResult> results;
+  index.search(u8"KICK", results);
+  REQUIRE(results.size() == 1);
+  REQUIRE(index.get_path(results[0].node) == library / "drums" / "kicks" / "Kick 01.wav");
+
+#ifdef WB_PLATFORM_LINUX
+  SECTION("File system notifications") {
+    // Give the indexer some time to start watching the directories
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    write_test_file(library / "keys" / "organ.wav", 400);
+    fs::remove(library / "drums" / "snare.wav");
+    fs::create_directories(library / "fx" / "risers");
+    write_test_file(library / "fx" / "risers" / "riser.wav", 500);
+    REQUIRE(wait_for_index(index, [&] {
+      return index.is_valid(index.find_node(library / "keys" / "organ.wav")) &&
+             !index.is_valid(index.find_node(library / "drums" / "snare.wav")) &&
+             index.is_valid(index.find_node(library / "fx" / "risers" / "riser.wav"));
+    }));
+    REQUIRE(index.num_files == 4);
+  }
+
+  SECTION("Moved directory notifications") {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    fs::rename(library / "drums", library / "percussion");
+    REQUIRE(wait_for_index(index, [&] {
+      return index.is_valid(index.find_node(library / "percussion" / "kicks" / "Kick 01.wav")) &&
+             !index.is_valid(index.find_node(library / "drums" / "kicks" / "Kick 01.wav"));
+    }));
+
+    // Files created in the moved directory show up under its new path
+    write_test_file(library / "percussion" / "kicks" / "Kick 02.wav", 100);
+    REQUIRE(wait_for_index(index, [&] {
+      return index.is_valid(index.find_node(library / "percussion" / "kicks" / "Kick 02.wav"));
+    }));
+    REQUIRE(!index.is_valid(index.find_node(library / "drums" / "kicks" / "Kick 02.wav")));
+    REQUIRE(index.num_files == 4);
+
+    // Changes in the directory after it left the library are not reported under its old path, even when a new
+    // directory takes its place
+    fs::rename(library / "percussion", temp_dir / "percussion");
+    REQUIRE(wait_for_index(index, [&] { return index.num_files == 1; }));
+    fs::create_directories(library / "percussion" / "kicks");
+    REQUIRE(wait_for_index(index, [&] { return index.is_valid(index.find_node(library / "percussion" / "kicks")); }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    fs::create_directories(temp_dir / "percussion" / "kicks" / "vintage");
+    write_test_file(library / "keys" / "organ.wav", 400);
+    REQUIRE(wait_for_index(index, [&] { return index.is_valid(index.find_node(library / "keys" / "organ.wav")); }));
+    REQUIRE(!index.is_valid(index.find_node(library / "percussion" / "kicks" / "vintage")));
+  }
+#endif
+
+  SECTION("Save and load") {
+    index.stop();
+    REQUIRE(index.save(temp_dir / "browser.cache"));
+
+    wb::BrowserIndex cached_index;
+    cached_index.add_root(library);
+    REQUIRE(cached_index.load(temp_dir / "browser.cache"));
+    REQUIRE(cached_index.num_files == 3);
+    REQUIRE(cached_index.is_valid(cached_index.find_node(library / "drums" / "kicks" / "Kick 01.wav")));
+
+    // Roots that are not in the browser anymore are dropped
+    wb::BrowserIndex other_index;
+    other_index.add_root(temp_dir / "other");
+    REQUIRE(other_index.load(temp_dir / "browser.cache"));
+    REQUIRE(other_index.num_files == 0);
+  }
+
+  index.stop();
+  fs::remove_all(temp_dir);
+}
@@ -0,0 +1,95 @@
+#include <filesystem>
+
+#include "catch_amalgamated.hpp"
+#include "core/chunk_file.h"
+#include "core/stream.h"
+
+static constexpr uint32_t test_magic = wb::fourcc("TEST");
+static constexpr uint32_t first_section = wb::fourcc("SEC0");
+static constexpr uint32_t second_section = wb::fourcc("SEC1");
+
+static void write_test_file(wb::ByteBuffer& file) {
+  wb::ChunkFileWriter writer;
+  wb::ByteBuffer& first = writer.begin_section(first_section);
+  wb::io_write(first, 1234u);
+  first.write("abc", 3);
+  writer.end_section();
+
+  wb::ByteBuffer& second = writer.begin_section(second_section, 0);
+  for (uint64_t i = 0; i < 100; i++)
+    wb::io_write(second, i);
+  writer.end_section();
+
+  writer.finalize(test_magic, 3, file);
+}
+
+TEST_CASE("Chunk file") {
+  wb::ByteBuffer file;
+  wb::ChunkFileReader reader;
+  wb::ByteBuffer section;
+  write_test_file(file);
+
+  SECTION("Read sections") {
+    REQUIRE(reader.open_memory(file.data(), file.position(), test_magic) == wb::ChunkFileResult::Ok);
+    REQUIRE(reader.version() == 3);
+    REQUIRE(reader.has_section(first_section));
+    REQUIRE(!reader.has_section(wb::fourcc("NONE")));
+    REQUIRE(reader.get_section(wb::fourcc("NONE"), section) == wb::ChunkFileResult::ErrSectionNotFound);
+
+    // Sections are read in any order
+    REQUIRE(reader.get_section(second_section, section) == wb::ChunkFileResult::Ok);
+    REQUIRE(section.size() == 100 * sizeof(uint64_t));
+    REQUIRE(((uintptr_t)section.data() - (uintptr_t)file.data()) % 8 == 0);
+    for (uint64_t i = 0; i < 100; i++) {
+      uint64_t value;
+      REQUIRE(wb::io_read(section, &value));
+      REQUIRE(value == i);
+    }
+
+    REQUIRE(reader.get_section(first_section, section) == wb::ChunkFileResult::Ok);
+    uint32_t value;
+    char str[3];
+    REQUIRE(wb::io_read(section, &value));
+    REQUIRE(section.read(str, 3));
+    REQUIRE(value == 1234);
+    REQUIRE(std::memcmp(str, "abc", 3) == 0);
+    REQUIRE(!section.read(str, 1));
+  }
+
+  SECTION("Wrong magic") {
+    REQUIRE(reader.open_memory(file.data(), file.position(), wb::fourcc("WBPJ")) == wb::ChunkFileResult::ErrInvalidFormat);
+    REQUIRE(reader.open_memory(file.data(), 8, test_magic) == wb::ChunkFileResult::ErrInvalidFormat);
+  }
+
+  SECTION("Truncated file") {
+    REQUIRE(reader.open_memory(file.data(), file.position() - 8, test_magic) == wb::ChunkFileResult::ErrCorruptedFile);
+  }
+
+  SECTION("Checksum mismatch") {
+    REQUIRE(reader.open_memory(file.data(), file.position(), test_magic) == wb::ChunkFileResult::Ok);
+    file.data()[reader.sections[0].offset] ^= std::byte{ 1 };
+    REQUIRE(reader.get_section(first_section, section) == wb::ChunkFileResult::ErrCorruptedFile);
+
+    // The second section has no checksum
+    file.data()[reader.sections[1].offset] ^= std::byte{ 1 };
+    REQUIRE(reader.get_section(second_section, section) == wb::ChunkFileResult::Ok);
+  }
+
+  SECTION("Mapped file") {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "wb_test_chunk_file.tmp";
+    wb::ChunkFileWriter writer;
+    wb::io_write(writer.begin_section(first_section), 5678u);
+    writer.end_section();
+    REQUIRE(writer.write_to_file(path, test_magic, 1) == wb::ChunkFileResult::Ok);
+    REQUIRE(wb::chunk_file_has_magic(path, test_magic));
+    REQUIRE(!std::filesystem::exists(std::filesystem::path(path) += ".tmp"));
+
+    uint32_t value = 0;
+    REQUIRE(reader.open(path, test_magic) == wb::ChunkFileResult::Ok);
+    REQUIRE(reader.get_section(first_section, section) == wb::ChunkFileResult::Ok);
+    REQUIRE(wb::io_read(section, &value));
+    REQUIRE(value == 5678);
+    reader.file.close();
+    std::filesystem::remove(path);
+  }
+}
@@ -0,0 +1,118 @@
+#include <random>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "dsp/dsp_ops.h"
+
+using wb::dsp::DSPOps;
+using wb::dsp::SIMDLevel;
+
+// Sizes around every vector width, so both the vector loop and the scalar tail run
+static constexpr uint32_t test_sizes[] = { 0, 1, 3, 4, 7, 8, 15, 16, 17, 33, 100, 513 };
+
+static std::vector<float> random_signal(uint32_t count, std::mt19937& rng) {
+  std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+  std::vector<float> signal(count + 1);
+  for (auto& sample : signal)
+    sample = dist(rng);
+  return signal;
+}
+
+static void require_equal(const std::vector<float>& a, const std::vector<float>& b) {
+  REQUIRE(a.size() == b.size());
+  for (size_t i = 0; i < a.size(); i++)
+    REQUIRE(a[i] == b[i]);
+}
+
+// Fused multiply-add rounds once, results may differ from the reference in the last bit
+static void require_close(const std::vector<float>& a, const std::vector<float>& b) {
+  REQUIRE(a.size() == b.size());
+  for (size_t i = 0; i < a.size(); i++)
+    REQUIRE(a[i] == Catch::Approx(b[i]).epsilon(1e-6).margin(1e-6));
+}
+
+static void test_ops(const DSPOps& ops) {
+  std::mt19937 rng(1234);
+  for (uint32_t count : test_sizes) {
+    INFO("count " << count);
+    // The extra sample past count checks that the kernels stay inside the buffer
+    std::vector<float> input = random_signal(count, rng);
+    std::vector<float> input2 = random_signal(count, rng);
+    std::vector<float> output = random_signal(count, rng);
+    std::vector<float> output2 = output;
+    std::vector<float> reference = output;
+    std::vector<float> reference2 = output;
+
+    REQUIRE(ops.find_abs_maximum(input.data(), count) == wb::dsp::find_abs_maximum<float>(input.data(), count));
+
+    ops.gain(input.data(), output.data(), count, 0.7f);
+    wb::dsp::gain<float>(input.data(), reference.data(), count, 0.7f);
+    require_equal(output, reference);
+
+    output = input;
+    reference = input;
+    ops.apply_gain(output.data(), count, -1.3f);
+    wb::dsp::apply_gain<float>(reference.data(), count, -1.3f);
+    require_equal(output, reference);
+
+    ops.hard_clip(input.data(), output.data(), count, 0.8f);
+    wb::dsp::hard_clip<float>(input.data(), reference.data(), count, 0.8f);
+    require_equal(output, reference);
+
+    ops.mix(input.data(), output.data(), count);
+    wb::dsp::mix<float>(input.data(), reference.data(), count);
+    require_equal(output, reference);
+
+    ops.mix_gain(input2.data(), output.data(), count, 0.3f);
+    wb::dsp::mix_gain<float>(input2.data(), reference.data(), count, 0.3f);
+    require_close(output, reference);
+
+    ops.mix_gain_ramp(input.data(), output.data(), count, 1.0f, 0.25f);
+    wb::dsp::mix_gain_ramp<float>(input.data(), reference.data(), count, 1.0f, 0.25f);
+    require_close(output, reference);
+
+    ops.pan_accumulate(input2.data(), output.data(), output2.data(), count, 0.6f, 0.9f);
+    wb::dsp::pan_accumulate<float>(input2.data(), reference.data(), reference2.data(), count, 0.6f, 0.9f);
+    require_close(output, reference);
+    require_close(output2, reference2);
+
+    float peak = ops.hard_clip_peak(input.data(), output.data(), count, 1.0f);
+    float reference_peak = wb::dsp::hard_clip_peak<float>(input.data(), reference.data(), count, 1.0f);
+    REQUIRE(peak == reference_peak);
+    require_equal(output, reference);
+
+    output = input;
+    reference = input;
+    peak = ops.apply_gain_peak(output.data(), count, 0.5f);
+    reference_peak = wb::dsp::apply_gain_peak<float>(reference.data(), count, 0.5f);
+    REQUIRE(peak == reference_peak);
+    require_equal(output, reference);
+  }
+}
+
+TEST_CASE("DSP ops") {
+  SIMDLevel supported = wb::dsp::get_supported_simd_level();
+  for (auto level : { SIMDLevel::Scalar, SIMDLevel::SSE2, SIMDLevel::AVX2, SIMDLevel::AVX512 }) {
+    DSPOps ops;
+    bool available = wb::dsp::get_dsp_ops(level, ops);
+    REQUIRE(available == (level <= supported));
+    if (!available)
+      continue;
+    INFO("level " << wb::dsp::get_simd_level_name(level));
+    REQUIRE(ops.level == level);
+    test_ops(ops);
+  }
+
+  SECTION("Dispatch") {
+    wb::dsp::init_dsp_ops(SIMDLevel::SSE2);
+    REQUIRE(wb::dsp::g_dsp_ops.level == std::min(supported, SIMDLevel::SSE2));
+    wb::dsp::init_dsp_ops();
+    REQUIRE(wb::dsp::g_dsp_ops.level == supported);
+
+    float buffer[] = { 0.5f, -2.0f, 1.5f, 0.25f, -0.75f };
+    REQUIRE(wb::dsp::find_abs_maximum(buffer, 5) == 2.0f);
+    REQUIRE(wb::dsp::hard_clip_peak(buffer, buffer, 5) == 2.0f);
+    REQUIRE(buffer[1] == -1.0f);
+    REQUIRE(buffer[2] == 1.0f);
+  }
+}
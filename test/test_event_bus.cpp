@@ -0,0 +1,70 @@
+#include <random>
+
+#include "catch_amalgamated.hpp"
+#include "engine/event_bus.h"
+
+static wb::MidiEvent make_note_on(uint32_t buffer_offset, int16_t key) {
+  return {
+    .type = wb::MidiEventType::NoteOn,
+    .buffer_offset = buffer_offset,
+    .note_on = {
+      .channel = 0,
+      .key = key,
+      .velocity = 1.0f,
+    },
+  };
+}
+
+TEST_CASE("TrackEventBus merges lanes in buffer offset order") {
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<uint32_t> offset_dist(0, 511);
+  wb::BlockArena arena;
+  REQUIRE(arena.init(256 * 1024));
+
+  wb::TrackEventBus bus;
+  bus.reserve(256);
+  bus.begin_block(arena);
+
+  for (uint32_t i = 0; i < 200; i++) {
+    bus.push_midi(wb::EventSource::Clip, make_note_on(offset_dist(rng), (int16_t)(i % 128)));
+    bus.push_midi(wb::EventSource::Live, make_note_on(offset_dist(rng), (int16_t)(i % 128)));
+    if (i % 4 == 0)
+      bus.push_param(wb::EventSource::Automation, offset_dist(rng), i, (double)i);
+  }
+  bus.merge();
+
+  REQUIRE(bus.num_events == 450);
+  for (uint32_t i = 1; i < bus.num_events; i++)
+    REQUIRE(bus.events[i - 1].buffer_offset <= bus.events[i].buffer_offset);
+  REQUIRE((std::byte*)bus.events >= arena.data);
+  REQUIRE((std::byte*)bus.events < arena.data + arena.capacity);
+}
+
+TEST_CASE("TrackEventBus merge is stable") {
+  wb::TrackEventBus bus;
+  bus.reserve(16);
+
+  // Same offset: lane priority first, then push order within the lane
+  bus.push_midi(wb::EventSource::Clip, make_note_on(8, 1));
+  bus.push_midi(wb::EventSource::Clip, make_note_on(8, 2));
+  bus.push_midi(wb::EventSource::Live, make_note_on(8, 3));
+  bus.push_param(wb::EventSource::Automation, 8, 0, 1.0);
+  bus.push_midi(wb::EventSource::Clip, make_note_on(4, 4));
+  bus.merge();
+
+  REQUIRE(bus.num_events == 5);
+  REQUIRE(bus.events[0].midi.note_on.key == 4);
+  REQUIRE(bus.events[1].type == wb::BusEventType::Param);
+  REQUIRE(bus.events[2].midi.note_on.key == 3);
+  REQUIRE(bus.events[3].midi.note_on.key == 1);
+  REQUIRE(bus.events[4].midi.note_on.key == 2);
+}
+
+TEST_CASE("TrackEventBus drops events when a lane is full") {
+  wb::TrackEventBus bus;
+  bus.reserve(4);
+  for (uint32_t i = 0; i < 6; i++)
+    bus.push_midi(wb::EventSource::Live, make_note_on(i, 60));
+  REQUIRE(bus.lanes[(uint32_t)wb::EventSource::Live].size() == 4);
+  REQUIRE(bus.num_dropped == 2);
+}
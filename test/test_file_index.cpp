@@ -0,0 +1,121 @@
+#include <filesystem>
+#include <fstream>
+
+#include "catch_amalgamated.hpp"
+#include "engine/file_index.h"
+
+namespace fs = std::filesystem;
+
+static void write_test_file(const fs::path& path, char fill, size_t size) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  std::string content(size, fill);
+  file.write(content.data(), content.size());
+}
+
+// 16-bit PCM wave file filled with silence
+static void write_test_wav(const fs::path& path, uint32_t channels, uint32_t rate, uint32_t num_frames) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  auto write_u32 = [&](uint32_t value) { file.write((const char*)&value, 4); };
+  auto write_u16 = [&](uint16_t value) { file.write((const char*)&value, 2); };
+  uint32_t data_size = num_frames * channels * 2;
+  file.write("RIFF", 4);
+  write_u32(36 + data_size);
+  file.write("WAVEfmt ", 8);
+  write_u32(16);
+  write_u16(1);
+  write_u16((uint16_t)channels);
+  write_u32(rate);
+  write_u32(rate * channels * 2);
+  write_u16((uint16_t)(channels * 2));
+  write_u16(16);
+  file.write("data", 4);
+  write_u32(data_size);
+  std::string content(data_size, '\0');
+  file.write(content.data(), content.size());
+}
+
+TEST_CASE("File index") {
+  fs::path temp_dir = fs::temp_directory_path() / "wb_test_file_index";
+  fs::path library = temp_dir / "library";
+  fs::remove_all(temp_dir);
+  fs::create_directories(library / "drums");
+  fs::create_directories(library / "keys");
+  write_test_file(library / "drums" / "kick.wav", 'k', 1000);
+  write_test_file(library / "drums" / "snare.wav", 's', 200000);
+  write_test_file(library / "keys" / "kick.wav", 'x', 1000);
+  write_test_file(library / "keys" / "notes.txt", 'n', 10);
+
+  wb::FileIndex index;
+  REQUIRE(index.open(temp_dir / "db"));
+  REQUIRE(index.refresh(library) == 3);
+
+  SECTION("Lookup") {
+    REQUIRE(index.find_path(library / "keys" / "notes.txt") == std::nullopt);
+    REQUIRE(index.find_by_name("kick.wav").size() == 2);
+    REQUIRE(index.find_by_name("snare.wav").size() == 1);
+
+    uint64_t hash = wb::compute_file_content_hash(library / "drums" / "kick.wav");
+    REQUIRE(hash != wb::compute_file_content_hash(library / "keys" / "kick.wav"));
+    auto entries = index.find_by_content_hash(hash);
+    REQUIRE(entries.size() == 1);
+    REQUIRE(entries[0].path == library / "drums" / "kick.wav");
+    REQUIRE(index.get_content_hash(library / "drums" / "kick.wav") == hash);
+  }
+
+  SECTION("Incremental refresh") {
+    // Nothing has changed
+    REQUIRE(index.refresh(library) == 0);
+
+    uint64_t hash = index.find_path(library / "drums" / "snare.wav")->content_hash;
+    fs::create_directories(library / "moved");
+    fs::rename(library / "drums" / "snare.wav", library / "moved" / "snare_renamed.wav");
+    REQUIRE(index.refresh(library) == 1);
+    REQUIRE(index.find_by_name("snare.wav").empty());
+
+    // The moved file can still be found by its content
+    auto entries = index.find_by_content_hash(hash);
+    REQUIRE(entries.size() == 1);
+    REQUIRE(entries[0].path == library / "moved" / "snare_renamed.wav");
+  }
+
+  SECTION("Sample info") {
+    write_test_wav(library / "keys" / "pad.wav", 2, 44100, 22050);
+    REQUIRE(index.refresh(library) == 1);
+
+    auto info = index.find_sample_info(library / "keys" / "pad.wav");
+    REQUIRE(info.has_value());
+    REQUIRE(info->sample_count == 22050);
+    REQUIRE(info->channel_count == 2);
+    REQUIRE(info->rate == 44100);
+    REQUIRE(info->format == wb::AudioFormat::I16);
+    REQUIRE(info->duration() == 0.5);
+
+    // Indexed, but not decodable
+    REQUIRE(index.find_path(library / "drums" / "kick.wav").has_value());
+    REQUIRE(index.find_sample_info(library / "drums" / "kick.wav") == std::nullopt);
+
+    // Stale entries are not used
+    write_test_wav(library / "keys" / "pad.wav", 1, 48000, 4800);
+    REQUIRE(index.find_sample_info(library / "keys" / "pad.wav") == std::nullopt);
+    info = index.get_sample_info(library / "keys" / "pad.wav");
+    REQUIRE(info.has_value());
+    REQUIRE(info->sample_count == 4800);
+    REQUIRE(index.find_sample_info(library / "keys" / "pad.wav")->rate == 48000);
+  }
+
+  SECTION("Index single file") {
+    // Outside of the library root, as dropped from the browser
+    fs::path loop = temp_dir / "loop.wav";
+    write_test_wav(loop, 1, 48000, 4800);
+    REQUIRE(index.find_current_path(loop) == std::nullopt);
+    uint32_t version = index.version;
+    index.index_file_async(loop);
+    index.wait_for_refresh();
+    REQUIRE(index.version != version);
+    REQUIRE(index.find_current_path(loop).has_value());
+    REQUIRE(index.find_sample_info(loop)->sample_count == 4800);
+  }
+
+  index.close();
+  fs::remove_all(temp_dir);
+}
@@ -0,0 +1,278 @@
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "dsp/codec.h"
+#include "dsp/sample.h"
+
+namespace fs = std::filesystem;
+
+static constexpr uint32_t test_block_size = 4096;
+static constexpr uint32_t test_sample_rate = 44100;
+// Enough threads to split the test file into several segments on any machine
+static constexpr uint32_t test_decode_threads = 4;
+
+struct BitWriter {
+  std::vector<uint8_t> bytes;
+  uint32_t num_bits = 0;
+
+  void write(uint32_t value, uint32_t bits) {
+    for (uint32_t i = bits; i-- > 0;) {
+      if (num_bits % 8 == 0)
+        bytes.push_back(0);
+      bytes.back() |= (uint8_t)(((value >> i) & 1) << (7 - num_bits % 8));
+      num_bits++;
+    }
+  }
+
+  void write_signed(int32_t value, uint32_t bits) {
+    write((uint32_t)value & (bits == 32 ? ~0u : (1u << bits) - 1), bits);
+  }
+
+  void write_rice(int32_t value, uint32_t param) {
+    uint32_t folded = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    for (uint32_t i = 0; i < (folded >> param); i++)
+      write(0, 1);
+    write(1, 1);
+    write(folded & ((1u << param) - 1), param);
+  }
+
+  void align() {
+    num_bits = (uint32_t)bytes.size() * 8;
+  }
+};
+
+static uint8_t crc8(const uint8_t* data, size_t size) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < size; i++) {
+    crc ^= data[i];
+    for (int j = 0; j < 8; j++)
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+static uint16_t crc16(const uint8_t* data, size_t size) {
+  uint16_t crc = 0;
+  for (size_t i = 0; i < size; i++) {
+    crc ^= (uint16_t)(data[i] << 8);
+    for (int j = 0; j < 8; j++)
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x8005) : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
+
+// Encode one subframe, cycling through the subframe types and residual codings
+static void write_subframe(BitWriter& writer, const int32_t* samples, uint32_t count, uint32_t bits, uint32_t kind) {
+  switch (kind % 4) {
+    case 0:  // Verbatim
+      writer.write(1 << 1, 8);
+      for (uint32_t i = 0; i < count; i++)
+        writer.write_signed(samples[i], bits);
+      break;
+    case 1:  // Fixed order 2, 4 partitions of rice method 0
+      writer.write(((8 + 2) << 1), 8);
+      writer.write_signed(samples[0], bits);
+      writer.write_signed(samples[1], bits);
+      writer.write(0, 2);
+      writer.write(count % 4 == 0 ? 2 : 0, 4);
+      for (uint32_t p = 0, num_partitions = count % 4 == 0 ? 4 : 1; p < num_partitions; p++) {
+        writer.write(10, 4);
+        uint32_t partition_size = count / num_partitions;
+        for (uint32_t i = (p == 0 ? 2 : 0); i < partition_size; i++) {
+          uint32_t n = p * partition_size + i;
+          writer.write_rice(samples[n] - 2 * samples[n - 1] + samples[n - 2], 10);
+        }
+      }
+      break;
+    case 2:  // LPC order 2 with the same predictor, rice method 1
+      writer.write(((32 + 1) << 1), 8);
+      writer.write_signed(samples[0], bits);
+      writer.write_signed(samples[1], bits);
+      writer.write(3 - 1, 4);  // Precision
+      writer.write_signed(0, 5);  // Shift
+      writer.write_signed(2, 3);
+      writer.write_signed(-1, 3);
+      writer.write(1, 2);
+      writer.write(0, 4);
+      writer.write(12, 5);
+      for (uint32_t i = 2; i < count; i++)
+        writer.write_rice(samples[i] - 2 * samples[i - 1] + samples[i - 2], 12);
+      break;
+    case 3:  // Fixed order 0 with an escaped partition
+      writer.write((8 << 1), 8);
+      writer.write(0, 2);
+      writer.write(0, 4);
+      writer.write(15, 4);
+      writer.write(bits, 5);
+      for (uint32_t i = 0; i < count; i++)
+        writer.write_signed(samples[i], bits);
+      break;
+  }
+}
+
+static std::vector<uint8_t> encode_flac(const std::vector<int32_t>& left, const std::vector<int32_t>& right) {
+  uint64_t total = left.size();
+  BitWriter writer;
+  writer.write('f', 8);
+  writer.write('L', 8);
+  writer.write('a', 8);
+  writer.write('C', 8);
+  writer.write(0x80, 8);  // Last block, STREAMINFO
+  writer.write(34, 24);
+  writer.write(test_block_size, 16);
+  writer.write(test_block_size, 16);
+  writer.write(0, 24);
+  writer.write(0, 24);
+  writer.write(test_sample_rate, 20);
+  writer.write(2 - 1, 3);
+  writer.write(16 - 1, 5);
+  writer.write((uint32_t)(total >> 32), 4);
+  writer.write((uint32_t)total, 32);
+  for (int i = 0; i < 4; i++)
+    writer.write(0, 32);
+
+  uint32_t frame_index = 0;
+  for (uint64_t start = 0; start < total; start += test_block_size, frame_index++) {
+    uint32_t count = (uint32_t)std::min((uint64_t)test_block_size, total - start);
+    size_t frame_start = writer.bytes.size();
+    uint32_t channel_assignment = frame_index % 4 == 0 ? 1 : 7 + frame_index % 4;  // Independent, L/S, R/S, M/S
+
+    writer.write(0xFFF8, 16);
+    writer.write(count == test_block_size ? 12 : 7, 4);
+    writer.write(9, 4);  // 44.1 kHz
+    writer.write(channel_assignment, 4);
+    writer.write(4, 3);  // 16-bit
+    writer.write(0, 1);
+    if (frame_index < 0x80) {
+      writer.write(frame_index, 8);
+    } else {
+      writer.write(0xC0 | (frame_index >> 6), 8);
+      writer.write(0x80 | (frame_index & 0x3F), 8);
+    }
+    if (count != test_block_size)
+      writer.write(count - 1, 16);
+    writer.write(crc8(writer.bytes.data() + frame_start, writer.bytes.size() - frame_start), 8);
+
+    std::vector<int32_t> ch0(left.begin() + start, left.begin() + start + count);
+    std::vector<int32_t> ch1(right.begin() + start, right.begin() + start + count);
+    uint32_t bits0 = 16;
+    uint32_t bits1 = 16;
+    for (uint32_t i = 0; i < count; i++) {
+      int32_t l = ch0[i];
+      int32_t r = ch1[i];
+      switch (channel_assignment) {
+        case 8: ch1[i] = l - r; break;
+        case 9: ch0[i] = l - r; break;
+        case 10:
+          ch0[i] = (l + r) >> 1;
+          ch1[i] = l - r;
+          break;
+      }
+    }
+    if (channel_assignment == 8 || channel_assignment == 10)
+      bits1 = 17;
+    else if (channel_assignment == 9)
+      bits0 = 17;
+
+    write_subframe(writer, ch0.data(), count, bits0, frame_index);
+    write_subframe(writer, ch1.data(), count, bits1, frame_index + 1);
+    writer.align();
+    writer.write(crc16(writer.bytes.data() + frame_start, writer.bytes.size() - frame_start), 16);
+  }
+  return writer.bytes;
+}
+
+static void write_bytes(const fs::path& path, const std::vector<uint8_t>& bytes) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+}
+
+TEST_CASE("FLAC decoding") {
+  // Long enough to be decoded in several segments
+  static constexpr uint64_t num_frames = 300000;
+  std::vector<int32_t> left(num_frames);
+  std::vector<int32_t> right(num_frames);
+  uint32_t seed = 1;
+  for (uint64_t i = 0; i < num_frames; i++) {
+    seed = seed * 1664525 + 1013904223;
+    left[i] = (int32_t)(std::sin((double)i * 0.01) * 20000.0) + (int32_t)(seed >> 26);
+    right[i] = (int32_t)(std::cos((double)i * 0.003) * 30000.0) - (int32_t)(seed >> 27);
+  }
+
+  fs::path temp_dir = fs::temp_directory_path() / "wb_test_flac";
+  fs::remove_all(temp_dir);
+  fs::create_directories(temp_dir);
+  fs::path path = temp_dir / "test.flac";
+  std::vector<uint8_t> bytes = encode_flac(left, right);
+  write_bytes(path, bytes);
+
+  SECTION("Load") {
+    auto sample = wb::Sample::load_file(path);
+    REQUIRE(sample.has_value());
+    REQUIRE(sample->format == wb::AudioFormat::I16);
+    REQUIRE(sample->channels == 2);
+    REQUIRE(sample->sample_rate == test_sample_rate);
+    REQUIRE(sample->count == num_frames);
+
+    const int16_t* l = sample->get_read_pointer<int16_t>(0);
+    const int16_t* r = sample->get_read_pointer<int16_t>(1);
+    uint64_t num_mismatches = 0;
+    for (uint64_t i = 0; i < num_frames; i++)
+      num_mismatches += l[i] != left[i] || r[i] != right[i];
+    REQUIRE(num_mismatches == 0);
+
+    auto info = wb::Sample::get_file_info(path);
+    REQUIRE(info.has_value());
+    REQUIRE(info->sample_count == num_frames);
+    REQUIRE(info->rate == test_sample_rate);
+  }
+
+  SECTION("Damaged frame") {
+    // Break the checksum of the 10th frame, its samples are silenced and the rest still decodes
+    wb::dsp::FlacStream stream;
+    REQUIRE(stream.open(bytes.data(), bytes.size()));
+    wb::dsp::FlacFrameHeader header;
+    std::vector<int32_t> block(test_block_size * 2);
+    int32_t* block_channels[2] = { block.data(), block.data() + test_block_size };
+    size_t offset = stream.find_frame(stream.first_frame_offset, header);
+    for (int i = 0; i < 10; i++) {
+      REQUIRE(stream.decode_frame(offset, header, block_channels, &offset));
+      REQUIRE(stream.read_frame_header(offset, header));
+    }
+    REQUIRE(header.first_frame == 10 * test_block_size);
+    bytes[offset + 100] ^= 0x55;
+    write_bytes(path, bytes);
+
+    auto sample = wb::Sample::load_flac_file(path, (const std::byte*)bytes.data(), bytes.size(), test_decode_threads);
+    REQUIRE(sample.has_value());
+    const int16_t* l = sample->get_read_pointer<int16_t>(0);
+    uint64_t num_mismatches = 0;
+    for (uint64_t i = 0; i < num_frames; i++) {
+      bool damaged = i >= 10 * test_block_size && i < 11 * test_block_size;
+      num_mismatches += l[i] != (damaged ? 0 : left[i]);
+    }
+    REQUIRE(num_mismatches == 0);
+  }
+
+  SECTION("Streaming decoder") {
+    wb::dsp::AudioFlacDecoder decoder;
+    REQUIRE(decoder.open(path.string().c_str()));
+    REQUIRE(decoder.num_frames == num_frames);
+    REQUIRE(decoder.seek(123457));
+
+    std::vector<float> buffer(1000 * 2);
+    REQUIRE(decoder.read_f32(buffer.data(), 2, 1000) == 1000);
+    for (uint32_t i = 0; i < 1000; i++) {
+      REQUIRE(buffer[i * 2] == (float)left[123457 + i] / 32768.0f);
+      REQUIRE(buffer[i * 2 + 1] == (float)right[123457 + i] / 32768.0f);
+    }
+
+    REQUIRE(decoder.seek(num_frames - 10));
+    REQUIRE(decoder.read_f32(buffer.data(), 2, 1000) == 10);
+  }
+
+  fs::remove_all(temp_dir);
+}
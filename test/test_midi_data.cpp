@@ -0,0 +1,151 @@
+#include <random>
+
+#include "catch_amalgamated.hpp"
+#include "engine/midi_data.h"
+
+static wb::MidiNote make_note(double min_time, double length, int16_t key) {
+  return {
+    .min_time = min_time,
+    .max_time = min_time + length,
+    .key = key,
+    .velocity = 0.5f,
+  };
+}
+
+static void fill_random_notes(wb::MidiData& data, std::mt19937& rng, uint32_t count) {
+  std::uniform_real_distribution<double> pos_dist(0.0, 256.0);
+  std::uniform_real_distribution<double> length_dist(0.1, 4.0);
+  std::uniform_int_distribution<int> key_dist(0, 127);
+  for (uint32_t i = 0; i < count; i++) {
+    // Add a few long notes so the index has to look behind the starting position
+    double length = (i % 97) == 0 ? 64.0 : length_dist(rng);
+    data.note_sequence.push_back(make_note(pos_dist(rng), length, (int16_t)key_dist(rng)));
+  }
+}
+
+static wb::Vector<uint32_t> find_notes_linear(
+    const wb::MidiData& data,
+    double min_pos,
+    double max_pos,
+    int16_t min_key,
+    int16_t max_key) {
+  wb::Vector<uint32_t> notes;
+  for (uint32_t id = 0; const auto& note : data.note_sequence) {
+    if (note.max_time >= min_pos && note.min_time <= max_pos && note.key >= min_key && note.key <= max_key)
+      notes.push_back(id);
+    id++;
+  }
+  return notes;
+}
+
+static uint32_t find_first_note_linear(const wb::MidiData& data, double pos) {
+  for (uint32_t id = 0; const auto& note : data.note_sequence) {
+    if (pos < note.max_time)
+      return id;
+    id++;
+  }
+  return WB_INVALID_NOTE_ID;
+}
+
+static void check_queries(const wb::MidiData& data, std::mt19937& rng) {
+  std::uniform_real_distribution<double> pos_dist(-8.0, 300.0);
+  std::uniform_int_distribution<int> key_dist(0, 127);
+  for (uint32_t i = 0; i < 200; i++) {
+    double min_pos = pos_dist(rng);
+    double max_pos = min_pos + pos_dist(rng) * 0.1;
+    int16_t min_key = (int16_t)key_dist(rng);
+    int16_t max_key = (int16_t)std::min(min_key + key_dist(rng) / 4, 127);
+    auto expected = find_notes_linear(data, min_pos, max_pos, min_key, max_key);
+    auto notes = const_cast<wb::MidiData&>(data).find_notes(min_pos, max_pos, min_key, max_key, 0);
+    REQUIRE(notes.size() == expected.size());
+    for (uint32_t j = 0; j < notes.size(); j++)
+      REQUIRE(notes[j] == expected[j]);
+    REQUIRE(data.find_first_note(min_pos) == find_first_note_linear(data, min_pos));
+  }
+}
+
+static void check_sorted(const wb::MidiData& data) {
+  for (uint32_t i = 1; i < data.note_sequence.size(); i++)
+    REQUIRE(data.note_sequence[i - 1].min_time <= data.note_sequence[i].min_time);
+}
+
+TEST_CASE("MidiData note index queries") {
+  std::mt19937 rng(1234);
+  wb::MidiData data;
+
+  SECTION("Empty sequence") {
+    data.update_channel(0);
+    REQUIRE(data.find_first_note(0.0) == WB_INVALID_NOTE_ID);
+    REQUIRE(data.find_notes(0.0, 100.0, 0, 127, 0).size() == 0);
+    REQUIRE(data.max_length == 0.0);
+  }
+
+  SECTION("Random sequence") {
+    fill_random_notes(data, rng, 5000);
+    data.update_channel(0);
+    check_sorted(data);
+    check_queries(data, rng);
+
+    double max_length = 0.0;
+    for (const auto& note : data.note_sequence)
+      max_length = std::max(max_length, note.max_time);
+    REQUIRE(data.max_length == max_length);
+  }
+
+  SECTION("Find note at position") {
+    data.note_sequence.push_back(make_note(0.0, 1.0, 60));
+    data.note_sequence.push_back(make_note(0.5, 1.0, 62));
+    data.note_sequence.push_back(make_note(1.0, 1.0, 60));
+    data.update_channel(0);
+    REQUIRE(data.find_note(0.75, 60, 0) == 0);
+    REQUIRE(data.find_note(1.0, 60, 0) == 2);
+    REQUIRE(data.find_note(0.75, 62, 0) == 1);
+    REQUIRE(data.find_note(2.0, 60, 0) == WB_INVALID_NOTE_ID);
+  }
+}
+
+TEST_CASE("MidiData note index incremental update") {
+  std::mt19937 rng(4321);
+  wb::MidiData data;
+  fill_random_notes(data, rng, 3000);
+  data.update_channel(0);
+
+  SECTION("Move notes") {
+    std::uniform_int_distribution<uint32_t> id_dist(0, data.note_sequence.size() - 1);
+    for (uint32_t i = 0; i < 20; i++) {
+      wb::MidiNote& note = data.note_sequence[id_dist(rng)];
+      note.min_time = std::max(note.min_time - 16.0, 0.0);
+      note.max_time = note.min_time + 2.0;
+      note.flags |= wb::MidiNoteFlags::Modified;
+      auto modified_notes = data.update_channel(0);
+      REQUIRE(modified_notes.size() == 1);
+      check_sorted(data);
+    }
+    check_queries(data, rng);
+  }
+
+  SECTION("Append notes") {
+    fill_random_notes(data, rng, 100);
+    data.update_channel(0);
+    REQUIRE(data.note_sequence.size() == 3100);
+    check_sorted(data);
+    check_queries(data, rng);
+  }
+
+  SECTION("Unflagged note edit") {
+    // The edited note is not flagged as Modified, the ordering must still be restored
+    data.note_sequence[100].min_time = 300.0;
+    data.note_sequence[100].max_time = 301.0;
+    data.update_channel(0);
+    check_sorted(data);
+    check_queries(data, rng);
+  }
+
+  SECTION("Remove notes") {
+    uint32_t first_removed_note = 1000;
+    data.note_sequence.erase_at(first_removed_note, 500);
+    data.update_channel(0, first_removed_note);
+    REQUIRE(data.note_sequence.size() == 2500);
+    check_queries(data, rng);
+  }
+}
@@ -0,0 +1,115 @@
+#include "catch_amalgamated.hpp"
+#include "engine/midi_data.h"
+#include "engine/midi_transform.h"
+
+static wb::MidiNote make_note(double min_time, double length, int16_t key, bool selected = true) {
+  return {
+    .min_time = min_time,
+    .max_time = min_time + length,
+    .key = key,
+    .flags = (uint16_t)(selected ? wb::MidiNoteFlags::Selected : 0),
+    .velocity = 0.5f,
+  };
+}
+
+static wb::MidiEditResult apply_transform(wb::MidiData& data, const wb::NoteTransform& transform) {
+  wb::BitSet selection;
+  wb::get_note_selection(data, selection);
+  return wb::apply_note_transform(data, selection, transform);
+}
+
+TEST_CASE("MIDI note transform") {
+  wb::MidiData data;
+  wb::NoteTransform transform;
+
+  SECTION("Quantize") {
+    data.note_sequence.push_back(make_note(0.1, 1.0, 60));
+    data.note_sequence.push_back(make_note(1.0, 1.0, 62));
+    data.note_sequence.push_back(make_note(1.9, 0.5, 64));
+    data.note_sequence.push_back(make_note(2.6, 0.5, 65, false));
+    data.update_channel(0);
+
+    transform.type = wb::NoteTransformType::Quantize;
+    transform.quantize = { .grid = 1.0, .strength = 1.0f, .quantize_end = false };
+    wb::MidiEditResult result = apply_transform(data, transform);
+
+    // The note already on the grid and the unselected note are left out of the backup
+    REQUIRE(result.deleted_notes.size() == 2);
+    REQUIRE(result.modified_notes.size() == 2);
+    REQUIRE(data.note_sequence[0].min_time == 0.0);
+    REQUIRE(data.note_sequence[0].max_time == 1.0);
+    REQUIRE(data.note_sequence[1].min_time == 1.0);
+    REQUIRE(data.note_sequence[2].min_time == 2.0);
+    REQUIRE(data.note_sequence[2].max_time == 2.5);
+    REQUIRE(data.note_sequence[3].min_time == 2.6);
+  }
+
+  SECTION("Quantize already on grid") {
+    data.note_sequence.push_back(make_note(0.0, 1.0, 60));
+    data.note_sequence.push_back(make_note(1.0, 1.0, 62));
+    data.update_channel(0);
+
+    transform.type = wb::NoteTransformType::Quantize;
+    transform.quantize = { .grid = 0.25, .strength = 1.0f, .quantize_end = true };
+    wb::MidiEditResult result = apply_transform(data, transform);
+    REQUIRE(result.deleted_notes.empty());
+    REQUIRE(result.modified_notes.empty());
+  }
+
+  SECTION("Transpose") {
+    data.note_sequence.push_back(make_note(0.0, 1.0, 60));
+    data.note_sequence.push_back(make_note(1.0, 1.0, 120));
+    data.update_channel(0);
+
+    transform.type = wb::NoteTransformType::Transpose;
+    transform.transpose = { .semitones = 12 };
+    wb::MidiEditResult result = apply_transform(data, transform);
+    REQUIRE(result.deleted_notes.size() == 2);
+    REQUIRE(data.note_sequence[0].key == 72);
+    REQUIRE(data.note_sequence[1].key == 127);
+  }
+
+  SECTION("Legato") {
+    // Chord followed by a single note, the chord notes must extend to the next onset
+    data.note_sequence.push_back(make_note(0.0, 0.5, 60));
+    data.note_sequence.push_back(make_note(0.0, 0.25, 64));
+    data.note_sequence.push_back(make_note(2.0, 0.5, 67));
+    data.update_channel(0);
+
+    transform.type = wb::NoteTransformType::Legato;
+    transform.legato = { .gap = 0.0 };
+    wb::MidiEditResult result = apply_transform(data, transform);
+    REQUIRE(result.deleted_notes.size() == 2);
+    REQUIRE(data.note_sequence[0].max_time == 2.0);
+    REQUIRE(data.note_sequence[1].max_time == 2.0);
+    REQUIRE(data.note_sequence[2].max_time == 2.5);
+  }
+
+  SECTION("Snap to scale") {
+    // C major
+    data.note_sequence.push_back(make_note(0.0, 1.0, 61));
+    data.note_sequence.push_back(make_note(1.0, 1.0, 62));
+    data.note_sequence.push_back(make_note(2.0, 1.0, 66));
+    data.update_channel(0);
+
+    transform.type = wb::NoteTransformType::SnapToScale;
+    transform.scale = { .scale_mask = 0b101010110101, .root = 0 };
+    wb::MidiEditResult result = apply_transform(data, transform);
+    REQUIRE(result.deleted_notes.size() == 2);
+    REQUIRE(data.note_sequence[0].key == 60);
+    REQUIRE(data.note_sequence[1].key == 62);
+    REQUIRE(data.note_sequence[2].key == 65);
+  }
+
+  SECTION("Keeps sequence sorted") {
+    for (int i = 0; i < 64; i++)
+      data.note_sequence.push_back(make_note(i * 0.5, 0.5, (int16_t)(i % 12 + 60), (i % 3) == 0));
+    data.update_channel(0);
+
+    transform.type = wb::NoteTransformType::Humanize;
+    transform.humanize = { .time_amount = 2.0, .velocity_amount = 0.1f, .seed = 1234 };
+    apply_transform(data, transform);
+    for (uint32_t i = 1; i < data.note_sequence.size(); i++)
+      REQUIRE(data.note_sequence[i - 1].min_time <= data.note_sequence[i].min_time);
+  }
+}
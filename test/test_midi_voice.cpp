@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "engine/midi_voice.h"
+
+static wb::MidiVoice make_voice(double max_time, int16_t key, float velocity = 1.0f) {
+  return {
+    .max_time = max_time,
+    .velocity = velocity,
+    .channel = 0,
+    .key = key,
+  };
+}
+
+TEST_CASE("MidiVoiceState releases voices in note-off order") {
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<double> time_dist(0.0, 100.0);
+  wb::MidiVoiceState state(512);
+  std::vector<double> expected;
+
+  for (uint32_t i = 0; i < 500; i++) {
+    double max_time = time_dist(rng);
+    REQUIRE(state.add_voice(make_voice(max_time, (int16_t)(i % 128)), nullptr) == wb::MidiVoiceAddResult::Added);
+    expected.push_back(max_time);
+  }
+  std::sort(expected.begin(), expected.end());
+  REQUIRE(state.used_voices() == 500);
+  REQUIRE(state.stats.peak_voices == 500);
+
+  // Nothing ends before the first note-off
+  REQUIRE(state.release_voice(expected[0] - 1.0) == nullptr);
+
+  for (double max_time : expected) {
+    wb::MidiVoice* voice = state.release_voice(max_time);
+    REQUIRE(voice != nullptr);
+    REQUIRE(voice->max_time == max_time);
+  }
+  REQUIRE(state.release_voice(1000.0) == nullptr);
+  REQUIRE(!state.has_voice());
+}
+
+TEST_CASE("MidiVoiceState voice stealing") {
+  wb::MidiVoiceState state(4);
+  wb::MidiVoice stolen_voice = make_voice(0.0, -1);
+
+  SECTION("Drop") {
+    state.steal_policy = wb::MidiVoiceStealPolicy::None;
+    for (int16_t i = 0; i < 4; i++)
+      state.add_voice(make_voice(10.0 + i, i), nullptr);
+    REQUIRE(state.add_voice(make_voice(20.0, 60), &stolen_voice) == wb::MidiVoiceAddResult::Dropped);
+    REQUIRE(state.stats.num_dropped == 1);
+    REQUIRE(state.used_voices() == 4);
+  }
+
+  SECTION("Earliest release") {
+    state.steal_policy = wb::MidiVoiceStealPolicy::EarliestRelease;
+    for (int16_t i = 0; i < 4; i++)
+      state.add_voice(make_voice(13.0 - i, i), nullptr);
+    REQUIRE(state.add_voice(make_voice(20.0, 60), &stolen_voice) == wb::MidiVoiceAddResult::Stolen);
+    REQUIRE(stolen_voice.key == 3);
+    REQUIRE(state.stats.num_stolen == 1);
+  }
+
+  SECTION("Oldest") {
+    state.steal_policy = wb::MidiVoiceStealPolicy::Oldest;
+    for (int16_t i = 0; i < 4; i++)
+      state.add_voice(make_voice(13.0 - i, i), nullptr);
+    REQUIRE(state.add_voice(make_voice(20.0, 60), &stolen_voice) == wb::MidiVoiceAddResult::Stolen);
+    REQUIRE(stolen_voice.key == 0);
+  }
+
+  SECTION("Quietest") {
+    state.steal_policy = wb::MidiVoiceStealPolicy::Quietest;
+    for (int16_t i = 0; i < 4; i++)
+      state.add_voice(make_voice(10.0 + i, i, i == 2 ? 0.1f : 0.8f), nullptr);
+    REQUIRE(state.add_voice(make_voice(20.0, 60), &stolen_voice) == wb::MidiVoiceAddResult::Stolen);
+    REQUIRE(stolen_voice.key == 2);
+  }
+
+  // The stolen voice must not be released later
+  uint32_t num_released = 0;
+  while (auto voice = state.release_voice(100.0)) {
+    REQUIRE(voice->key != stolen_voice.key);
+    num_released++;
+  }
+  REQUIRE(num_released == 4);
+}
@@ -1,6 +1,118 @@
+#include <filesystem>
+#include <fstream>
+
 #include "catch_amalgamated.hpp"
+#include "engine/assets_table.h"
+#include "engine/autosave.h"
+#include "engine/engine.h"
 #include "engine/project.h"
+#include "ui/command.h"
+#include "ui/timeline.h"
 
 TEST_CASE("Write project file") {
     // TODO
-}
\ No newline at end of file
+}
+
+static wb::MidiAsset* create_test_midi() {
+  wb::MidiAsset* asset = wb::g_midi_table.create_midi();
+  for (uint32_t i = 0; i < 4; i++) {
+    asset->data.note_sequence.push_back({
+      .min_time = (double)i,
+      .max_time = (double)i + 0.5,
+      .key = (int16_t)(60 + i),
+      .velocity = 0.5f,
+    });
+  }
+  asset->data.update_channel(0);
+  return asset;
+}
+
+static void capture_snapshot(wb::ProjectSnapshot& snapshot, const wb::ProjectSnapshot* previous) {
+  std::unique_lock lock(wb::g_engine.editor_lock);
+  wb::capture_project_snapshot(snapshot, previous, wb::g_engine, wb::g_sample_table, wb::g_midi_table, wb::g_timeline);
+}
+
+static float get_snapshot_velocity(const wb::ProjectSnapshot& snapshot, uint32_t note_id) {
+  REQUIRE(snapshot.midi_assets.size() == 1);
+  return (*snapshot.midi_assets[0].notes)[note_id].velocity;
+}
+
+TEST_CASE("Autosave snapshot") {
+  wb::Track* track = wb::g_engine.add_track("MIDI");
+  wb::MidiAsset* asset = create_test_midi();
+  wb::g_engine.add_midi_clip(track, "Clip", 0.0, 4.0, 0.0, { .asset = asset, .length = 4.0 });
+
+  wb::ProjectSnapshot first;
+  capture_snapshot(first, nullptr);
+  REQUIRE(get_snapshot_velocity(first, 1) == 0.5f);
+
+  // Unchanged notes are shared with the previous snapshot
+  wb::ProjectSnapshot unchanged;
+  capture_snapshot(unchanged, &first);
+  REQUIRE(unchanged.midi_assets[0].notes == first.midi_assets[0].notes);
+
+  SECTION("Note velocity") {
+    wb::MidiChangeNoteVelocityCmd cmd;
+    cmd.track_id = 0;
+    cmd.clip_id = 0;
+    cmd.note_id = 1;
+    cmd.relative_velocity = 0.25f;
+    REQUIRE(cmd.execute());
+    wb::ProjectSnapshot changed;
+    capture_snapshot(changed, &first);
+    REQUIRE(changed.midi_assets[0].notes != first.midi_assets[0].notes);
+    REQUIRE(get_snapshot_velocity(changed, 1) == 0.75f);
+
+    cmd.undo();
+    wb::ProjectSnapshot undone;
+    capture_snapshot(undone, &changed);
+    REQUIRE(get_snapshot_velocity(undone, 1) == 0.5f);
+  }
+
+  SECTION("Selected note velocity") {
+    wb::MidiChangeSelectedNoteVelocityCmd cmd;
+    cmd.track_id = 0;
+    cmd.clip_id = 0;
+    cmd.relative_velocity = -0.25f;
+    cmd.old_velocity.push_back({ 0, 0.5f });
+    cmd.old_velocity.push_back({ 3, 0.5f });
+    REQUIRE(cmd.execute());
+    wb::ProjectSnapshot changed;
+    capture_snapshot(changed, &first);
+    REQUIRE(get_snapshot_velocity(changed, 0) == 0.25f);
+    REQUIRE(get_snapshot_velocity(changed, 3) == 0.25f);
+
+    cmd.undo();
+    wb::ProjectSnapshot undone;
+    capture_snapshot(undone, &changed);
+    REQUIRE(get_snapshot_velocity(undone, 0) == 0.5f);
+    REQUIRE(get_snapshot_velocity(undone, 3) == 0.5f);
+  }
+
+  wb::g_engine.delete_track(0);
+  wb::g_midi_table.destroy(asset);
+}
+
+static std::string read_text(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file), {});
+}
+
+TEST_CASE("Autosave backup rotation") {
+  std::filesystem::path directory = std::filesystem::temp_directory_path() / "whitebox_test_autosave";
+  std::filesystem::remove_all(directory);
+  wb::Autosave autosave;
+  autosave.init({ .directory = directory, .interval_sec = 60, .num_backups = 2 });
+
+  for (const char* content : { "first", "second", "third" }) {
+    std::ofstream(autosave.get_file_path(0), std::ios::binary | std::ios::trunc) << content;
+    autosave.rotate_backups_();
+    // The latest autosave stays in place until the new one is written over it
+    REQUIRE(read_text(autosave.get_file_path(0)) == content);
+    REQUIRE(read_text(autosave.get_file_path(1)) == content);
+  }
+  REQUIRE(read_text(autosave.get_file_path(2)) == "second");
+  REQUIRE(!std::filesystem::exists(autosave.get_file_path(3)));
+
+  std::filesystem::remove_all(directory);
+}
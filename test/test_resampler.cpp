@@ -0,0 +1,86 @@
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "dsp/resampler.h"
+#include "dsp/sample_blocks.h"
+
+static std::vector<float> sine(size_t count, double frequency, double sample_rate) {
+  std::vector<float> signal(count);
+  for (size_t i = 0; i < count; i++)
+    signal[i] = (float)std::sin(2.0 * std::numbers::pi * frequency * (double)i / sample_rate);
+  return signal;
+}
+
+// Largest error away from the edges, where the filter runs past the signal
+static double max_error(const std::vector<float>& output, const std::vector<float>& expected, size_t margin) {
+  double error = 0.0;
+  for (size_t i = margin; i < output.size() - margin; i++)
+    error = std::max(error, (double)std::abs(output[i] - expected[i]));
+  return error;
+}
+
+TEST_CASE("Sinc resampler") {
+  using wb::dsp::SincResampler;
+
+  SECTION("Rate conversion") {
+    std::vector<float> input = sine(44100, 1000.0, 44100.0);
+    double ratio = 44100.0 / 48000.0;
+    size_t count = SincResampler::get_output_count(input.size(), ratio);
+    REQUIRE(count == 48000);
+    std::vector<float> output(count);
+    SincResampler::process(input.data(), input.size(), ratio, output.data(), count);
+    REQUIRE(max_error(output, sine(count, 1000.0, 48000.0), 100) < 1e-3);
+  }
+
+  SECTION("Speed change") {
+    // Playing at twice the speed doubles the pitch
+    std::vector<float> input = sine(48000, 500.0, 48000.0);
+    std::vector<float> output(SincResampler::get_output_count(input.size(), 2.0));
+    SincResampler::process(input.data(), input.size(), 2.0, output.data(), output.size());
+    REQUIRE(output.size() == 24000);
+    REQUIRE(max_error(output, sine(output.size(), 1000.0, 48000.0), 100) < 1e-3);
+  }
+
+  SECTION("Downsampling removes frequencies above the new Nyquist") {
+    // 15 kHz would alias to 9 kHz after halving the rate
+    std::vector<float> input = sine(48000, 15000.0, 48000.0);
+    std::vector<float> output(SincResampler::get_output_count(input.size(), 2.0));
+    SincResampler::process(input.data(), input.size(), 2.0, output.data(), output.size());
+    REQUIRE(max_error(output, std::vector<float>(output.size(), 0.0f), 100) < 1e-3);
+  }
+}
+
+TEST_CASE("Resample sample") {
+  static constexpr size_t count = wb::SampleBlocks::block_frames * 3 + 17;
+  wb::Sample sample(wb::AudioFormat::I16, 44100);
+  sample.name = "test";
+  sample.resize(count + wb::Sample::sample_padding, 2);
+  sample.count = count;
+  std::vector<float> left = sine(count + wb::Sample::sample_padding, 440.0, 44100.0);
+  std::vector<float> right = sine(count + wb::Sample::sample_padding, 880.0, 44100.0);
+  for (size_t i = 0; i < count + wb::Sample::sample_padding; i++) {
+    sample.get_write_pointer<int16_t>(0)[i] = (int16_t)(left[i] * 16000.0f);
+    sample.get_write_pointer<int16_t>(1)[i] = (int16_t)(right[i] * 16000.0f);
+  }
+
+  wb::Sample plain_render = wb::dsp::resample_sample(sample, 44100.0 / 48000.0, 48000);
+  REQUIRE(plain_render.format == wb::AudioFormat::F32);
+  REQUIRE(plain_render.sample_rate == 48000);
+  REQUIRE(plain_render.channels == 2);
+  REQUIRE(plain_render.count == wb::dsp::SincResampler::get_output_count(count, 44100.0 / 48000.0));
+
+  // Compressed samples render the same as uncompressed ones
+  REQUIRE(sample.compress());
+  wb::Sample compressed_render = wb::dsp::resample_sample(sample, 44100.0 / 48000.0, 48000);
+  REQUIRE(compressed_render.count == plain_render.count);
+  uint64_t num_mismatches = 0;
+  for (uint32_t c = 0; c < 2; c++) {
+    const float* a = plain_render.get_read_pointer<float>(c);
+    const float* b = compressed_render.get_read_pointer<float>(c);
+    for (size_t i = 0; i < plain_render.count + wb::Sample::sample_padding; i++)
+      num_mismatches += a[i] != b[i];
+  }
+  REQUIRE(num_mismatches == 0);
+}
@@ -0,0 +1,265 @@
+#include <vorbis/vorbisenc.h>
+#include <vorbis/vorbisfile.h>
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "dsp/sample.h"
+#include "extern/dr_mp3.h"
+
+namespace fs = std::filesystem;
+
+// Enough threads to split the test files into several segments on any machine
+static constexpr uint32_t test_decode_threads = 4;
+
+struct BitWriter {
+  std::vector<uint8_t> bytes;
+  uint32_t num_bits = 0;
+
+  void write(uint32_t value, uint32_t bits) {
+    for (uint32_t i = bits; i-- > 0;) {
+      if (num_bits % 8 == 0)
+        bytes.push_back(0);
+      bytes.back() |= (uint8_t)(((value >> i) & 1) << (7 - num_bits % 8));
+      num_bits++;
+    }
+  }
+};
+
+static void write_bytes(const fs::path& path, const std::vector<uint8_t>& bytes) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+}
+
+// MPEG-1 Layer III, 48 kHz mono at 128 kbps. Every frame is 384 bytes, 4 bytes of header and 17 bytes of side info
+// leave 363 bytes for the main data.
+static constexpr uint32_t mp3_frame_size = 384;
+static constexpr uint32_t mp3_slot_size = mp3_frame_size - 4 - 17;
+static constexpr uint32_t mp3_max_reservoir = 511;
+
+struct Mp3Granule {
+  uint32_t global_gain;
+  std::vector<int32_t> values;  // -1, 0 or 1, a multiple of 4 values starting at the lowest frequency
+};
+
+// Granules only use the count1 region with table B, a fixed 4 bit code per quadruple followed by the sign bits. It is
+// enough to produce a signal without writing a Huffman encoder.
+static void write_mp3_granule_data(BitWriter& writer, const Mp3Granule& granule) {
+  for (size_t i = 0; i < granule.values.size(); i += 4) {
+    uint32_t nonzero_mask = 0;
+    for (size_t j = 0; j < 4; j++)
+      nonzero_mask |= (granule.values[i + j] != 0) << (3 - j);
+    writer.write(15 - nonzero_mask, 4);
+    for (size_t j = 0; j < 4; j++)
+      if (granule.values[i + j] != 0)
+        writer.write(granule.values[i + j] < 0, 1);
+  }
+}
+
+static uint32_t get_mp3_granule_bits(const Mp3Granule& granule) {
+  uint32_t bits = (uint32_t)granule.values.size();
+  for (int32_t value : granule.values)
+    bits += value != 0;
+  return bits;
+}
+
+// Main data is packed as early as the bit reservoir allows, so frames keep referring to the data of earlier frames
+static std::vector<uint8_t> encode_mp3(uint32_t num_frames, std::mt19937& rng) {
+  std::vector<uint8_t> main_data_stream((size_t)num_frames * mp3_slot_size, 0);
+  std::vector<uint8_t> bytes;
+  uint32_t main_data_end = 0;
+  for (uint32_t frame = 0; frame < num_frames; frame++) {
+    Mp3Granule granules[2];
+    for (auto& granule : granules) {
+      granule.global_gain = 170 + rng() % 30;
+      granule.values.resize((size_t)(16 + rng() % 129) * 4);
+      for (auto& value : granule.values) {
+        uint32_t r = rng() % 4;
+        value = r == 0 ? 1 : r == 1 ? -1 : 0;
+      }
+    }
+
+    uint32_t slot_start = frame * mp3_slot_size;
+    uint32_t main_data_start = std::max(main_data_end, slot_start > mp3_max_reservoir ? slot_start - mp3_max_reservoir : 0);
+    BitWriter main_data;
+    write_mp3_granule_data(main_data, granules[0]);
+    write_mp3_granule_data(main_data, granules[1]);
+    REQUIRE(main_data_start + main_data.bytes.size() <= slot_start + mp3_slot_size);
+    std::memcpy(&main_data_stream[main_data_start], main_data.bytes.data(), main_data.bytes.size());
+    main_data_end = main_data_start + (uint32_t)main_data.bytes.size();
+
+    // MPEG-1, Layer III, no CRC, 128 kbps, 48 kHz, no padding, mono
+    BitWriter header;
+    header.write(0xFFFB, 16);
+    header.write(0x94, 8);
+    header.write(0xC0, 8);
+    header.write(slot_start - main_data_start, 9);  // main_data_begin
+    header.write(0, 5);                               // private_bits
+    header.write(0, 4);                               // scfsi
+    for (const auto& granule : granules) {
+      header.write(get_mp3_granule_bits(granule), 12);  // part2_3_length, no scalefactor bits
+      header.write(0, 9);                               // big_values
+      header.write(granule.global_gain, 8);
+      header.write(0, 4);   // scalefac_compress
+      header.write(0, 1);   // window_switching_flag
+      header.write(0, 15);  // table_select
+      header.write(0, 4);   // region0_count
+      header.write(0, 3);   // region1_count
+      header.write(0, 1);   // preflag
+      header.write(0, 1);   // scalefac_scale
+      header.write(1, 1);   // count1table_select
+    }
+    REQUIRE(header.bytes.size() == mp3_frame_size - mp3_slot_size);
+    bytes.insert(bytes.end(), header.bytes.begin(), header.bytes.end());
+    bytes.insert(bytes.end(), main_data_stream.begin() + slot_start, main_data_stream.begin() + slot_start + mp3_slot_size);
+  }
+  return bytes;
+}
+
+TEST_CASE("MP3 segmented decoding") {
+  std::mt19937 rng(1234);
+  std::vector<uint8_t> bytes = encode_mp3(600, rng);
+
+  drmp3_config config{};
+  drmp3_uint64 reference_count = 0;
+  float* reference =
+      drmp3_open_memory_and_read_pcm_frames_f32(bytes.data(), bytes.size(), &config, &reference_count, nullptr);
+  REQUIRE(reference != nullptr);
+  REQUIRE(config.channels == 1);
+  REQUIRE(reference_count > 4 * (1 << 17));
+
+  auto sample = wb::Sample::load_mp3_file("test.mp3", (const std::byte*)bytes.data(), bytes.size(), test_decode_threads);
+  REQUIRE(sample.has_value());
+  REQUIRE(sample->channels == 1);
+  REQUIRE(sample->count == reference_count);
+
+  const float* samples = sample->get_read_pointer<float>(0);
+  uint64_t num_mismatches = 0;
+  float peak = 0.0f;
+  for (uint64_t i = 0; i < reference_count; i++) {
+    num_mismatches += samples[i] != reference[i];
+    peak = std::max(peak, std::abs(reference[i]));
+  }
+  drmp3_free(reference, nullptr);
+  REQUIRE(peak > 0.001f);
+  REQUIRE(num_mismatches == 0);
+}
+
+static void write_ogg_page(std::vector<uint8_t>& bytes, const ogg_page& page) {
+  bytes.insert(bytes.end(), page.header, page.header + page.header_len);
+  bytes.insert(bytes.end(), page.body, page.body + page.body_len);
+}
+
+static std::vector<uint8_t> encode_ogg_vorbis(const std::vector<float>& left, const std::vector<float>& right) {
+  vorbis_info info;
+  vorbis_info_init(&info);
+  REQUIRE(vorbis_encode_init_vbr(&info, 2, 44100, 0.4f) == 0);
+  vorbis_comment comment;
+  vorbis_comment_init(&comment);
+  vorbis_dsp_state dsp;
+  vorbis_analysis_init(&dsp, &info);
+  vorbis_block block;
+  vorbis_block_init(&dsp, &block);
+  ogg_stream_state stream;
+  ogg_stream_init(&stream, 1);
+
+  std::vector<uint8_t> bytes;
+  ogg_page page;
+  ogg_packet header, header_comment, header_code;
+  vorbis_analysis_headerout(&dsp, &comment, &header, &header_comment, &header_code);
+  ogg_stream_packetin(&stream, &header);
+  ogg_stream_packetin(&stream, &header_comment);
+  ogg_stream_packetin(&stream, &header_code);
+  while (ogg_stream_flush(&stream, &page) != 0)
+    write_ogg_page(bytes, page);
+
+  size_t position = 0;
+  bool end_of_stream = false;
+  while (!end_of_stream) {
+    // Writing zero frames marks the end of the input
+    size_t num_frames = std::min(left.size() - position, (size_t)1024);
+    if (num_frames > 0) {
+      float** buffer = vorbis_analysis_buffer(&dsp, (int)num_frames);
+      std::memcpy(buffer[0], left.data() + position, num_frames * sizeof(float));
+      std::memcpy(buffer[1], right.data() + position, num_frames * sizeof(float));
+      position += num_frames;
+    }
+    vorbis_analysis_wrote(&dsp, (int)num_frames);
+
+    while (vorbis_analysis_blockout(&dsp, &block) == 1) {
+      vorbis_analysis(&block, nullptr);
+      vorbis_bitrate_addblock(&block);
+      ogg_packet packet;
+      while (vorbis_bitrate_flushpacket(&dsp, &packet) == 1) {
+        ogg_stream_packetin(&stream, &packet);
+        while (ogg_stream_pageout(&stream, &page) != 0) {
+          write_ogg_page(bytes, page);
+          end_of_stream |= ogg_page_eos(&page) != 0;
+        }
+      }
+    }
+  }
+
+  ogg_stream_clear(&stream);
+  vorbis_block_clear(&block);
+  vorbis_dsp_clear(&dsp);
+  vorbis_comment_clear(&comment);
+  vorbis_info_clear(&info);
+  return bytes;
+}
+
+TEST_CASE("Ogg Vorbis segmented decoding") {
+  fs::path temp_dir = fs::temp_directory_path() / "wb_test_sample_decode_vorbis";
+  fs::remove_all(temp_dir);
+  fs::create_directories(temp_dir);
+  fs::path path = temp_dir / "test.ogg";
+
+  static constexpr size_t num_frames = 600000;
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+  std::vector<float> left(num_frames);
+  std::vector<float> right(num_frames);
+  for (size_t i = 0; i < num_frames; i++) {
+    left[i] = (float)std::sin((double)i * 0.03) * 0.5f + noise(rng);
+    right[i] = (float)std::sin((double)i * 0.007) * 0.5f + noise(rng);
+  }
+  std::vector<uint8_t> bytes = encode_ogg_vorbis(left, right);
+  write_bytes(path, bytes);
+
+  // One pass over the whole file
+  std::vector<float> reference[2];
+  OggVorbis_File vf;
+  REQUIRE(ov_fopen(path.string().c_str(), &vf) == 0);
+  REQUIRE(ov_pcm_total(&vf, -1) == (ogg_int64_t)num_frames);
+  int current_bitstream = 0;
+  float** decode_channels = nullptr;
+  long ret;
+  while ((ret = ov_read_float(&vf, &decode_channels, 4096, &current_bitstream)) > 0) {
+    reference[0].insert(reference[0].end(), decode_channels[0], decode_channels[0] + ret);
+    reference[1].insert(reference[1].end(), decode_channels[1], decode_channels[1] + ret);
+  }
+  ov_clear(&vf);
+  REQUIRE(ret == 0);
+  REQUIRE(reference[0].size() == num_frames);
+
+  auto sample =
+      wb::Sample::load_ogg_vorbis_file(path, (const std::byte*)bytes.data(), bytes.size(), test_decode_threads);
+  REQUIRE(sample.has_value());
+  REQUIRE(sample->channels == 2);
+  REQUIRE(sample->count == num_frames);
+
+  uint64_t num_mismatches = 0;
+  for (uint32_t c = 0; c < 2; c++) {
+    const float* samples = sample->get_read_pointer<float>(c);
+    for (size_t i = 0; i < num_frames; i++)
+      num_mismatches += samples[i] != reference[c][i];
+  }
+  REQUIRE(num_mismatches == 0);
+
+  fs::remove_all(temp_dir);
+}
@@ -0,0 +1,118 @@
+#include <chrono>
+#include <thread>
+
+#include "catch_amalgamated.hpp"
+#include "engine/sample_preview.h"
+
+// Stereo ramp, the left channel counts up from 0 and the right channel counts down.
+struct RampDecoder final : public wb::dsp::AudioDecoder {
+  uint64_t position = 0;
+  uint64_t length;
+
+  RampDecoder(uint32_t rate, uint64_t num_frames) : length(num_frames) {
+    format = wb::AudioFormat::F32;
+    channels = 2;
+    sample_rate = rate;
+  }
+
+  bool open(const char* file) override {
+    return true;
+  }
+
+  void close() override {
+  }
+
+  bool seek(uint64_t frame) override {
+    position = frame;
+    return frame <= length;
+  }
+
+  size_t read_i16(int16_t* data, uint32_t n_channels, uint32_t num_frames) override {
+    return 0;
+  }
+
+  size_t read_i32(int32_t* data, uint32_t n_channels, uint32_t num_frames) override {
+    return 0;
+  }
+
+  size_t read_f32(float* data, uint32_t n_channels, uint32_t num_frames) override {
+    // Return short reads like compressed decoders do
+    uint64_t count = std::min({ (uint64_t)num_frames, length - position, (uint64_t)1000 });
+    for (uint64_t i = 0; i < count; i++) {
+      data[i * 2] = (float)(position + i);
+      data[i * 2 + 1] = -(float)(position + i);
+    }
+    position += count;
+    return count;
+  }
+};
+
+static void wait_for_stream(wb::SamplePreviewPlayer& player) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!player.voice->end_of_stream.load() && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  REQUIRE(player.voice->end_of_stream.load());
+}
+
+TEST_CASE("Sample preview") {
+  static constexpr uint32_t block_size = 512;
+  wb::SamplePreviewPlayer player;
+  wb::AudioBuffer<float> buffer(block_size, 2);
+
+  SECTION("Streams past the head") {
+    static constexpr uint64_t length = 40000;
+    REQUIRE(player.play("ramp.wav", std::make_unique<RampDecoder>(48000, length)));
+    REQUIRE(!player.voice->head->complete);
+    REQUIRE(player.voice->head->num_frames == wb::SamplePreviewPlayer::head_frames);
+    wait_for_stream(player);
+
+    uint64_t frame = 0;
+    bool continuous = true;
+    while (frame + block_size <= length - 1) {
+      buffer.clear();
+      player.process(buffer, 48000.0);
+      for (uint32_t i = 0; i < block_size; i++, frame++)
+        continuous = continuous && buffer.channel_buffers[0][i] == (float)frame &&
+                     buffer.channel_buffers[1][i] == -(float)frame;
+    }
+    REQUIRE(continuous);
+    REQUIRE(player.is_playing());
+
+    buffer.clear();
+    player.process(buffer, 48000.0);
+    REQUIRE(!player.is_playing());
+  }
+
+  SECTION("Resamples to the device rate") {
+    REQUIRE(player.play("ramp_24k.wav", std::make_unique<RampDecoder>(24000, 8000)));
+    REQUIRE(player.voice->head->complete);
+    buffer.clear();
+    player.process(buffer, 48000.0);
+    for (uint32_t i = 0; i < block_size; i++)
+      REQUIRE(buffer.channel_buffers[0][i] == Catch::Approx(i * 0.5));
+  }
+
+  SECTION("Stop") {
+    REQUIRE(player.play("ramp.wav", std::make_unique<RampDecoder>(48000, 40000)));
+    player.stop();
+    buffer.clear();
+    player.process(buffer, 48000.0);
+    for (uint32_t i = 0; i < block_size; i++)
+      REQUIRE(buffer.channel_buffers[0][i] == 0.0f);
+    REQUIRE(!player.is_playing());
+  }
+
+  SECTION("Head cache") {
+    REQUIRE(player.play("ramp_24k.wav", std::make_unique<RampDecoder>(24000, 8000)));
+    auto head = player.find_head_("ramp_24k.wav", player.voice->head->mtime);
+    REQUIRE(head == player.voice->head);
+    REQUIRE(player.find_head_("missing.wav", 0) == nullptr);
+
+    player.max_head_cache_bytes = 0;
+    REQUIRE(player.play("ramp.wav", std::make_unique<RampDecoder>(48000, 40000)));
+    REQUIRE(player.find_head_("ramp_24k.wav", head->mtime) == nullptr);
+    REQUIRE(player.head_cache.size() == 1);
+  }
+
+  player.shutdown();
+}
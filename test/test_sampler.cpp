@@ -0,0 +1,117 @@
+#include <cmath>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "core/audio_buffer.h"
+#include "dsp/sample_blocks.h"
+#include "dsp/sampler.h"
+
+static int32_t test_signal(uint32_t channel, size_t index, int32_t amplitude) {
+  uint32_t noise = (uint32_t)(index * 2654435761u + channel * 40503u) >> 26;
+  return (int32_t)(std::sin((double)index * (channel + 1) * 0.003) * amplitude) + (int32_t)noise - 32;
+}
+
+static wb::Sample create_test_sample(wb::AudioFormat format, uint32_t channels, size_t count) {
+  wb::Sample sample(format, 48000);
+  sample.name = "test";
+  sample.resize(count + wb::Sample::sample_padding, channels);
+  sample.count = count;
+  for (uint32_t c = 0; c < channels; c++) {
+    for (size_t i = 0; i < count + wb::Sample::sample_padding; i++) {
+      bool padding = i >= count;
+      if (format == wb::AudioFormat::I16)
+        sample.get_write_pointer<int16_t>(c)[i] = padding ? 0 : (int16_t)test_signal(c, i, 30000);
+      else
+        wb::write_packed_i24(sample.get_write_pointer<std::byte>(c) + i * 3, padding ? 0 : test_signal(c, i, 8000000));
+    }
+  }
+  return sample;
+}
+
+// Stream the whole sample in blocks of block_size frames, at most 512
+static std::vector<float> stream_sample(
+    wb::Sample& sample,
+    wb::dsp::ResamplerType resampler_type,
+    double speed,
+    uint32_t block_size) {
+  auto sampler = std::make_unique<wb::dsp::Sampler>();
+  wb::AudioBuffer<float> buffer(512, 2);
+  std::vector<float> output;
+  if (sample.is_compressed())
+    sampler->allocate_block_cache();
+  sampler->reset_state(resampler_type, 0.0, speed, sample.sample_rate, sample.sample_rate);
+  while (sampler->sample_offset_ < (double)sample.count) {
+    buffer.clear();
+    sampler->stream(&sample, 2, block_size, 0, 1.0f, buffer.channel_buffers);
+    for (uint32_t i = 0; i < block_size; i++) {
+      output.push_back(buffer.channel_buffers[0][i]);
+      output.push_back(buffer.channel_buffers[1][i]);
+    }
+  }
+  return output;
+}
+
+TEST_CASE("Packed 24-bit samples") {
+  static constexpr size_t count = 1001;
+  wb::Sample sample = create_test_sample(wb::AudioFormat::I24, 2, count);
+  REQUIRE(sample.get_memory_size() == count * 2 * 3);
+  REQUIRE(sample.get_unpacked_memory_size() == count * 2 * 4);
+
+  // Odd offsets and lengths go through both the vector and the scalar conversion
+  for (uint32_t offset : { 0u, 3u, 500u }) {
+    auto sampler = std::make_unique<wb::dsp::Sampler>();
+    wb::AudioBuffer<float> buffer(512, 2);
+    buffer.clear();
+    sampler->reset_state(wb::dsp::ResamplerType::Linear, (double)offset, 1.0, 48000.0, 48000.0);
+    sampler->stream(&sample, 2, 497, 0, 1.0f, buffer.channel_buffers);
+    for (uint32_t c = 0; c < 2; c++) {
+      for (uint32_t i = 0; i < 497; i++) {
+        float expected = (float)test_signal(c, offset + i, 8000000) / 8388607.0f;
+        REQUIRE(buffer.channel_buffers[c][i] == Catch::Approx(expected).margin(1e-6));
+      }
+    }
+  }
+}
+
+TEST_CASE("Compressed samples") {
+  static constexpr size_t count = wb::SampleBlocks::block_frames * 5 + 123;
+
+  for (auto format : { wb::AudioFormat::I16, wb::AudioFormat::I24 }) {
+    wb::Sample plain = create_test_sample(format, 2, count);
+    wb::Sample compressed = create_test_sample(format, 2, count);
+    REQUIRE(compressed.compress());
+    REQUIRE(compressed.is_compressed());
+    REQUIRE(compressed.get_memory_size() < plain.get_memory_size());
+
+    // Blocks decode to the original samples
+    std::vector<int32_t> block(wb::SampleBlocks::block_frames);
+    uint64_t num_mismatches = 0;
+    for (uint32_t c = 0; c < 2; c++) {
+      for (uint64_t b = 0; b < compressed.blocks->num_blocks; b++) {
+        compressed.blocks->decode_block(c, b, block.data());
+        for (uint32_t i = 0; i < wb::SampleBlocks::block_frames; i++) {
+          size_t frame = b * wb::SampleBlocks::block_frames + i;
+          int32_t expected = 0;
+          if (frame < count)
+            expected = format == wb::AudioFormat::I16
+                           ? plain.get_read_pointer<int16_t>(c)[frame]
+                           : wb::read_packed_i24(plain.get_read_pointer<std::byte>(c) + frame * 3);
+          num_mismatches += block[i] != expected;
+        }
+      }
+    }
+    REQUIRE(num_mismatches == 0);
+
+    // Streaming through the block cache matches the plain sample
+    for (auto resampler_type : { wb::dsp::ResamplerType::Nearest, wb::dsp::ResamplerType::Linear }) {
+      for (double speed : { 1.0, 1.5, 0.75 }) {
+        std::vector<float> expected = stream_sample(plain, resampler_type, speed, 333);
+        std::vector<float> output = stream_sample(compressed, resampler_type, speed, 333);
+        REQUIRE(output.size() == expected.size());
+        for (size_t i = 0; i < output.size(); i++)
+          num_mismatches += std::abs(output[i] - expected[i]) > 1e-5f;
+        REQUIRE(num_mismatches == 0);
+      }
+    }
+  }
+}
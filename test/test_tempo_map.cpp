@@ -0,0 +1,106 @@
+#include <limits>
+
+#include "catch_amalgamated.hpp"
+#include "engine/tempo_map.h"
+
+// Reference time of a beat, integrating 60 / bpm in small steps
+static double integrate_time(const wb::TempoMap& map, double beat) {
+  static constexpr uint32_t steps_per_beat = 4096;
+  double time = 0.0;
+  double step = 1.0 / steps_per_beat;
+  for (double b = 0.0; b < beat; b += step)
+    time += 60.0 / map.get_bpm_at(b + step * 0.5) * std::min(step, beat - b);
+  return time;
+}
+
+TEST_CASE("Tempo map") {
+  wb::TempoMap map;
+
+  SECTION("Constant tempo") {
+    map.set_initial_tempo(150.0);
+    REQUIRE(map.beat_to_time(10.0) == Catch::Approx(4.0));
+    REQUIRE(map.time_to_beat(4.0) == Catch::Approx(10.0));
+    REQUIRE(map.beat_to_samples(1.0, 48000.0) == Catch::Approx(19200.0));
+    REQUIRE(map.samples_to_beat(19200.0, 48000.0) == Catch::Approx(1.0));
+  }
+
+  SECTION("Tempo changes") {
+    map.add_tempo_point(8.0, 60.0);
+    map.add_tempo_point(4.0, 240.0);
+    REQUIRE(map.tempo_points.size() == 3);
+    REQUIRE(map.tempo_points[1].beat == 4.0);
+    REQUIRE(map.segments[2].start_time == Catch::Approx(2.0 + 1.0));
+    REQUIRE(map.beat_to_time(10.0) == Catch::Approx(3.0 + 2.0));
+    REQUIRE(map.time_to_beat(5.0) == Catch::Approx(10.0));
+    REQUIRE(map.get_bpm_at(5.0) == 240.0);
+
+    map.remove_tempo_point(1);
+    REQUIRE(map.beat_to_time(10.0) == Catch::Approx(4.0 + 2.0));
+  }
+
+  SECTION("Invalid tempo") {
+    REQUIRE(!map.add_tempo_point(4.0, 0.0));
+    REQUIRE(!map.add_tempo_point(4.0, -60.0));
+    REQUIRE(!map.add_tempo_point(4.0, std::nan("")));
+    REQUIRE(!map.add_tempo_point(std::numeric_limits<double>::infinity(), 60.0));
+    REQUIRE(!map.set_initial_tempo(std::numeric_limits<double>::infinity()));
+    REQUIRE(map.tempo_points.size() == 1);
+    REQUIRE(map.get_initial_bpm() == wb::TempoMap::default_bpm);
+
+    REQUIRE(map.add_tempo_point(4.0, 1e6));
+    REQUIRE(map.get_bpm_at(4.0) == wb::TempoMap::max_bpm);
+    REQUIRE(map.set_initial_tempo(1e-3));
+    REQUIRE(map.get_initial_bpm() == wb::TempoMap::min_bpm);
+  }
+
+  SECTION("Invalid time signature") {
+    REQUIRE(!map.add_time_signature(2, 0, 4));
+    REQUIRE(!map.add_time_signature(2, 3, 0));
+    REQUIRE(map.time_signatures.size() == 1);
+  }
+
+  SECTION("Tempo ramp") {
+    map.add_tempo_point(0.0, 100.0, true);
+    map.add_tempo_point(16.0, 180.0);
+    REQUIRE(map.get_bpm_at(8.0) == Catch::Approx(140.0));
+    for (double beat : { 1.0, 7.5, 16.0, 20.0 }) {
+      double time = map.beat_to_time(beat);
+      REQUIRE(time == Catch::Approx(integrate_time(map, beat)).epsilon(1e-6));
+      REQUIRE(map.time_to_beat(time) == Catch::Approx(beat).epsilon(1e-12));
+    }
+  }
+
+  SECTION("Cursor") {
+    map.add_tempo_point(2.0, 90.0, true);
+    map.add_tempo_point(4.0, 200.0);
+    map.add_tempo_point(6.0, 70.0);
+    wb::TempoCursor cursor;
+    cursor.begin_block(&map, 0.0, 44100.0);
+    for (double beat = -1.0; beat < 10.0; beat += 0.01)
+      REQUIRE(cursor.beat_to_time(beat) == map.beat_to_time(beat));
+    for (double beat = 10.0; beat > -1.0; beat -= 0.37)
+      REQUIRE(cursor.beat_to_time(beat) == map.beat_to_time(beat));
+    for (double time = 0.0; time < 5.0; time += 0.01)
+      REQUIRE(cursor.time_to_beat(time) == map.time_to_beat(time));
+
+    cursor.begin_block(&map, 3.0, 44100.0);
+    REQUIRE(cursor.samples_from_start(3.0) == 0.0);
+    REQUIRE(cursor.samples_from_start(5.0) == Catch::Approx((map.beat_to_time(5.0) - map.beat_to_time(3.0)) * 44100.0));
+    REQUIRE(cursor.get_bpm_at(3.0) == Catch::Approx(145.0));
+  }
+
+  SECTION("Time signatures") {
+    map.add_time_signature(2, 3, 4);
+    map.add_time_signature(4, 7, 8);
+    REQUIRE(map.bar_to_beat(2) == 8.0);
+    REQUIRE(map.bar_to_beat(4) == 14.0);
+    REQUIRE(map.bar_to_beat(5) == 17.5);
+
+    wb::BarPosition pos = map.beat_to_bar(12.5);
+    REQUIRE(pos.bar == 3);
+    REQUIRE(pos.beat == 1.5);
+    pos = map.beat_to_bar(18.0);
+    REQUIRE(pos.bar == 5);
+    REQUIRE(pos.beat == 0.5);
+  }
+}
@@ -0,0 +1,109 @@
+#include <random>
+
+#include "catch_amalgamated.hpp"
+#include "engine/track.h"
+
+static wb::Clip* add_clip(wb::Track& track, double min_time, double max_time) {
+  wb::Clip* clip = track.allocate_clip();
+  new (clip) wb::Clip("", {}, min_time, max_time);
+  track.clips.push_back(clip);
+  return clip;
+}
+
+static void check_clip_ordering(const wb::Track& track) {
+  for (uint32_t i = 0; i < track.clips.size(); i++) {
+    REQUIRE(track.clips[i]->id == i);
+    if (i > 0)
+      REQUIRE(track.clips[i - 1]->min_time <= track.clips[i]->min_time);
+  }
+}
+
+TEST_CASE("Track clip ordering") {
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<double> pos_dist(0.0, 1024.0);
+  wb::Track track;
+  for (uint32_t i = 0; i < 256; i++)
+    add_clip(track, (double)i * 4.0, (double)i * 4.0 + 2.0);
+  track.update_clip_ordering();
+  check_clip_ordering(track);
+
+  SECTION("Move clips") {
+    std::uniform_int_distribution<uint32_t> id_dist(0, 255);
+    for (uint32_t i = 0; i < 100; i++) {
+      wb::Clip* clip = track.clips[id_dist(rng)];
+      clip->min_time = pos_dist(rng);
+      clip->max_time = clip->min_time + 1.0;
+      track.update_clip_ordering();
+      check_clip_ordering(track);
+    }
+  }
+
+  SECTION("Delete clips") {
+    for (uint32_t i = 0; i < 256; i += 3)
+      track.mark_clip_deleted(track.clips[i]);
+    wb::Clip* clip = add_clip(track, 1.5, 1.75);
+    track.update_clip_ordering();
+    REQUIRE(track.clips.size() == 171);
+    REQUIRE(track.clips[0] == clip);
+    check_clip_ordering(track);
+  }
+
+  SECTION("Insert clips") {
+    for (uint32_t i = 0; i < 100; i++) {
+      wb::Clip* clip = track.allocate_clip();
+      double min_time = pos_dist(rng);
+      new (clip) wb::Clip("", {}, min_time, min_time + 0.5);
+      track.insert_clip(clip);
+      check_clip_ordering(track);
+    }
+  }
+}
+
+TEST_CASE("Track playback table") {
+  wb::Track track;
+  for (uint32_t i = 0; i < 64; i++)
+    add_clip(track, (double)(63 - i) * 2.0, (double)(63 - i) * 2.0 + 1.0);
+  track.update_clip_ordering();
+  track.reset_playback_state(0.0, true);
+  REQUIRE(track.playback_table_dirty);
+
+  track.update_playback_table();
+  const wb::ClipPlaybackTable& table = track.playback_table;
+  REQUIRE(table.size() == 64);
+  for (uint32_t i = 0; i < table.size(); i++) {
+    REQUIRE(table.clip[i] == track.clips[i]);
+    REQUIRE(table.min_time[i] == track.clips[i]->min_time);
+    REQUIRE(table.max_time[i] == track.clips[i]->max_time);
+    REQUIRE(table.sample[i] == nullptr);
+  }
+}
+
+TEST_CASE("Track song length") {
+  wb::SongLength song_length;
+  wb::Track first;
+  wb::Track second;
+  first.set_song_length(&song_length);
+  second.set_song_length(&song_length);
+  REQUIRE(song_length.length == wb::SongLength::empty_track_length);
+
+  add_clip(first, 0.0, 100.0);
+  first.update_clip_ordering();
+  wb::Clip* clip = add_clip(second, 10.0, 120.0);
+  second.update_clip_ordering();
+  REQUIRE(song_length.length == 120.0);
+  REQUIRE(!song_length.dirty);
+
+  // Shortening the longest track needs a rescan of the track ends
+  second.mark_clip_deleted(clip);
+  second.update_clip_ordering();
+  REQUIRE(second.content_end == wb::SongLength::empty_track_length);
+  REQUIRE(song_length.dirty);
+
+  // Shortening any other track does not
+  song_length = { .length = 100.0 };
+  wb::Clip* short_clip = second.allocate_clip();
+  new (short_clip) wb::Clip("", {}, 0.0, 50.0);
+  second.insert_clip(short_clip);
+  REQUIRE(song_length.length == 100.0);
+  REQUIRE(!song_length.dirty);
+}
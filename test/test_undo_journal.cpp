@@ -0,0 +1,90 @@
+#include <filesystem>
+
+#include "catch_amalgamated.hpp"
+#include "core/undo_journal.h"
+
+static uint64_t push_record(wb::UndoJournal& journal, uint32_t value, uint32_t size) {
+  wb::Vector<uint32_t> record;
+  record.resize(size / sizeof(uint32_t), value);
+  return journal.push(record.data(), size);
+}
+
+static bool check_record(wb::UndoJournal& journal, uint64_t id, uint32_t value, uint32_t size) {
+  wb::Vector<std::byte> data;
+  if (!journal.pop(id, data) || data.size() != size)
+    return false;
+  for (uint32_t i = 0; i < size / sizeof(uint32_t); i++) {
+    uint32_t item;
+    std::memcpy(&item, data.data() + i * sizeof(uint32_t), sizeof(uint32_t));
+    if (item != value)
+      return false;
+  }
+  return true;
+}
+
+TEST_CASE("Undo journal") {
+  wb::UndoJournal journal;
+
+  SECTION("Memory only") {
+    journal.init({ .memory_budget = 1024 });
+    wb::Vector<uint64_t> ids;
+    for (uint32_t i = 0; i < 100; i++) {
+      ids.push_back(push_record(journal, i, 100));
+      REQUIRE(journal.memory_used() <= 1024);
+    }
+
+    // Only the last 10 records fit into the arena
+    REQUIRE(journal.num_entries() == 10);
+    REQUIRE(journal.first_id() == ids[90]);
+    for (uint32_t i = 100; i-- > 90;)
+      REQUIRE(check_record(journal, ids[i], i, 100));
+    REQUIRE(journal.num_entries() == 0);
+    REQUIRE(journal.memory_used() == 0);
+  }
+
+  SECTION("Push after pop wraps around the arena") {
+    journal.init({ .memory_budget = 1000 });
+    uint64_t a = push_record(journal, 1, 400);
+    uint64_t b = push_record(journal, 2, 400);
+    REQUIRE(check_record(journal, b, 2, 400));
+    uint64_t c = push_record(journal, 3, 400);
+    uint64_t d = push_record(journal, 4, 400);
+    REQUIRE(journal.first_id() == c);
+    REQUIRE(!check_record(journal, a, 1, 400));
+    REQUIRE(check_record(journal, d, 4, 400));
+    REQUIRE(check_record(journal, c, 3, 400));
+  }
+
+  SECTION("Record larger than the budget") {
+    journal.init({ .memory_budget = 256 });
+    REQUIRE(push_record(journal, 1, 512) == WB_INVALID_JOURNAL_ENTRY);
+  }
+
+  SECTION("Spill to disk") {
+    std::filesystem::path spill_path = std::filesystem::temp_directory_path() / "wb_test_undo_journal.tmp";
+    journal.init({ .memory_budget = 1024, .spill_budget = 4096, .spill_path = spill_path });
+
+    wb::Vector<uint64_t> ids;
+    for (uint32_t i = 0; i < 100; i++) {
+      ids.push_back(push_record(journal, i, 200));
+      REQUIRE(journal.memory_used() <= 1024);
+      REQUIRE(journal.spill_used() <= 4096);
+    }
+
+    // 5 records in memory, 20 records in the spill file
+    REQUIRE(journal.num_entries() == 25);
+    REQUIRE(journal.first_id() == ids[75]);
+    for (uint32_t i = 100; i-- > 90;)
+      REQUIRE(check_record(journal, ids[i], i, 200));
+
+    // Push new records on top of the spilled ones
+    for (uint32_t i = 90; i < 95; i++)
+      ids[i] = push_record(journal, i + 1000, 200);
+    for (uint32_t i = 95; i-- > 90;)
+      REQUIRE(check_record(journal, ids[i], i + 1000, 200));
+    for (uint32_t i = 90; i-- > 75;)
+      REQUIRE(check_record(journal, ids[i], i, 200));
+    REQUIRE(journal.num_entries() == 0);
+    REQUIRE(journal.spill_used() == 0);
+  }
+}
@@ -215,9 +215,9 @@ TEST_CASE("Vector erase") {
     vec.push_back(6);
     vec.push_back(7);
     vec.push_back(8);
-    vec.erase(3);
+    vec.erase_at(3);
     REQUIRE(vec[3] == 5);
-    vec.erase(vec.size() - 1);
+    vec.erase_at(vec.size() - 1);
     REQUIRE(vec[vec.size() - 1] == 7);
   }
 
@@ -228,7 +228,7 @@ TEST_CASE("Vector erase") {
     vec.emplace_back(3);
     vec.emplace_back(4);
     vec.emplace_back(5);
-    vec.erase(2);
+    vec.erase_at(2);
     REQUIRE(vec[2].a == 4);
   }
 }
@@ -310,6 +310,17 @@ TEST_CASE("Vector reserve & resize") {
     REQUIRE(vec.data() != nullptr);
   }
 
+  SECTION("Resize with value") {
+    wb::Vector<int> vec;
+    vec.resize(10, 7);
+    REQUIRE(vec.size() == 10);
+    for (int i = 0; i < 10; i++)
+      REQUIRE(vec[i] == 7);
+    vec.resize(4, 1);
+    REQUIRE(vec.size() == 4);
+    REQUIRE(vec[3] == 7);
+  }
+
   SECTION("Shrink") {
     wb::Vector<TestType2> vec;
     vec.resize(10);